@@ -102,7 +102,29 @@ static err_t linkoutput_fn(struct netif *netif, struct pbuf *p)
     /* if the network driver can accept another packet, we make it happen */
     if (tud_network_can_xmit(p->tot_len))
     {
-      tud_network_xmit(p, 0 /* unused for this example */);
+      /* hand over the pbuf chain by reference, it is freed in tud_network_xmit_done_cb() */
+      tud_network_buf_t bufs[4];
+      uint8_t count = 0;
+
+      for (struct pbuf *q = p; q != NULL && count < TU_ARRAY_SIZE(bufs); q = q->next)
+      {
+        bufs[count].data = q->payload;
+        bufs[count].len  = q->len;
+        count++;
+      }
+
+      if (count == pbuf_clen(p))
+      {
+        pbuf_ref(p);
+        /* on failure the frame is dropped, its reference is released by tud_network_xmit_done_cb() */
+        if (!tud_network_xmit_bufs(bufs, count, p))
+          return ERR_BUF;
+      }
+      else
+      {
+        /* chain too long, copy it with tud_network_xmit_cb() */
+        tud_network_xmit(p, 0 /* unused for this example */);
+      }
       return ERR_OK;
     }
 
@@ -200,6 +222,11 @@ uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg)
   return pbuf_copy_partial(p, dst, p->tot_len, 0);
 }
 
+void tud_network_xmit_done_cb(void *ref)
+{
+  pbuf_free((struct pbuf *)ref);
+}
+
 static void service_traffic(void)
 {
   /* handle any packet received by tud_network_recv_cb() */
@@ -30,6 +30,9 @@
 #include "ff.h"
 #include "diskio.h"
 
+// lib/storage: cached block layer and FatFs diskio for MSC host
+#include "msc_blk.h"
+
 // lib/embedded-cli
 #define EMBEDDED_CLI_IMPL
 #include "embedded_cli.h"
@@ -51,7 +54,6 @@ static CLI_UINT cli_buffer[BYTES_TO_CLI_UINTS(CLI_BUFFER_SIZE)];
 
 //------------- Elm Chan FatFS -------------//
 static FATFS fatfs[CFG_TUH_DEVICE_MAX]; // for simplicity only support 1 LUN per device
-static volatile bool _disk_busy[CFG_TUH_DEVICE_MAX];
 
 static scsi_inquiry_resp_t inquiry_resp;
 
@@ -63,7 +65,7 @@ bool cli_init(void);
 
 bool msc_app_init(void)
 {
-  for(size_t i=0; i<CFG_TUH_DEVICE_MAX; i++) _disk_busy[i] = false;
+  msc_blk_init();
 
   // disable stdout buffered for echoing typing command
   #ifndef __ICCARM__ // TODO IAR doesn't support stream control ?
@@ -158,6 +160,7 @@ void tuh_msc_umount_cb(uint8_t dev_addr)
   drive_path[0] += drive_num;
 
   f_unmount(drive_path);
+  msc_blk_detach(dev_addr);
 
 //  if ( phy_disk == f_get_current_drive() )
 //  { // active drive is unplugged --> change to other drive
@@ -172,112 +175,6 @@ void tuh_msc_umount_cb(uint8_t dev_addr)
 //  }
 }
 
-//--------------------------------------------------------------------+
-// DiskIO
-//--------------------------------------------------------------------+
-
-static void wait_for_disk_io(BYTE pdrv)
-{
-  while(_disk_busy[pdrv])
-  {
-    tuh_task();
-  }
-}
-
-static bool disk_io_complete(uint8_t dev_addr, tuh_msc_complete_data_t const * cb_data)
-{
-  (void) dev_addr; (void) cb_data;
-  _disk_busy[dev_addr-1] = false;
-  return true;
-}
-
-DSTATUS disk_status (
-	BYTE pdrv		/* Physical drive nmuber to identify the drive */
-)
-{
-  uint8_t dev_addr = pdrv + 1;
-  return tuh_msc_mounted(dev_addr) ? 0 : STA_NODISK;
-}
-
-DSTATUS disk_initialize (
-	BYTE pdrv				/* Physical drive nmuber to identify the drive */
-)
-{
-  (void) pdrv;
-	return 0; // nothing to do
-}
-
-DRESULT disk_read (
-	BYTE pdrv,		/* Physical drive nmuber to identify the drive */
-	BYTE *buff,		/* Data buffer to store read data */
-	LBA_t sector,	/* Start sector in LBA */
-	UINT count		/* Number of sectors to read */
-)
-{
-	uint8_t const dev_addr = pdrv + 1;
-	uint8_t const lun = 0;
-
-	_disk_busy[pdrv] = true;
-	tuh_msc_read10(dev_addr, lun, buff, sector, (uint16_t) count, disk_io_complete, 0);
-	wait_for_disk_io(pdrv);
-
-	return RES_OK;
-}
-
-#if FF_FS_READONLY == 0
-
-DRESULT disk_write (
-	BYTE pdrv,			/* Physical drive nmuber to identify the drive */
-	const BYTE *buff,	/* Data to be written */
-	LBA_t sector,		/* Start sector in LBA */
-	UINT count			/* Number of sectors to write */
-)
-{
-	uint8_t const dev_addr = pdrv + 1;
-	uint8_t const lun = 0;
-
-	_disk_busy[pdrv] = true;
-	tuh_msc_write10(dev_addr, lun, buff, sector, (uint16_t) count, disk_io_complete, 0);
-	wait_for_disk_io(pdrv);
-
-	return RES_OK;
-}
-
-#endif
-
-DRESULT disk_ioctl (
-	BYTE pdrv,		/* Physical drive nmuber (0..) */
-	BYTE cmd,		/* Control code */
-	void *buff		/* Buffer to send/receive control data */
-)
-{
-  uint8_t const dev_addr = pdrv + 1;
-  uint8_t const lun = 0;
-  switch ( cmd )
-  {
-    case CTRL_SYNC:
-      // nothing to do since we do blocking
-      return RES_OK;
-
-    case GET_SECTOR_COUNT:
-      *((DWORD*) buff) = (WORD) tuh_msc_get_block_count(dev_addr, lun);
-      return RES_OK;
-
-    case GET_SECTOR_SIZE:
-      *((WORD*) buff) = (WORD) tuh_msc_get_block_size(dev_addr, lun);
-      return RES_OK;
-
-    case GET_BLOCK_SIZE:
-      *((DWORD*) buff) = 1;    // erase block size in units of sector size
-      return RES_OK;
-
-    default:
-      return RES_PARERR;
-  }
-
-	return RES_OK;
-}
-
 //--------------------------------------------------------------------+
 // CLI Commands
 //--------------------------------------------------------------------+
@@ -92,9 +92,12 @@ target_sources(tinyusb_host_base INTERFACE
 		${TOP}/src/portable/raspberrypi/rp2040/rp2040_usb.c
 		${TOP}/src/host/usbh.c
 		${TOP}/src/host/hub.c
+		${TOP}/src/class/audio/audio_host.c
 		${TOP}/src/class/cdc/cdc_host.c
 		${TOP}/src/class/hid/hid_host.c
+		${TOP}/src/class/midi/midi_host.c
 		${TOP}/src/class/msc/msc_host.c
+		${TOP}/src/class/net/ncm_host.c
 		${TOP}/src/class/vendor/vendor_host.c
 		)
 
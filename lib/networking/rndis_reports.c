@@ -253,8 +253,8 @@ void rndis_class_set_handler(uint8_t *data, int size)
         m->Status = RNDIS_STATUS_SUCCESS;
         m->DeviceFlags = RNDIS_DF_CONNECTIONLESS;
         m->Medium = RNDIS_MEDIUM_802_3;
-        m->MaxPacketsPerTransfer = 1;
-        m->MaxTransferSize = CFG_TUD_NET_MTU + sizeof(rndis_data_packet_t);
+        m->MaxPacketsPerTransfer = CFG_TUD_NET_RNDIS_PACKETS_PER_XFER;
+        m->MaxTransferSize = CFG_TUD_NET_RNDIS_PACKETS_PER_XFER * (CFG_TUD_NET_MTU + sizeof(rndis_data_packet_t));
         m->PacketAlignmentFactor = 0;
         m->AfListOffset = 0;
         m->AfListSize = 0;
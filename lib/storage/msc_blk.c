@@ -0,0 +1,464 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb.h"
+
+#if CFG_TUH_ENABLED && CFG_TUH_MSC
+
+#include "msc_blk.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+TU_VERIFY_STATIC(CFG_MSC_BLK_LINE_SECTORS > 0 && CFG_MSC_BLK_LINE_SECTORS <= 32, "line sectors must be 1-32");
+TU_VERIFY_STATIC(CFG_MSC_BLK_CACHE_LINES > 0 && CFG_MSC_BLK_CACHE_LINES < 256, "cache lines must be 1-255");
+
+#define LINE_SECTORS     CFG_MSC_BLK_LINE_SECTORS
+#define LINE_SIZE        (CFG_MSC_BLK_LINE_SECTORS * CFG_MSC_BLK_SECTOR_SIZE)
+
+// encode cache line transfer into MSC callback argument
+#define LINE_ARG(_idx, _start, _count)  ((uintptr_t) (_idx) | ((uintptr_t) (_start) << 8) | ((uintptr_t) (_count) << 16))
+
+enum {
+  DIRECT_PENDING = 0,
+  DIRECT_PASSED,
+  DIRECT_FAILED
+};
+
+typedef struct {
+  uint8_t daddr; // 0 if line is not used
+  uint8_t lun;
+  volatile uint8_t pending; // number of commands in flight
+
+  uint64_t lba; // first sector, aligned to LINE_SECTORS
+  uint32_t valid_mask;
+  uint32_t dirty_mask;
+  uint32_t last_used;
+} blk_line_t;
+
+typedef struct {
+  uint64_t next_lba; // sector after the last read, for sequential detection
+  volatile bool error; // asynchronous write-behind/read-ahead failed
+} blk_drive_t;
+
+static blk_line_t _lines[CFG_MSC_BLK_CACHE_LINES];
+static blk_drive_t _drives[CFG_TUH_DEVICE_MAX];
+static uint32_t _use_count;
+
+CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN
+static uint8_t _line_buf[CFG_MSC_BLK_CACHE_LINES][LINE_SIZE];
+
+TU_ATTR_ALWAYS_INLINE static inline uint32_t sector_mask(uint32_t start, uint32_t count) {
+  return count ? (UINT32_MAX >> (32 - count)) << start : 0;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t line_index(blk_line_t const* line) {
+  return (uint8_t) (line - _lines);
+}
+
+// number of sectors of line that are within device capacity
+static uint32_t line_sector_count(blk_line_t const* line) {
+  uint64_t const block_count = tuh_msc_get_block_count64(line->daddr, line->lun);
+  if (line->lba >= block_count) return 0;
+  return (block_count - line->lba < LINE_SECTORS) ? (uint32_t) (block_count - line->lba) : LINE_SECTORS;
+}
+
+static bool is_cacheable(uint8_t daddr, uint8_t lun) {
+  return tuh_msc_get_block_size(daddr, lun) == CFG_MSC_BLK_SECTOR_SIZE;
+}
+
+//--------------------------------------------------------------------+
+// Command submission
+//--------------------------------------------------------------------+
+static bool blk_submit(uint8_t daddr, uint8_t lun, bool is_read, void* buffer, uint64_t lba, uint32_t count,
+                       tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  // wait for a free slot in the command queue
+  while (!tuh_msc_ready(daddr)) {
+    TU_VERIFY(tuh_msc_mounted(daddr));
+    MSC_BLK_TASK_HOOK();
+  }
+
+  // prefer 10-byte commands, 16-byte ones are optional for small devices
+  if (lba + count <= ((uint64_t) UINT32_MAX + 1) && count <= UINT16_MAX) {
+    return is_read ? tuh_msc_read10(daddr, lun, buffer, (uint32_t) lba, (uint16_t) count, complete_cb, arg) :
+                     tuh_msc_write10(daddr, lun, buffer, (uint32_t) lba, (uint16_t) count, complete_cb, arg);
+  } else {
+    return is_read ? tuh_msc_read16(daddr, lun, buffer, lba, count, complete_cb, arg) :
+                     tuh_msc_write16(daddr, lun, buffer, lba, count, complete_cb, arg);
+  }
+}
+
+static bool direct_complete(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  (void) daddr;
+  volatile uint8_t* status = (volatile uint8_t*) cb_data->user_arg;
+  *status = (cb_data->csw->status == MSC_CSW_STATUS_PASSED) ? DIRECT_PASSED : DIRECT_FAILED;
+  return true;
+}
+
+// blocking transfer between device and application buffer
+static bool direct_xfer(uint8_t daddr, uint8_t lun, bool is_read, void* buffer, uint64_t lba, uint32_t count) {
+  volatile uint8_t status = DIRECT_PENDING;
+  TU_VERIFY(blk_submit(daddr, lun, is_read, buffer, lba, count, direct_complete, (uintptr_t) &status));
+
+  while (status == DIRECT_PENDING) {
+    TU_VERIFY(tuh_msc_mounted(daddr));
+    MSC_BLK_TASK_HOOK();
+  }
+
+  return status == DIRECT_PASSED;
+}
+
+//--------------------------------------------------------------------+
+// Cache line
+//--------------------------------------------------------------------+
+static bool line_read_complete(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  uintptr_t const arg = cb_data->user_arg;
+  blk_line_t* line = &_lines[arg & 0xff];
+  if (line->daddr != daddr || !line->pending) return true; // detached
+
+  if (cb_data->csw->status == MSC_CSW_STATUS_PASSED) {
+    line->valid_mask |= sector_mask((arg >> 8) & 0xff, (arg >> 16) & 0xff);
+  } else {
+    _drives[daddr - 1].error = true;
+  }
+
+  line->pending--;
+  return true;
+}
+
+static bool line_write_complete(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  uintptr_t const arg = cb_data->user_arg;
+  blk_line_t* line = &_lines[arg & 0xff];
+  if (line->daddr != daddr || !line->pending) return true; // detached
+
+  // on failure sectors stay dirty: they are written again by the next flush, error is reported by msc_blk_sync()
+  if (cb_data->csw->status == MSC_CSW_STATUS_PASSED) {
+    line->dirty_mask &= ~sector_mask((arg >> 8) & 0xff, (arg >> 16) & 0xff);
+  } else {
+    _drives[daddr - 1].error = true;
+  }
+
+  line->pending--;
+  return true;
+}
+
+// wait for all commands of line to complete, return false if line is detached meanwhile
+static bool line_wait(blk_line_t* line) {
+  uint8_t const daddr = line->daddr;
+  while (line->pending) {
+    TU_VERIFY(tuh_msc_mounted(daddr));
+    MSC_BLK_TASK_HOOK();
+  }
+  return daddr && line->daddr == daddr;
+}
+
+// start writing dirty sectors, one command per contiguous run. Line must be idle
+static bool line_flush(blk_line_t* line) {
+  uint32_t const dirty = line->dirty_mask;
+  uint32_t i = 0;
+
+  while (i < LINE_SECTORS) {
+    if (!(dirty & TU_BIT(i))) {
+      i++;
+      continue;
+    }
+
+    uint32_t const start = i;
+    while (i < LINE_SECTORS && (dirty & TU_BIT(i))) i++;
+
+    line->pending++;
+    if (!blk_submit(line->daddr, line->lun, false, &_line_buf[line_index(line)][start * CFG_MSC_BLK_SECTOR_SIZE],
+                    line->lba + start, i - start, line_write_complete, LINE_ARG(line_index(line), start, i - start))) {
+      line->pending--;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// start reading the whole line. Line must be idle and clean
+static bool line_fill(blk_line_t* line) {
+  uint32_t const count = line_sector_count(line);
+  TU_VERIFY(count);
+
+  line->pending++;
+  if (!blk_submit(line->daddr, line->lun, true, _line_buf[line_index(line)], line->lba, count,
+                  line_read_complete, LINE_ARG(line_index(line), 0, count))) {
+    line->pending--;
+    return false;
+  }
+
+  return true;
+}
+
+static blk_line_t* line_find(uint8_t daddr, uint8_t lun, uint64_t line_lba) {
+  for (uint8_t i = 0; i < CFG_MSC_BLK_CACHE_LINES; i++) {
+    blk_line_t* line = &_lines[i];
+    if (line->daddr == daddr && line->lun == lun && line->lba == line_lba) return line;
+  }
+  return NULL;
+}
+
+// Check if line caches any sector of [lba, lba + count)
+static bool line_overlaps(blk_line_t const* line, uint8_t daddr, uint8_t lun, uint64_t lba, uint32_t count) {
+  return line->daddr == daddr && line->lun == lun && line->lba < lba + count && lba < line->lba + LINE_SECTORS;
+}
+
+// Allocate a line by evicting the least recently used one. If may_block is false, only idle and clean lines are
+// considered and NULL is returned if there is none.
+static blk_line_t* line_alloc(uint8_t daddr, uint8_t lun, uint64_t line_lba, bool may_block) {
+  blk_line_t* victim = NULL;
+
+  for (uint8_t i = 0; i < CFG_MSC_BLK_CACHE_LINES; i++) {
+    blk_line_t* line = &_lines[i];
+
+    if (!line->daddr) {
+      victim = line;
+      break;
+    }
+
+    if (!may_block && (line->pending || line->dirty_mask)) continue;
+    if (!victim || (line->last_used < victim->last_used)) victim = line;
+  }
+  TU_VERIFY(victim, NULL);
+
+  if (victim->daddr) {
+    TU_VERIFY(line_wait(victim), NULL);
+    if (victim->dirty_mask) {
+      // dirty sectors that could not be written are kept rather than dropped
+      TU_VERIFY(line_flush(victim) && line_wait(victim) && !victim->dirty_mask, NULL);
+    }
+  }
+
+  victim->daddr      = daddr;
+  victim->lun        = lun;
+  victim->lba        = line_lba;
+  victim->valid_mask = 0;
+  victim->dirty_mask = 0;
+  victim->last_used  = ++_use_count;
+
+  return victim;
+}
+
+// write back and wait for dirty lines of a device overlapping [lba, lba+count), count = 0 for whole device
+static bool range_flush(uint8_t daddr, uint8_t lun, uint64_t lba, uint32_t count) {
+  bool ret = true;
+
+  for (uint8_t i = 0; i < CFG_MSC_BLK_CACHE_LINES; i++) {
+    blk_line_t* line = &_lines[i];
+    if (line->daddr != daddr || line->lun != lun) continue;
+    if (count && (line->lba >= lba + count || line->lba + LINE_SECTORS <= lba)) continue;
+
+    if (line->dirty_mask) {
+      // issue writes of all lines first, then wait for all of them
+      ret = line_wait(line) && line_flush(line) && ret;
+    }
+  }
+
+  for (uint8_t i = 0; i < CFG_MSC_BLK_CACHE_LINES; i++) {
+    blk_line_t* line = &_lines[i];
+    if (line->daddr != daddr || line->lun != lun) continue;
+    ret = line_wait(line) && ret;
+  }
+
+  return ret;
+}
+
+// prefetch lines following lba
+static void read_ahead(uint8_t daddr, uint8_t lun, uint64_t lba) {
+  uint64_t line_lba = lba - (lba % LINE_SECTORS);
+  uint64_t const block_count = tuh_msc_get_block_count64(daddr, lun);
+
+  // line containing lba (if not cached) plus CFG_MSC_BLK_READ_AHEAD lines after it
+  for (uint8_t i = 0; i <= CFG_MSC_BLK_READ_AHEAD; i++, line_lba += LINE_SECTORS) {
+    if (line_lba >= block_count) break;
+    if (line_find(daddr, lun, line_lba)) continue;
+
+    // never block for read-ahead: skip it if the command queue is full
+    if (!tuh_msc_ready(daddr)) break;
+    blk_line_t* line = line_alloc(daddr, lun, line_lba, false);
+    if (!line || !line_fill(line)) break;
+  }
+}
+
+//--------------------------------------------------------------------+
+// API
+//--------------------------------------------------------------------+
+void msc_blk_init(void) {
+  tu_memclr(_lines, sizeof(_lines));
+  tu_memclr(_drives, sizeof(_drives));
+  _use_count = 0;
+}
+
+bool msc_blk_read(uint8_t daddr, uint8_t lun, void* buffer, uint64_t lba, uint32_t count) {
+  TU_VERIFY(daddr && daddr <= CFG_TUH_DEVICE_MAX && tuh_msc_mounted(daddr));
+
+  if (!is_cacheable(daddr, lun)) {
+    return direct_xfer(daddr, lun, true, buffer, lba, count);
+  }
+
+  blk_drive_t* drv = &_drives[daddr - 1];
+  bool const sequential = (lba == drv->next_lba);
+  drv->next_lba = lba + count;
+
+  if (count >= LINE_SECTORS) {
+    // large read: bypass cache, but device must have the latest data of overlapped dirty sectors
+    TU_VERIFY(range_flush(daddr, lun, lba, count));
+    TU_VERIFY(direct_xfer(daddr, lun, true, buffer, lba, count));
+  } else {
+    uint8_t* buf = (uint8_t*) buffer;
+
+    while (count) {
+      uint64_t const line_lba = lba - (lba % LINE_SECTORS);
+      uint32_t const offset = (uint32_t) (lba - line_lba);
+      uint32_t const n = tu_min32(count, LINE_SECTORS - offset);
+      uint32_t const mask = sector_mask(offset, n);
+
+      blk_line_t* line = line_find(daddr, lun, line_lba);
+      if (!line) {
+        line = line_alloc(daddr, lun, line_lba, true);
+        TU_VERIFY(line);
+      }
+      TU_VERIFY(line_wait(line)); // read-ahead may be in progress
+
+      if ((line->valid_mask & mask) != mask) {
+        // fill would overwrite dirty sectors, write them back first
+        if (line->dirty_mask) {
+          TU_VERIFY(line_flush(line) && line_wait(line) && !line->dirty_mask);
+        }
+        TU_VERIFY(line_fill(line) && line_wait(line));
+        TU_VERIFY((line->valid_mask & mask) == mask);
+      }
+
+      memcpy(buf, &_line_buf[line_index(line)][offset * CFG_MSC_BLK_SECTOR_SIZE], n * CFG_MSC_BLK_SECTOR_SIZE);
+      line->last_used = ++_use_count;
+
+      buf   += n * CFG_MSC_BLK_SECTOR_SIZE;
+      lba   += n;
+      count -= n;
+    }
+  }
+
+  if (CFG_MSC_BLK_READ_AHEAD && sequential) {
+    read_ahead(daddr, lun, drv->next_lba);
+  }
+
+  return true;
+}
+
+bool msc_blk_write(uint8_t daddr, uint8_t lun, void const* buffer, uint64_t lba, uint32_t count) {
+  TU_VERIFY(daddr && daddr <= CFG_TUH_DEVICE_MAX && tuh_msc_mounted(daddr));
+
+  if (!is_cacheable(daddr, lun)) {
+    return direct_xfer(daddr, lun, false, (void*) (uintptr_t) buffer, lba, count);
+  }
+
+  uint8_t const* buf = (uint8_t const*) buffer;
+
+  if (count >= LINE_SECTORS) {
+    // large write: bypass cache. Overlapped lines finish their pending transfers first so that medium is written in order
+    for (uint8_t i = 0; i < CFG_MSC_BLK_CACHE_LINES; i++) {
+      if (line_overlaps(&_lines[i], daddr, lun, lba, count)) TU_VERIFY(line_wait(&_lines[i]));
+    }
+
+    // overlapped lines are left untouched if the write fails, dirty sectors are still written by next sync
+    TU_VERIFY(direct_xfer(daddr, lun, false, (void*) (uintptr_t) buffer, lba, count));
+
+    // update overlapped cached sectors which are now clean
+    for (uint8_t i = 0; i < CFG_MSC_BLK_CACHE_LINES; i++) {
+      blk_line_t* line = &_lines[i];
+      if (!line_overlaps(line, daddr, lun, lba, count)) continue;
+
+      uint64_t const start = (line->lba > lba) ? line->lba : lba;
+      uint64_t const end = (line->lba + LINE_SECTORS < lba + count) ? (line->lba + LINE_SECTORS) : (lba + count);
+      uint32_t const offset = (uint32_t) (start - line->lba);
+      uint32_t const n = (uint32_t) (end - start);
+
+      memcpy(&_line_buf[i][offset * CFG_MSC_BLK_SECTOR_SIZE], buf + (start - lba) * CFG_MSC_BLK_SECTOR_SIZE,
+             n * CFG_MSC_BLK_SECTOR_SIZE);
+      line->valid_mask |= sector_mask(offset, n);
+      line->dirty_mask &= ~sector_mask(offset, n);
+    }
+
+    return true;
+  }
+
+  while (count) {
+    uint64_t const line_lba = lba - (lba % LINE_SECTORS);
+    uint32_t const offset = (uint32_t) (lba - line_lba);
+    uint32_t const n = tu_min32(count, LINE_SECTORS - offset);
+    uint32_t const mask = sector_mask(offset, n);
+
+    blk_line_t* line = line_find(daddr, lun, line_lba);
+    if (!line) {
+      line = line_alloc(daddr, lun, line_lba, true);
+      TU_VERIFY(line);
+    }
+    TU_VERIFY(line_wait(line));
+
+    memcpy(&_line_buf[line_index(line)][offset * CFG_MSC_BLK_SECTOR_SIZE], buf, n * CFG_MSC_BLK_SECTOR_SIZE);
+    line->valid_mask |= mask;
+    line->dirty_mask |= mask;
+    line->last_used = ++_use_count;
+
+    // write-behind: line is completely filled, start writing it while application prepares next data
+    if (line->dirty_mask == sector_mask(0, line_sector_count(line))) {
+      TU_VERIFY(line_flush(line));
+    }
+
+    buf   += n * CFG_MSC_BLK_SECTOR_SIZE;
+    lba   += n;
+    count -= n;
+  }
+
+  return true;
+}
+
+bool msc_blk_sync(uint8_t daddr, uint8_t lun) {
+  TU_VERIFY(daddr && daddr <= CFG_TUH_DEVICE_MAX);
+
+  bool const ret = range_flush(daddr, lun, 0, 0);
+
+  // report and clear errors of asynchronous transfers
+  blk_drive_t* drv = &_drives[daddr - 1];
+  bool const failed = drv->error;
+  drv->error = false;
+
+  return ret && !failed;
+}
+
+void msc_blk_detach(uint8_t daddr) {
+  TU_VERIFY(daddr && daddr <= CFG_TUH_DEVICE_MAX,);
+
+  for (uint8_t i = 0; i < CFG_MSC_BLK_CACHE_LINES; i++) {
+    if (_lines[i].daddr == daddr) tu_memclr(&_lines[i], sizeof(blk_line_t));
+  }
+
+  tu_memclr(&_drives[daddr - 1], sizeof(blk_drive_t));
+}
+
+#endif
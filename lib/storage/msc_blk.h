@@ -0,0 +1,98 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef MSC_BLK_H_
+#define MSC_BLK_H_
+
+#include "tusb.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Blocking block device layer on top of the MSC host driver with a sector cache.
+// - Small reads/writes are served from cache lines of CFG_MSC_BLK_LINE_SECTORS sectors
+// - Sequential reads trigger asynchronous read-ahead of the next CFG_MSC_BLK_READ_AHEAD lines
+// - Writes are deferred (write-behind): a line is written when it is completely filled, evicted or synced
+// - Requests of at least one line bypass the cache and are issued as a single multi-sector command
+//
+// Blocking calls run tuh_task() (or MSC_BLK_TASK_HOOK) while waiting, they must be called from the
+// same context as tuh_task() and not from MSC callbacks.
+
+//--------------------------------------------------------------------+
+// Configuration
+//--------------------------------------------------------------------+
+
+// Number of cache lines, shared by all devices
+#ifndef CFG_MSC_BLK_CACHE_LINES
+#define CFG_MSC_BLK_CACHE_LINES    4
+#endif
+
+// Number of sectors per cache line, max 32
+#ifndef CFG_MSC_BLK_LINE_SECTORS
+#define CFG_MSC_BLK_LINE_SECTORS   8
+#endif
+
+// Sector size of cached devices, devices with other block size bypass the cache
+#ifndef CFG_MSC_BLK_SECTOR_SIZE
+#define CFG_MSC_BLK_SECTOR_SIZE    512
+#endif
+
+// Number of lines to prefetch when sequential read is detected, 0 to disable read-ahead
+#ifndef CFG_MSC_BLK_READ_AHEAD
+#define CFG_MSC_BLK_READ_AHEAD     1
+#endif
+
+// Executed while waiting for a transfer to complete
+#ifndef MSC_BLK_TASK_HOOK
+#define MSC_BLK_TASK_HOOK()        tuh_task()
+#endif
+
+//--------------------------------------------------------------------+
+// API
+//--------------------------------------------------------------------+
+
+// Initialize cache
+void msc_blk_init(void);
+
+// Read count sectors starting from lba
+bool msc_blk_read(uint8_t daddr, uint8_t lun, void* buffer, uint64_t lba, uint32_t count);
+
+// Write count sectors starting from lba, data may be held in cache until msc_blk_sync()
+bool msc_blk_write(uint8_t daddr, uint8_t lun, void const* buffer, uint64_t lba, uint32_t count);
+
+// Write all dirty cached sectors of a device and wait for completion. Return false if any asynchronous transfer
+// failed since last sync, sectors that could not be written stay dirty and are retried by the next sync
+bool msc_blk_sync(uint8_t daddr, uint8_t lun);
+
+// Drop all cached sectors (including dirty ones) of a device, should be called in tuh_msc_umount_cb()
+void msc_blk_detach(uint8_t daddr);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// FatFs disk I/O layer on top of msc_blk. Physical drive number is (device address - 1), LUN 0 only
+
+#include "tusb.h"
+
+#if CFG_TUH_ENABLED && CFG_TUH_MSC
+
+#include "ff.h"
+#include "diskio.h"
+
+#include "msc_blk.h"
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t pdrv2daddr(BYTE pdrv) {
+  return (uint8_t) (pdrv + 1);
+}
+
+DSTATUS disk_status(BYTE pdrv) {
+  return tuh_msc_mounted(pdrv2daddr(pdrv)) ? 0 : STA_NODISK;
+}
+
+DSTATUS disk_initialize(BYTE pdrv) {
+  return disk_status(pdrv);
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE* buff, LBA_t sector, UINT count) {
+  return msc_blk_read(pdrv2daddr(pdrv), 0, buff, sector, count) ? RES_OK : RES_ERROR;
+}
+
+#if FF_FS_READONLY == 0
+
+DRESULT disk_write(BYTE pdrv, const BYTE* buff, LBA_t sector, UINT count) {
+  return msc_blk_write(pdrv2daddr(pdrv), 0, buff, sector, count) ? RES_OK : RES_ERROR;
+}
+
+#endif
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff) {
+  uint8_t const daddr = pdrv2daddr(pdrv);
+  uint8_t const lun = 0;
+
+  switch (cmd) {
+    case CTRL_SYNC:
+      // write back cached sectors
+      return msc_blk_sync(daddr, lun) ? RES_OK : RES_ERROR;
+
+    case GET_SECTOR_COUNT:
+      *((LBA_t*) buff) = (LBA_t) tuh_msc_get_block_count64(daddr, lun);
+      return RES_OK;
+
+    case GET_SECTOR_SIZE:
+      *((WORD*) buff) = (WORD) tuh_msc_get_block_size(daddr, lun);
+      return RES_OK;
+
+    case GET_BLOCK_SIZE:
+      *((DWORD*) buff) = 1; // erase block size in units of sector size
+      return RES_OK;
+
+    default:
+      return RES_PARERR;
+  }
+}
+
+#endif
@@ -813,6 +813,99 @@ typedef struct TU_ATTR_PACKED
   uint16_t wLockDelay        ; ///< Indicates the time it takes this endpoint to reliably lock its internal clock recovery circuitry. Units used depend on the value of the bLockDelayUnits field.
 } audio_desc_cs_as_iso_data_ep_t;
 
+//--------------------------------------------------------------------+
+// Audio Class 1.0 (UAC1), only what is needed by the host driver
+//--------------------------------------------------------------------+
+
+/// UAC1 A.1.1 - Audio Data Format Type I Codes
+typedef enum
+{
+  AUDIO10_DATA_FORMAT_TYPE_I_UNDEFINED  = 0x0000,
+  AUDIO10_DATA_FORMAT_TYPE_I_PCM        = 0x0001,
+  AUDIO10_DATA_FORMAT_TYPE_I_PCM8       = 0x0002,
+  AUDIO10_DATA_FORMAT_TYPE_I_IEEE_FLOAT = 0x0003,
+  AUDIO10_DATA_FORMAT_TYPE_I_ALAW       = 0x0004,
+  AUDIO10_DATA_FORMAT_TYPE_I_MULAW      = 0x0005,
+} audio10_data_format_type_I_t;
+
+/// UAC1 A.9 - Audio Class-Specific Request Codes
+typedef enum
+{
+  AUDIO10_CS_REQ_UNDEF   = 0x00,
+  AUDIO10_CS_REQ_SET_CUR = 0x01,
+  AUDIO10_CS_REQ_GET_CUR = 0x81,
+  AUDIO10_CS_REQ_SET_MIN = 0x02,
+  AUDIO10_CS_REQ_GET_MIN = 0x82,
+  AUDIO10_CS_REQ_SET_MAX = 0x03,
+  AUDIO10_CS_REQ_GET_MAX = 0x83,
+  AUDIO10_CS_REQ_SET_RES = 0x04,
+  AUDIO10_CS_REQ_GET_RES = 0x84,
+} audio10_cs_req_t;
+
+/// UAC1 A.10.2 - Endpoint Control Selectors
+typedef enum
+{
+  AUDIO10_EP_CTRL_UNDEF         = 0x00,
+  AUDIO10_EP_CTRL_SAMPLING_FREQ = 0x01,
+  AUDIO10_EP_CTRL_PITCH         = 0x02,
+} audio10_ep_control_type_t;
+
+/// UAC1 4.6.1.2 - Class-Specific AS Isochronous Audio Data Endpoint bmAttributes
+typedef enum
+{
+  AUDIO10_CS_AS_ISO_DATA_EP_ATT_SAMPLING_FREQ    = 0x01,
+  AUDIO10_CS_AS_ISO_DATA_EP_ATT_PITCH            = 0x02,
+  AUDIO10_CS_AS_ISO_DATA_EP_ATT_MAX_PACKETS_ONLY = 0x80,
+} audio10_cs_as_iso_data_ep_attribute_t;
+
+/// UAC1 Class-Specific AC Interface Header Descriptor (4.3.2)
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t bLength            ; ///< Size of this descriptor in bytes: 8+n.
+  uint8_t bDescriptorType    ; ///< Descriptor Type. Value: TUSB_DESC_CS_INTERFACE.
+  uint8_t bDescriptorSubType ; ///< Descriptor SubType. Value: AUDIO_CS_AC_INTERFACE_HEADER.
+  uint16_t bcdADC            ; ///< Audio Device Class Specification Release Number in Binary-Coded Decimal. Value: U16_TO_U8S_LE(0x0100).
+  uint16_t wTotalLength      ; ///< Total number of bytes returned for the class-specific AudioControl interface descriptor.
+  uint8_t bInCollection      ; ///< The number of AudioStreaming and MIDIStreaming interfaces in the Audio Interface Collection.
+  uint8_t baInterfaceNr[]    ; ///< Interface numbers of the AudioStreaming and MIDIStreaming interfaces in the Collection.
+} audio10_desc_cs_ac_interface_t;
+
+/// UAC1 Class-Specific AS Interface Descriptor (4.5.2)
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t bLength            ; ///< Size of this descriptor, in bytes: 7.
+  uint8_t bDescriptorType    ; ///< Descriptor Type. Value: TUSB_DESC_CS_INTERFACE.
+  uint8_t bDescriptorSubType ; ///< Descriptor SubType. Value: AUDIO_CS_AS_INTERFACE_AS_GENERAL.
+  uint8_t bTerminalLink      ; ///< The Terminal ID of the Terminal to which the endpoint of this interface is connected.
+  uint8_t bDelay             ; ///< Delay introduced by the data path, in number of frames.
+  uint16_t wFormatTag        ; ///< The Audio Data Format that has to be used to communicate with this interface. See: audio10_data_format_type_I_t.
+} audio10_desc_cs_as_interface_t;
+
+/// UAC1 Type I Format Type Descriptor (Audio Formats 2.2.5)
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t bLength            ; ///< Size of this descriptor, in bytes: 8+(ns*3).
+  uint8_t bDescriptorType    ; ///< Descriptor Type. Value: TUSB_DESC_CS_INTERFACE.
+  uint8_t bDescriptorSubType ; ///< Descriptor SubType. Value: AUDIO_CS_AS_INTERFACE_FORMAT_TYPE.
+  uint8_t bFormatType        ; ///< Value: AUDIO_FORMAT_TYPE_I.
+  uint8_t bNrChannels        ; ///< Number of physical channels in the audio data stream.
+  uint8_t bSubframeSize      ; ///< The number of bytes occupied by one audio subframe. Can be 1, 2, 3 or 4.
+  uint8_t bBitResolution     ; ///< The number of effectively used bits from the available bits in an audio subframe.
+  uint8_t bSamFreqType       ; ///< 0: continuous sampling frequency (lower and upper bound follow), n: number of discrete sampling frequencies.
+  uint8_t tSamFreq[][3]      ; ///< Sampling frequencies in Hz, 3 bytes little endian each.
+} audio10_desc_type_I_format_t;
+
+/// UAC1 Class-Specific AS Isochronous Audio Data Endpoint Descriptor (4.6.1.2)
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t bLength            ; ///< Size of this descriptor, in bytes: 7.
+  uint8_t bDescriptorType    ; ///< Descriptor Type. Value: TUSB_DESC_CS_ENDPOINT.
+  uint8_t bDescriptorSubType ; ///< Descriptor SubType. Value: AUDIO_CS_EP_SUBTYPE_GENERAL.
+  uint8_t bmAttributes       ; ///< See: audio10_cs_as_iso_data_ep_attribute_t.
+  uint8_t bLockDelayUnits    ; ///< Indicates the units used for the wLockDelay field.
+  uint16_t wLockDelay        ; ///< Time it takes this endpoint to reliably lock its internal clock recovery circuitry.
+} audio10_desc_cs_as_iso_data_ep_t;
+
 // 5.2.2 Control Request Layout
 typedef struct TU_ATTR_PACKED
 {
@@ -226,6 +226,17 @@ uint8_t alt_setting_2[CFG_TUD_AUDIO_FUNC_2_N_AS_INT];
 uint8_t alt_setting_3[CFG_TUD_AUDIO_FUNC_3_N_AS_INT];
 #endif
 
+// Offset of AS interfaces (alternate setting zero) from AC interface descriptor, indexed by audiod_open()
+uint16_t as_itf_ofs_1[CFG_TUD_AUDIO_FUNC_1_N_AS_INT];
+
+#if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_N_AS_INT > 0
+uint16_t as_itf_ofs_2[CFG_TUD_AUDIO_FUNC_2_N_AS_INT];
+#endif
+
+#if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_N_AS_INT > 0
+uint16_t as_itf_ofs_3[CFG_TUD_AUDIO_FUNC_3_N_AS_INT];
+#endif
+
 // Software encoding/decoding support FIFOs
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING
   #if CFG_TUD_AUDIO_FUNC_1_TX_SUPP_SW_FIFO_SZ > 0
@@ -286,13 +297,13 @@ typedef struct
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN
   uint8_t ep_in;                // TX audio data EP.
-  uint16_t ep_in_sz;            // Current size of TX EP
+  uint16_t ep_in_sz;            // Current size of TX EP, all transactions of a (micro)frame for high-bandwidth EP
   uint8_t ep_in_as_intf_num;    // Corresponding Standard AS Interface Descriptor (4.9.1) belonging to output terminal to which this EP belongs - 0 is invalid (this fits to UAC2 specification since AS interfaces can not have interface number equal to zero)
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT
   uint8_t ep_out;               // Incoming (into uC) audio data EP.
-  uint16_t ep_out_sz;           // Current size of RX EP
+  uint16_t ep_out_sz;           // Current size of RX EP, all transactions of a (micro)frame for high-bandwidth EP
   uint8_t ep_out_as_intf_num;   // Corresponding Standard AS Interface Descriptor (4.9.1) belonging to input terminal to which this EP belongs - 0 is invalid (this fits to UAC2 specification since AS interfaces can not have interface number equal to zero)
 
 #if CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
@@ -305,6 +316,21 @@ typedef struct
   uint8_t ep_int_ctr;           // Audio control interrupt EP.
 #endif
 
+  // DMA streaming statistics, see tud_audio_n_dma_write_acquire() / tud_audio_n_dma_read_acquire()
+#if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
+  volatile uint32_t dma_in_overrun;   // Blocks not accepted since EP IN FIFO was full
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
+  volatile uint32_t dma_out_underrun; // Blocks not delivered since EP OUT FIFO was empty
+#endif
+
+  // Descriptor index built by audiod_open() - lets control requests be checked without walking the descriptors
+  uint32_t entity_map[8];       // Bit n is set if entity with ID n is defined in the AC interface
+  uint32_t ep_map;              // Bit (dir * 16 + EP number) is set if EP belongs to audio function
+  uint8_t as_itf_first;         // Interface number of first AS interface
+  uint8_t n_as_itf;             // Number of AS interfaces
+
   /*------------- From this point, data is not cleared by bus reset -------------*/
 
   uint16_t desc_length;         // Length of audio function descriptor
@@ -316,6 +342,10 @@ typedef struct
   // Current active alternate settings
   uint8_t * alt_setting;   // We need to save the current alternate setting this way, because it is possible that there are AS interfaces which do not have an EP!
 
+  // AS interface descriptor offsets, see as_itf_ofs_1
+  uint16_t * as_itf_ofs;
+  uint8_t n_as_itf_max;
+
   // EP Transfer buffers and FIFOs
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT
 #if !CFG_TUD_AUDIO_ENABLE_DECODING
@@ -340,12 +370,15 @@ typedef struct
         uint32_t mclk_freq;
       }fixed;
 
-#if 0 // implement later
       struct {
-        uint32_t nominal_value;
-        uint32_t threshold_bytes;
+        uint32_t nominal_value; // feedback at nominal sample rate
+        int32_t level_q8;       // low-pass filtered FIFO level in 1/256 bytes
+        int32_t integral_q8;    // integral term in 1/256 feedback LSB
+        uint32_t kp;
+        uint32_t ki;
+        uint16_t threshold;
+        uint8_t lpf_shift;
       }fifo_count;
-#endif
     }compute;
 
   } feedback;
@@ -373,6 +406,9 @@ typedef struct
   uint8_t n_bytes_per_sampe_rx;
   uint8_t n_channels_per_ff_rx;
   uint8_t n_ff_used_rx;
+#if CFG_TUD_AUDIO_ENABLE_CONVERSION
+  tu_audio_conv_t conv_rx;
+#endif
 #endif
 #endif
 
@@ -393,6 +429,9 @@ typedef struct
   audio_data_format_type_I_t format_type_I_tx;
   uint8_t n_channels_per_ff_tx;
   uint8_t n_ff_used_tx;
+#if CFG_TUD_AUDIO_ENABLE_CONVERSION
+  tu_audio_conv_t conv_tx;
+#endif
 #endif
 #endif
 
@@ -418,6 +457,19 @@ typedef struct
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && (USE_LINEAR_BUFFER || CFG_TUD_AUDIO_ENABLE_ENCODING)
   uint8_t * lin_buf_in;
 #define USE_LINEAR_BUFFER_TX   1
+#endif
+
+  // Multiple isochronous packets per transfer, packets are taken from / put into the EP FIFOs directly by the DCD
+#if CFG_TUD_ISO_PACKETS_PER_XFER > 1 && !USE_LINEAR_BUFFER
+#if CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
+  usbd_iso_xfer_t iso_xfer_out;
+#define USE_ISO_XFER_RX   1
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
+  usbd_iso_xfer_t iso_xfer_in;
+#define USE_ISO_XFER_TX   1
+#endif
 #endif
 
 } audiod_function_t;
@@ -430,6 +482,14 @@ typedef struct
 #define USE_LINEAR_BUFFER_RX   0
 #endif
 
+#ifndef USE_ISO_XFER_TX
+#define USE_ISO_XFER_TX   0
+#endif
+
+#ifndef USE_ISO_XFER_RX
+#define USE_ISO_XFER_RX   0
+#endif
+
 #define ITF_MEM_RESET_SIZE   offsetof(audiod_function_t, ctrl_buf)
 
 //--------------------------------------------------------------------+
@@ -456,6 +516,7 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
 static bool audiod_get_interface(uint8_t rhport, tusb_control_request_t const * p_request);
 static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const * p_request);
 
+static bool audiod_build_desc_index(audiod_function_t* audio);
 static bool audiod_get_AS_interface_index_global(uint8_t itf, uint8_t *func_id, uint8_t *idxItf, uint8_t const **pp_desc_int);
 static bool audiod_get_AS_interface_index(uint8_t itf, audiod_function_t * audio, uint8_t *idxItf, uint8_t const **pp_desc_int);
 static bool audiod_verify_entity_exists(uint8_t itf, uint8_t entityID, uint8_t *func_id);
@@ -477,8 +538,17 @@ static bool audiod_calc_tx_packet_sz(audiod_function_t* audio);
 static uint16_t audiod_tx_packet_size(const uint16_t* norminal_size, uint16_t data_count, uint16_t fifo_depth, uint16_t max_size);
 #endif
 
+#if CFG_TUD_AUDIO_ENABLE_EP_OUT && !USE_LINEAR_BUFFER_RX
+static bool audiod_rx_xfer_fifo(uint8_t rhport, audiod_function_t* audio);
+#endif
+
+#if USE_ISO_XFER_TX
+static uint16_t audiod_tx_iso_xfer_prepare(audiod_function_t* audio);
+#endif
+
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 static bool set_fb_params_freq(audiod_function_t* audio, uint32_t sample_freq, uint32_t mclk_freq);
+static void set_fb_params_fifo_count(audiod_function_t* audio, audio_feedback_params_t const* fb_param, uint32_t frame_div);
 #endif
 
 bool tud_audio_n_mounted(uint8_t func_id)
@@ -535,6 +605,43 @@ tu_fifo_t* tud_audio_n_get_ep_out_ff(uint8_t func_id)
   return NULL;
 }
 
+// Get pointer to the next len bytes of EP OUT FIFO to be read by a DMA, NULL on underrun
+void const* tud_audio_n_dma_read_acquire(uint8_t func_id, uint16_t len)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL, NULL);
+  audiod_function_t* audio = &_audiod_fct[func_id];
+
+  tu_fifo_buffer_info_t info;
+  tu_fifo_get_read_info(&audio->ep_out_ff, &info);
+
+  // Block must be linear in FIFO memory, this is always the case if FIFO depth is a multiple of len
+  if (info.len_lin < len)
+  {
+    audio->dma_out_underrun++;
+    return NULL;
+  }
+
+  return info.ptr_lin;
+}
+
+// Release len bytes of EP OUT FIFO after DMA has read them
+bool tud_audio_n_dma_read_release(uint8_t func_id, uint16_t len)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  tu_fifo_t* ff = &_audiod_fct[func_id].ep_out_ff;
+
+  TU_VERIFY(len <= tu_fifo_count(ff));
+  tu_fifo_advance_read_pointer(ff, len);
+
+  return true;
+}
+
+uint32_t tud_audio_n_dma_out_underrun(uint8_t func_id)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO, 0);
+  return _audiod_fct[func_id].dma_out_underrun;
+}
+
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT
@@ -569,6 +676,25 @@ tu_fifo_t* tud_audio_n_get_rx_support_ff(uint8_t func_id, uint8_t ff_idx)
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT
 
+#if !USE_LINEAR_BUFFER_RX
+// Schedule receive directly into EP OUT FIFO
+static bool audiod_rx_xfer_fifo(uint8_t rhport, audiod_function_t* audio)
+{
+#if USE_ISO_XFER_RX
+  usbd_iso_xfer_t* xfer = &audio->iso_xfer_out;
+  xfer->ff = &audio->ep_out_ff;
+  xfer->n_packets = CFG_TUD_ISO_PACKETS_PER_XFER;
+  for (uint8_t i = 0; i < CFG_TUD_ISO_PACKETS_PER_XFER; i++)
+  {
+    xfer->packet_len[i] = audio->ep_out_sz;
+  }
+  return usbd_edpt_iso_xfer_fifo_n(rhport, audio->ep_out, xfer);
+#else
+  return usbd_edpt_xfer_fifo(rhport, audio->ep_out, &audio->ep_out_ff, audio->ep_out_sz);
+#endif
+}
+#endif
+
 static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t n_bytes_received)
 {
   uint8_t idxItf = 0;
@@ -626,14 +752,14 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t
 #else
 
 #if USE_LINEAR_BUFFER_RX
-  // Data currently is in linear buffer, copy into EP OUT FIFO
-  TU_VERIFY(tu_fifo_write_n(&audio->ep_out_ff, audio->lin_buf_out, n_bytes_received));
+  // Data currently is in linear buffer, copy into EP OUT FIFO. Host may send zero-length packets when it has no samples
+  if (n_bytes_received) TU_VERIFY(tu_fifo_write_n(&audio->ep_out_ff, audio->lin_buf_out, n_bytes_received));
 
   // Schedule for next receive
   TU_VERIFY(usbd_edpt_xfer(rhport, audio->ep_out, audio->lin_buf_out, audio->ep_out_sz), false);
 #else
   // Data is already placed in EP FIFO, schedule for next receive
-  TU_VERIFY(usbd_edpt_xfer_fifo(rhport, audio->ep_out, &audio->ep_out_ff, audio->ep_out_sz), false);
+  TU_VERIFY(audiod_rx_xfer_fifo(rhport, audio), false);
 #endif
 
 #endif
@@ -654,56 +780,27 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t
 
 // Decoding according to 2.3.1.5 Audio Streams
 
-// Helper function
-static inline void * audiod_interleaved_copy_bytes_fast_decode(uint16_t const nBytesPerSample, void * dst, const void * dst_end, void * src, uint8_t const n_ff_used)
+// Convert number of bytes in USB subslots to number of bytes in RX support FIFO
+static inline uint16_t audiod_rx_usb_to_ff(audiod_function_t const* audio, uint16_t n_bytes)
 {
-  // Due to one FIFO contains 2 channels, data always aligned to (nBytesPerSample * 2)
-  uint16_t * dst16 = dst;
-  uint16_t * src16 = src;
-  const uint16_t * dst_end16 = dst_end;
-  uint32_t * dst32 = dst;
-  uint32_t * src32 = src;
-  const uint32_t * dst_end32 = dst_end;
+#if CFG_TUD_AUDIO_ENABLE_CONVERSION
+  return (uint16_t) (n_bytes / audio->n_bytes_per_sampe_rx * tu_audio_sample_format_size(audio->conv_rx.format, audio->n_bytes_per_sampe_rx));
+#else
+  (void) audio;
+  return n_bytes;
+#endif
+}
 
-  if (nBytesPerSample == 1)
-  {
-    while(dst16 < dst_end16)
-    {
-      *dst16++ = *src16++;
-      src16 += n_ff_used - 1;
-    }
-    return src16;
-  }
-  else if (nBytesPerSample == 2)
-  {
-    while(dst32 < dst_end32)
-    {
-      *dst32++ = *src32++;
-      src32 += n_ff_used - 1;
-    }
-    return src32;
-  }
-  else if (nBytesPerSample == 3)
-  {
-    while(dst16 < dst_end16)
-    {
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      src16 += 3 * (n_ff_used - 1);
-    }
-    return src16;
-  }
-  else // nBytesPerSample == 4
+// Helper function: copy (and convert) samples of one FIFO out of the interleaved stream
+static inline uint8_t const * audiod_deinterleave(audiod_function_t* audio, void * dst, uint16_t len, uint8_t const * src)
+{
+#if CFG_TUD_AUDIO_ENABLE_CONVERSION
+  if (audio->conv_rx.format != AUDIO_SAMPLE_FORMAT_SUBSLOT)
   {
-    while(dst32 < dst_end32)
-    {
-      *dst32++ = *src32++;
-      *dst32++ = *src32++;
-      src32 += 2 * (n_ff_used - 1);
-    }
-    return src32;
+    return tu_audio_deinterleave_conv(&audio->conv_rx, dst, len, src, audio->n_ff_used_rx);
   }
+#endif
+  return tu_audio_deinterleave(audio->n_bytes_per_sampe_rx, dst, len, src, audio->n_ff_used_rx);
 }
 
 static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, uint16_t n_bytes_received)
@@ -712,12 +809,11 @@ static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, u
 
   // Determine amount of samples
   uint8_t const n_ff_used               = audio->n_ff_used_rx;
-  uint16_t const nBytesPerFFToRead      = n_bytes_received / n_ff_used;
+  uint16_t const nBytesPerFFToRead      = audiod_rx_usb_to_ff(audio, n_bytes_received / n_ff_used);
   uint8_t cnt_ff;
 
   // Decode
-  uint8_t * src;
-  uint8_t * dst_end;
+  uint8_t const * src;
 
   tu_fifo_buffer_info_t info;
 
@@ -729,15 +825,13 @@ static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, u
     {
       info.len_lin = tu_min16(nBytesPerFFToRead, info.len_lin);
       src = &audio->lin_buf_out[cnt_ff*audio->n_channels_per_ff_rx * audio->n_bytes_per_sampe_rx];
-      dst_end = info.ptr_lin + info.len_lin;
-      src = audiod_interleaved_copy_bytes_fast_decode(audio->n_bytes_per_sampe_rx, info.ptr_lin, dst_end, src, n_ff_used);
+      src = audiod_deinterleave(audio, info.ptr_lin, info.len_lin, src);
 
       // Handle wrapped part of FIFO
       info.len_wrap = tu_min16(nBytesPerFFToRead - info.len_lin, info.len_wrap);
       if (info.len_wrap != 0)
       {
-        dst_end = info.ptr_wrap + info.len_wrap;
-        audiod_interleaved_copy_bytes_fast_decode(audio->n_bytes_per_sampe_rx, info.ptr_wrap, dst_end, src, n_ff_used);
+        audiod_deinterleave(audio, info.ptr_wrap, info.len_wrap, src);
       }
       tu_fifo_advance_write_pointer(&audio->rx_supp_ff[cnt_ff], info.len_lin + info.len_wrap);
     }
@@ -785,6 +879,43 @@ tu_fifo_t* tud_audio_n_get_ep_in_ff(uint8_t func_id)
   return NULL;
 }
 
+// Get pointer to free space of len bytes in EP IN FIFO to be written by a DMA, NULL on overrun
+void* tud_audio_n_dma_write_acquire(uint8_t func_id, uint16_t len)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL, NULL);
+  audiod_function_t* audio = &_audiod_fct[func_id];
+
+  tu_fifo_buffer_info_t info;
+  tu_fifo_get_write_info(&audio->ep_in_ff, &info);
+
+  // Block must be linear in FIFO memory, this is always the case if FIFO depth is a multiple of len
+  if (info.len_lin < len)
+  {
+    audio->dma_in_overrun++;
+    return NULL;
+  }
+
+  return info.ptr_lin;
+}
+
+// Commit len bytes written by DMA into EP IN FIFO
+bool tud_audio_n_dma_write_commit(uint8_t func_id, uint16_t len)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  tu_fifo_t* ff = &_audiod_fct[func_id].ep_in_ff;
+
+  TU_VERIFY(len <= tu_fifo_remaining(ff));
+  tu_fifo_advance_write_pointer(ff, len);
+
+  return true;
+}
+
+uint32_t tud_audio_n_dma_in_overrun(uint8_t func_id)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO, 0);
+  return _audiod_fct[func_id].dma_in_overrun;
+}
+
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_EP_IN
@@ -850,6 +981,41 @@ uint16_t tud_audio_int_ctr_n_write(uint8_t func_id, uint8_t const* buffer, uint1
 
 // n_bytes_copied - Informs caller how many bytes were loaded. In case n_bytes_copied = 0, a ZLP is scheduled to inform host no data is available for current frame.
 #if CFG_TUD_AUDIO_ENABLE_EP_IN
+#if USE_ISO_XFER_TX
+// Plan sizes of the next CFG_TUD_ISO_PACKETS_PER_XFER packets from current EP IN FIFO level. Packets are taken from the
+// FIFO when they are queued (one per service interval) and clamped to its level at that time.
+static uint16_t audiod_tx_iso_xfer_prepare(audiod_function_t* audio)
+{
+  usbd_iso_xfer_t* xfer = &audio->iso_xfer_in;
+  uint16_t count = tu_fifo_count(&audio->ep_in_ff);
+  uint16_t total = 0;
+
+  for (uint8_t i = 0; i < CFG_TUD_ISO_PACKETS_PER_XFER; i++)
+  {
+#if CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
+    uint16_t const len = audiod_tx_packet_size(audio->packet_sz_tx, count, audio->ep_in_ff.depth, audio->ep_in_sz);
+    // Samples keep coming in at nominal rate while former packets are sent
+    count = (uint16_t) tu_min32((uint32_t) (count - tu_min16(len, count)) + audio->packet_sz_tx[1], audio->ep_in_ff.depth);
+#else
+    // Send up to max packet size, more can not be done for ISO
+    uint16_t const len = audio->ep_in_sz;
+#endif
+    xfer->packet_len[i] = len;
+    total = (uint16_t) (total + len);
+  }
+
+  xfer->ff = &audio->ep_in_ff;
+  xfer->n_packets = CFG_TUD_ISO_PACKETS_PER_XFER;
+
+#if !CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
+  // Bytes available now, more are sent if FIFO is filled up before the packets are queued
+  total = tu_min16(total, count);
+#endif
+
+  return total;
+}
+#endif
+
 static bool audiod_tx_done_cb(uint8_t rhport, audiod_function_t * audio)
 {
   uint8_t idxItf;
@@ -918,6 +1084,10 @@ static bool audiod_tx_done_cb(uint8_t rhport, audiod_function_t * audio)
 #if USE_LINEAR_BUFFER_TX
   tu_fifo_read_n(&audio->ep_in_ff, audio->lin_buf_in, n_bytes_tx);
   TU_VERIFY(usbd_edpt_xfer(rhport, audio->ep_in, audio->lin_buf_in, n_bytes_tx));
+#elif USE_ISO_XFER_TX
+  // Schedule next CFG_TUD_ISO_PACKETS_PER_XFER packets at once, n_bytes_tx is the number of bytes planned to be sent
+  n_bytes_tx = audiod_tx_iso_xfer_prepare(audio);
+  TU_VERIFY(usbd_edpt_iso_xfer_fifo_n(rhport, audio->ep_in, &audio->iso_xfer_in));
 #else
   // Send everything in ISO EP FIFO
   TU_VERIFY(usbd_edpt_xfer_fifo(rhport, audio->ep_in, &audio->ep_in_ff, n_bytes_tx));
@@ -947,60 +1117,41 @@ range [-1, +1)
 
 /*
  * This function encodes channels saved within the support FIFOs into one stream by interleaving the PCM samples
- * in the support FIFOs according to 2.3.1.5 Audio Streams. It does not control justification (left or right) and
- * does not change the number of bytes per sample.
+ * in the support FIFOs according to 2.3.1.5 Audio Streams. Justification and number of bytes per sample are only
+ * changed if a sample format conversion is set up (CFG_TUD_AUDIO_ENABLE_CONVERSION).
  * */
 
-// Helper function
-static inline void * audiod_interleaved_copy_bytes_fast_encode(uint16_t const nBytesPerSample, void * src, const void * src_end, void * dst, uint8_t const n_ff_used)
+// Convert number of bytes in TX support FIFO to number of bytes in USB subslots and vice versa
+static inline uint16_t audiod_tx_ff_to_usb(audiod_function_t const* audio, uint16_t n_bytes)
 {
-  // Due to one FIFO contains 2 channels, data always aligned to (nBytesPerSample * 2)
-  uint16_t * dst16 = dst;
-  uint16_t * src16 = src;
-  const uint16_t * src_end16 = src_end;
-  uint32_t * dst32 = dst;
-  uint32_t * src32 = src;
-  const uint32_t * src_end32 = src_end;
+#if CFG_TUD_AUDIO_ENABLE_CONVERSION
+  return (uint16_t) (n_bytes / tu_audio_sample_format_size(audio->conv_tx.format, audio->n_bytes_per_sampe_tx) * audio->n_bytes_per_sampe_tx);
+#else
+  (void) audio;
+  return n_bytes;
+#endif
+}
 
-  if (nBytesPerSample == 1)
-  {
-    while(src16 < src_end16)
-    {
-      *dst16++ = *src16++;
-      dst16 += n_ff_used - 1;
-    }
-    return dst16;
-  }
-  else if (nBytesPerSample == 2)
-  {
-    while(src32 < src_end32)
-    {
-      *dst32++ = *src32++;
-      dst32 += n_ff_used - 1;
-    }
-    return dst32;
-  }
-  else if (nBytesPerSample == 3)
-  {
-    while(src16 < src_end16)
-    {
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      dst16 += 3 * (n_ff_used - 1);
-    }
-    return dst16;
-  }
-  else // nBytesPerSample == 4
+static inline uint16_t audiod_tx_usb_to_ff(audiod_function_t const* audio, uint16_t n_bytes)
+{
+#if CFG_TUD_AUDIO_ENABLE_CONVERSION
+  return (uint16_t) (n_bytes / audio->n_bytes_per_sampe_tx * tu_audio_sample_format_size(audio->conv_tx.format, audio->n_bytes_per_sampe_tx));
+#else
+  (void) audio;
+  return n_bytes;
+#endif
+}
+
+// Helper function: (convert and) copy samples of one FIFO into the interleaved stream
+static inline uint8_t * audiod_interleave(audiod_function_t* audio, uint8_t * dst, void const * src, uint16_t len)
+{
+#if CFG_TUD_AUDIO_ENABLE_CONVERSION
+  if (audio->conv_tx.format != AUDIO_SAMPLE_FORMAT_SUBSLOT)
   {
-    while(src32 < src_end32)
-    {
-      *dst32++ = *src32++;
-      *dst32++ = *src32++;
-      dst32 += 2 * (n_ff_used - 1);
-    }
-    return dst32;
+    return tu_audio_interleave_conv(&audio->conv_tx, dst, src, len, audio->n_ff_used_tx);
   }
+#endif
+  return tu_audio_interleave(audio->n_bytes_per_sampe_tx, dst, src, len, audio->n_ff_used_tx);
 }
 
 static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audio)
@@ -1025,12 +1176,15 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
     }
   }
 
+  // Packet size is determined in bytes of USB subslots
+  nBytesPerFFToSend = audiod_tx_ff_to_usb(audio, nBytesPerFFToSend);
+
 #if CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
   const uint16_t norm_packet_sz_tx[3] = {audio->packet_sz_tx[0] / n_ff_used,
                                          audio->packet_sz_tx[1] / n_ff_used,
                                          audio->packet_sz_tx[2] / n_ff_used};
   // packet_sz_tx is based on total packet size, here we want size for each support buffer.
-  nBytesPerFFToSend = audiod_tx_packet_size(norm_packet_sz_tx, nBytesPerFFToSend, audio->tx_supp_ff[0].depth, audio->ep_in_sz / n_ff_used);
+  nBytesPerFFToSend = audiod_tx_packet_size(norm_packet_sz_tx, nBytesPerFFToSend, audiod_tx_ff_to_usb(audio, audio->tx_supp_ff[0].depth), audio->ep_in_sz / n_ff_used);
   // Check if there is enough data
   if (nBytesPerFFToSend == 0)    return 0;
 #else
@@ -1044,8 +1198,8 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
 #endif
 
   // Encode
+  uint16_t const nBytesPerFFToEncode = audiod_tx_usb_to_ff(audio, nBytesPerFFToSend);
   uint8_t * dst;
-  uint8_t * src_end;
 
   tu_fifo_buffer_info_t info;
 
@@ -1057,18 +1211,16 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
 
     if (info.len_lin != 0)
     {
-      info.len_lin = tu_min16(nBytesPerFFToSend, info.len_lin);       // Limit up to desired length
-      src_end = (uint8_t *)info.ptr_lin + info.len_lin;
-      dst = audiod_interleaved_copy_bytes_fast_encode(audio->n_bytes_per_sampe_tx, info.ptr_lin, src_end, dst, n_ff_used);
+      info.len_lin = tu_min16(nBytesPerFFToEncode, info.len_lin);       // Limit up to desired length
+      dst = audiod_interleave(audio, dst, info.ptr_lin, info.len_lin);
 
       // Limit up to desired length
-      info.len_wrap = tu_min16(nBytesPerFFToSend - info.len_lin, info.len_wrap);
+      info.len_wrap = tu_min16(nBytesPerFFToEncode - info.len_lin, info.len_wrap);
 
       // Handle wrapped part of FIFO
       if (info.len_wrap != 0)
       {
-        src_end = (uint8_t *)info.ptr_wrap + info.len_wrap;
-        audiod_interleaved_copy_bytes_fast_encode(audio->n_bytes_per_sampe_tx, info.ptr_wrap, src_end, dst, n_ff_used);
+        audiod_interleave(audio, dst, info.ptr_wrap, info.len_wrap);
       }
 
       tu_fifo_advance_read_pointer(&audio->tx_supp_ff[cnt_ff], info.len_lin + info.len_wrap);
@@ -1126,16 +1278,22 @@ void audiod_init(void)
 #if CFG_TUD_AUDIO_FUNC_1_N_AS_INT > 0
       case 0:
         audio->alt_setting = alt_setting_1;
+        audio->as_itf_ofs = as_itf_ofs_1;
+        audio->n_as_itf_max = CFG_TUD_AUDIO_FUNC_1_N_AS_INT;
         break;
 #endif
 #if CFG_TUD_AUDIO > 1 && CFG_TUD_AUDIO_FUNC_2_N_AS_INT > 0
       case 1:
         audio->alt_setting = alt_setting_2;
+        audio->as_itf_ofs = as_itf_ofs_2;
+        audio->n_as_itf_max = CFG_TUD_AUDIO_FUNC_2_N_AS_INT;
         break;
 #endif
 #if CFG_TUD_AUDIO > 2 && CFG_TUD_AUDIO_FUNC_3_N_AS_INT > 0
       case 2:
         audio->alt_setting = alt_setting_3;
+        audio->as_itf_ofs = as_itf_ofs_3;
+        audio->n_as_itf_max = CFG_TUD_AUDIO_FUNC_3_N_AS_INT;
         break;
 #endif
     }
@@ -1483,6 +1641,9 @@ uint16_t audiod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uin
 #endif
       }
 
+      // Index entities, AS interfaces and EPs used by control requests
+      TU_ASSERT(audiod_build_desc_index(&_audiod_fct[i]), 0);
+
 #if USE_ISO_EP_ALLOCATION
       {
   #if CFG_TUD_AUDIO_ENABLE_EP_IN
@@ -1521,13 +1682,13 @@ uint16_t audiod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uin
                 {
   #if CFG_TUD_AUDIO_ENABLE_EP_IN
                   ep_in = desc_ep->bEndpointAddress;
-                  ep_in_size = TU_MAX(tu_edpt_packet_size(desc_ep), ep_in_size);
+                  ep_in_size = TU_MAX(tu_edpt_interval_size(desc_ep), ep_in_size);
   #endif
                 } else
                 {
   #if CFG_TUD_AUDIO_ENABLE_EP_OUT
                   ep_out = desc_ep->bEndpointAddress;
-                  ep_out_size = TU_MAX(tu_edpt_packet_size(desc_ep), ep_out_size);
+                  ep_out_size = TU_MAX(tu_edpt_interval_size(desc_ep), ep_out_size);
   #endif
                 }
               }
@@ -1623,6 +1784,17 @@ static bool audiod_get_interface(uint8_t rhport, tusb_control_request_t const *
   return true;
 }
 
+#if CFG_TUD_AUDIO_ENABLE_CONVERSION && ((CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING) || (CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING))
+// Ask application for the support FIFO sample format of the activated alternate setting, bBitResolution was already parsed into conv
+static void audiod_conv_init(uint8_t func_id, uint8_t itf, uint8_t alt, tu_audio_conv_t* conv, uint8_t n_bytes_per_sample, bool is_encode)
+{
+  audio_conversion_params_t params = { .format = AUDIO_SAMPLE_FORMAT_SUBSLOT, .dither = false };
+  if (tud_audio_conversion_params_cb) tud_audio_conversion_params_cb(func_id, itf, alt, &params);
+
+  tu_audio_conv_init(conv, params.format, params.dither, n_bytes_per_sample, conv->usb_bits, is_encode);
+}
+#endif
+
 static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const * p_request)
 {
   (void) rhport;
@@ -1755,7 +1927,7 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
             // Save address
             audio->ep_in = ep_addr;
             audio->ep_in_as_intf_num = itf;
-            audio->ep_in_sz = tu_edpt_packet_size(desc_ep);
+            audio->ep_in_sz = tu_edpt_interval_size(desc_ep);
 
             // If software encoding is enabled, parse for the corresponding parameters - doing this here means only AS interfaces with EPs get scanned for parameters
   #if CFG_TUD_AUDIO_ENABLE_ENCODING || CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
@@ -1763,8 +1935,11 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
 
             // Reconfigure size of support FIFOs - this is necessary to avoid samples to get split in case of a wrap
     #if CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
-            const uint16_t active_fifo_depth = (uint16_t) ((audio->tx_supp_ff_sz_max / (audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx))
-               * (audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx));
+      #if CFG_TUD_AUDIO_ENABLE_CONVERSION
+            audiod_conv_init(func_id, itf, alt, &audio->conv_tx, audio->n_bytes_per_sampe_tx, true);
+      #endif
+            const uint16_t ff_slot_sz = audiod_tx_usb_to_ff(audio, (uint16_t) (audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx));
+            const uint16_t active_fifo_depth = (uint16_t) ((audio->tx_supp_ff_sz_max / ff_slot_sz) * ff_slot_sz);
             for (uint8_t cnt = 0; cnt < audio->n_tx_supp_ff; cnt++)
             {
               tu_fifo_config(&audio->tx_supp_ff[cnt], audio->tx_supp_ff[cnt].buffer, active_fifo_depth, 1, true);
@@ -1787,14 +1962,18 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
             // Save address
             audio->ep_out = ep_addr;
             audio->ep_out_as_intf_num = itf;
-            audio->ep_out_sz = tu_edpt_packet_size(desc_ep);
+            audio->ep_out_sz = tu_edpt_interval_size(desc_ep);
 
   #if CFG_TUD_AUDIO_ENABLE_DECODING
             audiod_parse_for_AS_params(audio, p_desc_parse_for_params, p_desc_end, itf);
 
             // Reconfigure size of support FIFOs - this is necessary to avoid samples to get split in case of a wrap
     #if CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING
-            const uint16_t active_fifo_depth = (audio->rx_supp_ff_sz_max / audio->n_bytes_per_sampe_rx) * audio->n_bytes_per_sampe_rx;
+      #if CFG_TUD_AUDIO_ENABLE_CONVERSION
+            audiod_conv_init(func_id, itf, alt, &audio->conv_rx, audio->n_bytes_per_sampe_rx, false);
+      #endif
+            const uint16_t ff_slot_sz = audiod_rx_usb_to_ff(audio, (uint16_t) (audio->n_channels_per_ff_rx * audio->n_bytes_per_sampe_rx));
+            const uint16_t active_fifo_depth = (uint16_t) ((audio->rx_supp_ff_sz_max / ff_slot_sz) * ff_slot_sz);
             for (uint8_t cnt = 0; cnt < audio->n_rx_supp_ff; cnt++)
             {
               tu_fifo_config(&audio->rx_supp_ff[cnt], audio->rx_supp_ff[cnt].buffer, active_fifo_depth, 1, true);
@@ -1808,7 +1987,7 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
   #if USE_LINEAR_BUFFER_RX
             TU_VERIFY(usbd_edpt_xfer(rhport, audio->ep_out, audio->lin_buf_out, audio->ep_out_sz), false);
   #else
-            TU_VERIFY(usbd_edpt_xfer_fifo(rhport, audio->ep_out, &audio->ep_out_ff, audio->ep_out_sz), false);
+            TU_VERIFY(audiod_rx_xfer_fifo(rhport, audio), false);
   #endif
           }
 
@@ -1819,7 +1998,7 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
             audio->feedback.frame_shift = desc_ep->bInterval -1;
 
             // Enable SOF interrupt if callback is implemented
-            if (tud_audio_feedback_interval_isr) usbd_sof_enable(rhport, true);
+            if (tud_audio_feedback_interval_isr) usbd_sof_enable(rhport, SOF_CONSUMER_AUDIO, true);
           }
   #endif
 #endif // CFG_TUD_AUDIO_ENABLE_EP_OUT
@@ -1856,17 +2035,16 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
             set_fb_params_freq(audio, fb_param.sample_freq, fb_param.frequency.mclk_freq);
           break;
 
-          #if 0 // implement later
           case AUDIO_FEEDBACK_METHOD_FIFO_COUNT:
-          {
-            uint64_t fb64 = ((uint64_t) fb_param.sample_freq) << 16;
-            audio->feedback.compute.fifo_count.nominal_value = (uint32_t) (fb64 / frame_div);
-            audio->feedback.compute.fifo_count.threshold_bytes = fb_param.fifo_count.threshold_bytes;
+            if (audio->ep_fb)
+            {
+              set_fb_params_fifo_count(audio, &fb_param, frame_div);
 
-            tud_audio_fb_set(audio->feedback.compute.fifo_count.nominal_value);
-          }
+              // Controller runs in SOF ISR
+              usbd_sof_enable(rhport, SOF_CONSUMER_AUDIO, true);
+              tud_audio_n_fb_set(func_id, audio->feedback.compute.fifo_count.nominal_value);
+            }
           break;
-          #endif
 
           // nothing to do
           default: break;
@@ -1893,7 +2071,7 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
       break;
     }
   }
-  if (disable) usbd_sof_enable(rhport, false);
+  if (disable) usbd_sof_enable(rhport, SOF_CONSUMER_AUDIO, false);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
@@ -2224,6 +2402,71 @@ static bool set_fb_params_freq(audiod_function_t* audio, uint32_t sample_freq, u
   return true;
 }
 
+// FIFO whose level is regulated by AUDIO_FEEDBACK_METHOD_FIFO_COUNT
+static inline tu_fifo_t* audiod_fb_fifo(audiod_function_t* audio)
+{
+#if CFG_TUD_AUDIO_ENABLE_DECODING
+  return &audio->rx_supp_ff[0];
+#else
+  return &audio->ep_out_ff;
+#endif
+}
+
+static void set_fb_params_fifo_count(audiod_function_t* audio, audio_feedback_params_t const* fb_param, uint32_t frame_div)
+{
+  uint16_t const threshold = fb_param->fifo_count.threshold_bytes ? fb_param->fifo_count.threshold_bytes : (uint16_t) (audiod_fb_fifo(audio)->depth / 2);
+
+  audio->feedback.compute.fifo_count.nominal_value = (uint32_t) ((((uint64_t) fb_param->sample_freq) << 16) / frame_div);
+  audio->feedback.compute.fifo_count.threshold = threshold;
+
+  // Default gains: a level error of threshold bytes corrects by one sample per frame, integral time constant of 64 intervals
+  uint32_t const kp = fb_param->fifo_count.kp ? fb_param->fifo_count.kp : (1UL << 24) / tu_max16(threshold, 1);
+  audio->feedback.compute.fifo_count.kp = kp;
+  audio->feedback.compute.fifo_count.ki = fb_param->fifo_count.ki ? fb_param->fifo_count.ki : tu_max32(kp / 64, 1);
+  audio->feedback.compute.fifo_count.lpf_shift = fb_param->fifo_count.lpf_shift ? fb_param->fifo_count.lpf_shift : 4;
+
+  audio->feedback.compute.fifo_count.level_q8 = (int32_t) threshold << 8;
+  audio->feedback.compute.fifo_count.integral_q8 = 0;
+}
+
+// Low-pass filter OUT FIFO level, called every frame
+TU_ATTR_FAST_FUNC static void audiod_fb_fifo_count_sample(audiod_function_t* audio)
+{
+  int32_t const level_q8 = (int32_t) tu_fifo_count(audiod_fb_fifo(audio)) << 8;
+  audio->feedback.compute.fifo_count.level_q8 += (level_q8 - audio->feedback.compute.fifo_count.level_q8) >> audio->feedback.compute.fifo_count.lpf_shift;
+}
+
+// PI controller, called every feedback interval. Integration is held while output saturates in direction of the error (anti-windup)
+TU_ATTR_FAST_FUNC static void audiod_fb_fifo_count_update(uint8_t func_id, audiod_function_t* audio)
+{
+  int32_t const integral_max = 1L << 24; // one sample per frame
+
+  // Positive error: FIFO is running low, host should send more
+  int32_t const error_q8 = ((int32_t) audio->feedback.compute.fifo_count.threshold << 8) - audio->feedback.compute.fifo_count.level_q8;
+  int32_t const p_term = (int32_t) (((int64_t) audio->feedback.compute.fifo_count.kp * error_q8) >> 16);
+
+  int32_t integral_q8 = audio->feedback.compute.fifo_count.integral_q8 + (int32_t) (((int64_t) audio->feedback.compute.fifo_count.ki * error_q8) >> 8);
+  if (integral_q8 > integral_max) integral_q8 = integral_max;
+  if (integral_q8 < -integral_max) integral_q8 = -integral_max;
+
+  int64_t feedback = (int64_t) audio->feedback.compute.fifo_count.nominal_value + p_term + (integral_q8 >> 8);
+
+  if (feedback > audio->feedback.max_value)
+  {
+    feedback = audio->feedback.max_value;
+    if (error_q8 > 0) integral_q8 = audio->feedback.compute.fifo_count.integral_q8;
+  }
+  else if (feedback < audio->feedback.min_value)
+  {
+    feedback = audio->feedback.min_value;
+    if (error_q8 < 0) integral_q8 = audio->feedback.compute.fifo_count.integral_q8;
+  }
+
+  audio->feedback.compute.fifo_count.integral_q8 = integral_q8;
+
+  tud_audio_n_fb_set(func_id, (uint32_t) feedback);
+}
+
 uint32_t tud_audio_feedback_update(uint8_t func_id, uint32_t cycles)
 {
   audiod_function_t* audio = &_audiod_fct[func_id];
@@ -2284,7 +2527,15 @@ TU_ATTR_FAST_FUNC void audiod_sof_isr (uint8_t rhport, uint32_t frame_count)
       // HS shift need to be adjusted since SOF event is generated for frame only
       uint8_t const hs_adjust = (TUSB_SPEED_HIGH == tud_speed_get()) ? 3 : 0;
       uint32_t const interval = 1UL << (audio->feedback.frame_shift - hs_adjust);
-      if ( 0 == (frame_count & (interval-1)) )
+      bool const interval_elapsed = (0 == (frame_count & (interval-1)));
+
+      if (audio->feedback.compute_method == AUDIO_FEEDBACK_METHOD_FIFO_COUNT)
+      {
+        audiod_fb_fifo_count_sample(audio);
+        if (interval_elapsed) audiod_fb_fifo_count_update(i, audio);
+      }
+
+      if ( interval_elapsed )
       {
         if(tud_audio_feedback_interval_isr) tud_audio_feedback_interval_isr(i, frame_count, audio->feedback.frame_shift);
       }
@@ -2359,6 +2610,45 @@ bool tud_audio_buffer_and_schedule_control_xfer(uint8_t rhport, tusb_control_req
   return tud_control_xfer(rhport, p_request, (void*)_audiod_fct[func_id].ctrl_buf, len);
 }
 
+// Build the descriptor index of an audio function: entity IDs defined in the AC interface, AS interfaces and EPs.
+// Control requests are then checked without walking the descriptors of all audio functions.
+static bool audiod_build_desc_index(audiod_function_t* audio)
+{
+  uint8_t const *p_desc_end = audio->p_desc + audio->desc_length - TUD_AUDIO_DESC_IAD_LEN;
+
+  // Get pointers after class specific AC descriptors and end of AC descriptors - entities are defined in between
+  uint8_t const *p_desc = tu_desc_next(audio->p_desc);                                                      // Points to CS AC descriptor
+  uint8_t const *p_desc_ac_end = ((audio_desc_cs_ac_interface_t const *)p_desc)->wTotalLength + p_desc;
+
+  tu_memclr(audio->entity_map, sizeof(audio->entity_map));
+  audio->ep_map = 0;
+  audio->n_as_itf = 0;
+
+  for (p_desc = tu_desc_next(p_desc); p_desc < p_desc_ac_end; p_desc = tu_desc_next(p_desc))
+  {
+    uint8_t const entityID = p_desc[3];  // Entity IDs are always at offset 3
+    audio->entity_map[entityID >> 5] |= TU_BIT(entityID & 0x1F);
+  }
+
+  // AS interfaces and EPs follow - we assume the number of alternate settings is increasing thus alternate setting zero comes first
+  for (; p_desc < p_desc_end; p_desc = tu_desc_next(p_desc))
+  {
+    if (tu_desc_type(p_desc) == TUSB_DESC_INTERFACE && ((tusb_desc_interface_t const *)p_desc)->bAlternateSetting == 0)
+    {
+      TU_ASSERT(audio->n_as_itf < audio->n_as_itf_max);
+      if (audio->n_as_itf == 0) audio->as_itf_first = ((tusb_desc_interface_t const *)p_desc)->bInterfaceNumber;
+      audio->as_itf_ofs[audio->n_as_itf++] = (uint16_t) (p_desc - audio->p_desc);
+    }
+    else if (tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT)
+    {
+      uint8_t const ep = ((tusb_desc_endpoint_t const *)p_desc)->bEndpointAddress;
+      audio->ep_map |= TU_BIT(tu_edpt_dir(ep) * 16 + tu_edpt_number(ep));
+    }
+  }
+
+  return true;
+}
+
 // This helper function finds for a given audio function and AS interface number the index of the attached driver structure, the index of the interface in the audio function
 // (e.g. the std. AS interface with interface number 15 is the first AS interface for the given audio function and thus gets index zero), and
 // finally a pointer to the std. AS interface, where the pointer always points to the first alternate setting i.e. alternate interface zero.
@@ -2366,30 +2656,21 @@ static bool audiod_get_AS_interface_index(uint8_t itf, audiod_function_t * audio
 {
   if (audio->p_desc)
   {
-    // Get pointer at end
-    uint8_t const *p_desc_end = audio->p_desc + audio->desc_length - TUD_AUDIO_DESC_IAD_LEN;
-
-    // Advance past AC descriptors
-    uint8_t const *p_desc = tu_desc_next(audio->p_desc);
-    p_desc += ((audio_desc_cs_ac_interface_t const *)p_desc)->wTotalLength;
-
-    uint8_t tmp = 0;
-    while (p_desc < p_desc_end)
+    // Interfaces of a function are numbered contiguously (IAD), so the index is the distance to the first AS interface
+    uint8_t idx = (uint8_t) (itf - audio->as_itf_first);
+    if (idx >= audio->n_as_itf || ((tusb_desc_interface_t const *) (audio->p_desc + audio->as_itf_ofs[idx]))->bInterfaceNumber != itf)
     {
-      // We assume the number of alternate settings is increasing thus we return the index of alternate setting zero!
-      if (tu_desc_type(p_desc) == TUSB_DESC_INTERFACE && ((tusb_desc_interface_t const * )p_desc)->bAlternateSetting == 0)
+      // Otherwise look through indexed AS interfaces
+      for (idx = 0; idx < audio->n_as_itf; idx++)
       {
-        if (((tusb_desc_interface_t const * )p_desc)->bInterfaceNumber == itf)
-        {
-          *idxItf = tmp;
-          *pp_desc_int = p_desc;
-          return true;
-        }
-        // Increase index, bytes read, and pointer
-        tmp++;
+        if (((tusb_desc_interface_t const *) (audio->p_desc + audio->as_itf_ofs[idx]))->bInterfaceNumber == itf) break;
       }
-      p_desc = tu_desc_next(p_desc);
+      if (idx == audio->n_as_itf) return false;
     }
+
+    *idxItf = idx;
+    *pp_desc_int = audio->p_desc + audio->as_itf_ofs[idx];
+    return true;
   }
   return false;
 }
@@ -2422,25 +2703,17 @@ static bool audiod_verify_entity_exists(uint8_t itf, uint8_t entityID, uint8_t *
     // Look for the correct driver by checking if the unique standard AC interface number fits
     if (_audiod_fct[i].p_desc && ((tusb_desc_interface_t const *)_audiod_fct[i].p_desc)->bInterfaceNumber == itf)
     {
-      // Get pointers after class specific AC descriptors and end of AC descriptors - entities are defined in between
-      uint8_t const *p_desc = tu_desc_next(_audiod_fct[i].p_desc);                                          // Points to CS AC descriptor
-      uint8_t const *p_desc_end = ((audio_desc_cs_ac_interface_t const *)p_desc)->wTotalLength + p_desc;
-      p_desc = tu_desc_next(p_desc);                                                                            // Get past CS AC descriptor
-
-      while (p_desc < p_desc_end)
+      if (tu_bit_test(_audiod_fct[i].entity_map[entityID >> 5], entityID & 0x1F))
       {
-        if (p_desc[3] == entityID)  // Entity IDs are always at offset 3
-        {
-          *func_id = i;
-          return true;
-        }
-        p_desc = tu_desc_next(p_desc);
+        *func_id = i;
+        return true;
       }
     }
   }
   return false;
 }
 
+// Verify the AC interface or an AS interface with the given number exists and returns also the corresponding driver index
 static bool audiod_verify_itf_exists(uint8_t itf, uint8_t *func_id)
 {
   uint8_t i;
@@ -2448,18 +2721,13 @@ static bool audiod_verify_itf_exists(uint8_t itf, uint8_t *func_id)
   {
     if (_audiod_fct[i].p_desc)
     {
-      // Get pointer at beginning and end
-      uint8_t const *p_desc = _audiod_fct[i].p_desc;
-      uint8_t const *p_desc_end = _audiod_fct[i].p_desc + _audiod_fct[i].desc_length - TUD_AUDIO_DESC_IAD_LEN;
-
-      while (p_desc < p_desc_end)
+      uint8_t idxItf;
+      uint8_t const *dummy;
+      if (((tusb_desc_interface_t const *)_audiod_fct[i].p_desc)->bInterfaceNumber == itf ||
+          audiod_get_AS_interface_index(itf, &_audiod_fct[i], &idxItf, &dummy))
       {
-        if (tu_desc_type(p_desc) == TUSB_DESC_INTERFACE && ((tusb_desc_interface_t const *)_audiod_fct[i].p_desc)->bInterfaceNumber == itf)
-        {
-          *func_id = i;
-          return true;
-        }
-        p_desc = tu_desc_next(p_desc);
+        *func_id = i;
+        return true;
       }
     }
   }
@@ -2471,24 +2739,10 @@ static bool audiod_verify_ep_exists(uint8_t ep, uint8_t *func_id)
   uint8_t i;
   for (i = 0; i < CFG_TUD_AUDIO; i++)
   {
-    if (_audiod_fct[i].p_desc)
+    if (_audiod_fct[i].p_desc && tu_bit_test(_audiod_fct[i].ep_map, (uint8_t) (tu_edpt_dir(ep) * 16 + tu_edpt_number(ep))))
     {
-      // Get pointer at end
-      uint8_t const *p_desc_end = _audiod_fct[i].p_desc + _audiod_fct[i].desc_length;
-
-      // Advance past AC descriptors - EP we look for are streaming EPs
-      uint8_t const *p_desc = tu_desc_next(_audiod_fct[i].p_desc);
-      p_desc += ((audio_desc_cs_ac_interface_t const *)p_desc)->wTotalLength;
-
-      while (p_desc < p_desc_end)
-      {
-        if (tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT && ((tusb_desc_endpoint_t const * )p_desc)->bEndpointAddress == ep)
-        {
-          *func_id = i;
-          return true;
-        }
-        p_desc = tu_desc_next(p_desc);
-      }
+      *func_id = i;
+      return true;
     }
   }
   return false;
@@ -2562,6 +2816,9 @@ static void audiod_parse_for_AS_params(audiod_function_t* audio, uint8_t const *
       if (as_itf == audio->ep_in_as_intf_num)
       {
         audio->n_bytes_per_sampe_tx = ((audio_desc_type_I_format_t const * )p_desc)->bSubslotSize;
+#if CFG_TUD_AUDIO_ENABLE_CONVERSION && CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
+        audio->conv_tx.usb_bits = ((audio_desc_type_I_format_t const * )p_desc)->bBitResolution;
+#endif
       }
 #endif
 
@@ -2569,6 +2826,9 @@ static void audiod_parse_for_AS_params(audiod_function_t* audio, uint8_t const *
       if (as_itf == audio->ep_out_as_intf_num)
       {
         audio->n_bytes_per_sampe_rx = ((audio_desc_type_I_format_t const * )p_desc)->bSubslotSize;
+#if CFG_TUD_AUDIO_ENABLE_CONVERSION && CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING
+        audio->conv_rx.usb_bits = ((audio_desc_type_I_format_t const * )p_desc)->bBitResolution;
+#endif
       }
 #endif
     }
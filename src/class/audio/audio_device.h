@@ -29,6 +29,7 @@
 #define _TUSB_AUDIO_DEVICE_H_
 
 #include "audio.h"
+#include "audio_interleave.h"
 
 //--------------------------------------------------------------------+
 // Class Driver Configuration
@@ -92,6 +93,7 @@
 #endif
 
 // Maximum EP sizes for all alternate AS interface settings - used for checks and buffer allocation
+// For highspeed high-bandwidth EP this is packet size x transactions per microframe (up to 3072)
 #if CFG_TUD_AUDIO_ENABLE_EP_IN
 #ifndef CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX
 #error You must tell the driver the biggest EP IN size!
@@ -304,6 +306,13 @@
 
 // Remaining types not support so far
 
+// Sample format conversion fused into Type I PCM encoding/decoding: the support FIFOs may hold a different sample format
+// than the USB subslots (see audio_sample_format_t), selected per alternate setting by tud_audio_conversion_params_cb().
+// The FIFO depth is then a multiple of the FIFO sample size instead of the subslot size.
+#ifndef CFG_TUD_AUDIO_ENABLE_CONVERSION
+#define CFG_TUD_AUDIO_ENABLE_CONVERSION                     0
+#endif
+
 // Number of support FIFOs to set up - multiple channels can be handled by one FIFO - very common is two channels per FIFO stemming from one I2S interface
 #ifndef CFG_TUD_AUDIO_FUNC_1_N_TX_SUPP_SW_FIFO
 #define CFG_TUD_AUDIO_FUNC_1_N_TX_SUPP_SW_FIFO              0
@@ -371,6 +380,15 @@ uint16_t tud_audio_n_available                    (uint8_t func_id);
 uint16_t tud_audio_n_read                         (uint8_t func_id, void* buffer, uint16_t bufsize);
 bool     tud_audio_n_clear_ep_out_ff              (uint8_t func_id);                          // Delete all content in the EP OUT FIFO
 tu_fifo_t*   tud_audio_n_get_ep_out_ff            (uint8_t func_id);
+
+// DMA streaming e.g I2S/SAI TX: a peripheral DMA reads samples directly out of the EP OUT FIFO without an intermediate copy.
+// Acquire the next block of len bytes before the DMA transfer is started (e.g in DMA half/complete transfer ISR),
+// release it after the DMA has read it. Returns NULL if less than len bytes are available (underrun), the DMA should
+// then send silence. FIFO depth (CFG_TUD_AUDIO_FUNC_x_EP_OUT_SW_BUF_SZ) must be a multiple of len. ISR safe as long as
+// the DMA is the only reader of the FIFO.
+void const* tud_audio_n_dma_read_acquire          (uint8_t func_id, uint16_t len);
+bool     tud_audio_n_dma_read_release             (uint8_t func_id, uint16_t len);
+uint32_t tud_audio_n_dma_out_underrun             (uint8_t func_id);                          // Number of blocks not available since bus reset
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING
@@ -384,6 +402,15 @@ tu_fifo_t* tud_audio_n_get_rx_support_ff          (uint8_t func_id, uint8_t ff_i
 uint16_t tud_audio_n_write                        (uint8_t func_id, const void * data, uint16_t len);
 bool     tud_audio_n_clear_ep_in_ff               (uint8_t func_id);                          // Delete all content in the EP IN FIFO
 tu_fifo_t*   tud_audio_n_get_ep_in_ff             (uint8_t func_id);
+
+// DMA streaming e.g I2S/SAI RX: a peripheral DMA writes samples directly into the EP IN FIFO without an intermediate copy.
+// Acquire the next block of len bytes before the DMA transfer is started (e.g in DMA half/complete transfer ISR),
+// commit it once the DMA has filled it. Returns NULL if less than len bytes are free (overrun), the block should then
+// be dropped e.g by pointing the DMA to a scratch buffer. FIFO depth (CFG_TUD_AUDIO_FUNC_x_EP_IN_SW_BUF_SZ) must be a
+// multiple of len. ISR safe as long as the DMA is the only writer of the FIFO.
+void*    tud_audio_n_dma_write_acquire            (uint8_t func_id, uint16_t len);
+bool     tud_audio_n_dma_write_commit             (uint8_t func_id, uint16_t len);
+uint32_t tud_audio_n_dma_in_overrun               (uint8_t func_id);                          // Number of blocks dropped since bus reset
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING
@@ -411,6 +438,8 @@ static inline uint16_t     tud_audio_available              (void);
 static inline bool         tud_audio_clear_ep_out_ff        (void);                       // Delete all content in the EP OUT FIFO
 static inline uint16_t     tud_audio_read                   (void* buffer, uint16_t bufsize);
 static inline tu_fifo_t*   tud_audio_get_ep_out_ff          (void);
+static inline void const*  tud_audio_dma_read_acquire       (uint16_t len);
+static inline bool         tud_audio_dma_read_release       (uint16_t len);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING
@@ -426,6 +455,8 @@ static inline tu_fifo_t* tud_audio_get_rx_support_ff        (uint8_t ff_idx);
 static inline uint16_t tud_audio_write                      (const void * data, uint16_t len);
 static inline bool 	   tud_audio_clear_ep_in_ff             (void);
 static inline tu_fifo_t* tud_audio_get_ep_in_ff             (void);
+static inline void*    tud_audio_dma_write_acquire          (uint16_t len);
+static inline bool     tud_audio_dma_write_commit           (uint16_t len);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING
@@ -504,9 +535,7 @@ enum {
   AUDIO_FEEDBACK_METHOD_FREQUENCY_FIXED,
   AUDIO_FEEDBACK_METHOD_FREQUENCY_FLOAT,
   AUDIO_FEEDBACK_METHOD_FREQUENCY_POWER_OF_2,
-
-  // impelemnt later
-  // AUDIO_FEEDBACK_METHOD_FIFO_COUNT
+  AUDIO_FEEDBACK_METHOD_FIFO_COUNT, // computed by driver in SOF ISR from OUT FIFO level, no MCLK measurement required
 };
 
 typedef struct {
@@ -518,11 +547,15 @@ typedef struct {
       uint32_t mclk_freq; // Main clock frequency in Hz i.e. master clock to which sample clock is based on
     }frequency;
 
-#if 0 // implement later
+    // PI controller regulating the level of the OUT FIFO (first support FIFO if decoding is enabled). The level is
+    // low-pass filtered every frame, the controller runs every feedback interval. Gains are in 1/256 of the 16.16 feedback
+    // LSB per byte of level error, integral is limited to +/- one sample per frame (anti-windup).
     struct {
-      uint32_t threshold_bytes; // minimum number of bytes received to be considered as filled/ready
+      uint16_t threshold_bytes; // FIFO level to regulate to, 0 for half of FIFO depth
+      uint32_t kp;              // proportional gain, 0 for default: deviation of threshold bytes yields one sample per frame
+      uint32_t ki;              // integral gain, 0 for default of kp/64
+      uint8_t  lpf_shift;       // low-pass filter: level += (new - level) >> lpf_shift, 0 for default of 4
     }fifo_count;
-#endif
   };
 }audio_feedback_params_t;
 
@@ -537,6 +570,17 @@ TU_ATTR_WEAK TU_ATTR_FAST_FUNC void tud_audio_feedback_interval_isr(uint8_t func
 
 #endif // CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 
+#if CFG_TUD_AUDIO_ENABLE_CONVERSION && ((CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING) || (CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING))
+typedef struct {
+  uint8_t format;   // audio_sample_format_t of the support FIFOs
+  bool dither;      // add TPDF dither when bits are dropped, otherwise samples are truncated
+} audio_conversion_params_t;
+
+// Invoked when an AS interface alternate setting with EP is activated, to set the sample format of its support FIFOs.
+// Leaving params untouched (AUDIO_SAMPLE_FORMAT_SUBSLOT) keeps USB subslots as they are.
+TU_ATTR_WEAK void tud_audio_conversion_params_cb(uint8_t func_id, uint8_t itf, uint8_t alt_itf, audio_conversion_params_t* params);
+#endif
+
 #if CFG_TUD_AUDIO_INT_CTR_EPSIZE_IN
 TU_ATTR_WEAK bool tud_audio_int_ctr_done_cb(uint8_t rhport, uint16_t n_bytes_copied);
 #endif
@@ -598,6 +642,16 @@ static inline tu_fifo_t* tud_audio_get_ep_out_ff(void)
   return tud_audio_n_get_ep_out_ff(0);
 }
 
+static inline void const* tud_audio_dma_read_acquire(uint16_t len)
+{
+  return tud_audio_n_dma_read_acquire(0, len);
+}
+
+static inline bool tud_audio_dma_read_release(uint16_t len)
+{
+  return tud_audio_n_dma_read_release(0, len);
+}
+
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING
@@ -643,6 +697,16 @@ static inline tu_fifo_t* tud_audio_get_ep_in_ff(void)
   return tud_audio_n_get_ep_in_ff(0);
 }
 
+static inline void* tud_audio_dma_write_acquire(uint16_t len)
+{
+  return tud_audio_n_dma_write_acquire(0, len);
+}
+
+static inline bool tud_audio_dma_write_commit(uint16_t len)
+{
+  return tud_audio_n_dma_write_commit(0, len);
+}
+
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING
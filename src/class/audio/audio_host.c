@@ -0,0 +1,892 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUH_ENABLED && CFG_TUH_AUDIO
+
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
+
+#include "audio_host.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUH_AUDIO_LOG_LEVEL
+  #define CFG_TUH_AUDIO_LOG_LEVEL   CFG_TUH_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_AUDIO_LOG_LEVEL, __VA_ARGS__)
+
+TU_VERIFY_STATIC(CFG_TUH_AUDIO_EP_BUFSIZE <= UINT16_MAX && CFG_TUH_AUDIO_FIFO_SIZE <= UINT16_MAX, "buffer too large");
+TU_VERIFY_STATIC(CFG_TUH_AUDIO_FREQ_MAX >= 2, "continuous frequency range needs 2 entries");
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+enum {
+  AUDIOH_STREAM_IDLE = 0,
+  AUDIOH_STREAM_OPENING,
+  AUDIOH_STREAM_ACTIVE,
+  AUDIOH_STREAM_CLOSING,
+};
+
+enum {
+  STREAM_SET_FREQ = 0,
+  STREAM_GET_FREQ,
+  STREAM_CHECK_FREQ,
+  STREAM_START,
+  STREAM_OPEN_FAILED,
+  STREAM_CLOSE_COMPLETE,
+};
+
+// Feedback values further than 1/8 from nominal rate are ignored
+#define AUDIOH_FB_TOLERANCE_SHIFT   3
+
+// Maximum number of clock selector/multiplier hops from a terminal to its clock source
+#define AUDIOH_CLOCK_HOP_MAX        4
+
+typedef struct {
+  uint8_t itf_num;
+  uint8_t dir;
+  uint8_t terminal;         // bTerminalLink
+  uint8_t alt_count;
+  tuh_audio_alt_t alt[CFG_TUH_AUDIO_ALT_MAX];
+
+  //------------- Streaming -------------//
+  uint8_t state;
+  uint8_t alt_idx;          // selected alternate setting
+  uint8_t ep_data;          // endpoints opened for streaming
+  uint8_t ep_fb;
+  uint8_t interval_shift;   // (micro)frames per packet = 1 << interval_shift
+  uint16_t frame_bytes;     // bytes per audio frame: channels * subslot
+  uint16_t packet_max;      // largest packet rounded down to whole audio frames
+  uint32_t sample_rate;
+
+  uint32_t nominal;         // samples per packet in 16.16
+  uint32_t feedback;        // samples per packet in 16.16
+  uint32_t accum;           // fractional samples carried to next packet in 16.16
+
+  uint8_t buf_idx;          // rx: buffer on the bus, tx: buffer prepared next
+  uint16_t tx_len[2];
+  bool xfer_busy;
+  bool fb_busy;
+
+  tu_fifo_t ff;
+} audioh_stream_t;
+
+typedef struct {
+  uint8_t daddr;
+  uint8_t itf_num;          // AudioControl interface
+  uint8_t itf_last;         // last interface of the function
+  bool mounted;
+  bool ctrl_busy;           // a stream is being opened or closed
+  uint16_t bcd_adc;
+
+  uint8_t stream_count;
+  audioh_stream_t stream[CFG_TUH_AUDIO_STREAM_MAX];
+} audioh_interface_t;
+
+// Buffers used with the host controller
+typedef struct {
+  CFG_TUH_MEM_ALIGN uint8_t ep[CFG_TUH_AUDIO_STREAM_MAX][2][CFG_TUH_AUDIO_EP_BUFSIZE];
+  CFG_TUH_MEM_ALIGN uint8_t fb[CFG_TUH_AUDIO_STREAM_MAX][4];
+  CFG_TUH_MEM_ALIGN uint8_t ctrl[4];
+} audioh_epbuf_t;
+
+CFG_TUH_MEM_SECTION static audioh_interface_t audioh_data[CFG_TUH_AUDIO];
+CFG_TUH_MEM_SECTION static audioh_epbuf_t audioh_epbuf[CFG_TUH_AUDIO];
+
+static uint8_t audioh_ff_buf[CFG_TUH_AUDIO][CFG_TUH_AUDIO_STREAM_MAX][CFG_TUH_AUDIO_FIFO_SIZE];
+
+//--------------------------------------------------------------------+
+// INTERNAL OBJECT & FUNCTION DECLARATION
+//--------------------------------------------------------------------+
+
+static inline audioh_interface_t* get_itf(uint8_t idx) {
+  TU_VERIFY(idx < CFG_TUH_AUDIO, NULL);
+  audioh_interface_t* p_audio = &audioh_data[idx];
+
+  return (p_audio->daddr != 0) ? p_audio : NULL;
+}
+
+static inline audioh_stream_t* get_stream(uint8_t idx, uint8_t stream) {
+  audioh_interface_t* p_audio = get_itf(idx);
+  TU_VERIFY(p_audio && p_audio->mounted && stream < p_audio->stream_count, NULL);
+  return &p_audio->stream[stream];
+}
+
+static inline bool is_uac2(audioh_interface_t const* p_audio) {
+  return p_audio->bcd_adc >= 0x0200;
+}
+
+// idx and stream are kept in user data of control transfers
+static inline uintptr_t stream_state(uint8_t idx, uint8_t stream, uint8_t state) {
+  return ((uintptr_t) idx << 16) | ((uintptr_t) stream << 8) | state;
+}
+
+static void audioh_process_stream(tuh_xfer_t* xfer);
+
+//--------------------------------------------------------------------+
+// APPLICATION API
+//--------------------------------------------------------------------+
+
+uint8_t tuh_audio_itf_get_index(uint8_t daddr) {
+  for (uint8_t i = 0; i < CFG_TUH_AUDIO; i++) {
+    if (audioh_data[i].daddr == daddr) return i;
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_audio_mounted(uint8_t idx) {
+  audioh_interface_t* p_audio = get_itf(idx);
+  return p_audio && p_audio->mounted;
+}
+
+uint16_t tuh_audio_version(uint8_t idx) {
+  audioh_interface_t* p_audio = get_itf(idx);
+  return p_audio ? p_audio->bcd_adc : 0;
+}
+
+uint8_t tuh_audio_stream_count(uint8_t idx) {
+  audioh_interface_t* p_audio = get_itf(idx);
+  return p_audio ? p_audio->stream_count : 0;
+}
+
+tusb_dir_t tuh_audio_stream_dir(uint8_t idx, uint8_t stream) {
+  audioh_stream_t* p_stream = get_stream(idx, stream);
+  return (p_stream && p_stream->dir) ? TUSB_DIR_IN : TUSB_DIR_OUT;
+}
+
+uint8_t tuh_audio_stream_alt_count(uint8_t idx, uint8_t stream) {
+  audioh_stream_t* p_stream = get_stream(idx, stream);
+  return p_stream ? p_stream->alt_count : 0;
+}
+
+tuh_audio_alt_t const* tuh_audio_stream_alt(uint8_t idx, uint8_t stream, uint8_t alt_idx) {
+  audioh_stream_t* p_stream = get_stream(idx, stream);
+  TU_VERIFY(p_stream && alt_idx < p_stream->alt_count, NULL);
+  return &p_stream->alt[alt_idx];
+}
+
+// UAC1 alternate settings list supported rates, UAC2 rates are queried from the clock source by application if needed
+static bool audioh_rate_supported(tuh_audio_alt_t const* alt, uint32_t sample_rate) {
+  if (alt->n_freq == 0) {
+    return (alt->freq[0] == 0 && alt->freq[1] == 0) || (sample_rate >= alt->freq[0] && sample_rate <= alt->freq[1]);
+  }
+
+  for (uint8_t i = 0; i < alt->n_freq; i++) {
+    if (alt->freq[i] == sample_rate) return true;
+  }
+  return false;
+}
+
+bool tuh_audio_stream_open(uint8_t idx, uint8_t stream, uint8_t alt_idx, uint32_t sample_rate) {
+  audioh_interface_t* p_audio = get_itf(idx);
+  audioh_stream_t* p_stream = get_stream(idx, stream);
+  TU_VERIFY(p_stream && !p_audio->ctrl_busy && p_stream->state == AUDIOH_STREAM_IDLE);
+  TU_VERIFY(alt_idx < p_stream->alt_count && sample_rate);
+
+  tuh_audio_alt_t const* alt = &p_stream->alt[alt_idx];
+  TU_VERIFY(AUDIO_FORMAT_TYPE_I == alt->format_type && alt->n_channels && alt->subslot_size);
+  TU_VERIFY(alt->ep_size <= CFG_TUH_AUDIO_EP_BUFSIZE);
+  TU_VERIFY(audioh_rate_supported(alt, sample_rate));
+
+  p_stream->alt_idx     = alt_idx;
+  p_stream->sample_rate = sample_rate;
+  p_stream->state       = AUDIOH_STREAM_OPENING;
+  p_audio->ctrl_busy    = true;
+
+  TU_LOG_DRV("  Audio stream %u open: alt = %u, rate = %lu\r\n", stream, alt->alt, sample_rate);
+
+  if (!tuh_interface_set(p_audio->daddr, p_stream->itf_num, alt->alt, audioh_process_stream,
+                         stream_state(idx, stream, STREAM_SET_FREQ))) {
+    p_stream->state    = AUDIOH_STREAM_IDLE;
+    p_audio->ctrl_busy = false;
+    return false;
+  }
+
+  return true;
+}
+
+bool tuh_audio_stream_active(uint8_t idx, uint8_t stream) {
+  audioh_stream_t* p_stream = get_stream(idx, stream);
+  return p_stream && p_stream->state == AUDIOH_STREAM_ACTIVE;
+}
+
+uint32_t tuh_audio_stream_sample_rate(uint8_t idx, uint8_t stream) {
+  audioh_stream_t* p_stream = get_stream(idx, stream);
+  return (p_stream && p_stream->state == AUDIOH_STREAM_ACTIVE) ? p_stream->sample_rate : 0;
+}
+
+uint32_t tuh_audio_stream_feedback(uint8_t idx, uint8_t stream) {
+  audioh_stream_t* p_stream = get_stream(idx, stream);
+  return (p_stream && p_stream->state == AUDIOH_STREAM_ACTIVE) ? p_stream->feedback : 0;
+}
+
+tu_fifo_t* tuh_audio_stream_fifo(uint8_t idx, uint8_t stream) {
+  audioh_stream_t* p_stream = get_stream(idx, stream);
+  return p_stream ? &p_stream->ff : NULL;
+}
+
+uint16_t tuh_audio_stream_available(uint8_t idx, uint8_t stream) {
+  audioh_stream_t* p_stream = get_stream(idx, stream);
+  TU_VERIFY(p_stream && p_stream->state == AUDIOH_STREAM_ACTIVE, 0);
+  return p_stream->dir ? tu_fifo_count(&p_stream->ff) : tu_fifo_remaining(&p_stream->ff);
+}
+
+uint16_t tuh_audio_stream_read(uint8_t idx, uint8_t stream, void* buffer, uint16_t bufsize) {
+  audioh_stream_t* p_stream = get_stream(idx, stream);
+  TU_VERIFY(p_stream && p_stream->dir && p_stream->state == AUDIOH_STREAM_ACTIVE, 0);
+  return tu_fifo_read_n(&p_stream->ff, buffer, bufsize);
+}
+
+uint16_t tuh_audio_stream_write(uint8_t idx, uint8_t stream, void const* buffer, uint16_t bufsize) {
+  audioh_stream_t* p_stream = get_stream(idx, stream);
+  TU_VERIFY(p_stream && !p_stream->dir && p_stream->state == AUDIOH_STREAM_ACTIVE, 0);
+  return tu_fifo_write_n(&p_stream->ff, buffer, bufsize);
+}
+
+//--------------------------------------------------------------------+
+// Streaming
+//--------------------------------------------------------------------+
+
+static bool audioh_edpt_xfer(uint8_t daddr, uint8_t ep_addr, uint8_t* buffer, uint16_t len) {
+  TU_VERIFY(usbh_edpt_claim(daddr, ep_addr));
+
+  if (!usbh_edpt_xfer(daddr, ep_addr, buffer, len)) {
+    usbh_edpt_release(daddr, ep_addr);
+    return false;
+  }
+
+  return true;
+}
+
+static void audioh_rx_start(audioh_interface_t* p_audio, uint8_t idx, uint8_t stream) {
+  audioh_stream_t* p_stream = &p_audio->stream[stream];
+  p_stream->xfer_busy = audioh_edpt_xfer(p_audio->daddr, p_stream->ep_data,
+                                         audioh_epbuf[idx].ep[stream][p_stream->buf_idx], p_stream->packet_max);
+}
+
+// Take samples for next packet from FIFO: feedback (or nominal) rate accumulated per packet, less on underrun
+static void audioh_tx_prepare(audioh_stream_t* p_stream, uint8_t* buffer, uint8_t buf_idx) {
+  p_stream->accum += p_stream->feedback;
+  uint32_t len = (p_stream->accum >> 16) * p_stream->frame_bytes;
+  p_stream->accum &= 0xFFFFu;
+
+  len = tu_min32(len, p_stream->packet_max);
+
+  uint16_t const available = tu_fifo_count(&p_stream->ff);
+  len = tu_min32(len, available - (available % p_stream->frame_bytes));
+
+  p_stream->tx_len[buf_idx] = tu_fifo_read_n(&p_stream->ff, buffer, (uint16_t) len);
+}
+
+static void audioh_tx_start(audioh_interface_t* p_audio, uint8_t idx, uint8_t stream) {
+  audioh_stream_t* p_stream = &p_audio->stream[stream];
+  uint8_t const buf_idx = p_stream->buf_idx;
+
+  p_stream->xfer_busy = audioh_edpt_xfer(p_audio->daddr, p_stream->ep_data, audioh_epbuf[idx].ep[stream][buf_idx],
+                                         p_stream->tx_len[buf_idx]);
+
+  // prepare the other buffer while this one is on the bus
+  p_stream->buf_idx ^= 1;
+  audioh_tx_prepare(p_stream, audioh_epbuf[idx].ep[stream][p_stream->buf_idx], p_stream->buf_idx);
+}
+
+static void audioh_fb_start(audioh_interface_t* p_audio, uint8_t idx, uint8_t stream) {
+  audioh_stream_t* p_stream = &p_audio->stream[stream];
+  uint8_t const fb_size = p_stream->alt[p_stream->alt_idx].fb_size;
+
+  p_stream->fb_busy = audioh_edpt_xfer(p_audio->daddr, p_stream->ep_fb, audioh_epbuf[idx].fb[stream],
+                                       (uint16_t) tu_min16(fb_size, 4));
+}
+
+// Feedback is samples per (micro)frame: 10.14 in 3 bytes at full speed, 16.16 in 4 bytes at high speed. Some full
+// speed devices send 16.16 in 4 bytes, or 10.14 left aligned, the format closest to nominal rate is taken.
+static void audioh_fb_update(audioh_stream_t* p_stream, uint8_t const* buf, uint32_t len) {
+  TU_VERIFY(len >= 3,);
+
+  uint32_t const raw = (len >= 4) ? tu_unaligned_read32(buf) : (buf[0] | ((uint32_t) buf[1] << 8) | ((uint32_t) buf[2] << 16));
+  uint32_t const nominal = p_stream->nominal >> p_stream->interval_shift;
+  uint32_t const tolerance = nominal >> AUDIOH_FB_TOLERANCE_SHIFT;
+
+  uint32_t candidate[2] = { raw, raw << 2 };
+  if (len == 3) {
+    candidate[0] = raw << 2;
+    candidate[1] = raw;
+  }
+
+  for (uint8_t i = 0; i < 2; i++) {
+    uint32_t const value = candidate[i];
+    if (value + tolerance >= nominal && value <= nominal + tolerance) {
+      p_stream->feedback = value << p_stream->interval_shift;
+      return;
+    }
+  }
+}
+
+static bool audioh_stream_start(audioh_interface_t* p_audio, uint8_t idx, uint8_t stream) {
+  audioh_stream_t* p_stream = &p_audio->stream[stream];
+  tuh_audio_alt_t const* alt = &p_stream->alt[p_stream->alt_idx];
+  bool const is_hs = (TUSB_SPEED_HIGH == tuh_speed_get(p_audio->daddr));
+
+  p_stream->interval_shift = (uint8_t) (tu_min8(tu_max8(alt->interval, 1), 16) - 1);
+  p_stream->frame_bytes    = (uint16_t) (alt->n_channels * alt->subslot_size);
+  p_stream->packet_max     = (uint16_t) (alt->ep_size - (alt->ep_size % p_stream->frame_bytes));
+  p_stream->nominal        = (uint32_t) ((((uint64_t) p_stream->sample_rate << 16) << p_stream->interval_shift) /
+                                         (is_hs ? 8000u : 1000u));
+  p_stream->feedback       = p_stream->nominal;
+  p_stream->accum          = 0;
+  p_stream->buf_idx        = 0;
+
+  uint16_t const depth = (uint16_t) (CFG_TUH_AUDIO_FIFO_SIZE - (CFG_TUH_AUDIO_FIFO_SIZE % p_stream->frame_bytes));
+  TU_ASSERT(depth);
+  tu_fifo_config(&p_stream->ff, audioh_ff_buf[idx][stream], depth, 1, false);
+
+  // enumeration buffer is gone, endpoint descriptors are rebuilt from what was parsed
+  tusb_desc_endpoint_t desc_ep = {
+    .bLength          = sizeof(tusb_desc_endpoint_t),
+    .bDescriptorType  = TUSB_DESC_ENDPOINT,
+    .bEndpointAddress = alt->ep_addr,
+    .bmAttributes     = { .xfer = TUSB_XFER_ISOCHRONOUS, .sync = (uint8_t) ((alt->sync_type >> 2) & 0x03) },
+    .wMaxPacketSize   = tu_htole16(alt->ep_size),
+    .bInterval        = alt->interval
+  };
+  TU_ASSERT(tuh_edpt_open(p_audio->daddr, &desc_ep));
+  p_stream->ep_data = alt->ep_addr;
+
+  if (alt->ep_fb && !p_stream->dir) {
+    desc_ep.bEndpointAddress  = alt->ep_fb;
+    desc_ep.bmAttributes.sync = 0;
+    desc_ep.bmAttributes.usage = 1;
+    desc_ep.wMaxPacketSize    = tu_htole16(alt->fb_size);
+    desc_ep.bInterval         = alt->fb_interval;
+    TU_ASSERT(tuh_edpt_open(p_audio->daddr, &desc_ep));
+    p_stream->ep_fb = alt->ep_fb;
+  }
+
+  p_stream->state = AUDIOH_STREAM_ACTIVE;
+
+  if (p_stream->dir) {
+    audioh_rx_start(p_audio, idx, stream);
+  } else {
+    audioh_tx_prepare(p_stream, audioh_epbuf[idx].ep[stream][0], 0);
+    audioh_tx_start(p_audio, idx, stream);
+    if (p_stream->xfer_busy && p_stream->ep_fb) audioh_fb_start(p_audio, idx, stream);
+  }
+
+  if (!p_stream->xfer_busy) {
+    p_stream->state = AUDIOH_STREAM_OPENING;
+    return false;
+  }
+
+  TU_LOG_DRV("  Audio stream %u active: rate = %lu, nominal = 0x%08lX\r\n", stream, p_stream->sample_rate,
+             p_stream->nominal);
+  return true;
+}
+
+// Close endpoints once no transfer is pending, then select alternate setting 0
+static void audioh_stream_stop(audioh_interface_t* p_audio, uint8_t idx, uint8_t stream) {
+  audioh_stream_t* p_stream = &p_audio->stream[stream];
+  if (p_stream->state != AUDIOH_STREAM_CLOSING || p_stream->xfer_busy || p_stream->fb_busy) return;
+
+  if (p_stream->ep_data) tuh_edpt_close(p_audio->daddr, p_stream->ep_data);
+  if (p_stream->ep_fb) tuh_edpt_close(p_audio->daddr, p_stream->ep_fb);
+  p_stream->ep_data = 0;
+  p_stream->ep_fb   = 0;
+
+  if (!tuh_interface_set(p_audio->daddr, p_stream->itf_num, 0, audioh_process_stream,
+                         stream_state(idx, stream, STREAM_CLOSE_COMPLETE))) {
+    // device keeps its alternate setting, stream can still be re-opened
+    tuh_xfer_t xfer = {
+      .daddr     = p_audio->daddr,
+      .result    = XFER_RESULT_FAILED,
+      .user_data = stream_state(idx, stream, STREAM_CLOSE_COMPLETE)
+    };
+    audioh_process_stream(&xfer);
+  }
+}
+
+bool tuh_audio_stream_close(uint8_t idx, uint8_t stream) {
+  audioh_interface_t* p_audio = get_itf(idx);
+  audioh_stream_t* p_stream = get_stream(idx, stream);
+  TU_VERIFY(p_stream && !p_audio->ctrl_busy && p_stream->state == AUDIOH_STREAM_ACTIVE);
+
+  p_stream->state    = AUDIOH_STREAM_CLOSING;
+  p_audio->ctrl_busy = true;
+
+  audioh_stream_stop(p_audio, idx, stream);
+  return true;
+}
+
+static void audioh_data_complete(audioh_interface_t* p_audio, uint8_t idx, uint8_t stream, xfer_result_t result,
+                                 uint16_t len) {
+  audioh_stream_t* p_stream = &p_audio->stream[stream];
+  p_stream->xfer_busy = false;
+
+  if (p_stream->state != AUDIOH_STREAM_ACTIVE) {
+    audioh_stream_stop(p_audio, idx, stream);
+    return;
+  }
+
+  if (p_stream->dir) {
+    // re-arm with the other buffer first so that no service interval is missed
+    uint8_t const done_idx = p_stream->buf_idx;
+    p_stream->buf_idx ^= 1;
+    audioh_rx_start(p_audio, idx, stream);
+
+    if (result == XFER_RESULT_SUCCESS && len) {
+      uint16_t const remaining = tu_fifo_remaining(&p_stream->ff);
+      len = tu_min16(len, (uint16_t) (remaining - (remaining % p_stream->frame_bytes)));
+      len = (uint16_t) tu_fifo_write_n(&p_stream->ff, audioh_epbuf[idx].ep[stream][done_idx], len);
+      if (tuh_audio_rx_cb) tuh_audio_rx_cb(idx, stream, len);
+    }
+  } else {
+    uint16_t const sent = p_stream->tx_len[p_stream->buf_idx ^ 1];
+    audioh_tx_start(p_audio, idx, stream);
+    if (tuh_audio_tx_cb) tuh_audio_tx_cb(idx, stream, (result == XFER_RESULT_SUCCESS) ? sent : 0);
+  }
+}
+
+static void audioh_fb_complete(audioh_interface_t* p_audio, uint8_t idx, uint8_t stream, xfer_result_t result,
+                               uint32_t len) {
+  audioh_stream_t* p_stream = &p_audio->stream[stream];
+  p_stream->fb_busy = false;
+
+  if (p_stream->state != AUDIOH_STREAM_ACTIVE) {
+    audioh_stream_stop(p_audio, idx, stream);
+    return;
+  }
+
+  if (result == XFER_RESULT_SUCCESS) {
+    audioh_fb_update(p_stream, audioh_epbuf[idx].fb[stream], len);
+  }
+
+  audioh_fb_start(p_audio, idx, stream);
+}
+
+//--------------------------------------------------------------------+
+// Stream open/close sequence
+//--------------------------------------------------------------------+
+
+// Sample rate is a clock source control (UAC2, 4 bytes) or an endpoint control (UAC1, 3 bytes)
+static bool audioh_freq_request(audioh_interface_t* p_audio, uint8_t idx, uint8_t stream, tusb_dir_t dir,
+                                uint8_t next_state) {
+  audioh_stream_t* p_stream = &p_audio->stream[stream];
+  tuh_audio_alt_t const* alt = &p_stream->alt[p_stream->alt_idx];
+  uint8_t* buf = audioh_epbuf[idx].ctrl;
+  bool const uac2 = is_uac2(p_audio);
+
+  uint8_t request_code;
+  uint16_t value, index, length;
+  if (uac2) {
+    request_code = AUDIO_CS_REQ_CUR;
+    value        = AUDIO_CS_CTRL_SAM_FREQ << 8;
+    index        = (uint16_t) ((alt->clock_id << 8) | p_audio->itf_num);
+    length       = 4;
+  } else {
+    request_code = (dir == TUSB_DIR_IN) ? AUDIO10_CS_REQ_GET_CUR : AUDIO10_CS_REQ_SET_CUR;
+    value        = AUDIO10_EP_CTRL_SAMPLING_FREQ << 8;
+    index        = alt->ep_addr;
+    length       = 3;
+  }
+
+  tu_memclr(buf, sizeof(audioh_epbuf[idx].ctrl));
+  if (dir == TUSB_DIR_OUT) {
+    tu_unaligned_write32(buf, tu_htole32(p_stream->sample_rate));
+  }
+
+  tusb_control_request_t const request = {
+    .bmRequestType_bit = {
+      .recipient = uac2 ? TUSB_REQ_RCPT_INTERFACE : TUSB_REQ_RCPT_ENDPOINT,
+      .type      = TUSB_REQ_TYPE_CLASS,
+      .direction = dir
+    },
+    .bRequest = request_code,
+    .wValue   = tu_htole16(value),
+    .wIndex   = tu_htole16(index),
+    .wLength  = tu_htole16(length)
+  };
+
+  tuh_xfer_t xfer = {
+    .daddr       = p_audio->daddr,
+    .ep_addr     = 0,
+    .setup       = &request,
+    .buffer      = buf,
+    .complete_cb = audioh_process_stream,
+    .user_data   = stream_state(idx, stream, next_state)
+  };
+
+  return tuh_control_xfer(&xfer);
+}
+
+static void audioh_process_stream(tuh_xfer_t* xfer) {
+  uint8_t const idx = (uint8_t) (xfer->user_data >> 16);
+  uint8_t const stream = (uint8_t) ((xfer->user_data >> 8) & 0xFF);
+  uint8_t const state = (uint8_t) (xfer->user_data & 0xFF);
+  audioh_interface_t* p_audio = get_itf(idx);
+  TU_ASSERT(p_audio && stream < p_audio->stream_count,);
+
+  audioh_stream_t* p_stream = &p_audio->stream[stream];
+  tuh_audio_alt_t const* alt = &p_stream->alt[p_stream->alt_idx];
+  bool const success = (xfer->result == XFER_RESULT_SUCCESS);
+
+  switch (state) {
+    case STREAM_SET_FREQ:
+      if (!success) break;
+
+      if (AUDIO_CTRL_RW == alt->freq_ctrl) {
+        if (!audioh_freq_request(p_audio, idx, stream, TUSB_DIR_OUT, STREAM_GET_FREQ)) break;
+        return;
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    case STREAM_GET_FREQ:
+      if (!success) break;
+
+      if (alt->freq_ctrl & AUDIO_CTRL_R) {
+        if (!audioh_freq_request(p_audio, idx, stream, TUSB_DIR_IN, STREAM_CHECK_FREQ)) break;
+        return;
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    case STREAM_CHECK_FREQ:
+      if (!success) break;
+
+      if (state == STREAM_CHECK_FREQ) {
+        uint8_t const* buf = audioh_epbuf[idx].ctrl;
+        uint32_t const rate = is_uac2(p_audio) ? tu_le32toh(tu_unaligned_read32(buf)) :
+                              (buf[0] | ((uint32_t) buf[1] << 8) | ((uint32_t) buf[2] << 16));
+
+        // clock may not be exactly at the requested rate, stream at what device reports
+        uint32_t const diff = (rate > p_stream->sample_rate) ? (rate - p_stream->sample_rate) : (p_stream->sample_rate - rate);
+        TU_LOG_DRV("  Audio stream %u: device rate = %lu\r\n", stream, rate);
+        if (diff > (p_stream->sample_rate >> 8)) break;
+        p_stream->sample_rate = rate;
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    case STREAM_START:
+      if (!audioh_stream_start(p_audio, idx, stream)) break;
+
+      p_audio->ctrl_busy = false;
+      if (tuh_audio_stream_open_cb) tuh_audio_stream_open_cb(idx, stream, true);
+      return;
+
+    case STREAM_OPEN_FAILED:
+    case STREAM_CLOSE_COMPLETE:
+      p_stream->state    = AUDIOH_STREAM_IDLE;
+      p_audio->ctrl_busy = false;
+
+      if (state == STREAM_OPEN_FAILED) {
+        if (tuh_audio_stream_open_cb) tuh_audio_stream_open_cb(idx, stream, false);
+      } else {
+        if (tuh_audio_stream_close_cb) tuh_audio_stream_close_cb(idx, stream);
+      }
+      return;
+
+    default:
+      return;
+  }
+
+  // failed to open: close endpoints, and select alternate setting 0 unless selecting the alternate setting failed
+  TU_LOG_DRV("  Audio stream %u open failed at %u\r\n", stream, state);
+  if (p_stream->ep_data) tuh_edpt_close(p_audio->daddr, p_stream->ep_data);
+  if (p_stream->ep_fb) tuh_edpt_close(p_audio->daddr, p_stream->ep_fb);
+  p_stream->ep_data = 0;
+  p_stream->ep_fb   = 0;
+
+  if ((state == STREAM_SET_FREQ && !success) ||
+      !tuh_interface_set(p_audio->daddr, p_stream->itf_num, 0, audioh_process_stream,
+                         stream_state(idx, stream, STREAM_OPEN_FAILED))) {
+    tuh_xfer_t fail = {
+      .daddr     = p_audio->daddr,
+      .result    = XFER_RESULT_FAILED,
+      .user_data = stream_state(idx, stream, STREAM_OPEN_FAILED)
+    };
+    audioh_process_stream(&fail);
+  }
+}
+
+//--------------------------------------------------------------------+
+// CLASS DRIVER API
+//--------------------------------------------------------------------+
+
+bool audioh_init(void) {
+  TU_LOG_DRV("sizeof(audioh_interface_t) = %u\r\n", sizeof(audioh_interface_t));
+  tu_memclr(audioh_data, sizeof(audioh_data));
+  return true;
+}
+
+bool audioh_deinit(void) {
+  return true;
+}
+
+void audioh_close(uint8_t daddr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_AUDIO; idx++) {
+    audioh_interface_t* p_audio = &audioh_data[idx];
+    if (p_audio->daddr == daddr) {
+      TU_LOG_DRV("  Audioh close addr = %u index = %u\r\n", daddr, idx);
+      bool const mounted = p_audio->mounted;
+      tu_memclr(p_audio, sizeof(audioh_interface_t));
+
+      if (mounted && tuh_audio_umount_cb) tuh_audio_umount_cb(idx);
+    }
+  }
+}
+
+bool audioh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes) {
+  for (uint8_t idx = 0; idx < CFG_TUH_AUDIO; idx++) {
+    audioh_interface_t* p_audio = &audioh_data[idx];
+    if (p_audio->daddr != daddr) continue;
+
+    for (uint8_t stream = 0; stream < p_audio->stream_count; stream++) {
+      audioh_stream_t* p_stream = &p_audio->stream[stream];
+      if (ep_addr == p_stream->ep_data) {
+        audioh_data_complete(p_audio, idx, stream, event, (uint16_t) xferred_bytes);
+        return true;
+      } else if (ep_addr == p_stream->ep_fb) {
+        audioh_fb_complete(p_audio, idx, stream, event, xferred_bytes);
+        return true;
+      }
+    }
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
+
+static uint8_t const* audioh_find_entity(uint8_t const* ac_desc, uint16_t ac_len, uint8_t id) {
+  uint8_t const* p_desc = ac_desc;
+  uint8_t const* desc_end = ac_desc + ac_len;
+
+  while (p_desc < desc_end) {
+    // all units, terminals and clock entities have their ID at offset 3
+    if (TUSB_DESC_CS_INTERFACE == tu_desc_type(p_desc) && tu_desc_len(p_desc) >= 4 &&
+        p_desc[2] >= AUDIO_CS_AC_INTERFACE_INPUT_TERMINAL && p_desc[3] == id) {
+      return p_desc;
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return NULL;
+}
+
+// UAC2: follow terminal to its clock source through selectors (currently first input) and multipliers
+static uint8_t audioh_find_clock(uint8_t const* ac_desc, uint16_t ac_len, uint8_t terminal, uint8_t* freq_ctrl) {
+  uint8_t const* entity = audioh_find_entity(ac_desc, ac_len, terminal);
+  TU_VERIFY(entity, 0);
+
+  uint8_t id;
+  if (AUDIO_CS_AC_INTERFACE_INPUT_TERMINAL == entity[2] && tu_desc_len(entity) >= 8) {
+    id = entity[7];
+  } else if (AUDIO_CS_AC_INTERFACE_OUTPUT_TERMINAL == entity[2] && tu_desc_len(entity) >= 9) {
+    id = entity[8];
+  } else {
+    return 0;
+  }
+
+  for (uint8_t hop = 0; hop < AUDIOH_CLOCK_HOP_MAX; hop++) {
+    entity = audioh_find_entity(ac_desc, ac_len, id);
+    TU_VERIFY(entity && tu_desc_len(entity) >= 6, 0);
+
+    switch (entity[2]) {
+      case AUDIO_CS_AC_INTERFACE_CLOCK_SOURCE:
+        *freq_ctrl = entity[5] & 0x03;
+        return id;
+
+      case AUDIO_CS_AC_INTERFACE_CLOCK_SELECTOR:
+        id = entity[5];
+        break;
+
+      case AUDIO_CS_AC_INTERFACE_CLOCK_MULTIPLIER:
+        id = entity[4];
+        break;
+
+      default:
+        return 0;
+    }
+  }
+
+  return 0;
+}
+
+static void audioh_parse_format(audioh_interface_t const* p_audio, tuh_audio_alt_t* alt, uint8_t const* p_desc) {
+  uint8_t const len = tu_desc_len(p_desc);
+  TU_VERIFY(len >= 6,);
+
+  alt->format_type = p_desc[3];
+
+  if (is_uac2(p_audio)) {
+    alt->subslot_size   = p_desc[4];
+    alt->bit_resolution = p_desc[5];
+    return;
+  }
+
+  TU_VERIFY(len >= 8,);
+  alt->n_channels     = p_desc[4];
+  alt->subslot_size   = p_desc[5];
+  alt->bit_resolution = p_desc[6];
+
+  // bSamFreqType = 0: continuous range, tLowerSamFreq and tUpperSamFreq
+  uint8_t const n_freq = p_desc[7];
+  uint8_t const count = n_freq ? tu_min8(n_freq, CFG_TUH_AUDIO_FREQ_MAX) : 2;
+  alt->n_freq = n_freq ? count : 0;
+
+  for (uint8_t i = 0; i < count && 8u + 3u*i + 3u <= len; i++) {
+    uint8_t const* f = p_desc + 8 + 3*i;
+    alt->freq[i] = f[0] | ((uint32_t) f[1] << 8) | ((uint32_t) f[2] << 16);
+  }
+}
+
+bool audioh_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* itf_desc, uint16_t max_len) {
+  (void) rhport;
+
+  TU_VERIFY(TUSB_CLASS_AUDIO == itf_desc->bInterfaceClass && AUDIO_SUBCLASS_CONTROL == itf_desc->bInterfaceSubClass);
+
+  uint8_t const idx = tuh_audio_itf_get_index(0);
+  audioh_interface_t* p_audio = (idx < CFG_TUH_AUDIO) ? &audioh_data[idx] : NULL;
+  TU_VERIFY(p_audio);
+
+  tu_memclr(p_audio, sizeof(audioh_interface_t));
+  p_audio->itf_num  = itf_desc->bInterfaceNumber;
+  p_audio->itf_last = itf_desc->bInterfaceNumber;
+
+  uint8_t const* p_desc = (uint8_t const*) itf_desc;
+  uint8_t const* desc_end = p_desc + max_len;
+
+  // AudioControl interface: class-specific descriptors are kept to resolve clocks of streaming interfaces
+  uint8_t const* ac_desc = tu_desc_next(p_desc);
+  p_desc = ac_desc;
+  while (p_desc < desc_end && TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) {
+    if (TUSB_DESC_CS_INTERFACE == tu_desc_type(p_desc) && AUDIO_CS_AC_INTERFACE_HEADER == p_desc[2] &&
+        tu_desc_len(p_desc) >= 5) {
+      p_audio->bcd_adc = tu_unaligned_read16(p_desc + 3);
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+  uint16_t const ac_len = (uint16_t) (p_desc - ac_desc);
+  TU_VERIFY(p_audio->bcd_adc);
+
+  // AudioStreaming interfaces
+  audioh_stream_t* p_stream = NULL;
+  tuh_audio_alt_t* alt = NULL;
+
+  while (p_desc < desc_end) {
+    uint8_t const type = tu_desc_type(p_desc);
+
+    if (TUSB_DESC_INTERFACE == type) {
+      tusb_desc_interface_t const* desc_itf = (tusb_desc_interface_t const*) p_desc;
+      p_stream = NULL;
+      alt = NULL;
+
+      // end of audio streaming: another class, another audio function or MIDIStreaming interface (MIDI driver)
+      if (TUSB_CLASS_AUDIO != desc_itf->bInterfaceClass || AUDIO_SUBCLASS_STREAMING != desc_itf->bInterfaceSubClass) break;
+      p_audio->itf_last = tu_max8(p_audio->itf_last, desc_itf->bInterfaceNumber);
+
+      for (uint8_t i = 0; i < p_audio->stream_count; i++) {
+        if (p_audio->stream[i].itf_num == desc_itf->bInterfaceNumber) p_stream = &p_audio->stream[i];
+      }
+      if (!p_stream && p_audio->stream_count < CFG_TUH_AUDIO_STREAM_MAX) {
+        p_stream = &p_audio->stream[p_audio->stream_count++];
+        p_stream->itf_num = desc_itf->bInterfaceNumber;
+      }
+
+      if (p_stream && desc_itf->bAlternateSetting && desc_itf->bNumEndpoints &&
+          p_stream->alt_count < CFG_TUH_AUDIO_ALT_MAX) {
+        alt = &p_stream->alt[p_stream->alt_count++];
+        alt->alt = desc_itf->bAlternateSetting;
+      }
+    } else if (TUSB_DESC_CS_INTERFACE == type && alt && tu_desc_len(p_desc) >= 4) {
+      if (AUDIO_CS_AS_INTERFACE_AS_GENERAL == p_desc[2]) {
+        p_stream->terminal = p_desc[3];
+        if (is_uac2(p_audio)) {
+          if (tu_desc_len(p_desc) >= 11) alt->n_channels = p_desc[10];
+          alt->clock_id = audioh_find_clock(ac_desc, ac_len, p_stream->terminal, &alt->freq_ctrl);
+        }
+      } else if (AUDIO_CS_AS_INTERFACE_FORMAT_TYPE == p_desc[2]) {
+        audioh_parse_format(p_audio, alt, p_desc);
+      }
+    } else if (TUSB_DESC_ENDPOINT == type && alt) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+
+      if (TUSB_XFER_ISOCHRONOUS == desc_ep->bmAttributes.xfer) {
+        if (1 == desc_ep->bmAttributes.usage) {
+          alt->ep_fb       = desc_ep->bEndpointAddress;
+          alt->fb_size     = (uint8_t) tu_min16(tu_edpt_packet_size(desc_ep), 4);
+          alt->fb_interval = desc_ep->bInterval;
+        } else {
+          alt->ep_addr   = desc_ep->bEndpointAddress;
+          alt->ep_size   = tu_edpt_packet_size(desc_ep);
+          alt->interval  = desc_ep->bInterval;
+          alt->sync_type = (uint8_t) (desc_ep->bmAttributes.sync << 2);
+          p_stream->dir  = (uint8_t) tu_edpt_dir(desc_ep->bEndpointAddress);
+        }
+      }
+    } else if (TUSB_DESC_CS_ENDPOINT == type && alt && !is_uac2(p_audio) && tu_desc_len(p_desc) >= 4) {
+      if (p_desc[3] & AUDIO10_CS_AS_ISO_DATA_EP_ATT_SAMPLING_FREQ) alt->freq_ctrl = AUDIO_CTRL_RW;
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  // function without audio streaming e.g MIDI only is left for other drivers
+  if (!p_audio->stream_count) {
+    return false;
+  }
+
+  p_audio->daddr = daddr;
+
+  TU_LOG_DRV("  UAC%u: control itf = %u, %u streams, last itf = %u\r\n", is_uac2(p_audio) ? 2 : 1,
+             p_audio->itf_num, p_audio->stream_count, p_audio->itf_last);
+
+  return true;
+}
+
+bool audioh_set_config(uint8_t daddr, uint8_t itf_num) {
+  uint8_t idx = TUSB_INDEX_INVALID_8;
+  for (uint8_t i = 0; i < CFG_TUH_AUDIO; i++) {
+    if (audioh_data[i].daddr == daddr && audioh_data[i].itf_num == itf_num) idx = i;
+  }
+  TU_ASSERT(idx < CFG_TUH_AUDIO);
+
+  audioh_interface_t* p_audio = &audioh_data[idx];
+  p_audio->mounted = true;
+
+  TU_LOG_DRV("Audioh Set Configure complete\r\n");
+  if (tuh_audio_mount_cb) tuh_audio_mount_cb(idx);
+
+  // notify usbh that driver enumeration is complete
+  usbh_driver_set_config_complete(daddr, p_audio->itf_last);
+  return true;
+}
+
+#endif
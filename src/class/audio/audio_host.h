@@ -0,0 +1,184 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_AUDIO_HOST_H_
+#define _TUSB_AUDIO_HOST_H_
+
+#include "audio.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Host driver for USB Audio Class 1.0 and 2.0 functions with Type I PCM streaming interfaces.
+// - Each AudioStreaming interface is a stream, opened with an alternate setting and a sample rate. Sample rate is set
+//   on the clock source (UAC2) or the endpoint (UAC1) and read back.
+// - Samples are streamed through a tu_fifo per stream. Receive buffers are double buffered: the isochronous IN
+//   endpoint is re-armed with the other buffer before received data is copied into the FIFO. Transmit packets are
+//   prepared one ahead.
+// - Asynchronous OUT streams follow the device's explicit feedback endpoint, otherwise the nominal rate is sent.
+// Requires host controller driver with isochronous transfer support.
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// Maximum number of AudioStreaming interfaces per audio function
+#ifndef CFG_TUH_AUDIO_STREAM_MAX
+#define CFG_TUH_AUDIO_STREAM_MAX    2
+#endif
+
+// Maximum number of (non-zero) alternate settings recorded per AudioStreaming interface
+#ifndef CFG_TUH_AUDIO_ALT_MAX
+#define CFG_TUH_AUDIO_ALT_MAX       4
+#endif
+
+// Maximum number of discrete sample rates recorded per alternate setting (UAC1)
+#ifndef CFG_TUH_AUDIO_FREQ_MAX
+#define CFG_TUH_AUDIO_FREQ_MAX      4
+#endif
+
+// Size of each of the 2 endpoint buffers per stream, must hold largest wMaxPacketSize of used alternate settings
+#ifndef CFG_TUH_AUDIO_EP_BUFSIZE
+#define CFG_TUH_AUDIO_EP_BUFSIZE    (TUH_OPT_HIGH_SPEED ? 1024 : 256)
+#endif
+
+// Size of sample FIFO per stream
+#ifndef CFG_TUH_AUDIO_FIFO_SIZE
+#define CFG_TUH_AUDIO_FIFO_SIZE     (4*CFG_TUH_AUDIO_EP_BUFSIZE)
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Alternate setting of an AudioStreaming interface
+typedef struct {
+  uint8_t  alt;            // bAlternateSetting
+  uint8_t  ep_addr;        // isochronous data endpoint
+  uint8_t  ep_fb;          // explicit feedback endpoint, 0 if not available
+  uint8_t  sync_type;      // TUSB_ISO_EP_ATT_ASYNCHRONOUS, _ADAPTIVE, _SYNCHRONOUS or _NO_SYNC
+  uint16_t ep_size;        // wMaxPacketSize of data endpoint
+  uint8_t  interval;       // bInterval of data endpoint
+  uint8_t  fb_interval;    // bInterval of feedback endpoint
+  uint8_t  fb_size;        // wMaxPacketSize of feedback endpoint
+
+  uint8_t  format_type;    // AUDIO_FORMAT_TYPE_I
+  uint8_t  n_channels;
+  uint8_t  subslot_size;   // bytes per sample
+  uint8_t  bit_resolution;
+
+  uint8_t  clock_id;       // UAC2: clock source driving the linked terminal
+  uint8_t  freq_ctrl;      // sample rate control: AUDIO_CTRL_NONE, AUDIO_CTRL_R or AUDIO_CTRL_RW (host programmable)
+
+  // UAC1: n_freq discrete rates, or continuous range freq[0]..freq[1] if n_freq = 0. Not used for UAC2.
+  uint8_t  n_freq;
+  uint32_t freq[CFG_TUH_AUDIO_FREQ_MAX];
+} tuh_audio_alt_t;
+
+// Get interface index from device address, return TUSB_INDEX_INVALID_8 (0xFF) if not found
+uint8_t tuh_audio_itf_get_index(uint8_t daddr);
+
+// Check if interface is mounted
+bool tuh_audio_mounted(uint8_t idx);
+
+// Get audio class version (bcdADC) e.g 0x0100 or 0x0200
+uint16_t tuh_audio_version(uint8_t idx);
+
+// Get number of streams (AudioStreaming interfaces)
+uint8_t tuh_audio_stream_count(uint8_t idx);
+
+// Get stream direction: TUSB_DIR_IN (device to host, e.g microphone) or TUSB_DIR_OUT (host to device, e.g speaker)
+tusb_dir_t tuh_audio_stream_dir(uint8_t idx, uint8_t stream);
+
+// Get number of alternate settings for streaming, and their descriptions
+uint8_t tuh_audio_stream_alt_count(uint8_t idx, uint8_t stream);
+tuh_audio_alt_t const* tuh_audio_stream_alt(uint8_t idx, uint8_t stream, uint8_t alt_idx);
+
+// Start streaming with an alternate setting and sample rate. Completion is reported by tuh_audio_stream_open_cb()
+bool tuh_audio_stream_open(uint8_t idx, uint8_t stream, uint8_t alt_idx, uint32_t sample_rate);
+
+// Stop streaming and select alternate setting 0. Completion is reported by tuh_audio_stream_close_cb()
+bool tuh_audio_stream_close(uint8_t idx, uint8_t stream);
+
+// Check if stream is streaming
+bool tuh_audio_stream_active(uint8_t idx, uint8_t stream);
+
+// Get sample rate reported by device after tuh_audio_stream_open()
+uint32_t tuh_audio_stream_sample_rate(uint8_t idx, uint8_t stream);
+
+// Get current feedback of an OUT stream: samples per service interval in 16.16 format
+uint32_t tuh_audio_stream_feedback(uint8_t idx, uint8_t stream);
+
+// Sample FIFO of stream, e.g to be read/written directly by a DMA or DSP pipeline
+tu_fifo_t* tuh_audio_stream_fifo(uint8_t idx, uint8_t stream);
+
+// Number of bytes available to read from an IN stream / free to write to an OUT stream
+uint16_t tuh_audio_stream_available(uint8_t idx, uint8_t stream);
+
+// Read samples received from an IN stream
+uint16_t tuh_audio_stream_read(uint8_t idx, uint8_t stream, void* buffer, uint16_t bufsize);
+
+// Write samples to be sent to an OUT stream
+uint16_t tuh_audio_stream_write(uint8_t idx, uint8_t stream, void const* buffer, uint16_t bufsize);
+
+//--------------------------------------------------------------------+
+// Application Callbacks (Weak is optional)
+//--------------------------------------------------------------------+
+
+// Invoked when a device with audio function is mounted
+TU_ATTR_WEAK void tuh_audio_mount_cb(uint8_t idx);
+
+// Invoked when a device with audio function is unmounted
+TU_ATTR_WEAK void tuh_audio_umount_cb(uint8_t idx);
+
+// Invoked when tuh_audio_stream_open() is complete, streaming is started if success
+TU_ATTR_WEAK void tuh_audio_stream_open_cb(uint8_t idx, uint8_t stream, bool success);
+
+// Invoked when tuh_audio_stream_close() is complete
+TU_ATTR_WEAK void tuh_audio_stream_close_cb(uint8_t idx, uint8_t stream);
+
+// Invoked when a packet of an IN stream is written to its FIFO
+TU_ATTR_WEAK void tuh_audio_rx_cb(uint8_t idx, uint8_t stream, uint16_t n_bytes);
+
+// Invoked when a packet of an OUT stream is sent and next one is taken from its FIFO
+TU_ATTR_WEAK void tuh_audio_tx_cb(uint8_t idx, uint8_t stream, uint16_t n_bytes);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+bool audioh_init       (void);
+bool audioh_deinit     (void);
+bool audioh_open       (uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const *itf_desc, uint16_t max_len);
+bool audioh_set_config (uint8_t daddr, uint8_t itf_num);
+bool audioh_xfer_cb    (uint8_t daddr, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+void audioh_close      (uint8_t daddr);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
@@ -0,0 +1,601 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_AUDIO_INTERLEAVE_H_
+#define _TUSB_AUDIO_INTERLEAVE_H_
+
+#include "common/tusb_common.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Kernels moving PCM samples between an interleaved stream (EP linear buffer) and the support FIFOs according to
+// 2.3.1.5 Audio Streams. One FIFO contains 2 channels, hence a slice of (2 * n_bytes_per_sample) bytes is moved per
+// FIFO and audio frame, while the stream pointer skips the slices of the other (n_ff_used - 1) FIFOs.
+// Length is a multiple of the slice size. Both buffers are aligned to the slice size (at most to 4 bytes), which is
+// ensured by set_interface configuring the FIFO depth as a multiple of the slice size.
+//
+// Kernels are selected at compile time, the generic ones are used for anything not covered by an optimized kernel.
+// All kernels are plain C written such that the compiler maps them to the intended instructions.
+
+//--------------------------------------------------------------------+
+// Configuration
+//--------------------------------------------------------------------+
+
+// Pack two 2-byte slices (1-byte samples) into one word access on the FIFO side (PKHBT on ARMv7E-M DSP, PKBB16 on
+// RISC-V P extension), and move 6-byte slices (3-byte samples) with one word and one halfword access
+#ifndef CFG_TUD_AUDIO_INTERLEAVE_PACKED
+  #if ((defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP) || defined(__riscv_dsp) || defined(__riscv_p)) && \
+      (TU_BYTE_ORDER == TU_LITTLE_ENDIAN)
+    #define CFG_TUD_AUDIO_INTERLEAVE_PACKED   1
+  #else
+    #define CFG_TUD_AUDIO_INTERLEAVE_PACKED   0
+  #endif
+#endif
+
+// Move 8-byte slices (4-byte samples) with one 64-bit access (LDRD/STRD), which pays off on the 64-bit bus of Cortex-M7
+#ifndef CFG_TUD_AUDIO_INTERLEAVE_WIDE64
+  #if TU_CHECK_MCU(OPT_MCU_STM32F7, OPT_MCU_STM32H7, OPT_MCU_MIMXRT1XXX, OPT_MCU_SAMX7X)
+    #define CFG_TUD_AUDIO_INTERLEAVE_WIDE64   1
+  #else
+    #define CFG_TUD_AUDIO_INTERLEAVE_WIDE64   0
+  #endif
+#endif
+
+// 64-bit type only requiring word alignment, which is enough for LDRD/STRD on ARMv7-M
+typedef uint64_t TU_ATTR_ALIGNED(4) tu_audio_u64a4_t;
+
+//--------------------------------------------------------------------+
+// Generic kernels
+//--------------------------------------------------------------------+
+
+// Copy interleaved stream into one FIFO, return stream pointer past the last slice (including skipped slices)
+static inline void const* tu_audio_deinterleave_generic(uint8_t n_bytes_per_sample, void* dst, uint16_t len,
+                                                        void const* src, uint8_t n_ff_used) {
+  uint16_t* dst16 = (uint16_t*) dst;
+  uint16_t const* src16 = (uint16_t const*) src;
+  uint32_t* dst32 = (uint32_t*) dst;
+  uint32_t const* src32 = (uint32_t const*) src;
+
+  switch (n_bytes_per_sample) {
+    case 1:
+      for (uint16_t n = len / 2; n; n--) {
+        *dst16++ = *src16;
+        src16 += n_ff_used;
+      }
+      return src16;
+
+    case 2:
+      for (uint16_t n = len / 4; n; n--) {
+        *dst32++ = *src32;
+        src32 += n_ff_used;
+      }
+      return src32;
+
+    case 3:
+      for (uint16_t n = len / 6; n; n--) {
+        dst16[0] = src16[0];
+        dst16[1] = src16[1];
+        dst16[2] = src16[2];
+        dst16 += 3;
+        src16 += 3 * n_ff_used;
+      }
+      return src16;
+
+    default:
+      for (uint16_t n = len / 8; n; n--) {
+        dst32[0] = src32[0];
+        dst32[1] = src32[1];
+        dst32 += 2;
+        src32 += 2 * n_ff_used;
+      }
+      return src32;
+  }
+}
+
+// Copy one FIFO into interleaved stream, return stream pointer past the last slice (including skipped slices)
+static inline void* tu_audio_interleave_generic(uint8_t n_bytes_per_sample, void* dst, void const* src, uint16_t len,
+                                                uint8_t n_ff_used) {
+  uint16_t* dst16 = (uint16_t*) dst;
+  uint16_t const* src16 = (uint16_t const*) src;
+  uint32_t* dst32 = (uint32_t*) dst;
+  uint32_t const* src32 = (uint32_t const*) src;
+
+  switch (n_bytes_per_sample) {
+    case 1:
+      for (uint16_t n = len / 2; n; n--) {
+        *dst16 = *src16++;
+        dst16 += n_ff_used;
+      }
+      return dst16;
+
+    case 2:
+      for (uint16_t n = len / 4; n; n--) {
+        *dst32 = *src32++;
+        dst32 += n_ff_used;
+      }
+      return dst32;
+
+    case 3:
+      for (uint16_t n = len / 6; n; n--) {
+        dst16[0] = src16[0];
+        dst16[1] = src16[1];
+        dst16[2] = src16[2];
+        dst16 += 3 * n_ff_used;
+        src16 += 3;
+      }
+      return dst16;
+
+    default:
+      for (uint16_t n = len / 8; n; n--) {
+        dst32[0] = src32[0];
+        dst32[1] = src32[1];
+        dst32 += 2 * n_ff_used;
+        src32 += 2;
+      }
+      return dst32;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Packed kernels
+//--------------------------------------------------------------------+
+
+// 1-byte samples: two slices are combined into one word store. FIFO side is only halfword aligned, a leading slice is
+// copied alone if needed.
+static inline void const* tu_audio_deinterleave_pk16(void* dst, uint16_t len, void const* src, uint8_t n_ff_used) {
+  uint16_t* dst16 = (uint16_t*) dst;
+  uint16_t const* src16 = (uint16_t const*) src;
+  uint16_t n = len / 2;
+
+  if (n && ((uintptr_t) dst16 & 2u)) {
+    *dst16++ = *src16;
+    src16 += n_ff_used;
+    n--;
+  }
+
+  uint32_t* dst32 = (uint32_t*) (void*) dst16;
+  for (; n >= 2; n -= 2) {
+    uint32_t const lo = src16[0];
+    uint32_t const hi = src16[n_ff_used];
+    *dst32++ = lo | (hi << 16);
+    src16 += 2 * n_ff_used;
+  }
+
+  if (n) {
+    dst16 = (uint16_t*) (void*) dst32;
+    *dst16 = *src16;
+    src16 += n_ff_used;
+  }
+
+  return src16;
+}
+
+// 1-byte samples: one word load from FIFO is split into two slices
+static inline void* tu_audio_interleave_pk16(void* dst, void const* src, uint16_t len, uint8_t n_ff_used) {
+  uint16_t* dst16 = (uint16_t*) dst;
+  uint16_t const* src16 = (uint16_t const*) src;
+  uint16_t n = len / 2;
+
+  if (n && ((uintptr_t) src16 & 2u)) {
+    *dst16 = *src16++;
+    dst16 += n_ff_used;
+    n--;
+  }
+
+  uint32_t const* src32 = (uint32_t const*) (void const*) src16;
+  for (; n >= 2; n -= 2) {
+    uint32_t const w = *src32++;
+    dst16[0] = (uint16_t) w;
+    dst16[n_ff_used] = (uint16_t) (w >> 16);
+    dst16 += 2 * n_ff_used;
+  }
+
+  if (n) {
+    src16 = (uint16_t const*) (void const*) src32;
+    *dst16 = *src16;
+    dst16 += n_ff_used;
+  }
+
+  return dst16;
+}
+
+// 3-byte samples: each 6-byte slice is moved as one (unaligned) word and one halfword
+static inline void const* tu_audio_deinterleave_pk24(void* dst, uint16_t len, void const* src, uint8_t n_ff_used) {
+  uint8_t* dst8 = (uint8_t*) dst;
+  uint8_t const* src8 = (uint8_t const*) src;
+  size_t const stride = 6u * n_ff_used;
+
+  for (uint16_t n = len / 6; n; n--) {
+    tu_unaligned_write32(dst8, tu_unaligned_read32(src8));
+    tu_unaligned_write16(dst8 + 4, tu_unaligned_read16(src8 + 4));
+    dst8 += 6;
+    src8 += stride;
+  }
+
+  return src8;
+}
+
+static inline void* tu_audio_interleave_pk24(void* dst, void const* src, uint16_t len, uint8_t n_ff_used) {
+  uint8_t* dst8 = (uint8_t*) dst;
+  uint8_t const* src8 = (uint8_t const*) src;
+  size_t const stride = 6u * n_ff_used;
+
+  for (uint16_t n = len / 6; n; n--) {
+    tu_unaligned_write32(dst8, tu_unaligned_read32(src8));
+    tu_unaligned_write16(dst8 + 4, tu_unaligned_read16(src8 + 4));
+    dst8 += stride;
+    src8 += 6;
+  }
+
+  return dst8;
+}
+
+//--------------------------------------------------------------------+
+// Wide kernels
+//--------------------------------------------------------------------+
+
+// 4-byte samples: each 8-byte slice is moved with one 64-bit access
+static inline void const* tu_audio_deinterleave_w64(void* dst, uint16_t len, void const* src, uint8_t n_ff_used) {
+  tu_audio_u64a4_t* dst64 = (tu_audio_u64a4_t*) dst;
+  tu_audio_u64a4_t const* src64 = (tu_audio_u64a4_t const*) src;
+
+  for (uint16_t n = len / 8; n; n--) {
+    *dst64++ = *src64;
+    src64 += n_ff_used;
+  }
+
+  return src64;
+}
+
+static inline void* tu_audio_interleave_w64(void* dst, void const* src, uint16_t len, uint8_t n_ff_used) {
+  tu_audio_u64a4_t* dst64 = (tu_audio_u64a4_t*) dst;
+  tu_audio_u64a4_t const* src64 = (tu_audio_u64a4_t const*) src;
+
+  for (uint16_t n = len / 8; n; n--) {
+    *dst64 = *src64++;
+    dst64 += n_ff_used;
+  }
+
+  return dst64;
+}
+
+//--------------------------------------------------------------------+
+// API
+//--------------------------------------------------------------------+
+
+// Decode: copy len bytes of one FIFO's channels from interleaved stream src into dst.
+// Return stream pointer to continue with (e.g for the wrapped part of the FIFO)
+TU_ATTR_ALWAYS_INLINE static inline void const* tu_audio_deinterleave(uint8_t n_bytes_per_sample, void* dst, uint16_t len,
+                                                                      void const* src, uint8_t n_ff_used) {
+  // Single FIFO: stream is not interleaved at all
+  if (n_ff_used == 1) {
+    memcpy(dst, src, len);
+    return (uint8_t const*) src + len;
+  }
+
+#if CFG_TUD_AUDIO_INTERLEAVE_PACKED
+  if (n_bytes_per_sample == 1) return tu_audio_deinterleave_pk16(dst, len, src, n_ff_used);
+  #if !TUP_ARCH_STRICT_ALIGN && !TUP_MCU_STRICT_ALIGN
+  if (n_bytes_per_sample == 3) return tu_audio_deinterleave_pk24(dst, len, src, n_ff_used);
+  #endif
+#endif
+
+#if CFG_TUD_AUDIO_INTERLEAVE_WIDE64
+  if (n_bytes_per_sample == 4) return tu_audio_deinterleave_w64(dst, len, src, n_ff_used);
+#endif
+
+  return tu_audio_deinterleave_generic(n_bytes_per_sample, dst, len, src, n_ff_used);
+}
+
+// Encode: copy len bytes of one FIFO's channels from src into interleaved stream dst.
+// Return stream pointer to continue with (e.g for the wrapped part of the FIFO)
+TU_ATTR_ALWAYS_INLINE static inline void* tu_audio_interleave(uint8_t n_bytes_per_sample, void* dst, void const* src,
+                                                              uint16_t len, uint8_t n_ff_used) {
+  if (n_ff_used == 1) {
+    memcpy(dst, src, len);
+    return (uint8_t*) dst + len;
+  }
+
+#if CFG_TUD_AUDIO_INTERLEAVE_PACKED
+  if (n_bytes_per_sample == 1) return tu_audio_interleave_pk16(dst, src, len, n_ff_used);
+  #if !TUP_ARCH_STRICT_ALIGN && !TUP_MCU_STRICT_ALIGN
+  if (n_bytes_per_sample == 3) return tu_audio_interleave_pk24(dst, src, len, n_ff_used);
+  #endif
+#endif
+
+#if CFG_TUD_AUDIO_INTERLEAVE_WIDE64
+  if (n_bytes_per_sample == 4) return tu_audio_interleave_w64(dst, src, len, n_ff_used);
+#endif
+
+  return tu_audio_interleave_generic(n_bytes_per_sample, dst, src, len, n_ff_used);
+}
+
+//--------------------------------------------------------------------+
+// Sample format conversion
+//--------------------------------------------------------------------+
+
+// Sample format of the support FIFOs. USB side is always PCM as given by subslot size and bit resolution, which is
+// left-justified with trailing zeros (2.3.1.7.1 PCM Format).
+typedef enum {
+  AUDIO_SAMPLE_FORMAT_SUBSLOT = 0, // no conversion, FIFOs hold USB subslots
+  AUDIO_SAMPLE_FORMAT_PCM16,       // int16_t
+  AUDIO_SAMPLE_FORMAT_PCM24_RJ,    // 24 bit right-justified and sign-extended in int32_t
+  AUDIO_SAMPLE_FORMAT_PCM24_LJ,    // 24 bit left-justified in int32_t, lowest byte is zero
+  AUDIO_SAMPLE_FORMAT_PCM32,       // int32_t
+  AUDIO_SAMPLE_FORMAT_FLOAT32,     // float in range [-1, +1)
+} audio_sample_format_t;
+
+typedef struct {
+  uint8_t format;    // audio_sample_format_t of the FIFO side
+  uint8_t dither;    // add TPDF dither before bits are dropped, otherwise truncate
+  uint8_t usb_bytes; // bSubslotSize
+  uint8_t usb_bits;  // bBitResolution
+  uint32_t seed;     // dither noise generator state
+} tu_audio_conv_t;
+
+// Size of one sample in FIFO
+TU_ATTR_ALWAYS_INLINE static inline uint8_t tu_audio_sample_format_size(uint8_t format, uint8_t usb_bytes) {
+  switch (format) {
+    case AUDIO_SAMPLE_FORMAT_SUBSLOT: return usb_bytes;
+    case AUDIO_SAMPLE_FORMAT_PCM16:   return 2;
+    default:                          return 4;
+  }
+}
+
+// Resolution of FIFO format in bits, 32 for float as it is never quantized
+TU_ATTR_ALWAYS_INLINE static inline uint8_t tu_audio_sample_format_bits(uint8_t format) {
+  switch (format) {
+    case AUDIO_SAMPLE_FORMAT_PCM16:    return 16;
+    case AUDIO_SAMPLE_FORMAT_PCM24_RJ:
+    case AUDIO_SAMPLE_FORMAT_PCM24_LJ: return 24;
+    default:                           return 32;
+  }
+}
+
+// Setup conversion between USB subslots and FIFO format. Conversion is dropped if both sides hold identical data.
+static inline void tu_audio_conv_init(tu_audio_conv_t* conv, uint8_t format, bool dither, uint8_t usb_bytes,
+                                      uint8_t usb_bits, bool is_encode) {
+  if (usb_bits == 0 || usb_bits > 8 * usb_bytes) usb_bits = (uint8_t) (8 * usb_bytes);
+
+  conv->format = format;
+  conv->dither = dither ? 1 : 0;
+  conv->usb_bytes = usb_bytes;
+  conv->usb_bits = usb_bits;
+  if (conv->seed == 0) conv->seed = 0x2545F491u;
+
+  if (format == AUDIO_SAMPLE_FORMAT_FLOAT32 || tu_audio_sample_format_size(format, usb_bytes) != usb_bytes) return;
+
+  // Same container: data is identical unless the destination has to drop bits
+  uint8_t const ff_bits = tu_audio_sample_format_bits(format);
+  if (format != AUDIO_SAMPLE_FORMAT_PCM24_RJ && (is_encode ? (usb_bits >= ff_bits) : (ff_bits >= usb_bits))) {
+    conv->format = AUDIO_SAMPLE_FORMAT_SUBSLOT;
+  }
+}
+
+// Saturating add (QADD on ARMv7E-M DSP)
+TU_ATTR_ALWAYS_INLINE static inline int32_t tu_audio_sat_add32(int32_t a, int32_t b) {
+  int64_t const sum = (int64_t) a + b;
+  if (sum > INT32_MAX) return INT32_MAX;
+  if (sum < INT32_MIN) return INT32_MIN;
+  return (int32_t) sum;
+}
+
+// Reduce left-justified sample to given resolution, bits >= 32 leaves it untouched
+TU_ATTR_ALWAYS_INLINE static inline int32_t tu_audio_quantize(tu_audio_conv_t* conv, int32_t x, uint8_t bits) {
+  if (bits >= 32) return x;
+
+  uint32_t const lsb_mask = UINT32_MAX >> bits;
+
+  if (conv->dither) {
+    // Triangular PDF noise in range (-1, +1) LSB of target resolution: sum of two uniform values
+    uint32_t seed = conv->seed * 1664525u + 1013904223u;
+    uint32_t const r1 = seed >> bits;
+    seed = seed * 1664525u + 1013904223u;
+    uint32_t const r2 = seed >> bits;
+    conv->seed = seed;
+
+    x = tu_audio_sat_add32(x, (int32_t) (r1 + r2) - (int32_t) lsb_mask - 1);
+  }
+
+  return (int32_t) ((uint32_t) x & ~lsb_mask);
+}
+
+// Read little endian subslot as left-justified 32 bit sample
+TU_ATTR_ALWAYS_INLINE static inline int32_t tu_audio_subslot_read(uint8_t const* p, uint8_t n_bytes) {
+  switch (n_bytes) {
+    case 1:  return (int32_t) ((uint32_t) p[0] << 24);
+    case 2:  return (int32_t) ((uint32_t) tu_le16toh(tu_unaligned_read16(p)) << 16);
+    case 3:  return (int32_t) (((uint32_t) p[0] << 8) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 24));
+    default: return (int32_t) tu_le32toh(tu_unaligned_read32(p));
+  }
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void tu_audio_subslot_write(uint8_t* p, uint8_t n_bytes, int32_t x) {
+  uint32_t const u = (uint32_t) x;
+  switch (n_bytes) {
+    case 1:
+      p[0] = (uint8_t) (u >> 24);
+      break;
+
+    case 2:
+      tu_unaligned_write16(p, tu_htole16((uint16_t) (u >> 16)));
+      break;
+
+    case 3:
+      p[0] = (uint8_t) (u >> 8);
+      p[1] = (uint8_t) (u >> 16);
+      p[2] = (uint8_t) (u >> 24);
+      break;
+
+    default:
+      tu_unaligned_write32(p, tu_htole32(u));
+      break;
+  }
+}
+
+// Store left-justified 32 bit sample into FIFO format
+TU_ATTR_ALWAYS_INLINE static inline void tu_audio_ff_store(void* dst, uint8_t format, int32_t x) {
+  switch (format) {
+    case AUDIO_SAMPLE_FORMAT_PCM16:
+      *((int16_t*) dst) = (int16_t) (x >> 16);
+      break;
+
+    case AUDIO_SAMPLE_FORMAT_PCM24_RJ:
+      *((int32_t*) dst) = x >> 8;
+      break;
+
+    case AUDIO_SAMPLE_FORMAT_FLOAT32:
+      *((float*) dst) = (float) x * (1.0f / 2147483648.0f);
+      break;
+
+    default:
+      *((int32_t*) dst) = x;
+      break;
+  }
+}
+
+// Load sample in FIFO format as left-justified 32 bit sample, float is saturated
+TU_ATTR_ALWAYS_INLINE static inline int32_t tu_audio_ff_load(void const* src, uint8_t format) {
+  switch (format) {
+    case AUDIO_SAMPLE_FORMAT_PCM16:
+      return (int32_t) ((uint32_t) (uint16_t) *((int16_t const*) src) << 16);
+
+    case AUDIO_SAMPLE_FORMAT_PCM24_RJ:
+      return (int32_t) ((uint32_t) *((int32_t const*) src) << 8);
+
+    case AUDIO_SAMPLE_FORMAT_FLOAT32: {
+      float const f = *((float const*) src) * 2147483648.0f;
+      if (f >= 2147483648.0f) return INT32_MAX;
+      if (f > -2147483648.0f) return (int32_t) f;
+      return INT32_MIN; // also NaN
+    }
+
+    default:
+      return *((int32_t const*) src);
+  }
+}
+
+// Decode with conversion, format is constant in each call site so that the loop is specialized
+TU_ATTR_ALWAYS_INLINE static inline void const* tu_audio_deinterleave_conv_fmt(tu_audio_conv_t* conv, uint8_t format,
+                                                                               void* dst, uint16_t len, void const* src,
+                                                                               uint8_t n_ff_used) {
+  uint8_t const n_bytes = conv->usb_bytes;
+  uint8_t const ff_size = tu_audio_sample_format_size(format, n_bytes);
+  uint8_t const ff_bits = tu_audio_sample_format_bits(format);
+  uint8_t const q_bits = (ff_bits < conv->usb_bits) ? ff_bits : 32;
+  size_t const skip = 2u * n_bytes * (n_ff_used - 1u);
+  uint8_t* dst8 = (uint8_t*) dst;
+  uint8_t const* src8 = (uint8_t const*) src;
+
+  for (uint16_t n = (uint16_t) (len / (2u * ff_size)); n; n--) {
+    for (uint8_t ch = 0; ch < 2; ch++) {
+      tu_audio_ff_store(dst8, format, tu_audio_quantize(conv, tu_audio_subslot_read(src8, n_bytes), q_bits));
+      dst8 += ff_size;
+      src8 += n_bytes;
+    }
+    src8 += skip;
+  }
+
+  return src8;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void* tu_audio_interleave_conv_fmt(tu_audio_conv_t* conv, uint8_t format, void* dst,
+                                                                       void const* src, uint16_t len, uint8_t n_ff_used) {
+  uint8_t const n_bytes = conv->usb_bytes;
+  uint8_t const ff_size = tu_audio_sample_format_size(format, n_bytes);
+  uint8_t const ff_bits = tu_audio_sample_format_bits(format);
+  uint8_t const q_bits = (conv->usb_bits < ff_bits) ? conv->usb_bits : 32;
+  size_t const skip = 2u * n_bytes * (n_ff_used - 1u);
+  uint8_t* dst8 = (uint8_t*) dst;
+  uint8_t const* src8 = (uint8_t const*) src;
+
+  for (uint16_t n = (uint16_t) (len / (2u * ff_size)); n; n--) {
+    for (uint8_t ch = 0; ch < 2; ch++) {
+      tu_audio_subslot_write(dst8, n_bytes, tu_audio_quantize(conv, tu_audio_ff_load(src8, format), q_bits));
+      dst8 += n_bytes;
+      src8 += ff_size;
+    }
+    dst8 += skip;
+  }
+
+  return dst8;
+}
+
+// Decode and convert: len is number of bytes written to FIFO
+static inline void const* tu_audio_deinterleave_conv(tu_audio_conv_t* conv, void* dst, uint16_t len, void const* src,
+                                                     uint8_t n_ff_used) {
+  switch (conv->format) {
+    case AUDIO_SAMPLE_FORMAT_PCM16:
+      return tu_audio_deinterleave_conv_fmt(conv, AUDIO_SAMPLE_FORMAT_PCM16, dst, len, src, n_ff_used);
+
+    case AUDIO_SAMPLE_FORMAT_PCM24_RJ:
+      return tu_audio_deinterleave_conv_fmt(conv, AUDIO_SAMPLE_FORMAT_PCM24_RJ, dst, len, src, n_ff_used);
+
+    case AUDIO_SAMPLE_FORMAT_PCM24_LJ:
+      return tu_audio_deinterleave_conv_fmt(conv, AUDIO_SAMPLE_FORMAT_PCM24_LJ, dst, len, src, n_ff_used);
+
+    case AUDIO_SAMPLE_FORMAT_PCM32:
+      return tu_audio_deinterleave_conv_fmt(conv, AUDIO_SAMPLE_FORMAT_PCM32, dst, len, src, n_ff_used);
+
+    case AUDIO_SAMPLE_FORMAT_FLOAT32:
+      return tu_audio_deinterleave_conv_fmt(conv, AUDIO_SAMPLE_FORMAT_FLOAT32, dst, len, src, n_ff_used);
+
+    default: // AUDIO_SAMPLE_FORMAT_SUBSLOT
+      return tu_audio_deinterleave(conv->usb_bytes, dst, len, src, n_ff_used);
+  }
+}
+
+// Convert and encode: len is number of bytes read from FIFO
+static inline void* tu_audio_interleave_conv(tu_audio_conv_t* conv, void* dst, void const* src, uint16_t len,
+                                             uint8_t n_ff_used) {
+  switch (conv->format) {
+    case AUDIO_SAMPLE_FORMAT_PCM16:
+      return tu_audio_interleave_conv_fmt(conv, AUDIO_SAMPLE_FORMAT_PCM16, dst, src, len, n_ff_used);
+
+    case AUDIO_SAMPLE_FORMAT_PCM24_RJ:
+      return tu_audio_interleave_conv_fmt(conv, AUDIO_SAMPLE_FORMAT_PCM24_RJ, dst, src, len, n_ff_used);
+
+    case AUDIO_SAMPLE_FORMAT_PCM24_LJ:
+      return tu_audio_interleave_conv_fmt(conv, AUDIO_SAMPLE_FORMAT_PCM24_LJ, dst, src, len, n_ff_used);
+
+    case AUDIO_SAMPLE_FORMAT_PCM32:
+      return tu_audio_interleave_conv_fmt(conv, AUDIO_SAMPLE_FORMAT_PCM32, dst, src, len, n_ff_used);
+
+    case AUDIO_SAMPLE_FORMAT_FLOAT32:
+      return tu_audio_interleave_conv_fmt(conv, AUDIO_SAMPLE_FORMAT_FLOAT32, dst, src, len, n_ff_used);
+
+    default: // AUDIO_SAMPLE_FORMAT_SUBSLOT
+      return tu_audio_interleave(conv->usb_bytes, dst, src, len, n_ff_used);
+  }
+}
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
@@ -53,6 +53,19 @@ typedef struct
   CFG_TUSB_MEM_ALIGN uint8_t epin_buf[CFG_TUD_HID_EP_BUFSIZE];
   CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_HID_EP_BUFSIZE];
 
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+  // Queued reports are sent directly from their slot. Free running indices:
+  // [rd, tx) are armed or completed but not yet released, [tx, wr) are waiting for the endpoint
+  CFG_TUSB_MEM_ALIGN uint8_t queue_buf[CFG_TUD_HID_REPORT_QUEUE_SIZE][CFG_TUD_HID_EP_BUFSIZE];
+  uint16_t queue_len[CFG_TUD_HID_REPORT_QUEUE_SIZE];
+  volatile uint8_t queue_wr;
+  volatile uint8_t queue_tx;
+  volatile uint8_t queue_rd;
+  volatile bool queue_kick; // deferred arming pending
+
+  tud_hid_report_queue_stats_t queue_stats;
+#endif
+
   // TODO save hid descriptor since host can specifically request this after enumeration
   // Note: HID descriptor may be not available from application after enumeration
   tusb_hid_descriptor_hid_t const * hid_descriptor;
@@ -71,6 +84,41 @@ static inline uint8_t get_index_by_itfnum(uint8_t itf_num)
 	return 0xFF;
 }
 
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+// Arm the oldest waiting report if the endpoint is free. Claiming the endpoint serializes
+// callers, so a slot is never armed twice
+static bool queue_xfer(uint8_t rhport, hidd_interface_t* p_hid)
+{
+  if ( p_hid->queue_tx == p_hid->queue_wr ) return false;
+  TU_VERIFY( usbd_edpt_claim(rhport, p_hid->ep_in) );
+
+  uint8_t const tx = p_hid->queue_tx;
+  if ( tx == p_hid->queue_wr )
+  {
+    usbd_edpt_release(rhport, p_hid->ep_in);
+    return false;
+  }
+
+  uint8_t const slot = tx % CFG_TUD_HID_REPORT_QUEUE_SIZE;
+  p_hid->queue_tx = (uint8_t) (tx + 1);
+
+  if ( !usbd_edpt_xfer(rhport, p_hid->ep_in, p_hid->queue_buf[slot], p_hid->queue_len[slot]) )
+  {
+    p_hid->queue_tx = tx;
+    return false;
+  }
+
+  return true;
+}
+
+static void queue_kick_deferred(void* param)
+{
+  hidd_interface_t* p_hid = &_hidd_itf[(uintptr_t) param];
+  p_hid->queue_kick = false;
+  if ( p_hid->ep_in ) queue_xfer(0, p_hid);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // APPLICATION API
 //--------------------------------------------------------------------+
@@ -103,6 +151,90 @@ bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const* report, u
   return usbd_edpt_xfer(rhport, p_hid->ep_in, p_hid->epin_buf, len);
 }
 
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+bool tud_hid_n_report_queue(uint8_t instance, uint8_t report_id, void const* report, uint16_t len, bool in_isr)
+{
+  uint8_t const rhport = 0;
+  TU_VERIFY(instance < CFG_TUD_HID);
+  hidd_interface_t * p_hid = &_hidd_itf[instance];
+  TU_VERIFY(p_hid->ep_in);
+
+  uint16_t const total = (uint16_t) (len + (report_id ? 1 : 0));
+  TU_VERIFY(total <= CFG_TUD_HID_EP_BUFSIZE);
+
+  uint8_t const wr    = p_hid->queue_wr;
+  uint8_t const count = (uint8_t) (wr - p_hid->queue_rd);
+  uint8_t slot;
+
+  if ( count < CFG_TUD_HID_REPORT_QUEUE_SIZE )
+  {
+    slot = wr % CFG_TUD_HID_REPORT_QUEUE_SIZE;
+  }
+  else
+  {
+    // Queue is full: the newest report can only be replaced while it is not about to be armed,
+    // i.e with at least one other waiting report ahead of it
+    slot = (uint8_t) (wr - 1) % CFG_TUD_HID_REPORT_QUEUE_SIZE;
+    bool const coalesce = CFG_TUD_HID_REPORT_QUEUE_COALESCE &&
+                          ((uint8_t) (wr - p_hid->queue_tx) >= 2) &&
+                          (p_hid->queue_len[slot] == total) &&
+                          (!report_id || p_hid->queue_buf[slot][0] == report_id);
+    if ( !coalesce )
+    {
+      p_hid->queue_stats.dropped++;
+      return false;
+    }
+    p_hid->queue_stats.coalesced++;
+  }
+
+  uint8_t* buf = p_hid->queue_buf[slot];
+  if ( report_id ) *buf++ = report_id;
+  if ( len ) memcpy(buf, report, len);
+  p_hid->queue_len[slot] = total;
+
+  if ( count < CFG_TUD_HID_REPORT_QUEUE_SIZE )
+  {
+    // publish report after its content is written
+    p_hid->queue_wr = (uint8_t) (wr + 1);
+    if ( count + 1 > p_hid->queue_stats.max_count ) p_hid->queue_stats.max_count = (uint8_t) (count + 1);
+  }
+
+  if ( in_isr )
+  {
+    // Endpoint claim is not ISR-safe: arm from usbd task. If the endpoint is busy the report is
+    // armed on completion anyway
+    if ( !usbd_edpt_busy(rhport, p_hid->ep_in) && !p_hid->queue_kick )
+    {
+      p_hid->queue_kick = true;
+      usbd_defer_func(queue_kick_deferred, (void*) (uintptr_t) instance, true);
+    }
+  }
+  else
+  {
+    queue_xfer(rhport, p_hid);
+  }
+
+  return true;
+}
+
+uint8_t tud_hid_n_report_queue_available(uint8_t instance)
+{
+  hidd_interface_t const * p_hid = &_hidd_itf[instance];
+  return (uint8_t) (CFG_TUD_HID_REPORT_QUEUE_SIZE - (uint8_t) (p_hid->queue_wr - p_hid->queue_rd));
+}
+
+bool tud_hid_n_report_queue_stats(uint8_t instance, tud_hid_report_queue_stats_t* stats, bool clear)
+{
+  TU_VERIFY(instance < CFG_TUD_HID);
+  hidd_interface_t * p_hid = &_hidd_itf[instance];
+
+  if ( stats ) *stats = p_hid->queue_stats;
+  if ( clear ) tu_memclr(&p_hid->queue_stats, sizeof(p_hid->queue_stats));
+
+  return true;
+}
+#endif
+
 uint8_t tud_hid_n_interface_protocol(uint8_t instance)
 {
   return _hidd_itf[instance].itf_protocol;
@@ -397,10 +529,33 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   // Sent report successfully
   if (ep_addr == p_hid->ep_in)
   {
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+    // Armed queued report is always the oldest unreleased one, otherwise it was sent by tud_hid_n_report()
+    uint8_t const rd = p_hid->queue_rd;
+    if ( rd != p_hid->queue_tx )
+    {
+      // arm next queued report first, then release the completed slot after callback
+      queue_xfer(rhport, p_hid);
+
+      if (tud_hid_report_complete_cb)
+      {
+        tud_hid_report_complete_cb(instance, p_hid->queue_buf[rd % CFG_TUD_HID_REPORT_QUEUE_SIZE], (uint16_t) xferred_bytes);
+      }
+
+      p_hid->queue_rd = (uint8_t) (rd + 1);
+      return true;
+    }
+#endif
+
     if (tud_hid_report_complete_cb)
     {
       tud_hid_report_complete_cb(instance, p_hid->epin_buf, (uint16_t) xferred_bytes);
     }
+
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+    // reports may have been queued while endpoint was busy
+    queue_xfer(rhport, p_hid);
+#endif
   }
   // Received report
   else if (ep_addr == p_hid->ep_out)
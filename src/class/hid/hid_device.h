@@ -47,6 +47,24 @@
   #define CFG_TUD_HID_EP_BUFSIZE     64
 #endif
 
+// Number of input reports that can be queued per instance with tud_hid_n_report_queue(), 0 to disable.
+// Must be a power of 2 up to 128. Each queued report takes CFG_TUD_HID_EP_BUFSIZE bytes
+#ifndef CFG_TUD_HID_REPORT_QUEUE_SIZE
+  #define CFG_TUD_HID_REPORT_QUEUE_SIZE  0
+#endif
+
+// When the report queue is full, replace the newest queued report with the new one if both have the
+// same report ID and length instead of dropping the new one. Suitable for absolute reports (gamepad,
+// sensor) where only the latest state matters, not for relative ones (mouse movement)
+#ifndef CFG_TUD_HID_REPORT_QUEUE_COALESCE
+  #define CFG_TUD_HID_REPORT_QUEUE_COALESCE  0
+#endif
+
+// queue indices are free-running uint8_t, slots stay consistent across wrap-around only if size divides 256
+#if (CFG_TUD_HID_REPORT_QUEUE_SIZE > 128) || (CFG_TUD_HID_REPORT_QUEUE_SIZE & (CFG_TUD_HID_REPORT_QUEUE_SIZE - 1))
+  #error "CFG_TUD_HID_REPORT_QUEUE_SIZE must be a power of 2 not greater than 128"
+#endif
+
 //--------------------------------------------------------------------+
 // Application API (Multiple Instances)
 // CFG_TUD_HID > 1
@@ -76,6 +94,25 @@ bool tud_hid_n_mouse_report(uint8_t instance, uint8_t report_id, uint8_t buttons
 // use template layout report TUD_HID_REPORT_DESC_GAMEPAD
 bool tud_hid_n_gamepad_report(uint8_t instance, uint8_t report_id, int8_t x, int8_t y, int8_t z, int8_t rz, int8_t rx, int8_t ry, uint8_t hat, uint32_t buttons);
 
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+typedef struct {
+  uint32_t dropped;   // reports rejected because the queue was full
+  uint32_t coalesced; // reports that replaced the newest queued report because the queue was full
+  uint8_t  max_count; // highest number of reports queued at once
+} tud_hid_report_queue_stats_t;
+
+// Queue report to be sent to host, it is sent as soon as the IN endpoint is free and the next queued report
+// is armed right when the previous one completes. Return false if the queue is full (and not coalesced).
+// Can be called from interrupt context with in_isr = true, but reports must be queued from a single context.
+bool tud_hid_n_report_queue(uint8_t instance, uint8_t report_id, void const* report, uint16_t len, bool in_isr);
+
+// Number of reports that can still be queued
+uint8_t tud_hid_n_report_queue_available(uint8_t instance);
+
+// Get queue statistics, reset them to zero if clear is true
+bool tud_hid_n_report_queue_stats(uint8_t instance, tud_hid_report_queue_stats_t* stats, bool clear);
+#endif
+
 //--------------------------------------------------------------------+
 // Application API (Single Port)
 //--------------------------------------------------------------------+
@@ -86,6 +123,10 @@ static inline bool    tud_hid_report(uint8_t report_id, void const* report, uint
 static inline bool    tud_hid_keyboard_report(uint8_t report_id, uint8_t modifier, uint8_t keycode[6]);
 static inline bool    tud_hid_mouse_report(uint8_t report_id, uint8_t buttons, int8_t x, int8_t y, int8_t vertical, int8_t horizontal);
 static inline bool    tud_hid_gamepad_report(uint8_t report_id, int8_t x, int8_t y, int8_t z, int8_t rz, int8_t rx, int8_t ry, uint8_t hat, uint32_t buttons);
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+static inline bool    tud_hid_report_queue(uint8_t report_id, void const* report, uint16_t len, bool in_isr);
+static inline uint8_t tud_hid_report_queue_available(void);
+#endif
 
 //--------------------------------------------------------------------+
 // Callbacks (Weak is optional)
@@ -115,7 +156,7 @@ TU_ATTR_WEAK bool tud_hid_set_idle_cb(uint8_t instance, uint8_t idle_rate);
 
 // Invoked when sent REPORT successfully to host
 // Application can use this to send the next report
-// Note: For composite reports, report[0] is report ID
+// Note: For composite reports, report[0] is report ID. For queued reports, the next one is already armed
 TU_ATTR_WEAK void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* report, uint16_t len);
 
 
@@ -157,6 +198,18 @@ static inline bool  tud_hid_gamepad_report(uint8_t report_id, int8_t x, int8_t y
   return tud_hid_n_gamepad_report(0, report_id, x, y, z, rz, rx, ry, hat, buttons);
 }
 
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+static inline bool tud_hid_report_queue(uint8_t report_id, void const* report, uint16_t len, bool in_isr)
+{
+  return tud_hid_n_report_queue(0, report_id, report, len, in_isr);
+}
+
+static inline uint8_t tud_hid_report_queue_available(void)
+{
+  return tud_hid_n_report_queue_available(0);
+}
+#endif
+
 /* --------------------------------------------------------------------+
  * HID Report Descriptor Template
  *
@@ -707,4 +707,294 @@ uint8_t tuh_hid_parse_report_descriptor(tuh_hid_report_info_t* report_info_arr,
   return report_num;
 }
 
+//--------------------------------------------------------------------+
+// Report Field Parser
+//--------------------------------------------------------------------+
+
+enum {
+  HID_PARSER_STACK_DEPTH = 4
+};
+
+// Global items 6.2.2.7 USB HID 1.11
+typedef struct {
+  uint16_t usage_page;
+  uint8_t  report_size;
+  uint8_t  report_id;
+  uint16_t report_count;
+  int32_t  logical_min;
+  int32_t  logical_max;
+} hid_parser_global_t;
+
+// Local items 6.2.2.8 USB HID 1.11, usages are extended usages (page in upper 16 bits) once their page is known
+typedef struct {
+  uint32_t usages[CFG_TUH_HID_PARSER_USAGE_MAX];
+  uint8_t  usage_ext[CFG_TUH_HID_PARSER_USAGE_MAX]; // 1: usage page given by the usage item itself
+  uint8_t  n_usages;
+  uint8_t  has_min; // 1: usage minimum given, 2: as extended usage
+  uint8_t  has_max; // 1: usage maximum given, 2: as extended usage
+  uint32_t usage_min;
+  uint32_t usage_max;
+} hid_parser_local_t;
+
+// Bit position of the next field per report ID and type (input, output, feature)
+typedef struct {
+  uint8_t  report_id;
+  uint16_t bits[3];
+} hid_parser_report_t;
+
+static uint32_t item_data_unsigned(uint8_t const* data, uint8_t size) {
+  switch (size) {
+    case 1: return data[0];
+    case 2: return tu_u16(data[1], data[0]);
+    case 4: return tu_u32(data[3], data[2], data[1], data[0]);
+    default: return 0;
+  }
+}
+
+static int32_t item_data_signed(uint8_t const* data, uint8_t size) {
+  switch (size) {
+    case 1: return (int8_t) data[0];
+    case 2: return (int16_t) tu_u16(data[1], data[0]);
+    case 4: return (int32_t) tu_u32(data[3], data[2], data[1], data[0]);
+    default: return 0;
+  }
+}
+
+// Usage of element i: usage list first, then usage range, the last usage repeats for the remaining elements
+static uint32_t parser_usage_at(hid_parser_local_t const* local, uint16_t i) {
+  if (i < local->n_usages) return local->usages[i];
+  if (local->has_min && local->has_max && local->usage_min <= local->usage_max) {
+    uint32_t const u = local->usage_min + (uint32_t) (i - local->n_usages);
+    return tu_min32(u, local->usage_max);
+  }
+  return local->n_usages ? local->usages[local->n_usages - 1] : 0;
+}
+
+static uint16_t* parser_report_bits(hid_parser_report_t* reports, uint8_t* n_reports, uint8_t report_id, uint8_t type) {
+  for (uint8_t i = 0; i < *n_reports; i++) {
+    if (reports[i].report_id == report_id) return &reports[i].bits[type - HID_REPORT_TYPE_INPUT];
+  }
+  if (*n_reports >= CFG_TUH_HID_PARSER_REPORT_MAX) return NULL;
+  hid_parser_report_t* report = &reports[(*n_reports)++];
+  tu_memclr(report, sizeof(hid_parser_report_t));
+  report->report_id = report_id;
+  return &report->bits[type - HID_REPORT_TYPE_INPUT];
+}
+
+uint16_t tuh_hid_parse_report_fields(tuh_hid_field_t* fields, uint16_t field_count,
+                                     uint8_t const* desc_report, uint16_t desc_len) {
+  hid_parser_global_t global = { 0 };
+  hid_parser_global_t stack[HID_PARSER_STACK_DEPTH];
+  uint8_t sp = 0;
+  hid_parser_local_t local = { 0 };
+  hid_parser_report_t reports[CFG_TUH_HID_PARSER_REPORT_MAX];
+  uint8_t n_reports = 0;
+  uint16_t n_fields = 0;
+
+  uint8_t const* p_desc = desc_report;
+  uint8_t const* desc_end = desc_report + desc_len;
+
+  while (p_desc < desc_end) {
+    uint8_t const prefix = *p_desc++;
+
+    if (prefix == 0xFE) {
+      // long item: bDataSize, bLongItemTag then data. None is defined, skip it
+      if (desc_end - p_desc < 2) break;
+      uint8_t const data_size = p_desc[0];
+      if (desc_end - p_desc < 2 + data_size) break;
+      p_desc += 2 + data_size;
+      continue;
+    }
+
+    uint8_t const size = (prefix & 0x03) == 3 ? 4 : (prefix & 0x03);
+    uint8_t const type = (prefix >> 2) & 0x03;
+    uint8_t const tag = prefix >> 4;
+    if (desc_end - p_desc < size) break;
+    uint8_t const* data = p_desc;
+    uint32_t const data_u32 = item_data_unsigned(data, size);
+    p_desc += size;
+
+    switch (type) {
+      case RI_TYPE_MAIN:
+        if (tag == RI_MAIN_INPUT || tag == RI_MAIN_OUTPUT || tag == RI_MAIN_FEATURE) {
+          uint8_t const report_type = (tag == RI_MAIN_INPUT) ? HID_REPORT_TYPE_INPUT :
+                                      (tag == RI_MAIN_OUTPUT) ? HID_REPORT_TYPE_OUTPUT : HID_REPORT_TYPE_FEATURE;
+          uint16_t* bits = parser_report_bits(reports, &n_reports, global.report_id, report_type);
+          if (!bits) return n_fields;
+
+          // usages of less than 4 bytes are on the usage page current at the main item
+          for (uint8_t i = 0; i < local.n_usages; i++) {
+            if (!local.usage_ext[i]) local.usages[i] |= (uint32_t) global.usage_page << 16;
+          }
+          if (local.has_min == 1) local.usage_min |= (uint32_t) global.usage_page << 16;
+          if (local.has_max == 1) local.usage_max |= (uint32_t) global.usage_page << 16;
+
+          uint16_t const bit_offset = *bits;
+          *bits = (uint16_t) (*bits + global.report_size * global.report_count);
+
+          if (!(data_u32 & HID_CONSTANT) && global.report_size && global.report_size <= 32) {
+            tuh_hid_field_t field = {
+              .bit_size    = global.report_size,
+              .report_id   = global.report_id,
+              .type        = report_type,
+              .flags       = (uint8_t) data_u32,
+              .logical_min = global.logical_min,
+              .logical_max = global.logical_max,
+            };
+
+            if (data_u32 & HID_VARIABLE) {
+              // one field per run of elements with consecutive usages, possibly ending with a repeated usage
+              uint16_t i = 0;
+              while (i < global.report_count) {
+                uint32_t const first = parser_usage_at(&local, i);
+                uint32_t last = first;
+                bool repeating = false;
+                uint16_t n = 1;
+                while (i + n < global.report_count) {
+                  uint32_t const next = parser_usage_at(&local, (uint16_t) (i + n));
+                  if (!repeating && next == last + 1 && (next >> 16) == (first >> 16)) {
+                    last = next;
+                  } else if (next == last) {
+                    repeating = true;
+                  } else {
+                    break;
+                  }
+                  n++;
+                }
+
+                if (n_fields >= field_count) return n_fields;
+                field.usage_page = (uint16_t) (first >> 16);
+                field.usage      = (uint16_t) first;
+                field.usage_max  = (uint16_t) last;
+                field.bit_offset = (uint16_t) (bit_offset + i * global.report_size);
+                field.count      = n;
+                fields[n_fields++] = field;
+                i = (uint16_t) (i + n);
+              }
+            } else if (global.report_count) {
+              // array of indexes into the usage range or list
+              uint32_t first, last;
+              if (local.n_usages) {
+                first = local.usages[0];
+                last = local.usages[local.n_usages - 1];
+              } else {
+                first = local.usage_min;
+                last = local.usage_max;
+              }
+
+              if (n_fields >= field_count) return n_fields;
+              field.usage_page = (uint16_t) (first >> 16);
+              field.usage      = (uint16_t) first;
+              field.usage_max  = (uint16_t) last;
+              field.bit_offset = bit_offset;
+              field.count      = global.report_count;
+              fields[n_fields++] = field;
+            }
+          }
+        }
+
+        // local items only apply to the next main item
+        tu_memclr(&local, sizeof(local));
+        break;
+
+      case RI_TYPE_GLOBAL:
+        switch (tag) {
+          case RI_GLOBAL_USAGE_PAGE: global.usage_page = (uint16_t) data_u32; break;
+          case RI_GLOBAL_LOGICAL_MIN: global.logical_min = item_data_signed(data, size); break;
+
+          case RI_GLOBAL_LOGICAL_MAX:
+            // maximum is unsigned if minimum is not negative e.g 0..255 as 0xFF in one byte
+            global.logical_max = (global.logical_min < 0) ? item_data_signed(data, size) : (int32_t) data_u32;
+            break;
+
+          case RI_GLOBAL_REPORT_SIZE: global.report_size = (uint8_t) tu_min32(data_u32, 0xFF); break;
+          case RI_GLOBAL_REPORT_ID: global.report_id = (uint8_t) data_u32; break;
+          case RI_GLOBAL_REPORT_COUNT: global.report_count = (uint16_t) tu_min32(data_u32, 0xFFFF); break;
+
+          case RI_GLOBAL_PUSH:
+            if (sp < HID_PARSER_STACK_DEPTH) stack[sp++] = global;
+            break;
+
+          case RI_GLOBAL_POP:
+            if (sp) global = stack[--sp];
+            break;
+
+          default: break;
+        }
+        break;
+
+      case RI_TYPE_LOCAL:
+        switch (tag) {
+          case RI_LOCAL_USAGE:
+            if (local.n_usages < CFG_TUH_HID_PARSER_USAGE_MAX) {
+              local.usages[local.n_usages] = data_u32;
+              local.usage_ext[local.n_usages] = (size == 4);
+              local.n_usages++;
+            }
+            break;
+
+          case RI_LOCAL_USAGE_MIN:
+            local.usage_min = data_u32;
+            local.has_min = (size == 4) ? 2 : 1;
+            break;
+
+          case RI_LOCAL_USAGE_MAX:
+            local.usage_max = data_u32;
+            local.has_max = (size == 4) ? 2 : 1;
+            break;
+
+          default: break;
+        }
+        break;
+
+      default: break;
+    }
+  }
+
+  return n_fields;
+}
+
+tuh_hid_field_t const* tuh_hid_field_find(tuh_hid_field_t const* fields, uint16_t field_count, uint8_t type,
+                                          uint16_t usage_page, uint16_t usage) {
+  for (uint16_t i = 0; i < field_count; i++) {
+    tuh_hid_field_t const* field = &fields[i];
+    if (field->type == type && field->usage_page == usage_page && field->usage <= usage && usage <= field->usage_max) {
+      return field;
+    }
+  }
+  return NULL;
+}
+
+bool tuh_hid_field_value(tuh_hid_field_t const* field, uint8_t const* report, uint16_t len, uint16_t idx,
+                         int32_t* value) {
+  TU_VERIFY(idx < field->count);
+  if (field->report_id) {
+    TU_VERIFY(len && report[0] == field->report_id);
+    report++;
+    len--;
+  }
+
+  uint32_t const bit = field->bit_offset + (uint32_t) idx * field->bit_size;
+  uint8_t const size = field->bit_size;
+  TU_VERIFY(bit + size <= 8u * len);
+
+  // gather the bytes covering the element, at most 5
+  uint8_t const* p = report + (bit >> 3);
+  uint8_t const shift = (uint8_t) (bit & 7);
+  uint8_t const n_bytes = (uint8_t) ((shift + size + 7) >> 3);
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < n_bytes && i < 4; i++) v |= (uint32_t) p[i] << (8 * i);
+  v >>= shift;
+  if (n_bytes > 4) v |= (uint32_t) p[4] << (32 - shift);
+
+  if (size < 32) {
+    uint32_t const mask = (UINT32_C(1) << size) - 1;
+    v &= mask;
+    // sign extend
+    if (field->logical_min < 0 && (v >> (size - 1))) v |= ~mask;
+  }
+  *value = (int32_t) v;
+  return true;
+}
+
 #endif
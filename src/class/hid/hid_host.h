@@ -27,6 +27,7 @@
 #ifndef _TUSB_HID_HOST_H_
 #define _TUSB_HID_HOST_H_
 
+#include "host/usbh.h"
 #include "hid.h"
 
 #ifdef __cplusplus
@@ -46,6 +47,15 @@ extern "C" {
 #define CFG_TUH_HID_EPOUT_BUFSIZE 64
 #endif
 
+// Maximum number of usages of a main item recorded by tuh_hid_parse_report_fields(), further usages repeat the last one
+#ifndef CFG_TUH_HID_PARSER_USAGE_MAX
+#define CFG_TUH_HID_PARSER_USAGE_MAX 16
+#endif
+
+// Maximum number of report IDs whose bit positions are tracked by tuh_hid_parse_report_fields()
+#ifndef CFG_TUH_HID_PARSER_REPORT_MAX
+#define CFG_TUH_HID_PARSER_REPORT_MAX 16
+#endif
 
 typedef struct {
   uint8_t report_id;
@@ -57,6 +67,22 @@ typedef struct {
 //  uint8_t out_len;     // length of OUT report
 } tuh_hid_report_info_t;
 
+// Field of a report: report_count elements of report_size bits sharing a main item. Element i of a variable field has
+// usage min(usage + i, usage_max). An array field holds indexes, value v selects usage + (v - logical_min).
+typedef struct {
+  uint16_t usage_page;
+  uint16_t usage;
+  uint16_t usage_max;
+  uint16_t bit_offset; // offset of the first element in the report, report ID byte excluded
+  uint16_t count;      // number of elements
+  uint8_t  bit_size;   // size of one element, 1 to 32 bits
+  uint8_t  report_id;  // 0 if the device does not use report IDs
+  uint8_t  type;       // hid_report_type_t
+  uint8_t  flags;      // main item data e.g HID_VARIABLE, HID_RELATIVE, HID_NULL_STATE
+  int32_t  logical_min;
+  int32_t  logical_max;
+} tuh_hid_field_t;
+
 //--------------------------------------------------------------------+
 // Interface API
 //--------------------------------------------------------------------+
@@ -88,6 +114,23 @@ bool tuh_hid_mounted(uint8_t dev_addr, uint8_t idx);
 TU_ATTR_UNUSED uint8_t tuh_hid_parse_report_descriptor(tuh_hid_report_info_t* reports_info_arr, uint8_t arr_count,
                                                        uint8_t const* desc_report, uint16_t desc_len);
 
+// Parse report descriptor into a table of fields, return number of fields (at most field_count).
+// Global items including PUSH/POP, usage lists and ranges, and extended (32-bit) usages are supported. Constant
+// (padding) items and elements larger than 32 bits only advance the bit position. Parse once e.g in
+// tuh_hid_mount_cb() and decode each received report with tuh_hid_field_value().
+uint16_t tuh_hid_parse_report_fields(tuh_hid_field_t* fields, uint16_t field_count,
+                                     uint8_t const* desc_report, uint16_t desc_len);
+
+// Find the field of a report type containing a usage, return NULL if not found
+tuh_hid_field_t const* tuh_hid_field_find(tuh_hid_field_t const* fields, uint16_t field_count, uint8_t type,
+                                          uint16_t usage_page, uint16_t usage);
+
+// Get value of element idx of a field from a report as received, i.e starting with the report ID if the field has one.
+// Value is sign extended if logical minimum is negative. Return false if the report has another report ID or is too
+// short for the element.
+bool tuh_hid_field_value(tuh_hid_field_t const* field, uint8_t const* report, uint16_t len, uint16_t idx,
+                         int32_t* value);
+
 //--------------------------------------------------------------------+
 // Control Endpoint API
 //--------------------------------------------------------------------+
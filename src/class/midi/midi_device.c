@@ -238,6 +238,56 @@ static uint32_t write_flush(midid_interface_t* midi)
   }
 }
 
+// Encode SysEx data into event packets and write them to fifo in batches. Stop after the end of SysEx (0xF7),
+// when fifo is full or before a trailing partial packet. Return number of bytes consumed
+static uint32_t sysex_write(midid_interface_t* midi, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize, bool* ended)
+{
+  enum { SYSEX_BATCH = 16 };
+  uint8_t packets[SYSEX_BATCH*4];
+
+  uint32_t i = 0;
+  *ended = false;
+
+  while ( (i < bufsize) && !(*ended) )
+  {
+    uint16_t const avail = tu_min16(tu_fifo_remaining(&midi->tx_ff) / 4, SYSEX_BATCH);
+    uint16_t n = 0;
+
+    while ( (n < avail) && (i < bufsize) )
+    {
+      uint8_t len = (uint8_t) tu_min32(bufsize - i, 3);
+      for(uint8_t j = 0; j < len; j++)
+      {
+        if ( buffer[i+j] == MIDI_STATUS_SYSEX_END )
+        {
+          len = (uint8_t) (j + 1);
+          *ended = true;
+          break;
+        }
+      }
+
+      // partial packet is left to the caller
+      if ( !(*ended) && len < 3 ) break;
+
+      uint8_t* packet = packets + 4*n;
+      packet[0] = (uint8_t) ((cable_num << 4) | (*ended ? (MIDI_CIN_SYSEX_START + len) : MIDI_CIN_SYSEX_START));
+      for(uint8_t j = 0; j < 3; j++) packet[1+j] = (j < len) ? buffer[i+j] : 0;
+
+      i += len;
+      n++;
+
+      if ( *ended ) break;
+    }
+
+    if ( n == 0 ) break;
+
+    // fifo lock is taken once per batch, remaining was checked above
+    tu_fifo_write_n(&midi->tx_ff, packets, (uint16_t) (n*4));
+  }
+
+  return i;
+}
+
 uint32_t tud_midi_n_stream_write(uint8_t itf, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize)
 {
   midid_interface_t* midi = &_midid_itf[itf];
@@ -248,6 +298,21 @@ uint32_t tud_midi_n_stream_write(uint8_t itf, uint8_t cable_num, uint8_t const*
   uint32_t i = 0;
   while ( (i < bufsize) && (tu_fifo_remaining(&midi->tx_ff) >= 4) )
   {
+    // Fast path: encode SysEx in whole packets when no packet is being buffered
+    if ( (stream->index == 0) &&
+         (buffer[i] == MIDI_STATUS_SYSEX_START || (stream->buffer[0] & 0xF) == MIDI_CIN_SYSEX_START) )
+    {
+      bool ended;
+      uint32_t const count = sysex_write(midi, cable_num, buffer + i, bufsize - i, &ended);
+
+      if ( count )
+      {
+        i += count;
+        stream->buffer[0] = (uint8_t) ((cable_num << 4) | (ended ? MIDI_CIN_SYSEX_END_1BYTE : MIDI_CIN_SYSEX_START));
+        continue;
+      }
+    }
+
     uint8_t const data = buffer[i];
     i++;
 
@@ -370,6 +435,21 @@ bool tud_midi_n_packet_write (uint8_t itf, uint8_t const packet[4])
   return true;
 }
 
+uint32_t tud_midi_n_packet_write_n (uint8_t itf, uint8_t const packets[], uint32_t n_packets)
+{
+  midid_interface_t* midi = &_midid_itf[itf];
+  TU_VERIFY(midi->ep_in, 0);
+
+  uint32_t const count = tu_min32(n_packets, tu_fifo_remaining(&midi->tx_ff) / 4);
+  if ( count )
+  {
+    tu_fifo_write_n(&midi->tx_ff, packets, (uint16_t) (count*4));
+    write_flush(midi);
+  }
+
+  return count;
+}
+
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
@@ -66,7 +66,7 @@ uint32_t tud_midi_n_available    (uint8_t itf, uint8_t cable_num);
 // Read byte stream              (legacy)
 uint32_t tud_midi_n_stream_read  (uint8_t itf, uint8_t cable_num, void* buffer, uint32_t bufsize);
 
-// Write byte Stream             (legacy)
+// Write byte Stream             (legacy). SysEx data is encoded in whole packets
 uint32_t tud_midi_n_stream_write (uint8_t itf, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize);
 
 // Read event packet             (4 bytes)
@@ -75,6 +75,9 @@ bool     tud_midi_n_packet_read  (uint8_t itf, uint8_t packet[4]);
 // Write event packet            (4 bytes)
 bool     tud_midi_n_packet_write (uint8_t itf, uint8_t const packet[4]);
 
+// Write multiple event packets  (4 bytes each), return number of packets written
+uint32_t tud_midi_n_packet_write_n (uint8_t itf, uint8_t const packets[], uint32_t n_packets);
+
 //--------------------------------------------------------------------+
 // Application API (Single Interface)
 //--------------------------------------------------------------------+
@@ -86,6 +89,7 @@ static inline uint32_t tud_midi_stream_write (uint8_t cable_num, uint8_t const*
 
 static inline bool     tud_midi_packet_read  (uint8_t packet[4]);
 static inline bool     tud_midi_packet_write (uint8_t const packet[4]);
+static inline uint32_t tud_midi_packet_write_n (uint8_t const packets[], uint32_t n_packets);
 
 //------------- Deprecated API name  -------------//
 // TODO remove after 0.10.0 release
@@ -154,6 +158,11 @@ static inline bool tud_midi_packet_write (uint8_t const packet[4])
   return tud_midi_n_packet_write(0, packet);
 }
 
+static inline uint32_t tud_midi_packet_write_n (uint8_t const packets[], uint32_t n_packets)
+{
+  return tud_midi_n_packet_write_n(0, packets, n_packets);
+}
+
 //--------------------------------------------------------------------+
 // Internal Class Driver API
 //--------------------------------------------------------------------+
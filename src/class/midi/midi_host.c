@@ -0,0 +1,622 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUH_ENABLED && CFG_TUH_MIDI
+
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
+
+#include "midi_host.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUH_MIDI_LOG_LEVEL
+  #define CFG_TUH_MIDI_LOG_LEVEL   CFG_TUH_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_MIDI_LOG_LEVEL, __VA_ARGS__)
+
+TU_VERIFY_STATIC(CFG_TUH_MIDI_EP_BUFSIZE % 4 == 0 && CFG_TUH_MIDI_EP_BUFSIZE <= UINT16_MAX, "EP buffer must hold whole packets");
+TU_VERIFY_STATIC(CFG_TUH_MIDI_RX_BUFSIZE >= 2*CFG_TUH_MIDI_EP_BUFSIZE && CFG_TUH_MIDI_RX_BUFSIZE <= UINT16_MAX,
+                 "RX FIFO must hold both IN buffers");
+TU_VERIFY_STATIC(CFG_TUH_MIDI_TX_BUFSIZE % 4 == 0 && CFG_TUH_MIDI_TX_BUFSIZE <= UINT16_MAX, "TX FIFO must hold whole packets");
+TU_VERIFY_STATIC(CFG_TUH_MIDI_CABLE_MAX >= 1 && CFG_TUH_MIDI_CABLE_MAX <= 16, "MIDI has up to 16 cables");
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+typedef struct {
+  uint8_t buffer[4];
+  uint8_t index;
+  uint8_t total;
+} midih_stream_t;
+
+typedef struct {
+  uint8_t daddr;
+  uint8_t itf_num;          // AudioControl interface, or MIDIStreaming if there is none
+  uint8_t itf_last;         // MIDIStreaming interface
+  bool mounted;
+
+  uint8_t ep_in;
+  uint8_t ep_out;
+  uint8_t rx_cables;
+  uint8_t tx_cables;
+  uint16_t rx_len;          // bytes per IN transfer: one max packet
+
+  uint8_t rx_idx;           // IN buffer on the bus
+  volatile bool rx_busy;
+  volatile bool rx_kick;    // resuming IN transfer is deferred to usbh task
+
+  midih_stream_t stream_read;
+  midih_stream_t stream_write[CFG_TUH_MIDI_CABLE_MAX];
+
+  /*------------- From this point, data is not cleared by close -------------*/
+  tu_fifo_t rx_ff;
+  tu_fifo_t tx_ff;
+
+  #if CFG_FIFO_MUTEX
+  osal_mutex_def_t rx_ff_mutex;
+  osal_mutex_def_t tx_ff_mutex;
+  #endif
+} midih_interface_t;
+
+#define ITF_MEM_RESET_SIZE   offsetof(midih_interface_t, rx_ff)
+
+// Buffers used with the host controller
+typedef struct {
+  CFG_TUH_MEM_ALIGN uint8_t rx[2][CFG_TUH_MIDI_EP_BUFSIZE];
+  CFG_TUH_MEM_ALIGN uint8_t tx[CFG_TUH_MIDI_EP_BUFSIZE];
+} midih_epbuf_t;
+
+CFG_TUH_MEM_SECTION static midih_interface_t midih_data[CFG_TUH_MIDI];
+CFG_TUH_MEM_SECTION static midih_epbuf_t midih_epbuf[CFG_TUH_MIDI];
+
+static uint8_t midih_rx_ff_buf[CFG_TUH_MIDI][CFG_TUH_MIDI_RX_BUFSIZE];
+static uint8_t midih_tx_ff_buf[CFG_TUH_MIDI][CFG_TUH_MIDI_TX_BUFSIZE];
+
+//--------------------------------------------------------------------+
+// INTERNAL OBJECT & FUNCTION DECLARATION
+//--------------------------------------------------------------------+
+
+static inline midih_interface_t* get_itf(uint8_t idx) {
+  TU_VERIFY(idx < CFG_TUH_MIDI, NULL);
+  midih_interface_t* p_midi = &midih_data[idx];
+
+  return p_midi->mounted ? p_midi : NULL;
+}
+
+// Number of MIDI bytes in an event packet, MIDI 1.0 Table 4-1: Code Index Number Classifications
+static uint8_t midih_packet_bytes(uint8_t code_index) {
+  switch (code_index) {
+    case MIDI_CIN_MISC:
+    case MIDI_CIN_CABLE_EVENT:
+      return 0; // reserved
+
+    case MIDI_CIN_SYSEX_END_1BYTE:
+    case MIDI_CIN_1BYTE_DATA:
+      return 1;
+
+    case MIDI_CIN_SYSCOM_2BYTE:
+    case MIDI_CIN_SYSEX_END_2BYTE:
+    case MIDI_CIN_PROGRAM_CHANGE:
+    case MIDI_CIN_CHANNEL_PRESSURE:
+      return 2;
+
+    default:
+      return 3;
+  }
+}
+
+// Arm IN endpoint with the buffer not holding received data, must be called from usbh task
+static bool midih_rx_xfer(midih_interface_t* p_midi, uint8_t idx) {
+  TU_VERIFY(usbh_edpt_claim(p_midi->daddr, p_midi->ep_in));
+
+  uint8_t const buf_idx = p_midi->rx_idx ^ 1;
+  TU_ASSERT(usbh_edpt_xfer(p_midi->daddr, p_midi->ep_in, midih_epbuf[idx].rx[buf_idx], p_midi->rx_len));
+
+  p_midi->rx_idx = buf_idx;
+  p_midi->rx_busy = true;
+  return true;
+}
+
+static void midih_rx_kick(void* param) {
+  uint8_t const idx = (uint8_t) (uintptr_t) param;
+  midih_interface_t* p_midi = &midih_data[idx];
+  p_midi->rx_kick = false;
+
+  if (p_midi->mounted && p_midi->ep_in && !p_midi->rx_busy &&
+      tu_fifo_remaining(&p_midi->rx_ff) >= p_midi->rx_len) {
+    midih_rx_xfer(p_midi, idx);
+  }
+}
+
+// IN endpoint is paused while RX FIFO is full: resume from usbh task once application has read enough
+static void midih_rx_resume(midih_interface_t* p_midi, uint8_t idx) {
+  if (!p_midi->ep_in || p_midi->rx_busy || p_midi->rx_kick) return;
+  if (tu_fifo_remaining(&p_midi->rx_ff) < p_midi->rx_len) return;
+
+  p_midi->rx_kick = true;
+  usbh_defer_func(midih_rx_kick, (void*) (uintptr_t) idx, false);
+}
+
+static void midih_rx_complete(midih_interface_t* p_midi, uint8_t idx, xfer_result_t result, uint32_t xferred_bytes) {
+  uint8_t const* buf = midih_epbuf[idx].rx[p_midi->rx_idx];
+  uint16_t const len = (result == XFER_RESULT_SUCCESS) ? (uint16_t) (xferred_bytes & ~3u) : 0;
+  p_midi->rx_busy = false;
+
+  // Re-arm with the other buffer first if FIFO can take both
+  if (result == XFER_RESULT_SUCCESS && tu_fifo_remaining(&p_midi->rx_ff) >= len + p_midi->rx_len) {
+    midih_rx_xfer(p_midi, idx);
+  }
+
+  // Copy runs of packets, skipping zero padding (cable 0 with reserved code index 0) sent by some devices
+  uint32_t num_packets = 0;
+  uint16_t start = 0;
+  for (uint16_t i = 0; i <= len; i += 4) {
+    if (i == len || buf[i] == 0) {
+      if (i > start) {
+        tu_fifo_write_n(&p_midi->rx_ff, buf + start, (uint16_t) (i - start));
+        num_packets += (uint32_t) (i - start) / 4;
+      }
+      start = (uint16_t) (i + 4);
+    }
+  }
+
+  if (result != XFER_RESULT_SUCCESS) {
+    TU_LOG_DRV("  MIDI IN transfer failed, result = %u\r\n", result);
+  } else if (!p_midi->rx_busy && tu_fifo_remaining(&p_midi->rx_ff) >= p_midi->rx_len) {
+    midih_rx_xfer(p_midi, idx);
+  }
+
+  if (num_packets && tuh_midi_rx_cb) tuh_midi_rx_cb(idx, num_packets);
+}
+
+static uint32_t midih_write_flush(midih_interface_t* p_midi, uint8_t idx) {
+  // No data to send
+  if (!tu_fifo_count(&p_midi->tx_ff)) return 0;
+
+  // skip if previous transfer not complete
+  TU_VERIFY(usbh_edpt_claim(p_midi->daddr, p_midi->ep_out), 0);
+
+  uint8_t* buf = midih_epbuf[idx].tx;
+  uint16_t const count = tu_fifo_read_n(&p_midi->tx_ff, buf, CFG_TUH_MIDI_EP_BUFSIZE);
+
+  if (count) {
+    TU_ASSERT(usbh_edpt_xfer(p_midi->daddr, p_midi->ep_out, buf, count), 0);
+    return count;
+  } else {
+    // Release endpoint since we don't make any transfer
+    usbh_edpt_release(p_midi->daddr, p_midi->ep_out);
+    return 0;
+  }
+}
+
+//--------------------------------------------------------------------+
+// APPLICATION API
+//--------------------------------------------------------------------+
+
+uint8_t tuh_midi_itf_get_index(uint8_t daddr) {
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    if (midih_data[i].daddr == daddr) return i;
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_midi_mounted(uint8_t idx) {
+  return get_itf(idx) != NULL;
+}
+
+uint8_t tuh_midi_rx_cable_count(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  return p_midi ? p_midi->rx_cables : 0;
+}
+
+uint8_t tuh_midi_tx_cable_count(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  return p_midi ? p_midi->tx_cables : 0;
+}
+
+//------------- Read -------------//
+
+uint32_t tuh_midi_available(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi, 0);
+
+  midih_stream_t const* stream = &p_midi->stream_read;
+
+  // when using with packet API stream total & index are both zero
+  return tu_fifo_count(&p_midi->rx_ff) + (uint8_t) (stream->total - stream->index);
+}
+
+uint32_t tuh_midi_stream_read(uint8_t idx, uint8_t* p_cable_num, void* buffer, uint32_t bufsize) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_cable_num && bufsize, 0);
+
+  uint8_t* buf8 = (uint8_t*) buffer;
+  midih_stream_t* stream = &p_midi->stream_read;
+
+  uint32_t total_read = 0;
+  while (bufsize) {
+    // Get new packet from fifo, then set packet expected bytes
+    if (stream->total == 0) {
+      if (4 != tu_fifo_read_n(&p_midi->rx_ff, stream->buffer, 4)) break;
+
+      stream->total = midih_packet_bytes(stream->buffer[0] & 0x0f);
+      if (stream->total == 0) continue; // skip reserved packet
+    }
+
+    // Bytes of another cable are left for the next read
+    uint8_t const cable_num = stream->buffer[0] >> 4;
+    if (total_read == 0) {
+      *p_cable_num = cable_num;
+    } else if (cable_num != *p_cable_num) {
+      break;
+    }
+
+    // Copy data up to bufsize, skip the header (1st byte) in the buffer
+    uint8_t const count = (uint8_t) tu_min32((uint32_t) (stream->total - stream->index), bufsize);
+    memcpy(buf8, stream->buffer + 1 + stream->index, count);
+
+    total_read += count;
+    stream->index += count;
+    buf8 += count;
+    bufsize -= count;
+
+    // complete current event packet, reset stream
+    if (stream->total == stream->index) {
+      stream->index = 0;
+      stream->total = 0;
+    }
+  }
+
+  midih_rx_resume(p_midi, idx);
+  return total_read;
+}
+
+bool tuh_midi_packet_read(uint8_t idx, uint8_t packet[4]) {
+  return 1 == tuh_midi_packet_read_n(idx, packet, 1);
+}
+
+uint32_t tuh_midi_packet_read_n(uint8_t idx, uint8_t packets[], uint32_t max_packets) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi, 0);
+
+  uint32_t const count = tu_min32(max_packets, tu_fifo_count(&p_midi->rx_ff) / 4);
+  uint32_t const num_read = count ? tu_fifo_read_n(&p_midi->rx_ff, packets, (uint16_t) (count*4)) / 4 : 0;
+
+  midih_rx_resume(p_midi, idx);
+  return num_read;
+}
+
+//------------- Write -------------//
+
+uint32_t tuh_midi_stream_write(uint8_t idx, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->ep_out && cable_num < CFG_TUH_MIDI_CABLE_MAX, 0);
+
+  midih_stream_t* stream = &p_midi->stream_write[cable_num];
+  uint8_t const cable_bits = (uint8_t) (cable_num << 4);
+
+  uint32_t i = 0;
+  while ((i < bufsize) && (tu_fifo_remaining(&p_midi->tx_ff) >= 4)) {
+    uint8_t const data = buffer[i];
+    i++;
+
+    if (stream->index == 0) {
+      //------------- New event packet -------------//
+      uint8_t const msg = data >> 4;
+
+      stream->index = 2;
+      stream->buffer[1] = data;
+
+      if ((stream->buffer[0] & 0xF) == MIDI_CIN_SYSEX_START) {
+        // Still in a SysEx transmit
+        if (data == MIDI_STATUS_SYSEX_END) {
+          stream->buffer[0] = cable_bits | MIDI_CIN_SYSEX_END_1BYTE;
+          stream->total = 2;
+        } else {
+          stream->total = 4;
+        }
+      } else if ((msg >= 0x8 && msg <= 0xB) || msg == 0xE) {
+        // Channel Voice Messages
+        stream->buffer[0] = cable_bits | msg;
+        stream->total = 4;
+      } else if (msg == 0xC || msg == 0xD) {
+        // Channel Voice Messages, two-byte variants (Program Change and Channel Pressure)
+        stream->buffer[0] = cable_bits | msg;
+        stream->total = 3;
+      } else if (msg == 0xf) {
+        // System message
+        if (data == MIDI_STATUS_SYSEX_START) {
+          stream->buffer[0] = MIDI_CIN_SYSEX_START;
+          stream->total = 4;
+        } else if (data == MIDI_STATUS_SYSCOM_TIME_CODE_QUARTER_FRAME || data == MIDI_STATUS_SYSCOM_SONG_SELECT) {
+          stream->buffer[0] = MIDI_CIN_SYSCOM_2BYTE;
+          stream->total = 3;
+        } else if (data == MIDI_STATUS_SYSCOM_SONG_POSITION_POINTER) {
+          stream->buffer[0] = MIDI_CIN_SYSCOM_3BYTE;
+          stream->total = 4;
+        } else {
+          stream->buffer[0] = MIDI_CIN_SYSEX_END_1BYTE;
+          stream->total = 2;
+        }
+        stream->buffer[0] |= cable_bits;
+      } else {
+        // Pack individual bytes if we don't support packing them into words.
+        stream->buffer[0] = cable_bits | MIDI_CIN_1BYTE_DATA;
+        stream->total = 2;
+      }
+    } else {
+      //------------- On-going (buffering) packet -------------//
+      TU_ASSERT(stream->index < 4, i);
+      stream->buffer[stream->index] = data;
+      stream->index++;
+
+      // See if this byte ends a SysEx.
+      if ((stream->buffer[0] & 0xF) == MIDI_CIN_SYSEX_START && data == MIDI_STATUS_SYSEX_END) {
+        stream->buffer[0] = (uint8_t) (cable_bits | (MIDI_CIN_SYSEX_START + (stream->index - 1)));
+        stream->total = stream->index;
+      }
+    }
+
+    // Send out packet
+    if (stream->index == stream->total) {
+      // zeroes unused bytes
+      for (uint8_t j = stream->total; j < 4; j++) stream->buffer[j] = 0;
+
+      uint16_t const count = tu_fifo_write_n(&p_midi->tx_ff, stream->buffer, 4);
+
+      // complete current event packet, reset stream
+      stream->index = stream->total = 0;
+
+      // FIFO overflown, since we already check fifo remaining. It is probably race condition
+      TU_ASSERT(count == 4, i);
+    }
+  }
+
+  midih_write_flush(p_midi, idx);
+
+  return i;
+}
+
+bool tuh_midi_packet_write(uint8_t idx, uint8_t const packet[4]) {
+  return 1 == tuh_midi_packet_write_n(idx, packet, 1);
+}
+
+uint32_t tuh_midi_packet_write_n(uint8_t idx, uint8_t const packets[], uint32_t n_packets) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->ep_out, 0);
+
+  uint32_t const count = tu_min32(n_packets, tu_fifo_remaining(&p_midi->tx_ff) / 4);
+  if (count) {
+    tu_fifo_write_n(&p_midi->tx_ff, packets, (uint16_t) (count*4));
+    midih_write_flush(p_midi, idx);
+  }
+
+  return count;
+}
+
+//--------------------------------------------------------------------+
+// USBH API
+//--------------------------------------------------------------------+
+
+bool midih_init(void) {
+  TU_LOG_DRV("sizeof(midih_interface_t) = %u\r\n", sizeof(midih_interface_t));
+  tu_memclr(midih_data, sizeof(midih_data));
+
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    midih_interface_t* p_midi = &midih_data[i];
+    tu_fifo_config(&p_midi->rx_ff, midih_rx_ff_buf[i], CFG_TUH_MIDI_RX_BUFSIZE, 1, false);
+    tu_fifo_config(&p_midi->tx_ff, midih_tx_ff_buf[i], CFG_TUH_MIDI_TX_BUFSIZE, 1, false);
+
+    #if CFG_FIFO_MUTEX
+    tu_fifo_config_mutex(&p_midi->rx_ff, NULL, osal_mutex_create(&p_midi->rx_ff_mutex));
+    tu_fifo_config_mutex(&p_midi->tx_ff, osal_mutex_create(&p_midi->tx_ff_mutex), NULL);
+    #endif
+  }
+
+  return true;
+}
+
+bool midih_deinit(void) {
+  #if CFG_FIFO_MUTEX
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    midih_interface_t* p_midi = &midih_data[i];
+    osal_mutex_delete(p_midi->rx_ff.mutex_rd);
+    osal_mutex_delete(p_midi->tx_ff.mutex_wr);
+  }
+  #endif
+
+  return true;
+}
+
+void midih_close(uint8_t daddr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_MIDI; idx++) {
+    midih_interface_t* p_midi = &midih_data[idx];
+    if (p_midi->daddr == daddr) {
+      TU_LOG_DRV("  MIDIh close addr = %u index = %u\r\n", daddr, idx);
+      bool const mounted = p_midi->mounted;
+      tu_memclr(p_midi, ITF_MEM_RESET_SIZE);
+      tu_fifo_clear(&p_midi->rx_ff);
+      tu_fifo_clear(&p_midi->tx_ff);
+
+      if (mounted && tuh_midi_umount_cb) tuh_midi_umount_cb(idx);
+    }
+  }
+}
+
+bool midih_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes) {
+  for (uint8_t idx = 0; idx < CFG_TUH_MIDI; idx++) {
+    midih_interface_t* p_midi = &midih_data[idx];
+    if (p_midi->daddr != daddr || !p_midi->mounted) continue;
+
+    if (ep_addr == p_midi->ep_in) {
+      midih_rx_complete(p_midi, idx, event, xferred_bytes);
+      return true;
+    } else if (ep_addr == p_midi->ep_out) {
+      // send remaining events
+      midih_write_flush(p_midi, idx);
+      return true;
+    }
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
+
+bool midih_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* itf_desc, uint16_t max_len) {
+  (void) rhport;
+
+  TU_VERIFY(TUSB_CLASS_AUDIO == itf_desc->bInterfaceClass &&
+            (AUDIO_SUBCLASS_CONTROL == itf_desc->bInterfaceSubClass ||
+             AUDIO_SUBCLASS_MIDI_STREAMING == itf_desc->bInterfaceSubClass));
+
+  uint8_t const* p_desc = (uint8_t const*) itf_desc;
+  uint8_t const* desc_end = p_desc + max_len;
+
+  // AudioControl interface is followed by MIDIStreaming interface
+  if (AUDIO_SUBCLASS_CONTROL == itf_desc->bInterfaceSubClass) {
+    p_desc = tu_desc_next(p_desc);
+    while (p_desc < desc_end && TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) p_desc = tu_desc_next(p_desc);
+    TU_VERIFY(p_desc < desc_end);
+  }
+
+  tusb_desc_interface_t const* desc_ms = (tusb_desc_interface_t const*) p_desc;
+  TU_VERIFY(TUSB_CLASS_AUDIO == desc_ms->bInterfaceClass &&
+            AUDIO_SUBCLASS_MIDI_STREAMING == desc_ms->bInterfaceSubClass);
+
+  uint8_t idx = TUSB_INDEX_INVALID_8;
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    if (midih_data[i].daddr == 0) {
+      idx = i;
+      break;
+    }
+  }
+  TU_VERIFY(idx < CFG_TUH_MIDI);
+  midih_interface_t* p_midi = &midih_data[idx];
+
+  // Bulk endpoints, each followed by class-specific endpoint descriptor listing its embedded jacks
+  tusb_desc_endpoint_t const* desc_in = NULL;
+  tusb_desc_endpoint_t const* desc_out = NULL;
+  uint8_t rx_cables = 1, tx_cables = 1;
+  uint8_t last_dir = TUSB_DIR_OUT;
+
+  p_desc = tu_desc_next(p_desc);
+  while (p_desc < desc_end) {
+    uint8_t const type = tu_desc_type(p_desc);
+
+    if (TUSB_DESC_INTERFACE == type) {
+      // alternate settings of MIDIStreaming interface are not used
+      if (((tusb_desc_interface_t const*) p_desc)->bInterfaceNumber != desc_ms->bInterfaceNumber) break;
+    } else if (TUSB_DESC_ENDPOINT == type) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      if (TUSB_XFER_BULK == desc_ep->bmAttributes.xfer) {
+        last_dir = tu_edpt_dir(desc_ep->bEndpointAddress);
+        if (TUSB_DIR_IN == last_dir) {
+          if (!desc_in) desc_in = desc_ep;
+        } else {
+          if (!desc_out) desc_out = desc_ep;
+        }
+      }
+    } else if (TUSB_DESC_CS_ENDPOINT == type && MIDI_CS_ENDPOINT_GENERAL == p_desc[2] && tu_desc_len(p_desc) >= 4) {
+      uint8_t const cables = tu_min8(p_desc[3], 16);
+      if (TUSB_DIR_IN == last_dir) {
+        rx_cables = cables;
+      } else {
+        tx_cables = cables;
+      }
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  TU_VERIFY(desc_in || desc_out);
+  if (desc_in) {
+    uint16_t const mps = tu_edpt_packet_size(desc_in);
+    TU_ASSERT(mps && mps <= CFG_TUH_MIDI_EP_BUFSIZE && 2*mps <= CFG_TUH_MIDI_RX_BUFSIZE);
+  }
+  if (desc_out) {
+    TU_ASSERT(tu_edpt_packet_size(desc_out) <= CFG_TUH_MIDI_EP_BUFSIZE);
+  }
+
+  tu_memclr(p_midi, ITF_MEM_RESET_SIZE);
+  tu_fifo_clear(&p_midi->rx_ff);
+  tu_fifo_clear(&p_midi->tx_ff);
+
+  p_midi->itf_num  = itf_desc->bInterfaceNumber;
+  p_midi->itf_last = desc_ms->bInterfaceNumber;
+
+  if (desc_in) {
+    TU_ASSERT(tuh_edpt_open(daddr, desc_in));
+    p_midi->ep_in     = desc_in->bEndpointAddress;
+    p_midi->rx_len    = tu_edpt_packet_size(desc_in);
+    p_midi->rx_cables = rx_cables;
+  }
+
+  if (desc_out) {
+    TU_ASSERT(tuh_edpt_open(daddr, desc_out));
+    p_midi->ep_out    = desc_out->bEndpointAddress;
+    p_midi->tx_cables = tx_cables;
+  }
+
+  p_midi->daddr = daddr;
+
+  TU_LOG_DRV("  MIDI: itf = %u, MIDIStreaming itf = %u, %u in cables, %u out cables\r\n", p_midi->itf_num,
+             p_midi->itf_last, p_midi->rx_cables, p_midi->tx_cables);
+
+  return true;
+}
+
+bool midih_set_config(uint8_t daddr, uint8_t itf_num) {
+  uint8_t idx = TUSB_INDEX_INVALID_8;
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    if (midih_data[i].daddr == daddr && midih_data[i].itf_num == itf_num) idx = i;
+  }
+  TU_ASSERT(idx < CFG_TUH_MIDI);
+
+  midih_interface_t* p_midi = &midih_data[idx];
+  p_midi->mounted = true;
+
+  if (p_midi->ep_in) midih_rx_xfer(p_midi, idx);
+
+  TU_LOG_DRV("MIDIh Set Configure complete\r\n");
+  if (tuh_midi_mount_cb) tuh_midi_mount_cb(idx);
+
+  // events written in mount callback
+  if (p_midi->ep_out) midih_write_flush(p_midi, idx);
+
+  // notify usbh that driver enumeration is complete
+  usbh_driver_set_config_complete(daddr, p_midi->itf_last);
+  return true;
+}
+
+#endif
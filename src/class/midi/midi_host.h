@@ -0,0 +1,130 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_MIDI_HOST_H_
+#define _TUSB_MIDI_HOST_H_
+
+#include "class/audio/audio.h"
+#include "midi.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Host driver for USB MIDI 1.0 functions: an optional AudioControl interface followed by a MIDIStreaming interface
+// with bulk endpoints. Each embedded jack of an endpoint is a virtual cable.
+// - Bulk IN is double buffered: the endpoint is re-armed with the other buffer before received events are copied into
+//   the RX FIFO, and each transfer is one max packet so events are delivered as soon as they arrive.
+// - Events written by application are queued in the TX FIFO and sent as soon as the OUT endpoint is free.
+// Functions containing audio streaming interfaces are left to the audio host driver.
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// Size of each of the 2 IN buffers and of the OUT buffer, must hold wMaxPacketSize of the bulk endpoints
+#ifndef CFG_TUH_MIDI_EP_BUFSIZE
+#define CFG_TUH_MIDI_EP_BUFSIZE     (TUH_OPT_HIGH_SPEED ? 512 : 64)
+#endif
+
+// Size of event FIFOs per MIDI function
+#ifndef CFG_TUH_MIDI_RX_BUFSIZE
+#define CFG_TUH_MIDI_RX_BUFSIZE     (4*CFG_TUH_MIDI_EP_BUFSIZE)
+#endif
+
+#ifndef CFG_TUH_MIDI_TX_BUFSIZE
+#define CFG_TUH_MIDI_TX_BUFSIZE     (4*CFG_TUH_MIDI_EP_BUFSIZE)
+#endif
+
+// Number of cables with their own byte stream state for tuh_midi_stream_write()
+#ifndef CFG_TUH_MIDI_CABLE_MAX
+#define CFG_TUH_MIDI_CABLE_MAX      16
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Get index of MIDI function from device address, return TUSB_INDEX_INVALID_8 (0xFF) if not found
+uint8_t  tuh_midi_itf_get_index(uint8_t daddr);
+
+// Check if MIDI function is mounted
+bool     tuh_midi_mounted(uint8_t idx);
+
+// Get number of cables (embedded jacks) of IN (device to host) and OUT (host to device) endpoint
+uint8_t  tuh_midi_rx_cable_count(uint8_t idx);
+uint8_t  tuh_midi_tx_cable_count(uint8_t idx);
+
+// Get the number of bytes available for reading
+uint32_t tuh_midi_available(uint8_t idx);
+
+// Read byte stream of a single cable: stop at the first event of another cable, whose number is returned with the
+// next read. p_cable_num is set to the cable of read bytes.
+uint32_t tuh_midi_stream_read(uint8_t idx, uint8_t* p_cable_num, void* buffer, uint32_t bufsize);
+
+// Write byte stream to a cable, each cable keeps its own message state
+uint32_t tuh_midi_stream_write(uint8_t idx, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize);
+
+// Read event packet             (4 bytes)
+bool     tuh_midi_packet_read(uint8_t idx, uint8_t packet[4]);
+
+// Read multiple event packets   (4 bytes each), return number of packets read
+uint32_t tuh_midi_packet_read_n(uint8_t idx, uint8_t packets[], uint32_t max_packets);
+
+// Write event packet            (4 bytes)
+bool     tuh_midi_packet_write(uint8_t idx, uint8_t const packet[4]);
+
+// Write multiple event packets  (4 bytes each), return number of packets written
+uint32_t tuh_midi_packet_write_n(uint8_t idx, uint8_t const packets[], uint32_t n_packets);
+
+//--------------------------------------------------------------------+
+// Application Callbacks (Weak is optional)
+//--------------------------------------------------------------------+
+
+// Invoked when a device with MIDI function is mounted
+TU_ATTR_WEAK void tuh_midi_mount_cb(uint8_t idx);
+
+// Invoked when a device with MIDI function is unmounted
+TU_ATTR_WEAK void tuh_midi_umount_cb(uint8_t idx);
+
+// Invoked when event packets are received and written to RX FIFO
+TU_ATTR_WEAK void tuh_midi_rx_cb(uint8_t idx, uint32_t num_packets);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+bool midih_init       (void);
+bool midih_deinit     (void);
+bool midih_open       (uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const *itf_desc, uint16_t max_len);
+bool midih_set_config (uint8_t daddr, uint8_t itf_num);
+bool midih_xfer_cb    (uint8_t daddr, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+void midih_close      (uint8_t daddr);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
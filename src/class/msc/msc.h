@@ -121,8 +121,17 @@ typedef enum
   SCSI_CMD_READ_FORMAT_CAPACITY         = 0x23, ///< The command allows the Host to request a list of the possible format capacities for an installed writable media. This command also has the capability to report the writable capacity for a media when it is installed
   SCSI_CMD_READ_10                      = 0x28, ///< The READ (10) command requests that the device server read the specified logical block(s) and transfer them to the data-in buffer.
   SCSI_CMD_WRITE_10                     = 0x2A, ///< The WRITE (10) command requests that the device server transfer the specified logical block(s) from the data-out buffer and write them.
+  SCSI_CMD_READ_16                      = 0x88, ///< Same as READ (10) with 64-bit LBA and 32-bit block count
+  SCSI_CMD_WRITE_16                     = 0x8A, ///< Same as WRITE (10) with 64-bit LBA and 32-bit block count
+  SCSI_CMD_SERVICE_ACTION_IN_16         = 0x9E, ///< Service Action In (16), used for READ CAPACITY (16)
 }scsi_cmd_type_t;
 
+/// SCSI Service Action In (16) service actions
+typedef enum
+{
+  SCSI_SERVICE_ACTION_READ_CAPACITY_16 = 0x10,
+}scsi_service_action_in_t;
+
 /// SCSI Sense Key
 typedef enum
 {
@@ -375,6 +384,45 @@ typedef struct TU_ATTR_PACKED
 TU_VERIFY_STATIC(sizeof(scsi_read10_t) == 10, "size is not correct");
 TU_VERIFY_STATIC(sizeof(scsi_write10_t) == 10, "size is not correct");
 
+/// SCSI Read Capacity 16 Command (Service Action In 16)
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code       ; ///< SCSI OpCode for \ref SCSI_CMD_SERVICE_ACTION_IN_16
+  uint8_t  service_action ; ///< \ref SCSI_SERVICE_ACTION_READ_CAPACITY_16
+  uint32_t lba_hi         ; ///< Upper 32 bits of the Logical Block Address
+  uint32_t lba_lo         ; ///< Lower 32 bits of the Logical Block Address
+  uint32_t alloc_length   ; ///< Allocation length of the response
+  uint8_t  reserved       ;
+  uint8_t  control        ;
+} scsi_read_capacity16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read_capacity16_t) == 16, "size is not correct");
+
+/// SCSI Read Capacity 16 Response Data
+typedef struct {
+  uint32_t last_lba_hi ; ///< Upper 32 bits of the last Logical Block Address
+  uint32_t last_lba_lo ; ///< Lower 32 bits of the last Logical Block Address
+  uint32_t block_size  ; ///< Block size in bytes
+  uint8_t  reserved[20];
+} scsi_read_capacity16_resp_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read_capacity16_resp_t) == 32, "size is not correct");
+
+/// SCSI Read 16 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code    ; ///< SCSI OpCode
+  uint8_t  reserved    ;
+  uint32_t lba_hi      ; ///< Upper 32 bits of the first Logical Block Address (LBA) accessed by this command
+  uint32_t lba_lo      ; ///< Lower 32 bits of the first Logical Block Address (LBA) accessed by this command
+  uint32_t block_count ; ///< Number of Blocks used by this command
+  uint8_t  reserved2   ;
+  uint8_t  control     ;
+} scsi_read16_t, scsi_write16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read16_t) == 16, "size is not correct");
+TU_VERIFY_STATIC(sizeof(scsi_write16_t) == 16, "size is not correct");
+
 #ifdef __cplusplus
  }
 #endif
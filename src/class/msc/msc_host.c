@@ -40,6 +40,10 @@
 
 #define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_MSC_LOG_LEVEL, __VA_ARGS__)
 
+// Largest data transfer queued to the HCD at once (usbh transfer length is 16-bit). Data stage larger than this
+// is split into multiple transfers within the same SCSI command. Must be multiple of bulk max packet size.
+#define MSCH_XFER_SIZE_MAX   (UINT16_MAX & ~(TUSB_EPSIZE_BULK_HS - 1u))
+
 //--------------------------------------------------------------------+
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
@@ -50,6 +54,14 @@ enum {
   MSC_STAGE_STATUS,
 };
 
+// SCSI command waiting in the queue
+typedef struct {
+  msc_cbw_t cbw;
+  void* buffer;
+  tuh_msc_complete_cb_t complete_cb;
+  uintptr_t complete_arg;
+} msch_cmd_t;
+
 typedef struct {
   uint8_t itf_num;
   uint8_t ep_in;
@@ -62,25 +74,36 @@ typedef struct {
 
   struct {
     uint32_t block_size;
-    uint32_t block_count;
+    uint64_t block_count;
   } capacity[CFG_TUH_MSC_MAXLUN];
 
   //------------- SCSI -------------//
+  tu_edpt_state_t cmd_state; // claimed while a command is in flight (CBW -> CSW)
   uint8_t stage;
+  uint32_t data_xferred; // bytes transferred so far in data stage
   void* buffer;
   tuh_msc_complete_cb_t complete_cb;
   uintptr_t complete_arg;
 
   CFG_TUH_MEM_ALIGN msc_cbw_t cbw;
   CFG_TUH_MEM_ALIGN msc_csw_t csw;
+
+  /*------------- From this point, data is not cleared by bus reset -------------*/
+  // Pending commands, BOT executes one command at a time for all LUNs
+  tu_fifo_t cmd_ff;
+  msch_cmd_t cmd_ff_buf[CFG_TUH_MSC_CMD_QUEUE_SIZE];
+  osal_mutex_t cmd_mutex;
+  OSAL_MUTEX_DEF(cmd_mutexdef);
 } msch_interface_t;
 
+#define ITF_MEM_RESET_SIZE   offsetof(msch_interface_t, cmd_ff)
+
 CFG_TUH_MEM_SECTION static msch_interface_t _msch_itf[CFG_TUH_DEVICE_MAX];
 
 // buffer used to read scsi information when mounted
 // largest response data currently is inquiry TODO Inquiry is not part of enum anymore
 CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN
-static uint8_t _msch_buffer[sizeof(scsi_inquiry_resp_t)];
+static uint8_t _msch_buffer[TU_MAX(sizeof(scsi_inquiry_resp_t), sizeof(scsi_read_capacity16_resp_t))];
 
 // FIXME potential nul reference
 TU_ATTR_ALWAYS_INLINE
@@ -97,6 +120,12 @@ uint8_t tuh_msc_get_maxlun(uint8_t dev_addr) {
 }
 
 uint32_t tuh_msc_get_block_count(uint8_t dev_addr, uint8_t lun) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  uint64_t const block_count = p_msc->capacity[lun].block_count;
+  return (block_count > UINT32_MAX) ? UINT32_MAX : (uint32_t) block_count;
+}
+
+uint64_t tuh_msc_get_block_count64(uint8_t dev_addr, uint8_t lun) {
   msch_interface_t* p_msc = get_itf(dev_addr);
   return p_msc->capacity[lun].block_count;
 }
@@ -113,7 +142,12 @@ bool tuh_msc_mounted(uint8_t dev_addr) {
 
 bool tuh_msc_ready(uint8_t dev_addr) {
   msch_interface_t* p_msc = get_itf(dev_addr);
-  return p_msc->mounted && !usbh_edpt_busy(dev_addr, p_msc->ep_in) && !usbh_edpt_busy(dev_addr, p_msc->ep_out);
+  return p_msc->mounted && !tu_fifo_full(&p_msc->cmd_ff);
+}
+
+uint16_t tuh_msc_queue_count(uint8_t dev_addr) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  return tu_fifo_count(&p_msc->cmd_ff);
 }
 
 //--------------------------------------------------------------------+
@@ -126,25 +160,87 @@ static inline void cbw_init(msc_cbw_t* cbw, uint8_t lun) {
   cbw->lun       = lun;
 }
 
+static void cmd_complete(uint8_t daddr, msc_cbw_t const* cbw, msc_csw_t const* csw, void* buffer,
+                         tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  if (complete_cb) {
+    tuh_msc_complete_data_t const cb_data = {
+        .cbw = cbw,
+        .csw = csw,
+        .scsi_data = buffer,
+        .user_arg = arg
+    };
+    complete_cb(daddr, &cb_data);
+  }
+}
+
+// Complete a command which cannot be (fully) executed with failed status
+static void cmd_fail(uint8_t daddr, msc_cbw_t const* cbw, uint32_t data_residue, void* buffer,
+                     tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msc_csw_t const csw = {
+      .signature    = MSC_CSW_SIGNATURE,
+      .tag          = cbw->tag,
+      .data_residue = data_residue,
+      .status       = MSC_CSW_STATUS_FAILED
+  };
+  cmd_complete(daddr, cbw, &csw, buffer, complete_cb, arg);
+}
+
+// Start the next queued command if no command is in flight.
+// Called after queuing a command and when the CSW of the current command is received,
+// so that the next CBW goes out without a round-trip through application code.
+// A command whose CBW cannot be sent is completed with failed status, and the next one is tried.
+static void cmd_start_next(uint8_t daddr) {
+  msch_interface_t* p_msc = get_itf(daddr);
+  msch_cmd_t cmd;
+
+  while (1) {
+    // command in flight, it will start the next one on completion
+    if (!tu_edpt_claim(&p_msc->cmd_state, p_msc->cmd_mutex)) return;
+
+    if (!tu_fifo_read(&p_msc->cmd_ff, &cmd)) {
+      // queue is empty: release and re-check in case a command is queued while we still held the claim
+      tu_edpt_release(&p_msc->cmd_state, p_msc->cmd_mutex);
+      if (tu_fifo_empty(&p_msc->cmd_ff)) return;
+      continue;
+    }
+
+    p_msc->cbw = cmd.cbw;
+    p_msc->stage = MSC_STAGE_CMD;
+    p_msc->data_xferred = 0;
+    p_msc->buffer = cmd.buffer;
+    p_msc->complete_cb = cmd.complete_cb;
+    p_msc->complete_arg = cmd.complete_arg;
+
+    if (usbh_edpt_claim(daddr, p_msc->ep_out)) {
+      if (usbh_edpt_xfer(daddr, p_msc->ep_out, (uint8_t*) &p_msc->cbw, sizeof(msc_cbw_t))) return;
+      usbh_edpt_release(daddr, p_msc->ep_out);
+    }
+
+    TU_LOG_DRV("  MSCh failed to send CBW\r\n");
+    p_msc->stage = MSC_STAGE_IDLE;
+    tu_edpt_release(&p_msc->cmd_state, p_msc->cmd_mutex);
+
+    cmd_fail(daddr, &cmd.cbw, cmd.cbw.total_bytes, cmd.buffer, cmd.complete_cb, cmd.complete_arg);
+  }
+}
+
 bool tuh_msc_scsi_command(uint8_t daddr, msc_cbw_t const* cbw, void* data,
                           tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
   msch_interface_t* p_msc = get_itf(daddr);
   TU_VERIFY(p_msc->configured);
 
-  // claim endpoint
-  TU_VERIFY(usbh_edpt_claim(daddr, p_msc->ep_out));
-
-  p_msc->cbw = *cbw;
-  p_msc->stage = MSC_STAGE_CMD;
-  p_msc->buffer = data;
-  p_msc->complete_cb = complete_cb;
-  p_msc->complete_arg = arg;
+  msch_cmd_t const cmd = {
+      .cbw          = *cbw,
+      .buffer       = data,
+      .complete_cb  = complete_cb,
+      .complete_arg = arg
+  };
 
-  if (!usbh_edpt_xfer(daddr, p_msc->ep_out, (uint8_t*) &p_msc->cbw, sizeof(msc_cbw_t))) {
-    usbh_edpt_release(daddr, p_msc->ep_out);
-    return false;
-  }
+  // queue is full
+  TU_VERIFY(tu_fifo_write(&p_msc->cmd_ff, &cmd));
 
+  // once queued, the command is always completed via complete_cb
+  cmd_start_next(daddr);
   return true;
 }
 
@@ -164,6 +260,28 @@ bool tuh_msc_read_capacity(uint8_t dev_addr, uint8_t lun, scsi_read_capacity10_r
   return tuh_msc_scsi_command(dev_addr, &cbw, response, complete_cb, arg);
 }
 
+bool tuh_msc_read_capacity16(uint8_t dev_addr, uint8_t lun, scsi_read_capacity16_resp_t* response,
+                             tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  TU_VERIFY(p_msc->configured);
+
+  msc_cbw_t cbw;
+  cbw_init(&cbw, lun);
+
+  cbw.total_bytes = sizeof(scsi_read_capacity16_resp_t);
+  cbw.dir         = TUSB_DIR_IN_MASK;
+  cbw.cmd_len     = sizeof(scsi_read_capacity16_t);
+
+  scsi_read_capacity16_t const cmd_read_capacity16 = {
+      .cmd_code       = SCSI_CMD_SERVICE_ACTION_IN_16,
+      .service_action = SCSI_SERVICE_ACTION_READ_CAPACITY_16,
+      .alloc_length   = tu_htonl(sizeof(scsi_read_capacity16_resp_t))
+  };
+  memcpy(cbw.command, &cmd_read_capacity16, cbw.cmd_len);
+
+  return tuh_msc_scsi_command(dev_addr, &cbw, response, complete_cb, arg);
+}
+
 bool tuh_msc_inquiry(uint8_t dev_addr, uint8_t lun, scsi_inquiry_resp_t* response,
                      tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
   msch_interface_t* p_msc = get_itf(dev_addr);
@@ -263,6 +381,60 @@ bool tuh_msc_write10(uint8_t dev_addr, uint8_t lun, void const* buffer, uint32_t
   return tuh_msc_scsi_command(dev_addr, &cbw, (void*) (uintptr_t) buffer, complete_cb, arg);
 }
 
+bool tuh_msc_read16(uint8_t dev_addr, uint8_t lun, void* buffer, uint64_t lba, uint32_t block_count,
+                    tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  TU_VERIFY(p_msc->mounted);
+
+  // data stage is limited by 32-bit dCBWDataTransferLength
+  uint64_t const total_bytes = (uint64_t) block_count * p_msc->capacity[lun].block_size;
+  TU_VERIFY(total_bytes <= UINT32_MAX);
+
+  msc_cbw_t cbw;
+  cbw_init(&cbw, lun);
+
+  cbw.total_bytes = (uint32_t) total_bytes;
+  cbw.dir         = TUSB_DIR_IN_MASK;
+  cbw.cmd_len     = sizeof(scsi_read16_t);
+
+  scsi_read16_t const cmd_read16 = {
+      .cmd_code    = SCSI_CMD_READ_16,
+      .lba_hi      = tu_htonl((uint32_t) (lba >> 32)),
+      .lba_lo      = tu_htonl((uint32_t) lba),
+      .block_count = tu_htonl(block_count)
+  };
+  memcpy(cbw.command, &cmd_read16, cbw.cmd_len);
+
+  return tuh_msc_scsi_command(dev_addr, &cbw, buffer, complete_cb, arg);
+}
+
+bool tuh_msc_write16(uint8_t dev_addr, uint8_t lun, void const* buffer, uint64_t lba, uint32_t block_count,
+                     tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  TU_VERIFY(p_msc->mounted);
+
+  // data stage is limited by 32-bit dCBWDataTransferLength
+  uint64_t const total_bytes = (uint64_t) block_count * p_msc->capacity[lun].block_size;
+  TU_VERIFY(total_bytes <= UINT32_MAX);
+
+  msc_cbw_t cbw;
+  cbw_init(&cbw, lun);
+
+  cbw.total_bytes = (uint32_t) total_bytes;
+  cbw.dir         = TUSB_DIR_OUT;
+  cbw.cmd_len     = sizeof(scsi_write16_t);
+
+  scsi_write16_t const cmd_write16 = {
+      .cmd_code    = SCSI_CMD_WRITE_16,
+      .lba_hi      = tu_htonl((uint32_t) (lba >> 32)),
+      .lba_lo      = tu_htonl((uint32_t) lba),
+      .block_count = tu_htonl(block_count)
+  };
+  memcpy(cbw.command, &cmd_write16, cbw.cmd_len);
+
+  return tuh_msc_scsi_command(dev_addr, &cbw, (void*) (uintptr_t) buffer, complete_cb, arg);
+}
+
 #if 0
 // MSC interface Reset (not used now)
 bool tuh_msc_reset(uint8_t dev_addr) {
@@ -287,10 +459,28 @@ bool tuh_msc_reset(uint8_t dev_addr) {
 bool msch_init(void) {
   TU_LOG_DRV("sizeof(msch_interface_t) = %u\r\n", sizeof(msch_interface_t));
   tu_memclr(_msch_itf, sizeof(_msch_itf));
+
+  for (uint8_t i = 0; i < CFG_TUH_DEVICE_MAX; i++) {
+    msch_interface_t* p_msc = &_msch_itf[i];
+    p_msc->cmd_mutex = osal_mutex_create(&p_msc->cmd_mutexdef);
+    tu_fifo_config(&p_msc->cmd_ff, p_msc->cmd_ff_buf, CFG_TUH_MSC_CMD_QUEUE_SIZE, sizeof(msch_cmd_t), false);
+    tu_fifo_config_mutex(&p_msc->cmd_ff, p_msc->cmd_mutex, p_msc->cmd_mutex);
+  }
+
   return true;
 }
 
 bool msch_deinit(void) {
+  #if OSAL_MUTEX_REQUIRED
+  for (uint8_t i = 0; i < CFG_TUH_DEVICE_MAX; i++) {
+    msch_interface_t* p_msc = &_msch_itf[i];
+    if (p_msc->cmd_mutex) {
+      osal_mutex_delete(p_msc->cmd_mutex);
+      p_msc->cmd_mutex = NULL;
+    }
+  }
+  #endif
+
   return true;
 }
 
@@ -306,7 +496,55 @@ void msch_close(uint8_t dev_addr) {
     if (tuh_msc_umount_cb) tuh_msc_umount_cb(dev_addr);
   }
 
-  tu_memclr(p_msc, sizeof(msch_interface_t));
+  // command in flight and queued commands are completed with failed status. Interface is no longer usable so that
+  // callbacks cannot queue new commands
+  p_msc->configured = false;
+  p_msc->mounted = false;
+
+  if (p_msc->stage != MSC_STAGE_IDLE) {
+    p_msc->stage = MSC_STAGE_IDLE;
+    cmd_fail(dev_addr, &p_msc->cbw, p_msc->cbw.total_bytes - p_msc->data_xferred, p_msc->buffer, p_msc->complete_cb,
+             p_msc->complete_arg);
+  }
+
+  msch_cmd_t cmd;
+  while (tu_fifo_read(&p_msc->cmd_ff, &cmd)) {
+    cmd_fail(dev_addr, &cmd.cbw, cmd.cbw.total_bytes, cmd.buffer, cmd.complete_cb, cmd.complete_arg);
+  }
+
+  tu_fifo_clear(&p_msc->cmd_ff);
+  tu_memclr(p_msc, ITF_MEM_RESET_SIZE);
+}
+
+// Complete command in flight with failed status when a transfer fails, then continue with the next queued command
+static void cmd_abort(uint8_t dev_addr, msch_interface_t* p_msc) {
+  TU_LOG_DRV("  MSCh command failed in stage %u\r\n", p_msc->stage);
+  p_msc->stage = MSC_STAGE_IDLE;
+
+  msc_cbw_t const done_cbw = p_msc->cbw;
+  uint32_t const data_residue = p_msc->cbw.total_bytes - p_msc->data_xferred;
+  void* const done_buffer = p_msc->buffer;
+  tuh_msc_complete_cb_t const complete_cb = p_msc->complete_cb;
+  uintptr_t const complete_arg = p_msc->complete_arg;
+
+  tu_edpt_release(&p_msc->cmd_state, p_msc->cmd_mutex);
+  cmd_start_next(dev_addr);
+
+  cmd_fail(dev_addr, &done_cbw, data_residue, done_buffer, complete_cb, complete_arg);
+}
+
+static bool csw_xfer(uint8_t dev_addr, msch_interface_t* p_msc) {
+  p_msc->stage = MSC_STAGE_STATUS;
+  return usbh_edpt_xfer(dev_addr, p_msc->ep_in, (uint8_t*) &p_msc->csw, (uint16_t) sizeof(msc_csw_t));
+}
+
+// Queue next chunk of data stage, large data is split into multiple transfers of at most MSCH_XFER_SIZE_MAX
+static bool data_xfer_next(uint8_t dev_addr, msch_interface_t* p_msc) {
+  msc_cbw_t const * cbw = &p_msc->cbw;
+  uint8_t const ep_data = (cbw->dir & TUSB_DIR_IN_MASK) ? p_msc->ep_in : p_msc->ep_out;
+  uint16_t const xfer_len = (uint16_t) tu_min32(cbw->total_bytes - p_msc->data_xferred, MSCH_XFER_SIZE_MAX);
+
+  return usbh_edpt_xfer(dev_addr, ep_data, ((uint8_t*) p_msc->buffer) + p_msc->data_xferred, xfer_len);
 }
 
 bool msch_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes) {
@@ -317,40 +555,57 @@ bool msch_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t event, uint32
   switch (p_msc->stage) {
     case MSC_STAGE_CMD:
       // Must be Command Block
-      TU_ASSERT(ep_addr == p_msc->ep_out && event == XFER_RESULT_SUCCESS && xferred_bytes == sizeof(msc_cbw_t));
-
-      if (cbw->total_bytes && p_msc->buffer) {
+      if (ep_addr != p_msc->ep_out || event != XFER_RESULT_SUCCESS || xferred_bytes != sizeof(msc_cbw_t)) {
+        cmd_abort(dev_addr, p_msc);
+      } else if (cbw->total_bytes && p_msc->buffer) {
         // Data stage if any
         p_msc->stage = MSC_STAGE_DATA;
-        uint8_t const ep_data = (cbw->dir & TUSB_DIR_IN_MASK) ? p_msc->ep_in : p_msc->ep_out;
-        TU_ASSERT(usbh_edpt_xfer(dev_addr, ep_data, p_msc->buffer, (uint16_t) cbw->total_bytes));
+        if (!data_xfer_next(dev_addr, p_msc)) cmd_abort(dev_addr, p_msc);
       } else {
         // Status stage
-        p_msc->stage = MSC_STAGE_STATUS;
-        TU_ASSERT(usbh_edpt_xfer(dev_addr, p_msc->ep_in, (uint8_t*) &p_msc->csw, (uint16_t) sizeof(msc_csw_t)));
+        if (!csw_xfer(dev_addr, p_msc)) cmd_abort(dev_addr, p_msc);
       }
       break;
 
-    case MSC_STAGE_DATA:
+    case MSC_STAGE_DATA: {
+      uint32_t const requested = tu_min32(cbw->total_bytes - p_msc->data_xferred, MSCH_XFER_SIZE_MAX);
+      p_msc->data_xferred += xferred_bytes;
+
+      // more data to transfer: continue unless error or short packet (device ends data stage early)
+      if (event == XFER_RESULT_SUCCESS && xferred_bytes == requested && p_msc->data_xferred < cbw->total_bytes) {
+        if (!data_xfer_next(dev_addr, p_msc)) cmd_abort(dev_addr, p_msc);
+        break;
+      }
+
       // Status stage
-      p_msc->stage = MSC_STAGE_STATUS;
-      TU_ASSERT(usbh_edpt_xfer(dev_addr, p_msc->ep_in, (uint8_t*) &p_msc->csw, (uint16_t) sizeof(msc_csw_t)));
+      if (!csw_xfer(dev_addr, p_msc)) cmd_abort(dev_addr, p_msc);
       break;
+    }
+
+    case MSC_STAGE_STATUS: {
+      // CSW is not received: previous content of csw is not valid
+      if (event != XFER_RESULT_SUCCESS) {
+        cmd_abort(dev_addr, p_msc);
+        break;
+      }
 
-    case MSC_STAGE_STATUS:
       // SCSI op is complete
       p_msc->stage = MSC_STAGE_IDLE;
 
-      if (p_msc->complete_cb) {
-        tuh_msc_complete_data_t const cb_data = {
-            .cbw = cbw,
-            .csw = csw,
-            .scsi_data = p_msc->buffer,
-            .user_arg = p_msc->complete_arg
-        };
-        p_msc->complete_cb(dev_addr, &cb_data);
-      }
+      // save completed command since cbw/csw are re-used by the next queued command
+      msc_cbw_t const done_cbw = *cbw;
+      msc_csw_t const done_csw = *csw;
+      void* const done_buffer = p_msc->buffer;
+      tuh_msc_complete_cb_t const complete_cb = p_msc->complete_cb;
+      uintptr_t const complete_arg = p_msc->complete_arg;
+
+      // keep the pipes busy: issue next CBW before invoking the callback
+      tu_edpt_release(&p_msc->cmd_state, p_msc->cmd_mutex);
+      cmd_start_next(dev_addr);
+
+      cmd_complete(dev_addr, &done_cbw, &done_csw, done_buffer, complete_cb, complete_arg);
       break;
+    }
 
       // unknown state
     default:
@@ -367,6 +622,8 @@ static void config_get_maxlun_complete(tuh_xfer_t* xfer);
 static bool config_test_unit_ready_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data);
 static bool config_request_sense_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data);
 static bool config_read_capacity_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data);
+static bool config_read_capacity16_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data);
+static void config_mount_complete(uint8_t dev_addr);
 
 bool msch_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
   (void) rhport;
@@ -452,6 +709,9 @@ static bool config_test_unit_ready_complete(uint8_t dev_addr, tuh_msc_complete_d
   msc_cbw_t const* cbw = cb_data->cbw;
   msc_csw_t const* csw = cb_data->csw;
 
+  // interface is closed while enumerating
+  TU_VERIFY(get_itf(dev_addr)->configured);
+
   if (csw->status == 0) {
     // Unit is ready, read its capacity
     TU_LOG_DRV("SCSI Read Capacity\r\n");
@@ -487,17 +747,48 @@ static bool config_read_capacity_complete(uint8_t dev_addr, tuh_msc_complete_dat
 
   // Capacity response field: Block size and Last LBA are both Big-Endian
   scsi_read_capacity10_resp_t* resp = (scsi_read_capacity10_resp_t*) ((void*) _msch_buffer);
-  p_msc->capacity[cbw->lun].block_count = tu_ntohl(resp->last_lba) + 1;
+  uint32_t const last_lba = tu_ntohl(resp->last_lba);
+  p_msc->capacity[cbw->lun].block_count = (uint64_t) last_lba + 1;
+  p_msc->capacity[cbw->lun].block_size  = tu_ntohl(resp->block_size);
+
+  if (last_lba == UINT32_MAX) {
+    // capacity does not fit in 32-bit LBA, use Read Capacity 16
+    TU_LOG_DRV("SCSI Read Capacity 16\r\n");
+    TU_ASSERT(tuh_msc_read_capacity16(dev_addr, cbw->lun, (scsi_read_capacity16_resp_t*) ((void*) _msch_buffer),
+                                      config_read_capacity16_complete, 0));
+  } else {
+    config_mount_complete(dev_addr);
+  }
+
+  return true;
+}
+
+static bool config_read_capacity16_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data) {
+  msc_cbw_t const* cbw = cb_data->cbw;
+  msc_csw_t const* csw = cb_data->csw;
+
+  TU_ASSERT(csw->status == 0);
+
+  msch_interface_t* p_msc = get_itf(dev_addr);
+
+  scsi_read_capacity16_resp_t* resp = (scsi_read_capacity16_resp_t*) ((void*) _msch_buffer);
+  uint64_t const last_lba = (((uint64_t) tu_ntohl(resp->last_lba_hi)) << 32) | tu_ntohl(resp->last_lba_lo);
+  p_msc->capacity[cbw->lun].block_count = last_lba + 1;
   p_msc->capacity[cbw->lun].block_size  = tu_ntohl(resp->block_size);
 
+  config_mount_complete(dev_addr);
+  return true;
+}
+
+static void config_mount_complete(uint8_t dev_addr) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+
   // Mark enumeration is complete
   p_msc->mounted = true;
   if (tuh_msc_mount_cb) tuh_msc_mount_cb(dev_addr);
 
   // notify usbh that driver enumeration is complete
   usbh_driver_set_config_complete(dev_addr, p_msc->itf_num);
-
-  return true;
 }
 
 #endif
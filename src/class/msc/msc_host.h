@@ -41,6 +41,11 @@
 #define CFG_TUH_MSC_MAXLUN  4
 #endif
 
+// Number of SCSI commands that can be queued per device (in addition to the one in flight)
+#ifndef CFG_TUH_MSC_CMD_QUEUE_SIZE
+#define CFG_TUH_MSC_CMD_QUEUE_SIZE  4
+#endif
+
 typedef struct {
   msc_cbw_t const* cbw; // SCSI command
   msc_csw_t const* csw; // SCSI status
@@ -58,21 +63,29 @@ typedef bool (*tuh_msc_complete_cb_t)(uint8_t dev_addr, tuh_msc_complete_data_t
 // This function true after tuh_msc_mounted_cb() and false after tuh_msc_unmounted_cb()
 bool tuh_msc_mounted(uint8_t dev_addr);
 
-// Check if the interface is currently ready or busy transferring data
+// Check if the interface can accept a new SCSI command i.e command queue is not full
 bool tuh_msc_ready(uint8_t dev_addr);
 
+// Get number of queued SCSI commands, not including the one in flight
+uint16_t tuh_msc_queue_count(uint8_t dev_addr);
+
 // Get Max Lun
 uint8_t tuh_msc_get_maxlun(uint8_t dev_addr);
 
-// Get number of block
+// Get number of block, saturated to UINT32_MAX for devices larger than 32-bit LBA
 uint32_t tuh_msc_get_block_count(uint8_t dev_addr, uint8_t lun);
 
+// Get number of block (64-bit)
+uint64_t tuh_msc_get_block_count64(uint8_t dev_addr, uint8_t lun);
+
 // Get block size in bytes
 uint32_t tuh_msc_get_block_size(uint8_t dev_addr, uint8_t lun);
 
 // Perform a full SCSI command (cbw, data, csw) in non-blocking manner.
-// Complete callback is invoked when SCSI op is complete.
-// return true if success, false if there is already pending operation.
+// Commands are queued and executed in order, the next CBW is sent as soon as the previous CSW is received.
+// Complete callback is always invoked: when SCSI op is complete, or with failed CSW status if a transfer of the
+// command fails or the device is unplugged.
+// return true if success, false if the command queue is full.
 bool tuh_msc_scsi_command(uint8_t daddr, msc_cbw_t const* cbw, void* data, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
 
 // Perform SCSI Inquiry command
@@ -95,12 +108,27 @@ bool tuh_msc_read10(uint8_t dev_addr, uint8_t lun, void * buffer, uint32_t lba,
 // Complete callback is invoked when SCSI op is complete.
 bool tuh_msc_write10(uint8_t dev_addr, uint8_t lun, void const * buffer, uint32_t lba, uint16_t block_count, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
 
+// Perform SCSI Read 16 command. Read n blocks starting from 64-bit LBA to buffer.
+// Data larger than a single host transfer is split internally within the same SCSI command.
+// Complete callback is invoked when SCSI op is complete.
+bool tuh_msc_read16(uint8_t dev_addr, uint8_t lun, void * buffer, uint64_t lba, uint32_t block_count, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+
+// Perform SCSI Write 16 command. Write n blocks starting from 64-bit LBA to device.
+// Data larger than a single host transfer is split internally within the same SCSI command.
+// Complete callback is invoked when SCSI op is complete.
+bool tuh_msc_write16(uint8_t dev_addr, uint8_t lun, void const * buffer, uint64_t lba, uint32_t block_count, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+
 // Perform SCSI Read Capacity 10 command
 // Complete callback is invoked when SCSI op is complete.
 // Note: during enumeration, host stack already carried out this request. Application can retrieve capacity by
 // simply call tuh_msc_get_block_count() and tuh_msc_get_block_size()
 bool tuh_msc_read_capacity(uint8_t dev_addr, uint8_t lun, scsi_read_capacity10_resp_t* response, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
 
+// Perform SCSI Read Capacity 16 command, required for devices with more than 2^32 blocks.
+// Complete callback is invoked when SCSI op is complete.
+// Note: during enumeration, host stack already carried out this request if needed.
+bool tuh_msc_read_capacity16(uint8_t dev_addr, uint8_t lun, scsi_read_capacity16_resp_t* response, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+
 //------------- Application Callback -------------//
 
 // Invoked when a device with MassStorage interface is mounted
@@ -56,16 +56,37 @@ typedef struct
   // keep a copy of endpoint attribute instead
   uint8_t const * ecm_desc_epdata;
 
+  uint32_t rndis_max_xfer; // MaxTransferSize of host (RNDIS Initialize), limits size of IN transfers
+
 } netd_interface_t;
 
 #define CFG_TUD_NET_PACKET_PREFIX_LEN sizeof(rndis_data_packet_t)
 #define CFG_TUD_NET_PACKET_SUFFIX_LEN 0
 
+#define NETD_ALIGN4(_x)  (((_x) + 3u) & ~3u)
+
+// Size of a transfer buffer: ECM frame or up to CFG_TUD_NET_RNDIS_PACKETS_PER_XFER RNDIS packet messages,
+// each padded to 4 bytes
+#define NETD_XFER_SIZE  (CFG_TUD_NET_RNDIS_PACKETS_PER_XFER * NETD_ALIGN4(CFG_TUD_NET_PACKET_PREFIX_LEN + CFG_TUD_NET_MTU) + CFG_TUD_NET_PACKET_PREFIX_LEN)
+
+TU_VERIFY_STATIC(NETD_XFER_SIZE <= UINT16_MAX, "CFG_TUD_NET_RNDIS_PACKETS_PER_XFER is too large");
+
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static
-uint8_t received[CFG_TUD_NET_PACKET_PREFIX_LEN + CFG_TUD_NET_MTU + CFG_TUD_NET_PACKET_PREFIX_LEN];
+uint8_t received[CFG_TUD_NET_RX_FRAMES][NETD_XFER_SIZE];
 
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static
-uint8_t transmitted[CFG_TUD_NET_PACKET_PREFIX_LEN + CFG_TUD_NET_MTU + CFG_TUD_NET_PACKET_PREFIX_LEN];
+uint8_t transmitted[CFG_TUD_NET_TX_FRAMES][NETD_XFER_SIZE];
+
+// State of receive/transmit buffers
+enum {
+  NETD_BUF_FREE = 0,
+  NETD_BUF_RECEIVING,  // rx: OUT transfer queued
+  NETD_BUF_READY,      // rx: received, waiting for delivery
+  NETD_BUF_DELIVERING, // rx: frames are being passed to application
+  NETD_BUF_HELD,       // rx: all frames delivered, some still held by application
+  NETD_BUF_FILLING,    // tx: frames are being added (RNDIS multi-packet)
+  NETD_BUF_QUEUED,     // tx: waiting for or in IN transfer
+};
 
 struct ecm_notify_struct
 {
@@ -107,17 +128,291 @@ CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static union
 // TODO remove CFG_TUD_MEM_SECTION
 CFG_TUD_MEM_SECTION tu_static netd_interface_t _netd_itf;
 
-tu_static bool can_xmit;
+// Receive buffers are armed and delivered in ring order
+typedef struct
+{
+  uint16_t len;     // received length
+  uint8_t  state;
+  uint8_t  hold;    // number of frames held by application
+} netd_rx_buf_t;
+
+// Transmit buffers are filled and sent in ring order
+typedef struct
+{
+  uint16_t len;
+  uint8_t  state;
+  uint8_t  count;   // number of RNDIS packet messages
+  uint16_t last;    // offset of last RNDIS packet message
+
+  // frame sent in place by tud_network_xmit_bufs(), released when transfer is complete
+  uint8_t const *ext;
+  void *ext_ref;
+} netd_tx_buf_t;
+
+tu_static struct
+{
+  netd_rx_buf_t rx[CFG_TUD_NET_RX_FRAMES];
+  uint8_t  rx_cur;     // buffer being delivered
+  uint8_t  rx_arm;     // buffer to arm next
+  bool     rx_armed;   // OUT endpoint is armed
+  bool     rx_busy;    // a frame is passed to application, waiting for tud_network_recv_renew()
+  uint16_t rx_offset;  // offset of next RNDIS packet message in buffer being delivered
+
+  netd_tx_buf_t tx[CFG_TUD_NET_TX_FRAMES];
+  uint8_t  tx_fill;    // buffer to fill next
+  uint8_t  tx_send;    // buffer to send next or being sent
+  bool     tx_busy;    // IN endpoint is busy
+  uint16_t tx_reserve; // size passed to tud_network_can_xmit(), reserved for tud_network_xmit()
+} _netd_buf;
+
+// Arm the OUT endpoint with next receive buffer if it is free
+static void netd_start_rx(void)
+{
+  uint8_t const idx = _netd_buf.rx_arm;
+  if (_netd_buf.rx_armed || _netd_buf.rx[idx].state != NETD_BUF_FREE || !_netd_itf.ep_out) return;
+
+  _netd_buf.rx[idx].state = NETD_BUF_RECEIVING;
+  _netd_buf.rx_armed = true;
+
+  if (!usbd_edpt_xfer(0, _netd_itf.ep_out, received[idx], NETD_XFER_SIZE))
+  {
+    _netd_buf.rx[idx].state = NETD_BUF_FREE;
+    _netd_buf.rx_armed = false;
+  }
+}
+
+// Get next frame of the buffer being delivered, return false if there is none left
+static bool netd_next_frame(uint8_t idx, uint8_t **frame, uint16_t *size)
+{
+  uint8_t *buf = received[idx];
+  uint16_t const len = _netd_buf.rx[idx].len;
+  uint16_t const offset = _netd_buf.rx_offset;
+
+  if (_netd_itf.ecm_mode)
+  {
+    if (offset || !len) return false;
+
+    *frame = buf;
+    *size  = len;
+    _netd_buf.rx_offset = len;
+    return true;
+  }
+
+  // RNDIS: transfer may contain several packet messages
+  rndis_data_packet_t hdr;
+  TU_VERIFY(offset + sizeof(rndis_data_packet_t) <= len);
+  memcpy(&hdr, buf + offset, sizeof(rndis_data_packet_t));
+
+  TU_VERIFY(hdr.MessageType == REMOTE_NDIS_PACKET_MSG && hdr.MessageLength >= sizeof(rndis_data_packet_t) &&
+            hdr.MessageLength <= (uint32_t) (len - offset));
+
+  uint32_t const data_offset = offset + offsetof(rndis_data_packet_t, DataOffset) + hdr.DataOffset;
+  TU_VERIFY(hdr.DataOffset <= hdr.MessageLength && hdr.DataLength <= hdr.MessageLength &&
+            data_offset + hdr.DataLength <= offset + hdr.MessageLength);
+
+  *frame = buf + data_offset;
+  *size  = (uint16_t) hdr.DataLength;
+  _netd_buf.rx_offset = (uint16_t) (offset + hdr.MessageLength);
+  return true;
+}
+
+// Pass received frames to application in order, one at a time
+static void netd_deliver_rx(void)
+{
+  while (!_netd_buf.rx_busy)
+  {
+    uint8_t const idx = _netd_buf.rx_cur;
+    netd_rx_buf_t *rx = &_netd_buf.rx[idx];
+
+    if (rx->state == NETD_BUF_READY)
+    {
+      rx->state = NETD_BUF_DELIVERING;
+      _netd_buf.rx_offset = 0;
+    }
+
+    if (rx->state != NETD_BUF_DELIVERING) break;
+
+    uint8_t *frame;
+    uint16_t size;
+    if (netd_next_frame(idx, &frame, &size))
+    {
+      _netd_buf.rx_busy = true;
+      if (!tud_network_recv_cb(frame, size))
+      {
+        /* if a buffer was never handled by user code, we must renew on the user's behalf */
+        _netd_buf.rx_busy = false;
+      }
+    }
+    else
+    {
+      // all frames delivered, buffer is re-used once released by application
+      rx->state = rx->hold ? NETD_BUF_HELD : NETD_BUF_FREE;
+      _netd_buf.rx_cur = (uint8_t) ((idx + 1) % CFG_TUD_NET_RX_FRAMES);
+      netd_start_rx();
+    }
+  }
+}
+
+static int netd_find_rx_buf(const uint8_t *frame)
+{
+  for (uint8_t i = 0; i < CFG_TUD_NET_RX_FRAMES; i++)
+  {
+    if (frame >= received[i] && frame < received[i] + NETD_XFER_SIZE) return i;
+  }
+  return -1;
+}
 
 void tud_network_recv_renew(void)
 {
-  usbd_edpt_xfer(0, _netd_itf.ep_out, received, sizeof(received));
+  _netd_buf.rx_busy = false;
+  netd_start_rx();
+  netd_deliver_rx();
+}
+
+bool tud_network_recv_hold(const uint8_t *datagram)
+{
+  int const idx = netd_find_rx_buf(datagram);
+  TU_VERIFY(idx >= 0 && _netd_buf.rx[idx].state == NETD_BUF_DELIVERING);
+
+  _netd_buf.rx[idx].hold++;
+  return true;
+}
+
+void tud_network_recv_release(const uint8_t *datagram)
+{
+  int const idx = netd_find_rx_buf(datagram);
+  TU_VERIFY(idx >= 0 && _netd_buf.rx[idx].hold, );
+
+  _netd_buf.rx[idx].hold--;
+  if (_netd_buf.rx[idx].hold == 0 && _netd_buf.rx[idx].state == NETD_BUF_HELD)
+  {
+    _netd_buf.rx[idx].state = NETD_BUF_FREE;
+    netd_start_rx();
+  }
+}
+
+// Send next queued transmit buffer if IN endpoint is idle. A partially filled buffer is sent as well.
+static void netd_start_tx(void)
+{
+  if (_netd_buf.tx_busy || !_netd_itf.ep_in) return;
+
+  netd_tx_buf_t *tx = &_netd_buf.tx[_netd_buf.tx_send];
+
+  if (tx->state == NETD_BUF_FILLING)
+  {
+    tx->state = NETD_BUF_QUEUED;
+    _netd_buf.tx_fill = (uint8_t) ((_netd_buf.tx_fill + 1) % CFG_TUD_NET_TX_FRAMES);
+  }
+
+  if (tx->state != NETD_BUF_QUEUED) return;
+
+  _netd_buf.tx_busy = true;
+  usbd_edpt_xfer(0, _netd_itf.ep_in, tx->ext ? (uint8_t*) (uintptr_t) tx->ext : transmitted[_netd_buf.tx_send], tx->len);
+}
+
+// Release transmit buffer after its transfer is complete
+static void netd_tx_done(netd_tx_buf_t *tx)
+{
+  if (tx->ext)
+  {
+    tx->ext = NULL;
+    if (tud_network_xmit_done_cb) tud_network_xmit_done_cb(tx->ext_ref);
+  }
+  tx->state = NETD_BUF_FREE;
+}
+
+// Maximum length of a transmit transfer
+static uint16_t netd_tx_max(void)
+{
+  if (_netd_itf.ecm_mode) return CFG_TUD_NET_MTU;
+  return (uint16_t) tu_min32(NETD_XFER_SIZE - CFG_TUD_NET_PACKET_PREFIX_LEN, _netd_itf.rndis_max_xfer);
+}
+
+// Check if a frame of size bytes can be appended to transmit buffer
+static bool netd_tx_fits(netd_tx_buf_t const *tx, uint16_t size)
+{
+  if (tx->state == NETD_BUF_FREE) return true;
+  if (tx->state != NETD_BUF_FILLING) return false;
+
+  return tx->count < CFG_TUD_NET_RNDIS_PACKETS_PER_XFER &&
+         NETD_ALIGN4(tx->len) + CFG_TUD_NET_PACKET_PREFIX_LEN + size <= netd_tx_max();
+}
+
+// Get transmit buffer to place a frame of given size, NULL if all buffers are in use
+static netd_tx_buf_t *netd_tx_buf(uint16_t size)
+{
+  netd_tx_buf_t *tx = &_netd_buf.tx[_netd_buf.tx_fill];
+
+  if (tx->state == NETD_BUF_FILLING && !netd_tx_fits(tx, size))
+  {
+    // current buffer is full, queue it and continue with the next one
+    tx->state = NETD_BUF_QUEUED;
+    _netd_buf.tx_fill = (uint8_t) ((_netd_buf.tx_fill + 1) % CFG_TUD_NET_TX_FRAMES);
+    tx = &_netd_buf.tx[_netd_buf.tx_fill];
+  }
+
+  if (!netd_tx_fits(tx, size)) return NULL;
+
+  if (tx->state == NETD_BUF_FREE)
+  {
+    tx->state = NETD_BUF_FILLING;
+    tx->len   = 0;
+    tx->count = 0;
+  }
+
+  return tx;
 }
 
-static void do_in_xfer(uint8_t *buf, uint16_t len)
+// Get pointer to place frame data in transmit buffer, add RNDIS packet message header if needed
+static uint8_t *netd_tx_frame_ptr(netd_tx_buf_t *tx)
 {
-  can_xmit = false;
-  usbd_edpt_xfer(0, _netd_itf.ep_in, buf, len);
+  uint8_t *buf = transmitted[tx - _netd_buf.tx];
+
+  if (_netd_itf.ecm_mode) return buf;
+
+  // pad previous message to 4 bytes
+  if (tx->count)
+  {
+    uint16_t const pad = (uint16_t) (NETD_ALIGN4(tx->len) - tx->len);
+    rndis_data_packet_t *prev = (rndis_data_packet_t *) ((void*) (buf + tx->last));
+    memset(buf + tx->len, 0, pad);
+    prev->MessageLength += pad;
+    tx->len = (uint16_t) (tx->len + pad);
+  }
+
+  return buf + tx->len + CFG_TUD_NET_PACKET_PREFIX_LEN;
+}
+
+// Frame of given size was placed in transmit buffer
+static void netd_tx_frame_added(netd_tx_buf_t *tx, uint16_t size)
+{
+  if (_netd_itf.ecm_mode)
+  {
+    tx->len = size;
+    tx->state = NETD_BUF_QUEUED; // one frame per transfer
+  }
+  else
+  {
+    rndis_data_packet_t *hdr = (rndis_data_packet_t *) ((void*) (transmitted[tx - _netd_buf.tx] + tx->len));
+    memset(hdr, 0, sizeof(rndis_data_packet_t));
+    hdr->MessageType = REMOTE_NDIS_PACKET_MSG;
+    hdr->MessageLength = CFG_TUD_NET_PACKET_PREFIX_LEN + size;
+    hdr->DataOffset = sizeof(rndis_data_packet_t) - offsetof(rndis_data_packet_t, DataOffset);
+    hdr->DataLength = size;
+
+    tx->last = tx->len;
+    tx->len = (uint16_t) (tx->len + CFG_TUD_NET_PACKET_PREFIX_LEN + size);
+    tx->count++;
+
+    if (tx->count >= CFG_TUD_NET_RNDIS_PACKETS_PER_XFER) tx->state = NETD_BUF_QUEUED;
+  }
+
+  if (tx->state == NETD_BUF_QUEUED)
+  {
+    _netd_buf.tx_fill = (uint8_t) ((_netd_buf.tx_fill + 1) % CFG_TUD_NET_TX_FRAMES);
+  }
+
+  netd_start_tx();
 }
 
 void netd_report(uint8_t *buf, uint16_t len)
@@ -135,6 +430,13 @@ void netd_report(uint8_t *buf, uint16_t len)
 void netd_init(void)
 {
   tu_memclr(&_netd_itf, sizeof(_netd_itf));
+
+  // release frames sent in place
+  for (uint8_t i = 0; i < CFG_TUD_NET_TX_FRAMES; i++)
+  {
+    netd_tx_done(&_netd_buf.tx[i]);
+  }
+  tu_memclr(&_netd_buf, sizeof(_netd_buf));
 }
 
 void netd_reset(uint8_t rhport)
@@ -215,13 +517,12 @@ uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
     // Open endpoint pair for RNDIS
     TU_ASSERT( usbd_open_edpt_pair(rhport, p_desc, 2, TUSB_XFER_BULK, &_netd_itf.ep_out, &_netd_itf.ep_in), 0 );
 
-    tud_network_init_cb();
+    _netd_itf.rndis_max_xfer = NETD_XFER_SIZE;
 
-    // we are ready to transmit a packet
-    can_xmit = true;
+    tud_network_init_cb();
 
     // prepare for incoming packets
-    tud_network_recv_renew();
+    netd_start_rx();
   }
 
   drv_len += 2*sizeof(tusb_desc_endpoint_t);
@@ -282,8 +583,7 @@ bool netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t
                 // TODO should be merge with RNDIS's after endpoint opened
                 // Also should have opposite callback for application to disable network !!
                 tud_network_init_cb();
-                can_xmit = true; // we are ready to transmit a packet
-                tud_network_recv_renew(); // prepare for incoming packets
+                netd_start_rx(); // prepare for incoming packets
               }
             }else
             {
@@ -343,6 +643,13 @@ bool netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t
     {
       if ( !_netd_itf.ecm_mode )
       {
+        // host's maximum transfer size limits the number of packets combined in an IN transfer
+        rndis_initialize_msg_t const *init_msg = (rndis_initialize_msg_t const *) ((void const*) notify.rndis_buf);
+        if ( init_msg->MessageType == REMOTE_NDIS_INITIALIZE_MSG && init_msg->MaxTransferSize )
+        {
+          _netd_itf.rndis_max_xfer = init_msg->MaxTransferSize;
+        }
+
         rndis_class_set_handler(notify.rndis_buf, request->wLength);
       }
     }
@@ -351,34 +658,6 @@ bool netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t
   return true;
 }
 
-static void handle_incoming_packet(uint32_t len)
-{
-  uint8_t *pnt = received;
-  uint32_t size = 0;
-
-  if (_netd_itf.ecm_mode)
-  {
-    size = len;
-  }
-  else
-  {
-    rndis_data_packet_t *r = (rndis_data_packet_t *) ((void*) pnt);
-    if (len >= sizeof(rndis_data_packet_t))
-      if ( (r->MessageType == REMOTE_NDIS_PACKET_MSG) && (r->MessageLength <= len))
-        if ( (r->DataOffset + offsetof(rndis_data_packet_t, DataOffset) + r->DataLength) <= len)
-        {
-          pnt = &received[r->DataOffset + offsetof(rndis_data_packet_t, DataOffset)];
-          size = r->DataLength;
-        }
-  }
-
-  if (!tud_network_recv_cb(pnt, (uint16_t) size))
-  {
-    /* if a buffer was never handled by user code, we must renew on the user's behalf */
-    tud_network_recv_renew();
-  }
-}
-
 bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
 {
   (void) rhport;
@@ -387,7 +666,15 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   /* new packet received */
   if ( ep_addr == _netd_itf.ep_out )
   {
-    handle_incoming_packet(xferred_bytes);
+    uint8_t const idx = _netd_buf.rx_arm;
+    _netd_buf.rx[idx].len = (uint16_t) xferred_bytes;
+    _netd_buf.rx[idx].state = NETD_BUF_READY;
+    _netd_buf.rx_arm = (uint8_t) ((idx + 1) % CFG_TUD_NET_RX_FRAMES);
+    _netd_buf.rx_armed = false;
+
+    // re-arm with next buffer before passing frames to application
+    netd_start_rx();
+    netd_deliver_rx();
   }
 
   /* data transmission finished */
@@ -397,12 +684,16 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
 
     if ( xferred_bytes && (0 == (xferred_bytes % CFG_TUD_NET_ENDPOINT_SIZE)) )
     {
-      do_in_xfer(NULL, 0); /* a ZLP is needed */
+      usbd_edpt_xfer(rhport, _netd_itf.ep_in, NULL, 0); /* a ZLP is needed */
     }
     else
     {
       /* we're finally finished */
-      can_xmit = true;
+      netd_tx_done(&_netd_buf.tx[_netd_buf.tx_send]);
+      _netd_buf.tx_send = (uint8_t) ((_netd_buf.tx_send + 1) % CFG_TUD_NET_TX_FRAMES);
+      _netd_buf.tx_busy = false;
+
+      netd_start_tx();
     }
   }
 
@@ -416,35 +707,80 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
 
 bool tud_network_can_xmit(uint16_t size)
 {
-  (void)size;
+  _netd_buf.tx_reserve = size;
+
+  netd_tx_buf_t const *tx = &_netd_buf.tx[_netd_buf.tx_fill];
+
+  if (netd_tx_fits(tx, size)) return true;
+
+  // current buffer is full, next one must be free
+  if (tx->state == NETD_BUF_FILLING)
+  {
+    return _netd_buf.tx[(_netd_buf.tx_fill + 1) % CFG_TUD_NET_TX_FRAMES].state == NETD_BUF_FREE;
+  }
 
-  return can_xmit;
+  return false;
 }
 
 void tud_network_xmit(void *ref, uint16_t arg)
 {
-  uint8_t *data;
-  uint16_t len;
+  // size is not known before copying, use the one checked by tud_network_can_xmit()
+  netd_tx_buf_t *tx = netd_tx_buf(_netd_buf.tx_reserve);
+  if (!tx) return; // no room: frame is dropped, ref is left to the caller
 
-  if (!can_xmit)
-    return;
+  uint8_t *data = netd_tx_frame_ptr(tx);
+  uint16_t const size = tud_network_xmit_cb(data, ref, arg);
 
-  len = (_netd_itf.ecm_mode) ? 0 : CFG_TUD_NET_PACKET_PREFIX_LEN;
-  data = transmitted + len;
+  netd_tx_frame_added(tx, size);
+}
 
-  len += tud_network_xmit_cb(data, ref, arg);
+bool tud_network_xmit_bufs(tud_network_buf_t const *bufs, uint8_t count, void *ref)
+{
+  uint16_t total = 0;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    total = (uint16_t) (total + bufs[i].len);
+  }
 
-  if (!_netd_itf.ecm_mode)
+#if CFG_TUD_NET_XMIT_ZERO_COPY
+  // single segment ECM frame is sent without copying
+  if (_netd_itf.ecm_mode && count == 1)
   {
-    rndis_data_packet_t *hdr = (rndis_data_packet_t *) ((void*) transmitted);
-    memset(hdr, 0, sizeof(rndis_data_packet_t));
-    hdr->MessageType = REMOTE_NDIS_PACKET_MSG;
-    hdr->MessageLength = len;
-    hdr->DataOffset = sizeof(rndis_data_packet_t) - offsetof(rndis_data_packet_t, DataOffset);
-    hdr->DataLength = len - sizeof(rndis_data_packet_t);
+    netd_tx_buf_t *tx = &_netd_buf.tx[_netd_buf.tx_fill];
+    if (tx->state != NETD_BUF_FREE)
+    {
+      if (tud_network_xmit_done_cb) tud_network_xmit_done_cb(ref);
+      return false;
+    }
+
+    tx->ext     = bufs[0].data;
+    tx->ext_ref = ref;
+    tx->state   = NETD_BUF_FILLING;
+    netd_tx_frame_added(tx, bufs[0].len);
+    return true;
+  }
+#endif
+
+  netd_tx_buf_t *tx = netd_tx_buf(total);
+  if (!tx)
+  {
+    // no room: tud_network_can_xmit() was not called with total length
+    if (tud_network_xmit_done_cb) tud_network_xmit_done_cb(ref);
+    return false;
   }
 
-  do_in_xfer(transmitted, len);
+  // gather segments into transfer buffer
+  uint8_t *data = netd_tx_frame_ptr(tx);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    memcpy(data, bufs[i].data, bufs[i].len);
+    data += bufs[i].len;
+  }
+
+  if (tud_network_xmit_done_cb) tud_network_xmit_done_cb(ref);
+
+  netd_tx_frame_added(tx, total);
+  return true;
 }
 
 #endif
@@ -45,57 +45,35 @@
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
 
-#define NTH16_SIGNATURE      0x484D434E
-#define NDP16_SIGNATURE_NCM0 0x304D434E
-#define NDP16_SIGNATURE_NCM1 0x314D434E
+// Largest transfer queued to the DCD at once (16-bit length). NTBs larger than this (NTB32 only)
+// are sent and received with multiple transfers. Must be multiple of bulk max packet size.
+#define NCM_XFER_SIZE_MAX    (UINT16_MAX & ~(TUSB_EPSIZE_BULK_HS - 1u))
 
-typedef struct TU_ATTR_PACKED
-{
-  uint16_t wLength;
-  uint16_t bmNtbFormatsSupported;
-  uint32_t dwNtbInMaxSize;
-  uint16_t wNdbInDivisor;
-  uint16_t wNdbInPayloadRemainder;
-  uint16_t wNdbInAlignment;
-  uint16_t wReserved;
-  uint32_t dwNtbOutMaxSize;
-  uint16_t wNdbOutDivisor;
-  uint16_t wNdbOutPayloadRemainder;
-  uint16_t wNdbOutAlignment;
-  uint16_t wNtbOutMaxDatagrams;
-} ntb_parameters_t;
-
-typedef struct TU_ATTR_PACKED
-{
-  uint32_t dwSignature;
-  uint16_t wHeaderLength;
-  uint16_t wSequence;
-  uint16_t wBlockLength;
-  uint16_t wNdpIndex;
-} nth16_t;
-
-typedef struct TU_ATTR_PACKED
-{
-  uint16_t wDatagramIndex;
-  uint16_t wDatagramLength;
-} ndp16_datagram_t;
-
-typedef struct TU_ATTR_PACKED
-{
-  uint32_t dwSignature;
-  uint16_t wLength;
-  uint16_t wNextNdpIndex;
-  ndp16_datagram_t datagram[];
-} ndp16_t;
+// NTB32 is needed for NTBs larger than 64 KB
+TU_VERIFY_STATIC(CFG_TUD_NCM_NTB32 || (CFG_TUD_NCM_IN_NTB_MAX_SIZE <= UINT16_MAX && CFG_TUD_NCM_OUT_NTB_MAX_SIZE <= UINT16_MAX),
+                 "NTB larger than 64KB requires CFG_TUD_NCM_NTB32");
 
 typedef union TU_ATTR_PACKED {
   struct {
     nth16_t nth;
     ndp16_t ndp;
   };
+  struct {
+    nth32_t nth32;
+    ndp32_t ndp32;
+  };
   uint8_t data[CFG_TUD_NCM_IN_NTB_MAX_SIZE];
 } transmit_ntb_t;
 
+// State of receive NTB buffers
+enum {
+  RECV_NTB_FREE = 0,
+  RECV_NTB_RECEIVING,  // armed on OUT endpoint
+  RECV_NTB_READY,      // received, waiting for its datagrams to be delivered
+  RECV_NTB_DELIVERING, // datagrams are being delivered to application
+  RECV_NTB_HELD,       // all datagrams delivered, but some are still held by application
+};
+
 struct ecm_notify_struct
 {
   tusb_control_request_t header;
@@ -110,9 +88,25 @@ typedef struct
   uint8_t ep_notif;
   uint8_t ep_in;
   uint8_t ep_out;
+  uint16_t ep_in_size;
+
+  uint8_t ntb_format;   // NTB_FORMAT_16 or NTB_FORMAT_32 selected by host with SET_NTB_FORMAT
+
+  // Receive NTBs are armed and delivered in ring order
+  struct {
+    uint32_t len;   // received length
+    uint8_t  state;
+    uint8_t  hold;  // number of datagrams held by application
+  } rx_ntb[CFG_TUD_NCM_OUT_NTB_N];
+
+  uint8_t rx_cur;   // index of receive NTB whose datagrams are delivered
+  uint8_t rx_arm;   // index of next receive NTB to arm
+  bool    rx_armed; // OUT endpoint is armed
+  bool    rx_busy;  // a datagram is passed to application, waiting for tud_network_recv_renew()
 
-  const ndp16_t *ndp;
-  uint8_t num_datagrams, current_datagram_index;
+  const void *ndp;      // NDP16 or NDP32 of the NTB being delivered
+  bool ndp32;
+  uint16_t num_datagrams, current_datagram_index;
 
   enum {
     REPORT_SPEED,
@@ -123,14 +117,28 @@ typedef struct
 
   uint8_t  current_ntb;           // Index in transmit_ntb[] that is currently being filled with datagrams
   uint8_t  datagram_count;        // Number of datagrams in transmit_ntb[current_ntb]
-  uint16_t next_datagram_offset;  // Offset in transmit_ntb[current_ntb].data to place the next datagram
-  uint16_t ntb_in_size;           // Maximum size of transmitted (IN to host) NTBs; initially CFG_TUD_NCM_IN_NTB_MAX_SIZE
-  uint8_t  max_datagrams_per_ntb; // Maximum number of datagrams per NTB; initially CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB
+  uint32_t next_datagram_offset;  // Offset in transmit_ntb[current_ntb].data to place the next datagram
+  uint32_t ntb_in_size;           // Maximum size of transmitted (IN to host) NTBs; initially CFG_TUD_NCM_IN_NTB_MAX_SIZE, set by SET_NTB_INPUT_SIZE
+  uint8_t  max_datagrams_per_ntb; // Maximum number of datagrams per NTB; initially CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB, set by SET_NTB_INPUT_SIZE
 
   uint16_t nth_sequence;          // Sequence number counter for transmitted NTBs
 
+  volatile uint16_t tx_hold;      // SOF ticks left before the NTB being filled must be sent, decremented in ISR
+  volatile bool tx_hold_expired;  // hold time of the NTB being filled has expired, set in ISR
+  tud_network_ncm_tx_stats_t tx_stats;
+
+  uint8_t  tx_ntb;                // Index in transmit_ntb[] that is being transferred
+  uint32_t tx_len;                // Length of NTB being transferred
+  uint32_t tx_sent;               // Bytes of NTB already transferred
+
   bool transferring;
 
+  // buffer for class control requests with data stage
+  CFG_TUSB_MEM_ALIGN union {
+    ntb_input_size_t ntb_input_size;
+    uint16_t ntb_format;
+  } ctrl_buf;
+
 } ncm_interface_t;
 
 //--------------------------------------------------------------------+
@@ -139,7 +147,7 @@ typedef struct
 
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static const ntb_parameters_t ntb_parameters = {
     .wLength                 = sizeof(ntb_parameters_t),
-    .bmNtbFormatsSupported   = 0x01,
+    .bmNtbFormatsSupported   = CFG_TUD_NCM_NTB32 ? 0x03 : 0x01,
     .dwNtbInMaxSize          = CFG_TUD_NCM_IN_NTB_MAX_SIZE,
     .wNdbInDivisor           = 4,
     .wNdbInPayloadRemainder  = 0,
@@ -154,7 +162,7 @@ CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static const ntb_parameters_t ntb_para
 
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static transmit_ntb_t transmit_ntb[2];
 
-CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static uint8_t receive_ntb[CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static uint8_t receive_ntb[CFG_TUD_NCM_OUT_NTB_N][CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
 
 tu_static ncm_interface_t ncm_interface;
 
@@ -163,9 +171,58 @@ tu_static ncm_interface_t ncm_interface;
  */
 static void ncm_prepare_for_tx(void) {
   ncm_interface.datagram_count = 0;
+  ncm_interface.tx_hold = 0;
+  ncm_interface.tx_hold_expired = false;
   // datagrams start after all the headers
-  ncm_interface.next_datagram_offset = sizeof(nth16_t) + sizeof(ndp16_t)
-      + ((CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp16_datagram_t));
+  if (ncm_interface.ntb_format == NTB_FORMAT_32) {
+    ncm_interface.next_datagram_offset = sizeof(nth32_t) + sizeof(ndp32_t)
+        + ((CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp32_datagram_t));
+  } else {
+    ncm_interface.next_datagram_offset = sizeof(nth16_t) + sizeof(ndp16_t)
+        + ((CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp16_datagram_t));
+  }
+}
+
+/*
+ * Restore the NTB format and input size to their defaults, as required on reset and when
+ * alternate setting 0 of the data interface is selected (NCM 7.2).
+ */
+static void ncm_reset_ntb_params(void) {
+  ncm_interface.ntb_format = NTB_FORMAT_16;
+  ncm_interface.ntb_in_size = tu_min32(CFG_TUD_NCM_IN_NTB_MAX_SIZE, UINT16_MAX);
+  ncm_interface.max_datagrams_per_ntb = CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB;
+  ncm_prepare_for_tx();
+}
+
+/*
+ * Check if the NTB being filled can not take another full size datagram.
+ */
+static bool ncm_tx_full(void) {
+  return ncm_interface.datagram_count >= ncm_interface.max_datagrams_per_ntb ||
+         ncm_interface.next_datagram_offset + CFG_TUD_NET_MTU > ncm_interface.ntb_in_size;
+}
+
+/*
+ * Check if the NTB being filled should be sent: it is full or its hold time has expired.
+ */
+static bool ncm_tx_ready(void) {
+  if (ncm_interface.datagram_count == 0) {
+    return false;
+  }
+
+#if CFG_TUD_NCM_TX_AGGREGATION_US
+  return ncm_interface.tx_hold == 0 || ncm_tx_full();
+#else
+  return true;
+#endif
+}
+
+/*
+ * Queue the next part of the NTB being transmitted.
+ */
+static bool ncm_xfer_tx(void) {
+  uint16_t const len = (uint16_t) tu_min32(ncm_interface.tx_len - ncm_interface.tx_sent, NCM_XFER_SIZE_MAX);
+  return usbd_edpt_xfer(0, ncm_interface.ep_in, transmit_ntb[ncm_interface.tx_ntb].data + ncm_interface.tx_sent, len);
 }
 
 /*
@@ -178,24 +235,64 @@ static void ncm_start_tx(void) {
   }
 
   transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
-  size_t ntb_length = ncm_interface.next_datagram_offset;
-
-  // Fill in NTB header
-  ntb->nth.dwSignature = NTH16_SIGNATURE;
-  ntb->nth.wHeaderLength = sizeof(nth16_t);
-  ntb->nth.wSequence = ncm_interface.nth_sequence++;
-  ntb->nth.wBlockLength = ntb_length;
-  ntb->nth.wNdpIndex = sizeof(nth16_t);
-
-  // Fill in NDP16 header and terminator
-  ntb->ndp.dwSignature = NDP16_SIGNATURE_NCM0;
-  ntb->ndp.wLength = sizeof(ndp16_t) + (ncm_interface.datagram_count + 1) * sizeof(ndp16_datagram_t);
-  ntb->ndp.wNextNdpIndex = 0;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = 0;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = 0;
+  uint32_t ntb_length = ncm_interface.next_datagram_offset;
+
+  // Avoid the need for a ZLP: pad the NTB with one byte if it ends on a packet boundary
+  // but is shorter than the host's receive buffer
+  if (ncm_interface.ep_in_size && (ntb_length % ncm_interface.ep_in_size) == 0 && ntb_length < ncm_interface.ntb_in_size) {
+    ntb_length++;
+  }
+
+  if (ncm_interface.ntb_format == NTB_FORMAT_32) {
+    // Fill in NTB header
+    ntb->nth32.dwSignature = NTH32_SIGNATURE;
+    ntb->nth32.wHeaderLength = sizeof(nth32_t);
+    ntb->nth32.wSequence = ncm_interface.nth_sequence++;
+    ntb->nth32.dwBlockLength = ntb_length;
+    ntb->nth32.dwNdpIndex = sizeof(nth32_t);
+
+    // Fill in NDP32 header and terminator
+    ntb->ndp32.dwSignature = NDP32_SIGNATURE_NCM0;
+    ntb->ndp32.wLength = (uint16_t) (sizeof(ndp32_t) + (ncm_interface.datagram_count + 1) * sizeof(ndp32_datagram_t));
+    ntb->ndp32.wReserved6 = 0;
+    ntb->ndp32.dwNextNdpIndex = 0;
+    ntb->ndp32.dwReserved12 = 0;
+    ntb->ndp32.datagram[ncm_interface.datagram_count].dwDatagramIndex = 0;
+    ntb->ndp32.datagram[ncm_interface.datagram_count].dwDatagramLength = 0;
+  } else {
+    // Fill in NTB header
+    ntb->nth.dwSignature = NTH16_SIGNATURE;
+    ntb->nth.wHeaderLength = sizeof(nth16_t);
+    ntb->nth.wSequence = ncm_interface.nth_sequence++;
+    ntb->nth.wBlockLength = (uint16_t) ntb_length;
+    ntb->nth.wNdpIndex = sizeof(nth16_t);
+
+    // Fill in NDP16 header and terminator
+    ntb->ndp.dwSignature = NDP16_SIGNATURE_NCM0;
+    ntb->ndp.wLength = (uint16_t) (sizeof(ndp16_t) + (ncm_interface.datagram_count + 1) * sizeof(ndp16_datagram_t));
+    ntb->ndp.wNextNdpIndex = 0;
+    ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = 0;
+    ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = 0;
+  }
+
+  // Update statistics
+  tud_network_ncm_tx_stats_t *stats = &ncm_interface.tx_stats;
+  stats->ntb_count++;
+  stats->datagram_count += ncm_interface.datagram_count;
+  stats->datagrams_per_ntb[ncm_interface.datagram_count - 1]++;
+  if (ncm_tx_full()) {
+    stats->sent_full++;
+  } else if (ncm_interface.tx_hold_expired) {
+    stats->sent_timeout++;
+  } else {
+    stats->sent_idle++;
+  }
 
   // Kick off an endpoint transfer
-  usbd_edpt_xfer(0, ncm_interface.ep_in, ntb->data, ntb_length);
+  ncm_interface.tx_ntb = ncm_interface.current_ntb;
+  ncm_interface.tx_len = ntb_length;
+  ncm_interface.tx_sent = 0;
+  ncm_xfer_tx();
   ncm_interface.transferring = true;
 
   // Swap to the other NTB and clear it out
@@ -232,32 +329,217 @@ tu_static struct ecm_notify_struct ncm_notify_speed_change =
     .uplink = 10000000,
 };
 
-void tud_network_recv_renew(void)
+/*
+ * Arm the OUT endpoint with the next receive NTB if it is free, so that the host can send
+ * the next NTB while datagrams of previous ones are being consumed.
+ */
+static void ncm_start_rx(void) {
+  uint8_t const idx = ncm_interface.rx_arm;
+
+  if (ncm_interface.rx_armed || !ncm_interface.itf_data_alt || ncm_interface.rx_ntb[idx].state != RECV_NTB_FREE) {
+    return;
+  }
+
+  ncm_interface.rx_ntb[idx].state = RECV_NTB_RECEIVING;
+  ncm_interface.rx_ntb[idx].len = 0;
+  ncm_interface.rx_armed = true;
+
+  if (!usbd_edpt_xfer(0, ncm_interface.ep_out, receive_ntb[idx], (uint16_t) tu_min32(CFG_TUD_NCM_OUT_NTB_MAX_SIZE, NCM_XFER_SIZE_MAX))) {
+    ncm_interface.rx_ntb[idx].state = RECV_NTB_FREE;
+    ncm_interface.rx_armed = false;
+  }
+}
+
+/*
+ * Validate a received NTB (NTB16 or NTB32) and set up its datagrams for delivery. An invalid NTB has no datagrams.
+ */
+static void ncm_parse_rx(uint8_t idx)
 {
-  if (!ncm_interface.num_datagrams)
-  {
-    usbd_edpt_xfer(0, ncm_interface.ep_out, receive_ntb, sizeof(receive_ntb));
+  uint8_t const *ntb = receive_ntb[idx];
+  uint32_t const len = ncm_interface.rx_ntb[idx].len;
+
+  ncm_interface.rx_ntb[idx].state = RECV_NTB_DELIVERING;
+  ncm_interface.current_datagram_index = 0;
+  ncm_interface.num_datagrams = 0;
+
+  if (len == 0) {
     return;
   }
 
-  const ndp16_t *ndp = ncm_interface.ndp;
-  const int i = ncm_interface.current_datagram_index;
-  ncm_interface.current_datagram_index++;
-  ncm_interface.num_datagrams--;
+  TU_ASSERT(len >= sizeof(uint32_t), );
+  uint32_t const signature = tu_unaligned_read32(ntb);
+
+  if (signature == NTH16_SIGNATURE) {
+    TU_ASSERT(len >= sizeof(nth16_t), );
+    const nth16_t *hdr = (const nth16_t *)ntb;
+    TU_ASSERT(hdr->wNdpIndex >= sizeof(nth16_t) && (hdr->wNdpIndex + sizeof(ndp16_t)) <= len, );
+
+    const ndp16_t *ndp = (const ndp16_t *)(ntb + hdr->wNdpIndex);
+    TU_ASSERT(ndp->dwSignature == NDP16_SIGNATURE_NCM0 || ndp->dwSignature == NDP16_SIGNATURE_NCM1, );
+    TU_ASSERT(ndp->wLength >= sizeof(ndp16_t) && hdr->wNdpIndex + ndp->wLength <= len, );
+
+    uint32_t const num_datagrams = (uint32_t) ((ndp->wLength - sizeof(ndp16_t)) / sizeof(ndp16_datagram_t));
+    ncm_interface.ndp = ndp;
+    ncm_interface.ndp32 = false;
+    for (uint32_t i = 0; i < num_datagrams && ndp->datagram[i].wDatagramIndex && ndp->datagram[i].wDatagramLength &&
+                    (uint32_t) ndp->datagram[i].wDatagramIndex + ndp->datagram[i].wDatagramLength <= len; i++)
+    {
+      ncm_interface.num_datagrams++;
+    }
+  }
+#if CFG_TUD_NCM_NTB32
+  else if (signature == NTH32_SIGNATURE) {
+    TU_ASSERT(len >= sizeof(nth32_t), );
+    const nth32_t *hdr = (const nth32_t *)ntb;
+    TU_ASSERT(hdr->dwNdpIndex >= sizeof(nth32_t) && hdr->dwNdpIndex < len && (len - hdr->dwNdpIndex) >= sizeof(ndp32_t), );
+
+    const ndp32_t *ndp = (const ndp32_t *)(ntb + hdr->dwNdpIndex);
+    TU_ASSERT(ndp->dwSignature == NDP32_SIGNATURE_NCM0 || ndp->dwSignature == NDP32_SIGNATURE_NCM1, );
+    TU_ASSERT(ndp->wLength >= sizeof(ndp32_t) && hdr->dwNdpIndex + ndp->wLength <= len, );
+
+    uint32_t const num_datagrams = (uint32_t) ((ndp->wLength - sizeof(ndp32_t)) / sizeof(ndp32_datagram_t));
+    ncm_interface.ndp = ndp;
+    ncm_interface.ndp32 = true;
+    for (uint32_t i = 0; i < num_datagrams && ndp->datagram[i].dwDatagramIndex && ndp->datagram[i].dwDatagramLength &&
+                    ndp->datagram[i].dwDatagramIndex < len && ndp->datagram[i].dwDatagramLength <= len - ndp->datagram[i].dwDatagramIndex &&
+                    ndp->datagram[i].dwDatagramLength <= UINT16_MAX; i++)
+    {
+      ncm_interface.num_datagrams++;
+    }
+  }
+#endif
+  else {
+    TU_BREAKPOINT();
+  }
+}
+
+/*
+ * Pass the next received datagram to the application. When all datagrams of the current NTB are delivered,
+ * the NTB is released (unless some datagrams are held) and delivery continues with the next received NTB.
+ */
+static void ncm_deliver_rx(void)
+{
+  while (!ncm_interface.rx_busy) {
+    uint8_t const idx = ncm_interface.rx_cur;
+
+    switch (ncm_interface.rx_ntb[idx].state) {
+      case RECV_NTB_READY:
+        ncm_parse_rx(idx);
+        break;
+
+      case RECV_NTB_DELIVERING:
+        if (ncm_interface.num_datagrams) {
+          const int i = ncm_interface.current_datagram_index;
+          ncm_interface.current_datagram_index++;
+          ncm_interface.num_datagrams--;
+
+          uint32_t index, length;
+          if (ncm_interface.ndp32) {
+            const ndp32_t *ndp = (const ndp32_t *) ncm_interface.ndp;
+            index  = ndp->datagram[i].dwDatagramIndex;
+            length = ndp->datagram[i].dwDatagramLength;
+          } else {
+            const ndp16_t *ndp = (const ndp16_t *) ncm_interface.ndp;
+            index  = ndp->datagram[i].wDatagramIndex;
+            length = ndp->datagram[i].wDatagramLength;
+          }
+
+          ncm_interface.rx_busy = true;
+          if (!tud_network_recv_cb(receive_ntb[idx] + index, (uint16_t) length)) {
+            // datagram was not taken by application: drop it and continue with the next one
+            ncm_interface.rx_busy = false;
+          }
+        } else {
+          // done with this NTB, it can be re-used once application releases all held datagrams
+          ncm_interface.rx_ntb[idx].state = ncm_interface.rx_ntb[idx].hold ? RECV_NTB_HELD : RECV_NTB_FREE;
+          ncm_interface.rx_cur = (uint8_t) ((idx + 1) % CFG_TUD_NCM_OUT_NTB_N);
+          ncm_start_rx();
+        }
+        break;
+
+      default:
+        // nothing received yet
+        return;
+    }
+  }
+}
+
+// find receive NTB containing a datagram
+static int ncm_find_rx_ntb(const uint8_t *datagram)
+{
+  for (uint8_t i = 0; i < CFG_TUD_NCM_OUT_NTB_N; i++) {
+    if (datagram >= receive_ntb[i] && datagram < receive_ntb[i] + CFG_TUD_NCM_OUT_NTB_MAX_SIZE) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void tud_network_recv_renew(void)
+{
+  ncm_interface.rx_busy = false;
+  ncm_start_rx();
+  ncm_deliver_rx();
+}
+
+bool tud_network_recv_hold(const uint8_t *datagram)
+{
+  int const idx = ncm_find_rx_ntb(datagram);
+  TU_VERIFY(idx >= 0 && ncm_interface.rx_ntb[idx].state == RECV_NTB_DELIVERING);
+
+  ncm_interface.rx_ntb[idx].hold++;
+  return true;
+}
+
+void tud_network_recv_release(const uint8_t *datagram)
+{
+  int const idx = ncm_find_rx_ntb(datagram);
+  TU_VERIFY(idx >= 0 && ncm_interface.rx_ntb[idx].hold, );
 
-  tud_network_recv_cb(receive_ntb + ndp->datagram[i].wDatagramIndex, ndp->datagram[i].wDatagramLength);
+  ncm_interface.rx_ntb[idx].hold--;
+  if (ncm_interface.rx_ntb[idx].hold == 0 && ncm_interface.rx_ntb[idx].state == RECV_NTB_HELD) {
+    ncm_interface.rx_ntb[idx].state = RECV_NTB_FREE;
+    ncm_start_rx();
+  }
 }
 
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
 
+#if CFG_TUD_NCM_TX_AGGREGATION_US
+
+// Deferred from SOF ISR when the hold time of the NTB being filled has expired
+static void ncm_tx_hold_expired(void *param)
+{
+  (void) param;
+
+  // NTB may have been sent (full) in the meantime, a new NTB has its own hold time
+  if (ncm_interface.itf_data_alt == 1 && ncm_tx_ready()) {
+    ncm_start_tx();
+  }
+}
+
+void netd_sof_isr(uint8_t rhport, uint32_t frame_count)
+{
+  (void) rhport;
+  (void) frame_count;
+
+  if (ncm_interface.tx_hold) {
+    ncm_interface.tx_hold--;
+    if (ncm_interface.tx_hold == 0) {
+      ncm_interface.tx_hold_expired = true;
+      usbd_defer_func(ncm_tx_hold_expired, NULL, true);
+    }
+  }
+}
+
+#endif
+
 void netd_init(void)
 {
   tu_memclr(&ncm_interface, sizeof(ncm_interface));
-  ncm_interface.ntb_in_size = CFG_TUD_NCM_IN_NTB_MAX_SIZE;
-  ncm_interface.max_datagrams_per_ntb = CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB;
-  ncm_prepare_for_tx();
+  ncm_reset_ntb_params();
 }
 
 void netd_reset(uint8_t rhport)
@@ -316,6 +598,14 @@ uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
 
   TU_ASSERT(usbd_open_edpt_pair(rhport, p_desc, 2, TUSB_XFER_BULK, &ncm_interface.ep_out, &ncm_interface.ep_in) );
 
+  for (uint8_t i = 0; i < 2; i++) {
+    tusb_desc_endpoint_t const * desc_ep = (tusb_desc_endpoint_t const *) p_desc;
+    if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
+      ncm_interface.ep_in_size = tu_edpt_packet_size(desc_ep);
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
   drv_len += 2*sizeof(tusb_desc_endpoint_t);
 
   return drv_len;
@@ -346,6 +636,30 @@ TU_ATTR_WEAK void tud_network_link_state_cb(bool state)
 // return false to stall control endpoint (e.g unsupported request)
 bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
 {
+  // class requests with data stage are applied when data is received
+  if ( stage == CONTROL_STAGE_DATA && request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS &&
+       request->bRequest == NCM_SET_NTB_INPUT_SIZE )
+  {
+    ntb_input_size_t const * input_size = &ncm_interface.ctrl_buf.ntb_input_size;
+
+    // host may only shrink the NTB below what is advertised in GET_NTB_PARAMETERS
+    uint32_t const max_size = (ncm_interface.ntb_format == NTB_FORMAT_16) ? tu_min32(CFG_TUD_NCM_IN_NTB_MAX_SIZE, UINT16_MAX)
+                                                                          : CFG_TUD_NCM_IN_NTB_MAX_SIZE;
+    TU_VERIFY(input_size->dwNtbInMaxSize >= 2048 && input_size->dwNtbInMaxSize <= max_size);
+
+    ncm_interface.ntb_in_size = input_size->dwNtbInMaxSize;
+
+    // optional wNtbInMaxDatagrams, 0 means no limit
+    ncm_interface.max_datagrams_per_ntb = CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB;
+    if ( request->wLength == sizeof(ntb_input_size_t) && input_size->wNtbInMaxDatagrams )
+    {
+      ncm_interface.max_datagrams_per_ntb = (uint8_t) tu_min16(input_size->wNtbInMaxDatagrams, CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB);
+    }
+
+    TU_LOG_DRV("NCM NTB input size = %lu, max datagrams = %u\r\n", ncm_interface.ntb_in_size, ncm_interface.max_datagrams_per_ntb);
+    return true;
+  }
+
   if ( stage != CONTROL_STAGE_SETUP ) return true;
 
   switch ( request->bmRequestType_bit.type )
@@ -373,13 +687,18 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
           if (req_alt != ncm_interface.itf_data_alt) {
             ncm_interface.itf_data_alt = req_alt;
 
+#if CFG_TUD_NCM_TX_AGGREGATION_US
+            // SOF is used to time out aggregated NTBs
+            usbd_sof_enable(rhport, SOF_CONSUMER_NCM, req_alt != 0);
+#endif
+
             if (ncm_interface.itf_data_alt) {
-              if (!usbd_edpt_busy(rhport, ncm_interface.ep_out)) {
-                tud_network_recv_renew(); // prepare for incoming datagrams
-              }
+              ncm_start_rx(); // prepare for incoming datagrams
               if (!ncm_interface.report_pending) {
                 ncm_report();
               }
+            } else {
+              ncm_reset_ntb_params();
             }
 
             tud_network_link_state_cb(ncm_interface.itf_data_alt);
@@ -397,48 +716,60 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
     case TUSB_REQ_TYPE_CLASS:
       TU_VERIFY (ncm_interface.itf_num == request->wIndex);
 
-      if (NCM_GET_NTB_PARAMETERS == request->bRequest)
+      switch ( request->bRequest )
       {
-        tud_control_xfer(rhport, request, (void*)(uintptr_t) &ntb_parameters, sizeof(ntb_parameters));
-      }
+        case NCM_GET_NTB_PARAMETERS:
+          tud_control_xfer(rhport, request, (void*)(uintptr_t) &ntb_parameters, sizeof(ntb_parameters));
+          break;
 
-      break;
+        case NCM_GET_NTB_FORMAT:
+          ncm_interface.ctrl_buf.ntb_format = ncm_interface.ntb_format;
+          tud_control_xfer(rhport, request, &ncm_interface.ctrl_buf.ntb_format, sizeof(uint16_t));
+          break;
 
-      // unsupported request
-    default: return false;
-  }
+        case NCM_SET_NTB_FORMAT:
+          // format can only be changed while data interface is inactive
+          TU_VERIFY(ncm_interface.itf_data_alt == 0);
+          TU_VERIFY(request->wValue == NTB_FORMAT_16 || (CFG_TUD_NCM_NTB32 && request->wValue == NTB_FORMAT_32));
 
-  return true;
-}
+          ncm_interface.ntb_format = (uint8_t) request->wValue;
+          if ( ncm_interface.ntb_format == NTB_FORMAT_16 )
+          {
+            ncm_interface.ntb_in_size = tu_min32(ncm_interface.ntb_in_size, UINT16_MAX);
+          }
+          ncm_prepare_for_tx();
 
-static void handle_incoming_datagram(uint32_t len)
-{
-  uint32_t size = len;
+          tud_control_status(rhport, request);
+          break;
 
-  if (len == 0) {
-    return;
-  }
+        case NCM_GET_NTB_INPUT_SIZE:
+          ncm_interface.ctrl_buf.ntb_input_size.dwNtbInMaxSize = ncm_interface.ntb_in_size;
+          ncm_interface.ctrl_buf.ntb_input_size.wNtbInMaxDatagrams = ncm_interface.max_datagrams_per_ntb;
+          ncm_interface.ctrl_buf.ntb_input_size.wReserved = 0;
+          tud_control_xfer(rhport, request, &ncm_interface.ctrl_buf.ntb_input_size,
+                           tu_min16(request->wLength, sizeof(ntb_input_size_t)));
+          break;
 
-  TU_ASSERT(size >= sizeof(nth16_t), );
+        case NCM_SET_NTB_INPUT_SIZE:
+          TU_VERIFY(request->wLength == sizeof(uint32_t) || request->wLength == sizeof(ntb_input_size_t));
+          tud_control_xfer(rhport, request, &ncm_interface.ctrl_buf.ntb_input_size, request->wLength);
+          break;
 
-  const nth16_t *hdr = (const nth16_t *)receive_ntb;
-  TU_ASSERT(hdr->dwSignature == NTH16_SIGNATURE, );
-  TU_ASSERT(hdr->wNdpIndex >= sizeof(nth16_t) && (hdr->wNdpIndex + sizeof(ndp16_t)) <= len, );
+        case NCM_SET_ETHERNET_PACKET_FILTER:
+          // all packets are passed to application
+          tud_control_status(rhport, request);
+          break;
 
-  const ndp16_t *ndp = (const ndp16_t *)(receive_ntb + hdr->wNdpIndex);
-  TU_ASSERT(ndp->dwSignature == NDP16_SIGNATURE_NCM0 || ndp->dwSignature == NDP16_SIGNATURE_NCM1, );
-  TU_ASSERT(hdr->wNdpIndex + ndp->wLength <= len, );
+          // unsupported request
+        default: return false;
+      }
+      break;
 
-  int num_datagrams = (ndp->wLength - 12) / 4;
-  ncm_interface.current_datagram_index = 0;
-  ncm_interface.num_datagrams = 0;
-  ncm_interface.ndp = ndp;
-  for (int i = 0; i < num_datagrams && ndp->datagram[i].wDatagramIndex && ndp->datagram[i].wDatagramLength; i++)
-  {
-    ncm_interface.num_datagrams++;
+      // unsupported request
+    default: return false;
   }
 
-  tud_network_recv_renew();
+  return true;
 }
 
 bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
@@ -446,21 +777,45 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   (void) rhport;
   (void) result;
 
-  /* new datagram receive_ntb */
+  /* new NTB received: re-arm with the next receive NTB right away, then deliver datagrams */
   if (ep_addr == ncm_interface.ep_out )
   {
-    handle_incoming_datagram(xferred_bytes);
+    uint8_t const idx = ncm_interface.rx_arm;
+    uint32_t const requested = tu_min32(CFG_TUD_NCM_OUT_NTB_MAX_SIZE - ncm_interface.rx_ntb[idx].len, NCM_XFER_SIZE_MAX);
+    ncm_interface.rx_ntb[idx].len += xferred_bytes;
+
+    // NTB larger than a single transfer: continue until short packet or buffer is full
+    if (xferred_bytes == requested && ncm_interface.rx_ntb[idx].len < CFG_TUD_NCM_OUT_NTB_MAX_SIZE)
+    {
+      uint32_t const len = ncm_interface.rx_ntb[idx].len;
+      uint16_t const next = (uint16_t) tu_min32(CFG_TUD_NCM_OUT_NTB_MAX_SIZE - len, NCM_XFER_SIZE_MAX);
+      if (usbd_edpt_xfer(rhport, ncm_interface.ep_out, receive_ntb[idx] + len, next)) return true;
+    }
+
+    ncm_interface.rx_ntb[idx].state = RECV_NTB_READY;
+    ncm_interface.rx_arm = (uint8_t) ((idx + 1) % CFG_TUD_NCM_OUT_NTB_N);
+    ncm_interface.rx_armed = false;
+
+    ncm_start_rx();
+    ncm_deliver_rx();
   }
 
   /* data transmission finished */
   if (ep_addr == ncm_interface.ep_in )
   {
+    // continue with the rest of a large NTB
+    ncm_interface.tx_sent += xferred_bytes;
+    if (ncm_interface.transferring && ncm_interface.tx_sent < ncm_interface.tx_len && ncm_xfer_tx()) {
+      return true;
+    }
+
     if (ncm_interface.transferring) {
       ncm_interface.transferring = false;
     }
 
     // If there are datagrams queued up that we tried to send while this NTB was being emitted, send them now
-    if (ncm_interface.datagram_count && ncm_interface.itf_data_alt == 1) {
+    // unless they are still held for aggregation
+    if (ncm_tx_ready() && ncm_interface.itf_data_alt == 1) {
       ncm_start_tx();
     }
   }
@@ -484,7 +839,7 @@ bool tud_network_can_xmit(uint16_t size)
     return false;
   }
 
-  size_t next_datagram_offset = ncm_interface.next_datagram_offset;
+  uint32_t next_datagram_offset = ncm_interface.next_datagram_offset;
   if (next_datagram_offset + size > ncm_interface.ntb_in_size) {
     TU_LOG_DRV("ntb full [by size]\r\n");
     return false;
@@ -493,15 +848,21 @@ bool tud_network_can_xmit(uint16_t size)
   return true;
 }
 
-void tud_network_xmit(void *ref, uint16_t arg)
+/*
+ * Add a datagram of given size, already placed at next_datagram_offset of the current NTB.
+ */
+static void ncm_add_datagram(uint16_t size)
 {
   transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
-  size_t next_datagram_offset = ncm_interface.next_datagram_offset;
-
-  uint16_t size = tud_network_xmit_cb(ntb->data + next_datagram_offset, ref, arg);
-
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = ncm_interface.next_datagram_offset;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = size;
+  uint32_t next_datagram_offset = ncm_interface.next_datagram_offset;
+
+  if (ncm_interface.ntb_format == NTB_FORMAT_32) {
+    ntb->ndp32.datagram[ncm_interface.datagram_count].dwDatagramIndex = next_datagram_offset;
+    ntb->ndp32.datagram[ncm_interface.datagram_count].dwDatagramLength = size;
+  } else {
+    ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = (uint16_t) next_datagram_offset;
+    ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = size;
+  }
 
   ncm_interface.datagram_count++;
   next_datagram_offset += size;
@@ -512,7 +873,62 @@ void tud_network_xmit(void *ref, uint16_t arg)
 
   ncm_interface.next_datagram_offset = next_datagram_offset;
 
-  ncm_start_tx();
+#if CFG_TUD_NCM_TX_AGGREGATION_US
+  // first datagram of this NTB: start hold time
+  if (ncm_interface.datagram_count == 1) {
+    uint32_t const tick_us = (tud_speed_get() == TUSB_SPEED_HIGH) ? 125 : 1000;
+    ncm_interface.tx_hold = (uint16_t) tu_min32(TU_DIV_CEIL(CFG_TUD_NCM_TX_AGGREGATION_US, tick_us), UINT16_MAX);
+  }
+#endif
+
+  if (ncm_tx_ready()) {
+    ncm_start_tx();
+  }
+}
+
+void tud_network_xmit(void *ref, uint16_t arg)
+{
+  uint8_t *dst = transmit_ntb[ncm_interface.current_ntb].data + ncm_interface.next_datagram_offset;
+  ncm_add_datagram(tud_network_xmit_cb(dst, ref, arg));
+}
+
+bool tud_network_xmit_bufs(tud_network_buf_t const *bufs, uint8_t count, void *ref)
+{
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    total += bufs[i].len;
+  }
+
+  // reject the whole frame rather than sending a truncated one
+  if (total > UINT16_MAX || !tud_network_can_xmit((uint16_t) total)) {
+    TU_LOG_DRV("drop frame: does not fit in NTB\r\n");
+    if (tud_network_xmit_done_cb) {
+      tud_network_xmit_done_cb(ref);
+    }
+    return false;
+  }
+
+  // gather segments directly into the NTB
+  uint8_t *dst = transmit_ntb[ncm_interface.current_ntb].data + ncm_interface.next_datagram_offset;
+  for (uint8_t i = 0; i < count; i++) {
+    memcpy(dst, bufs[i].data, bufs[i].len);
+    dst += bufs[i].len;
+  }
+
+  if (tud_network_xmit_done_cb) {
+    tud_network_xmit_done_cb(ref);
+  }
+
+  ncm_add_datagram((uint16_t) total);
+  return true;
+}
+
+void tud_network_ncm_tx_stats(tud_network_ncm_tx_stats_t *stats, bool reset)
+{
+  *stats = ncm_interface.tx_stats;
+  if (reset) {
+    tu_memclr(&ncm_interface.tx_stats, sizeof(ncm_interface.tx_stats));
+  }
 }
 
 #endif
@@ -0,0 +1,883 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUH_ENABLED && CFG_TUH_NCM
+
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
+
+#include "ncm_host.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUH_NCM_LOG_LEVEL
+  #define CFG_TUH_NCM_LOG_LEVEL   CFG_TUH_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_NCM_LOG_LEVEL, __VA_ARGS__)
+
+// NTB header, one NDP with its terminating entry and at least one datagram must fit in a transmit buffer
+#define NCMH_TX_OVERHEAD   (sizeof(nth16_t) + 4 + sizeof(ndp16_t) + 2*sizeof(ndp16_datagram_t))
+
+TU_VERIFY_STATIC(CFG_TUH_NCM_RX_NTB_SIZE <= UINT16_MAX && CFG_TUH_NCM_TX_NTB_SIZE <= UINT16_MAX,
+                 "only NTB16 is supported, buffer size must fit in 16-bit");
+TU_VERIFY_STATIC(CFG_TUH_NCM_RX_NTB_SIZE >= 2048, "NTB input size must be at least 2048");
+TU_VERIFY_STATIC(CFG_TUH_NCM_TX_NTB_SIZE >= CFG_TUH_NCM_MTU + NCMH_TX_OVERHEAD, "transmit buffer too small for MTU");
+TU_VERIFY_STATIC(CFG_TUH_NCM_RX_NTB_N < 128 && CFG_TUH_NCM_TX_NTB_N < 128, "too many buffers");
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+enum {
+  NCMH_BUF_FREE = 0,
+  NCMH_BUF_BUSY,      // rx: transfer in flight, tx: filling with frames
+  NCMH_BUF_READY,     // rx: datagrams being delivered, tx: queued for sending
+  NCMH_BUF_SENDING,   // tx only
+};
+
+enum {
+  CONFIG_GET_MAC_STRING = 0,
+  CONFIG_PARSE_MAC_STRING,
+  CONFIG_GET_NTB_PARAMETERS,
+  CONFIG_SET_NTB_INPUT_SIZE,
+  CONFIG_SET_PACKET_FILTER,
+  CONFIG_SET_DATA_INTERFACE,
+  CONFIG_COMPLETE,
+};
+
+// SET_ETHERNET_PACKET_FILTER: directed, broadcast and all multicast
+#define NCMH_PACKET_FILTER   0x000E
+
+// bmNetworkCapabilities of NCM functional descriptor: 8-byte GET/SET_NTB_INPUT_SIZE
+#define NCMH_CAP_NTB_INPUT_SIZE_8   TU_BIT(5)
+
+typedef struct {
+  uint16_t len;
+  uint8_t state;
+  uint8_t hold;               // number of frames held by application
+  bool delivering;            // datagrams are being passed to application, freeing is deferred until done
+} ncmh_rx_buf_t;
+
+typedef struct {
+  uint16_t len;
+  uint8_t state;
+  uint8_t count;
+  ndp16_datagram_t datagram[CFG_TUH_NCM_TX_MAX_DATAGRAMS];
+} ncmh_tx_buf_t;
+
+typedef struct {
+  uint8_t daddr;
+  uint8_t itf_num;
+  uint8_t itf_data;
+  uint8_t itf_data_alt;
+
+  uint8_t ep_notif;
+  uint8_t ep_in;
+  uint8_t ep_out;
+  uint8_t ep_notif_size;
+  uint16_t ep_out_size;
+
+  uint8_t mac_str_idx;
+  uint8_t capabilities;
+  uint8_t mac[6];
+
+  bool is_ncm;
+  bool mac_valid;
+  bool mounted;
+
+  //------------- NTB parameters -------------//
+  uint16_t rx_size;           // requested transfer size of each receive buffer
+  uint16_t tx_max_size;       // min of dwNtbOutMaxSize and buffer size
+  uint16_t tx_divisor;        // datagram offset % divisor == remainder
+  uint16_t tx_remainder;
+  uint16_t tx_ndp_align;
+  uint8_t  tx_max_datagrams;
+  uint16_t tx_sequence;
+
+  //------------- Receive ring -------------//
+  ncmh_rx_buf_t rx[CFG_TUH_NCM_RX_NTB_N];
+
+  uint8_t rx_arm;             // buffer in flight, or first candidate for the next transfer
+  bool rx_armed;
+  bool rx_halted;             // endpoint stalled or failed, receiving is stopped
+
+  //------------- Transmit ring -------------//
+  ncmh_tx_buf_t tx[CFG_TUH_NCM_TX_NTB_N];
+
+  uint8_t tx_fill;            // buffer frames are added to
+  uint8_t tx_send;            // oldest buffer not yet sent
+  bool tx_busy;
+  bool tx_zlp;                // ECM: zero length packet pending after current transfer
+  uint16_t tx_reserved;       // size passed to tuh_ncm_xmit_reserve()
+} ncmh_interface_t;
+
+// Buffers used with the host controller
+typedef struct {
+  CFG_TUH_MEM_ALIGN uint8_t rx[CFG_TUH_NCM_RX_NTB_N][CFG_TUH_NCM_RX_NTB_SIZE];
+  CFG_TUH_MEM_ALIGN uint8_t tx[CFG_TUH_NCM_TX_NTB_N][CFG_TUH_NCM_TX_NTB_SIZE];
+  CFG_TUH_MEM_ALIGN uint8_t notif[16];
+
+  CFG_TUH_MEM_ALIGN union {
+    ntb_parameters_t ntb_params;
+    ntb_input_size_t ntb_input_size;
+    uint16_t mac_str[1 + 12]; // string descriptor: header + 12 hex digits
+  } ctrl;
+} ncmh_epbuf_t;
+
+CFG_TUH_MEM_SECTION static ncmh_interface_t ncmh_data[CFG_TUH_NCM];
+CFG_TUH_MEM_SECTION static ncmh_epbuf_t ncmh_epbuf[CFG_TUH_NCM];
+
+//--------------------------------------------------------------------+
+// INTERNAL OBJECT & FUNCTION DECLARATION
+//--------------------------------------------------------------------+
+
+static inline ncmh_interface_t* get_itf(uint8_t idx) {
+  TU_VERIFY(idx < CFG_TUH_NCM, NULL);
+  ncmh_interface_t* p_ncm = &ncmh_data[idx];
+
+  return (p_ncm->daddr != 0) ? p_ncm : NULL;
+}
+
+static inline uint8_t get_idx_by_ep_addr(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUH_NCM; i++) {
+    ncmh_interface_t* p_ncm = &ncmh_data[i];
+    if ((p_ncm->daddr == daddr) &&
+        (ep_addr == p_ncm->ep_notif || ep_addr == p_ncm->ep_in || ep_addr == p_ncm->ep_out)) {
+      return i;
+    }
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+static inline uint8_t ring_next(uint8_t i, uint8_t count) {
+  return (uint8_t) ((i + 1u) % count);
+}
+
+static void ncmh_rx_start(ncmh_interface_t* p_ncm, uint8_t idx);
+static void ncmh_tx_kick(ncmh_interface_t* p_ncm, uint8_t idx);
+static bool ncmh_notif_start(ncmh_interface_t* p_ncm, uint8_t idx);
+
+//--------------------------------------------------------------------+
+// APPLICATION API
+//--------------------------------------------------------------------+
+
+uint8_t tuh_ncm_itf_get_index(uint8_t daddr) {
+  for (uint8_t i = 0; i < CFG_TUH_NCM; i++) {
+    if (ncmh_data[i].daddr == daddr) return i;
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_ncm_mounted(uint8_t idx) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  return p_ncm && p_ncm->mounted;
+}
+
+bool tuh_ncm_is_ncm(uint8_t idx) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  return p_ncm && p_ncm->is_ncm;
+}
+
+bool tuh_ncm_get_mac(uint8_t idx, uint8_t mac[6]) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mac_valid);
+
+  memcpy(mac, p_ncm->mac, 6);
+  return true;
+}
+
+//------------- Transmit -------------//
+
+// offset of next datagram in NTB honoring wNdpOutDivisor/wNdpOutPayloadRemainder
+static uint32_t ncmh_tx_datagram_offset(ncmh_interface_t const* p_ncm, uint32_t len) {
+  uint32_t offset = len - (len % p_ncm->tx_divisor) + p_ncm->tx_remainder;
+  if (offset < len) offset += p_ncm->tx_divisor;
+  return offset;
+}
+
+static uint32_t ncmh_tx_ndp_offset(ncmh_interface_t const* p_ncm, uint32_t len) {
+  return (len + p_ncm->tx_ndp_align - 1) & ~(uint32_t) (p_ncm->tx_ndp_align - 1);
+}
+
+static bool ncmh_tx_fits(ncmh_interface_t const* p_ncm, uint8_t buf_idx, uint16_t size) {
+  uint8_t const count = p_ncm->tx[buf_idx].count;
+
+  if (!p_ncm->is_ncm) {
+    return count == 0 && size <= p_ncm->tx_max_size;
+  }
+
+  TU_VERIFY(count < p_ncm->tx_max_datagrams);
+
+  // datagram, then NDP with one more entry and the terminator
+  uint32_t const end = ncmh_tx_datagram_offset(p_ncm, p_ncm->tx[buf_idx].len) + size;
+  uint32_t const ntb_len = ncmh_tx_ndp_offset(p_ncm, end) + (uint32_t) (sizeof(ndp16_t) + (count + 2u) * sizeof(ndp16_datagram_t));
+
+  return ntb_len <= p_ncm->tx_max_size;
+}
+
+// Close the buffer being filled so that it is sent next
+static void ncmh_tx_close(ncmh_interface_t* p_ncm, uint8_t idx) {
+  uint8_t const buf_idx = p_ncm->tx_fill;
+  uint8_t* buf = ncmh_epbuf[idx].tx[buf_idx];
+  ncmh_tx_buf_t* tx = &p_ncm->tx[buf_idx];
+
+  if (p_ncm->is_ncm) {
+    uint16_t const ndp_idx = (uint16_t) ncmh_tx_ndp_offset(p_ncm, tx->len);
+    uint16_t const ndp_len = (uint16_t) (sizeof(ndp16_t) + (tx->count + 1u) * sizeof(ndp16_datagram_t));
+
+    ndp16_t* ndp = (ndp16_t*) (buf + ndp_idx);
+    ndp->dwSignature   = NDP16_SIGNATURE_NCM0;
+    ndp->wLength       = ndp_len;
+    ndp->wNextNdpIndex = 0;
+    memcpy(ndp->datagram, tx->datagram, tx->count * sizeof(ndp16_datagram_t));
+    ndp->datagram[tx->count].wDatagramIndex  = 0;
+    ndp->datagram[tx->count].wDatagramLength = 0;
+
+    tx->len = (uint16_t) (ndp_idx + ndp_len);
+
+    nth16_t* nth = (nth16_t*) buf;
+    nth->dwSignature   = NTH16_SIGNATURE;
+    nth->wHeaderLength = sizeof(nth16_t);
+    nth->wSequence     = p_ncm->tx_sequence++;
+    nth->wBlockLength  = tx->len;
+    nth->wNdpIndex     = ndp_idx;
+  }
+
+  tx->state = NCMH_BUF_READY;
+  p_ncm->tx_fill = ring_next(p_ncm->tx_fill, CFG_TUH_NCM_TX_NTB_N);
+}
+
+// Get buffer that can take a frame of given size, closing the current one if it is full. Return -1 if none.
+static int ncmh_tx_buf(ncmh_interface_t* p_ncm, uint8_t idx, uint16_t size) {
+  for (uint8_t attempt = 0; attempt < 2; attempt++) {
+    uint8_t const buf_idx = p_ncm->tx_fill;
+    ncmh_tx_buf_t* tx = &p_ncm->tx[buf_idx];
+
+    if (tx->state == NCMH_BUF_FREE) {
+      tx->state = NCMH_BUF_BUSY;
+      tx->count = 0;
+      tx->len   = p_ncm->is_ncm ? sizeof(nth16_t) : 0;
+    }
+
+    if (tx->state != NCMH_BUF_BUSY) return -1;
+    if (ncmh_tx_fits(p_ncm, buf_idx, size)) return buf_idx;
+
+    // an empty buffer can never take this frame
+    if (tx->count == 0) return -1;
+    ncmh_tx_close(p_ncm, idx);
+  }
+
+  return -1;
+}
+
+bool tuh_ncm_xmit_available(uint8_t idx, uint16_t size) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted);
+
+  uint8_t const buf_idx = p_ncm->tx_fill;
+  if (p_ncm->tx[buf_idx].state == NCMH_BUF_FREE) return true;
+  if (p_ncm->tx[buf_idx].state != NCMH_BUF_BUSY) return false;
+  if (ncmh_tx_fits(p_ncm, buf_idx, size)) return true;
+
+  // frame goes to the next buffer
+  return p_ncm->tx[buf_idx].count && p_ncm->tx[ring_next(buf_idx, CFG_TUH_NCM_TX_NTB_N)].state == NCMH_BUF_FREE;
+}
+
+uint8_t* tuh_ncm_xmit_reserve(uint8_t idx, uint16_t size) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted && size, NULL);
+
+  int const buf_idx = ncmh_tx_buf(p_ncm, idx, size);
+  TU_VERIFY(buf_idx >= 0, NULL);
+
+  p_ncm->tx_reserved = size;
+
+  uint32_t const offset = p_ncm->is_ncm ? ncmh_tx_datagram_offset(p_ncm, p_ncm->tx[buf_idx].len) : 0;
+  return ncmh_epbuf[idx].tx[buf_idx] + offset;
+}
+
+bool tuh_ncm_xmit_commit(uint8_t idx, uint16_t size) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted);
+  TU_VERIFY(size && size <= p_ncm->tx_reserved);
+  p_ncm->tx_reserved = 0;
+
+  ncmh_tx_buf_t* tx = &p_ncm->tx[p_ncm->tx_fill];
+  TU_ASSERT(tx->state == NCMH_BUF_BUSY);
+
+  if (p_ncm->is_ncm) {
+    uint16_t const offset = (uint16_t) ncmh_tx_datagram_offset(p_ncm, tx->len);
+    tx->datagram[tx->count].wDatagramIndex  = offset;
+    tx->datagram[tx->count].wDatagramLength = size;
+    tx->len = (uint16_t) (offset + size);
+    tx->count++;
+  } else {
+    tx->len   = size;
+    tx->count = 1;
+    ncmh_tx_close(p_ncm, idx);
+  }
+
+  // send right away if idle, otherwise frames are aggregated until the current transfer completes
+  ncmh_tx_kick(p_ncm, idx);
+  return true;
+}
+
+bool tuh_ncm_xmit(uint8_t idx, void const* frame, uint16_t size) {
+  uint8_t* buf = tuh_ncm_xmit_reserve(idx, size);
+  TU_VERIFY(buf);
+
+  memcpy(buf, frame, size);
+  return tuh_ncm_xmit_commit(idx, size);
+}
+
+static void ncmh_tx_kick(ncmh_interface_t* p_ncm, uint8_t idx) {
+  if (p_ncm->tx_busy) return;
+
+  uint8_t const buf_idx = p_ncm->tx_send;
+  ncmh_tx_buf_t* tx = &p_ncm->tx[buf_idx];
+
+  // nothing queued: send the partially filled NTB
+  if (tx->state == NCMH_BUF_BUSY && tx->count && p_ncm->tx_reserved == 0) {
+    ncmh_tx_close(p_ncm, idx);
+  }
+
+  if (tx->state != NCMH_BUF_READY) return;
+
+  uint16_t len = tx->len;
+  uint8_t* buf = ncmh_epbuf[idx].tx[buf_idx];
+
+  if (0 == (len % p_ncm->ep_out_size)) {
+    if (p_ncm->is_ncm) {
+      // NTB shorter than dwNtbOutMaxSize must end with a short packet: pad instead of sending ZLP
+      if (len < p_ncm->tx_max_size) buf[len++] = 0;
+    } else {
+      p_ncm->tx_zlp = true;
+    }
+  }
+
+  TU_ASSERT(usbh_edpt_claim(p_ncm->daddr, p_ncm->ep_out),);
+  tx->state = NCMH_BUF_SENDING;
+  p_ncm->tx_busy = true;
+
+  if (!usbh_edpt_xfer(p_ncm->daddr, p_ncm->ep_out, buf, len)) {
+    usbh_edpt_release(p_ncm->daddr, p_ncm->ep_out);
+    tx->state = NCMH_BUF_READY;
+    p_ncm->tx_busy = false;
+    p_ncm->tx_zlp = false;
+  }
+}
+
+static void ncmh_tx_complete(ncmh_interface_t* p_ncm, uint8_t idx) {
+  if (p_ncm->tx_zlp) {
+    p_ncm->tx_zlp = false;
+    if (usbh_edpt_claim(p_ncm->daddr, p_ncm->ep_out) &&
+        usbh_edpt_xfer(p_ncm->daddr, p_ncm->ep_out, NULL, 0)) {
+      return;
+    }
+  }
+
+  p_ncm->tx[p_ncm->tx_send].state = NCMH_BUF_FREE;
+  p_ncm->tx_send = ring_next(p_ncm->tx_send, CFG_TUH_NCM_TX_NTB_N);
+  p_ncm->tx_busy = false;
+
+  ncmh_tx_kick(p_ncm, idx);
+
+  if (tuh_ncm_tx_complete_cb) tuh_ncm_tx_complete_cb(idx);
+}
+
+//------------- Receive -------------//
+
+static int ncmh_rx_buf_of(uint8_t idx, uint8_t const* frame) {
+  for (uint8_t i = 0; i < CFG_TUH_NCM_RX_NTB_N; i++) {
+    uint8_t const* buf = ncmh_epbuf[idx].rx[i];
+    if (buf <= frame && frame < buf + CFG_TUH_NCM_RX_NTB_SIZE) return i;
+  }
+  return -1;
+}
+
+bool tuh_ncm_rx_hold(uint8_t idx, uint8_t const* frame) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm);
+
+  int const buf_idx = ncmh_rx_buf_of(idx, frame);
+  TU_VERIFY(buf_idx >= 0 && p_ncm->rx[buf_idx].state == NCMH_BUF_READY && p_ncm->rx[buf_idx].hold < UINT8_MAX);
+
+  p_ncm->rx[buf_idx].hold++;
+  return true;
+}
+
+void tuh_ncm_rx_release(uint8_t idx, uint8_t const* frame) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm,);
+
+  int const buf_idx = ncmh_rx_buf_of(idx, frame);
+  TU_VERIFY(buf_idx >= 0 && p_ncm->rx[buf_idx].hold,);
+
+  // released from tuh_ncm_rx_cb(): buffer is freed by ncmh_rx_complete() once all datagrams are delivered
+  if (--p_ncm->rx[buf_idx].hold == 0 && !p_ncm->rx[buf_idx].delivering) {
+    p_ncm->rx[buf_idx].state = NCMH_BUF_FREE;
+    ncmh_rx_start(p_ncm, idx);
+  }
+}
+
+static void ncmh_rx_start(ncmh_interface_t* p_ncm, uint8_t idx) {
+  if (!p_ncm->mounted || p_ncm->rx_armed || p_ncm->rx_halted) return;
+
+  // buffers held by application may be released out of order
+  uint8_t buf_idx = p_ncm->rx_arm;
+  for (uint8_t i = 0; i < CFG_TUH_NCM_RX_NTB_N && p_ncm->rx[buf_idx].state != NCMH_BUF_FREE; i++) {
+    buf_idx = ring_next(buf_idx, CFG_TUH_NCM_RX_NTB_N);
+  }
+  if (p_ncm->rx[buf_idx].state != NCMH_BUF_FREE) return;
+
+  TU_VERIFY(usbh_edpt_claim(p_ncm->daddr, p_ncm->ep_in),);
+  p_ncm->rx_arm = buf_idx;
+  p_ncm->rx[buf_idx].state = NCMH_BUF_BUSY;
+  p_ncm->rx_armed = true;
+
+  if (!usbh_edpt_xfer(p_ncm->daddr, p_ncm->ep_in, ncmh_epbuf[idx].rx[buf_idx], p_ncm->rx_size)) {
+    usbh_edpt_release(p_ncm->daddr, p_ncm->ep_in);
+    p_ncm->rx[buf_idx].state = NCMH_BUF_FREE;
+    p_ncm->rx_armed = false;
+  }
+}
+
+static void ncmh_rx_deliver(uint8_t idx, uint8_t const* frame, uint16_t size) {
+  if (size && tuh_ncm_rx_cb) tuh_ncm_rx_cb(idx, frame, size);
+}
+
+// Pass all datagrams of a received NTB16 to application, malformed parts are dropped
+static void ncmh_rx_parse_ntb(uint8_t idx, uint8_t const* ntb, uint16_t len) {
+  TU_VERIFY(len >= sizeof(nth16_t),);
+
+  nth16_t const* nth = (nth16_t const*) ntb;
+  TU_VERIFY(nth->dwSignature == NTH16_SIGNATURE && nth->wHeaderLength == sizeof(nth16_t),);
+
+  uint16_t const block_len = tu_min16(nth->wBlockLength ? nth->wBlockLength : len, len);
+  uint16_t ndp_idx = nth->wNdpIndex;
+
+  // bound the number of NDPs in case of loop in the chain
+  for (uint8_t n = 0; n < 8 && ndp_idx; n++) {
+    TU_VERIFY(ndp_idx >= sizeof(nth16_t) && (uint32_t) ndp_idx + sizeof(ndp16_t) <= block_len,);
+
+    uint8_t const* p_ndp = ntb + ndp_idx;
+    uint32_t const signature = tu_unaligned_read32(p_ndp);
+    uint16_t const ndp_len = tu_unaligned_read16(p_ndp + 4);
+    TU_VERIFY(signature == NDP16_SIGNATURE_NCM0 || signature == NDP16_SIGNATURE_NCM1,);
+    TU_VERIFY(ndp_len >= sizeof(ndp16_t) + 2*sizeof(ndp16_datagram_t) && (uint32_t) ndp_idx + ndp_len <= block_len,);
+
+    for (uint16_t i = sizeof(ndp16_t); i + sizeof(ndp16_datagram_t) <= ndp_len; i += sizeof(ndp16_datagram_t)) {
+      uint16_t const dg_idx = tu_unaligned_read16(p_ndp + i);
+      uint16_t const dg_len = tu_unaligned_read16(p_ndp + i + 2);
+      if (dg_idx == 0 || dg_len == 0) break;
+
+      if ((uint32_t) dg_idx + dg_len <= block_len && dg_len <= CFG_TUH_NCM_MTU) {
+        ncmh_rx_deliver(idx, ntb + dg_idx, dg_len);
+      }
+    }
+
+    ndp_idx = tu_unaligned_read16(p_ndp + 6);
+  }
+}
+
+static void ncmh_rx_complete(ncmh_interface_t* p_ncm, uint8_t idx, xfer_result_t result, uint16_t len) {
+  uint8_t const buf_idx = p_ncm->rx_arm;
+
+  p_ncm->rx_armed = false;
+  p_ncm->rx_arm = ring_next(buf_idx, CFG_TUH_NCM_RX_NTB_N);
+  p_ncm->rx[buf_idx].state = NCMH_BUF_READY;
+  p_ncm->rx[buf_idx].len = len;
+
+  // re-arming a stalled or failed endpoint would fail again right away
+  if (result == XFER_RESULT_STALLED || result == XFER_RESULT_FAILED) {
+    TU_LOG_DRV("  NCM receive stopped, result = %u\r\n", result);
+    p_ncm->rx_halted = true;
+  }
+
+  // keep the endpoint busy with the next buffer while this one is consumed
+  ncmh_rx_start(p_ncm, idx);
+
+  if (result == XFER_RESULT_SUCCESS) {
+    uint8_t const* buf = ncmh_epbuf[idx].rx[buf_idx];
+    p_ncm->rx[buf_idx].delivering = true;
+    if (p_ncm->is_ncm) {
+      ncmh_rx_parse_ntb(idx, buf, len);
+    } else {
+      ncmh_rx_deliver(idx, buf, len);
+    }
+    p_ncm->rx[buf_idx].delivering = false;
+  }
+
+  if (p_ncm->rx[buf_idx].hold == 0) {
+    p_ncm->rx[buf_idx].state = NCMH_BUF_FREE;
+    ncmh_rx_start(p_ncm, idx);
+  }
+}
+
+//------------- Notification -------------//
+
+static bool ncmh_notif_start(ncmh_interface_t* p_ncm, uint8_t idx) {
+  if (p_ncm->ep_notif == 0) return true;
+
+  TU_VERIFY(usbh_edpt_claim(p_ncm->daddr, p_ncm->ep_notif));
+  if (!usbh_edpt_xfer(p_ncm->daddr, p_ncm->ep_notif, ncmh_epbuf[idx].notif, p_ncm->ep_notif_size)) {
+    usbh_edpt_release(p_ncm->daddr, p_ncm->ep_notif);
+    return false;
+  }
+
+  return true;
+}
+
+static void ncmh_notif_complete(ncmh_interface_t* p_ncm, uint8_t idx, xfer_result_t result, uint32_t len) {
+  uint8_t const* notif = ncmh_epbuf[idx].notif;
+
+  if (result == XFER_RESULT_SUCCESS && len >= 8 &&
+      notif[0] == 0xA1 && notif[1] == CDC_NOTIF_NETWORK_CONNECTION) {
+    bool const connected = tu_unaligned_read16(notif + 2) != 0;
+    TU_LOG_DRV("  NCM link %s\r\n", connected ? "up" : "down");
+    if (tuh_ncm_link_cb) tuh_ncm_link_cb(idx, connected);
+  }
+
+  // re-arming a stalled or failed endpoint would fail again right away
+  if (result == XFER_RESULT_STALLED || result == XFER_RESULT_FAILED) {
+    TU_LOG_DRV("  NCM notification stopped, result = %u\r\n", result);
+    return;
+  }
+
+  ncmh_notif_start(p_ncm, idx);
+}
+
+//--------------------------------------------------------------------+
+// CLASS DRIVER API
+//--------------------------------------------------------------------+
+
+bool ncmh_init(void) {
+  TU_LOG_DRV("sizeof(ncmh_interface_t) = %u\r\n", sizeof(ncmh_interface_t));
+  tu_memclr(ncmh_data, sizeof(ncmh_data));
+  return true;
+}
+
+bool ncmh_deinit(void) {
+  return true;
+}
+
+void ncmh_close(uint8_t daddr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_NCM; idx++) {
+    ncmh_interface_t* p_ncm = &ncmh_data[idx];
+    if (p_ncm->daddr == daddr) {
+      TU_LOG_DRV("  NCMh close addr = %u index = %u\r\n", daddr, idx);
+      bool const mounted = p_ncm->mounted;
+      tu_memclr(p_ncm, sizeof(ncmh_interface_t));
+
+      if (mounted && tuh_ncm_umount_cb) tuh_ncm_umount_cb(idx);
+    }
+  }
+}
+
+bool ncmh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes) {
+  uint8_t const idx = get_idx_by_ep_addr(daddr, ep_addr);
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_ASSERT(p_ncm);
+
+  if (ep_addr == p_ncm->ep_out) {
+    ncmh_tx_complete(p_ncm, idx);
+  } else if (ep_addr == p_ncm->ep_in) {
+    ncmh_rx_complete(p_ncm, idx, event, (uint16_t) xferred_bytes);
+  } else {
+    ncmh_notif_complete(p_ncm, idx, event, xferred_bytes);
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
+
+bool ncmh_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* itf_desc, uint16_t max_len) {
+  (void) rhport;
+
+  TU_VERIFY(TUSB_CLASS_CDC == itf_desc->bInterfaceClass &&
+            (CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL == itf_desc->bInterfaceSubClass ||
+             CDC_COMM_SUBCLASS_ETHERNET_CONTROL_MODEL == itf_desc->bInterfaceSubClass));
+
+  uint8_t const idx = tuh_ncm_itf_get_index(0);
+  ncmh_interface_t* p_ncm = (idx < CFG_TUH_NCM) ? &ncmh_data[idx] : NULL;
+  TU_VERIFY(p_ncm);
+
+  tu_memclr(p_ncm, sizeof(ncmh_interface_t));
+  p_ncm->daddr   = daddr;
+  p_ncm->itf_num = itf_desc->bInterfaceNumber;
+  p_ncm->is_ncm  = (CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL == itf_desc->bInterfaceSubClass);
+
+  uint8_t const* p_desc = (uint8_t const*) itf_desc;
+  uint8_t const* desc_end = p_desc + max_len;
+
+  // Communication interface: functional descriptors and notification endpoint
+  p_desc = tu_desc_next(p_desc);
+  while (p_desc < desc_end && TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) {
+    if (TUSB_DESC_CS_INTERFACE == tu_desc_type(p_desc) && tu_desc_len(p_desc) >= 4) {
+      if (CDC_FUNC_DESC_ETHERNET_NETWORKING == p_desc[2]) {
+        p_ncm->mac_str_idx = p_desc[3];
+      } else if (CDC_FUNC_DESC_NCM == p_desc[2] && tu_desc_len(p_desc) >= 6) {
+        p_ncm->capabilities = p_desc[5];
+      }
+    } else if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc)) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      if (TUSB_XFER_INTERRUPT == desc_ep->bmAttributes.xfer && TUSB_DIR_IN == tu_edpt_dir(desc_ep->bEndpointAddress)) {
+        TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+        p_ncm->ep_notif = desc_ep->bEndpointAddress;
+        p_ncm->ep_notif_size = (uint8_t) tu_min16(tu_edpt_packet_size(desc_ep), sizeof(ncmh_epbuf[0].notif));
+      }
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  // Data interface: endpoints are in the alternate setting that has them
+  while (p_desc < desc_end) {
+    if (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) {
+      tusb_desc_interface_t const* desc_data = (tusb_desc_interface_t const*) p_desc;
+      if (p_ncm->ep_in && p_ncm->ep_out) break;
+
+      if (TUSB_CLASS_CDC_DATA == desc_data->bInterfaceClass && 2 == desc_data->bNumEndpoints) {
+        p_ncm->itf_data     = desc_data->bInterfaceNumber;
+        p_ncm->itf_data_alt = desc_data->bAlternateSetting;
+      }
+    } else if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc) && p_ncm->itf_data) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      if (TUSB_XFER_BULK == desc_ep->bmAttributes.xfer) {
+        TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+        if (TUSB_DIR_IN == tu_edpt_dir(desc_ep->bEndpointAddress)) {
+          p_ncm->ep_in = desc_ep->bEndpointAddress;
+        } else {
+          p_ncm->ep_out = desc_ep->bEndpointAddress;
+          p_ncm->ep_out_size = tu_edpt_packet_size(desc_ep);
+        }
+      }
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  if (!(p_ncm->ep_in && p_ncm->ep_out && p_ncm->ep_out_size)) {
+    p_ncm->daddr = 0;
+    return false;
+  }
+
+  TU_LOG_DRV("  %s: data itf = %u alt = %u, MAC string = %u\r\n", p_ncm->is_ncm ? "NCM" : "ECM",
+             p_ncm->itf_data, p_ncm->itf_data_alt, p_ncm->mac_str_idx);
+
+  return true;
+}
+
+// idx is kept in user data since wIndex of the requests is not always the interface number
+static inline uintptr_t config_state(uint8_t idx, uint8_t state) {
+  return ((uintptr_t) idx << 8) | state;
+}
+
+static bool ncmh_class_request(ncmh_interface_t* p_ncm, uint8_t idx, uint8_t request_code, tusb_dir_t dir,
+                               uint16_t value, void* buffer, uint16_t length, uint8_t next_state,
+                               tuh_xfer_cb_t complete_cb) {
+  tusb_control_request_t const request = {
+    .bmRequestType_bit = {
+      .recipient = TUSB_REQ_RCPT_INTERFACE,
+      .type      = TUSB_REQ_TYPE_CLASS,
+      .direction = dir
+    },
+    .bRequest = request_code,
+    .wValue   = tu_htole16(value),
+    .wIndex   = tu_htole16(p_ncm->itf_num),
+    .wLength  = tu_htole16(length)
+  };
+
+  tuh_xfer_t xfer = {
+    .daddr       = p_ncm->daddr,
+    .ep_addr     = 0,
+    .setup       = &request,
+    .buffer      = buffer,
+    .complete_cb = complete_cb,
+    .user_data   = config_state(idx, next_state)
+  };
+
+  return tuh_control_xfer(&xfer);
+}
+
+static uint8_t hex_value(uint16_t c) {
+  if (c >= '0' && c <= '9') return (uint8_t) (c - '0');
+  if (c >= 'a' && c <= 'f') return (uint8_t) (c - 'a' + 10);
+  if (c >= 'A' && c <= 'F') return (uint8_t) (c - 'A' + 10);
+  return 0xFF;
+}
+
+// iMACAddress string is 12 hex digits in UTF-16
+static bool ncmh_parse_mac(ncmh_interface_t* p_ncm, uint16_t const* str) {
+  TU_VERIFY((str[0] & 0xFF) >= 2 + 12*2);
+
+  for (uint8_t i = 0; i < 6; i++) {
+    uint8_t const hi = hex_value(tu_le16toh(str[1 + 2*i]));
+    uint8_t const lo = hex_value(tu_le16toh(str[2 + 2*i]));
+    TU_VERIFY(hi < 16 && lo < 16);
+    p_ncm->mac[i] = (uint8_t) ((hi << 4) | lo);
+  }
+
+  p_ncm->mac_valid = true;
+  return true;
+}
+
+static void ncmh_process_config(tuh_xfer_t* xfer) {
+  uint8_t const idx = (uint8_t) (xfer->user_data >> 8);
+  uint8_t const state = (uint8_t) (xfer->user_data & 0xFF);
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_ASSERT(p_ncm,);
+
+  ncmh_epbuf_t* epbuf = &ncmh_epbuf[idx];
+
+  switch (state) {
+    case CONFIG_GET_MAC_STRING:
+      if (p_ncm->mac_str_idx) {
+        TU_ASSERT(tuh_descriptor_get_string(p_ncm->daddr, p_ncm->mac_str_idx, 0x0409, epbuf->ctrl.mac_str,
+                                            sizeof(epbuf->ctrl.mac_str), ncmh_process_config,
+                                            config_state(idx, CONFIG_PARSE_MAC_STRING)),);
+        break;
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    case CONFIG_PARSE_MAC_STRING:
+      // MAC address is optional for the driver, application may assign one
+      if (p_ncm->mac_str_idx && xfer->result == XFER_RESULT_SUCCESS) {
+        ncmh_parse_mac(p_ncm, epbuf->ctrl.mac_str);
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    case CONFIG_GET_NTB_PARAMETERS:
+      if (p_ncm->is_ncm) {
+        TU_ASSERT(ncmh_class_request(p_ncm, idx, NCM_GET_NTB_PARAMETERS, TUSB_DIR_IN, 0, &epbuf->ctrl.ntb_params,
+                                     sizeof(ntb_parameters_t), CONFIG_SET_NTB_INPUT_SIZE, ncmh_process_config),);
+        break;
+      }
+
+      // ECM: one frame per transfer
+      p_ncm->rx_size          = CFG_TUH_NCM_RX_NTB_SIZE;
+      p_ncm->tx_max_size      = CFG_TUH_NCM_MTU;
+      p_ncm->tx_max_datagrams = 1;
+      p_ncm->tx_divisor       = 1;
+      p_ncm->tx_ndp_align     = 1;
+      TU_ATTR_FALLTHROUGH;
+
+    case CONFIG_SET_NTB_INPUT_SIZE:
+      if (p_ncm->is_ncm) {
+        TU_ASSERT(xfer->result == XFER_RESULT_SUCCESS,);
+        ntb_parameters_t const* params = &epbuf->ctrl.ntb_params;
+        TU_ASSERT(params->bmNtbFormatsSupported & TU_BIT(NTB_FORMAT_16),);
+
+        uint32_t const in_max = tu_le32toh(params->dwNtbInMaxSize);
+        uint32_t const out_max = tu_le32toh(params->dwNtbOutMaxSize);
+        uint16_t const divisor = tu_le16toh(params->wNdbOutDivisor);
+        uint16_t const alignment = tu_le16toh(params->wNdbOutAlignment);
+        uint16_t const max_datagrams = tu_le16toh(params->wNtbOutMaxDatagrams);
+
+        p_ncm->rx_size          = (uint16_t) tu_min32(in_max, CFG_TUH_NCM_RX_NTB_SIZE);
+        p_ncm->tx_max_size      = (uint16_t) tu_min32(out_max, CFG_TUH_NCM_TX_NTB_SIZE);
+        p_ncm->tx_divisor       = divisor ? divisor : 4;
+        p_ncm->tx_remainder     = (uint16_t) (tu_le16toh(params->wNdbOutPayloadRemainder) % p_ncm->tx_divisor);
+        p_ncm->tx_ndp_align     = tu_max16(alignment, 4);
+        p_ncm->tx_max_datagrams = (uint8_t) ((max_datagrams && max_datagrams < CFG_TUH_NCM_TX_MAX_DATAGRAMS) ?
+                                             max_datagrams : CFG_TUH_NCM_TX_MAX_DATAGRAMS);
+
+        TU_LOG_DRV("  NTB in = %u, out = %u, out divisor = %u, max datagrams = %u\r\n",
+                   p_ncm->rx_size, p_ncm->tx_max_size, p_ncm->tx_divisor, p_ncm->tx_max_datagrams);
+        TU_ASSERT(p_ncm->tx_max_size >= CFG_TUH_NCM_MTU + NCMH_TX_OVERHEAD && (p_ncm->tx_ndp_align & (p_ncm->tx_ndp_align - 1)) == 0,);
+
+        // device must not send NTBs larger than our receive buffer
+        ntb_input_size_t* input_size = &epbuf->ctrl.ntb_input_size;
+        input_size->dwNtbInMaxSize     = tu_htole32(p_ncm->rx_size);
+        input_size->wNtbInMaxDatagrams = 0;
+        input_size->wReserved          = 0;
+        uint16_t const len = (p_ncm->capabilities & NCMH_CAP_NTB_INPUT_SIZE_8) ? sizeof(ntb_input_size_t) : sizeof(uint32_t);
+
+        TU_ASSERT(ncmh_class_request(p_ncm, idx, NCM_SET_NTB_INPUT_SIZE, TUSB_DIR_OUT, 0, input_size, len,
+                                     CONFIG_SET_PACKET_FILTER, ncmh_process_config),);
+        break;
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    case CONFIG_SET_PACKET_FILTER:
+      // failure of SET_NTB_INPUT_SIZE is not fatal as long as device uses the advertised size
+      if (p_ncm->is_ncm && xfer->result != XFER_RESULT_SUCCESS) {
+        TU_ASSERT(p_ncm->rx_size >= tu_le32toh(epbuf->ctrl.ntb_params.dwNtbInMaxSize),);
+      }
+
+      TU_ASSERT(ncmh_class_request(p_ncm, idx, CDC_REQUEST_SET_ETHERNET_PACKET_FILTER, TUSB_DIR_OUT,
+                                   NCMH_PACKET_FILTER, NULL, 0, CONFIG_SET_DATA_INTERFACE, ncmh_process_config),);
+      break;
+
+    case CONFIG_SET_DATA_INTERFACE:
+      // packet filter is optional for NCM, ignore result
+      TU_ASSERT(tuh_interface_set(p_ncm->daddr, p_ncm->itf_data, p_ncm->itf_data_alt, ncmh_process_config,
+                                  config_state(idx, CONFIG_COMPLETE)),);
+      break;
+
+    case CONFIG_COMPLETE:
+      TU_ASSERT(xfer->result == XFER_RESULT_SUCCESS,);
+      TU_LOG_DRV("NCMh Set Configure complete\r\n");
+
+      p_ncm->mounted = true;
+      if (tuh_ncm_mount_cb) tuh_ncm_mount_cb(idx);
+
+      ncmh_rx_start(p_ncm, idx);
+      ncmh_notif_start(p_ncm, idx);
+
+      // notify usbh that driver enumeration is complete, data interface is the last one of this function
+      usbh_driver_set_config_complete(p_ncm->daddr, p_ncm->itf_data);
+      break;
+
+    default:
+      break;
+  }
+}
+
+bool ncmh_set_config(uint8_t daddr, uint8_t itf_num) {
+  uint8_t idx = TUSB_INDEX_INVALID_8;
+  for (uint8_t i = 0; i < CFG_TUH_NCM; i++) {
+    if (ncmh_data[i].daddr == daddr && ncmh_data[i].itf_num == itf_num) idx = i;
+  }
+  TU_ASSERT(idx < CFG_TUH_NCM);
+
+  // fake transfer to kick-off process
+  tuh_xfer_t xfer;
+  xfer.daddr     = daddr;
+  xfer.result    = XFER_RESULT_SUCCESS;
+  xfer.setup     = NULL;
+  xfer.user_data = config_state(idx, CONFIG_GET_MAC_STRING);
+
+  ncmh_process_config(&xfer);
+  return true;
+}
+
+#endif
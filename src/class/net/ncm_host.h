@@ -0,0 +1,145 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_NCM_HOST_H_
+#define _TUSB_NCM_HOST_H_
+
+#include "class/cdc/cdc.h"
+#include "ncm.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Host driver for CDC-NCM (NTB16) network adapters, with fallback to CDC-ECM.
+// - Received NTBs are parsed in place and datagrams passed to application without copying. Multiple receive
+//   buffers are used so that the IN endpoint is re-armed while application consumes previous NTB.
+// - Transmitted frames are aggregated in an NTB while the previous one is on the bus.
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// Maximum Ethernet frame size including header
+#ifndef CFG_TUH_NCM_MTU
+#define CFG_TUH_NCM_MTU             1514
+#endif
+
+// Size of each receive buffer: NTB (NCM) or frame (ECM). Requested from device with SET_NTB_INPUT_SIZE.
+#ifndef CFG_TUH_NCM_RX_NTB_SIZE
+#define CFG_TUH_NCM_RX_NTB_SIZE     3200
+#endif
+
+// Number of receive buffers per interface
+#ifndef CFG_TUH_NCM_RX_NTB_N
+#define CFG_TUH_NCM_RX_NTB_N        2
+#endif
+
+// Size of each transmit buffer, limited further by dwNtbOutMaxSize of device
+#ifndef CFG_TUH_NCM_TX_NTB_SIZE
+#define CFG_TUH_NCM_TX_NTB_SIZE     3200
+#endif
+
+// Number of transmit buffers per interface: one is filled while others are sent
+#ifndef CFG_TUH_NCM_TX_NTB_N
+#define CFG_TUH_NCM_TX_NTB_N        2
+#endif
+
+// Maximum number of datagrams in a transmitted NTB
+#ifndef CFG_TUH_NCM_TX_MAX_DATAGRAMS
+#define CFG_TUH_NCM_TX_MAX_DATAGRAMS 8
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Get interface index from device address, return TUSB_INDEX_INVALID_8 (0xFF) if not found
+uint8_t tuh_ncm_itf_get_index(uint8_t daddr);
+
+// Check if interface is mounted
+bool tuh_ncm_mounted(uint8_t idx);
+
+// Check if interface uses NCM (true) or ECM (false)
+bool tuh_ncm_is_ncm(uint8_t idx);
+
+// Get MAC address of the device (from iMACAddress string), return false if not available
+bool tuh_ncm_get_mac(uint8_t idx, uint8_t mac[6]);
+
+// Check if a frame of given size can be transmitted now
+bool tuh_ncm_xmit_available(uint8_t idx, uint16_t size);
+
+// Reserve room for a frame of given size in the transmit NTB, return pointer to place frame data.
+// Frame is added with tuh_ncm_xmit_commit() which must be called before any other transmit function.
+uint8_t* tuh_ncm_xmit_reserve(uint8_t idx, uint16_t size);
+
+// Add frame placed in the buffer returned by tuh_ncm_xmit_reserve(), size must not exceed the reserved one
+bool tuh_ncm_xmit_commit(uint8_t idx, uint16_t size);
+
+// Copy a frame into transmit NTB
+bool tuh_ncm_xmit(uint8_t idx, void const* frame, uint16_t size);
+
+// Keep the frame passed to tuh_ncm_rx_cb() valid after the callback returns, e.g to wrap it in a reference pbuf.
+// Its receive buffer is not re-used until tuh_ncm_rx_release() is called.
+bool tuh_ncm_rx_hold(uint8_t idx, uint8_t const* frame);
+
+// Release a frame held by tuh_ncm_rx_hold()
+void tuh_ncm_rx_release(uint8_t idx, uint8_t const* frame);
+
+//--------------------------------------------------------------------+
+// Application Callbacks (Weak is optional)
+//--------------------------------------------------------------------+
+
+// Invoked when a device with NCM/ECM interface is mounted
+TU_ATTR_WEAK void tuh_ncm_mount_cb(uint8_t idx);
+
+// Invoked when a device with NCM/ECM interface is unmounted
+TU_ATTR_WEAK void tuh_ncm_umount_cb(uint8_t idx);
+
+// Invoked when device reports network connection change
+TU_ATTR_WEAK void tuh_ncm_link_cb(uint8_t idx, bool connected);
+
+// Invoked for each received Ethernet frame. Frame is only valid within the callback unless held.
+TU_ATTR_WEAK void tuh_ncm_rx_cb(uint8_t idx, uint8_t const* frame, uint16_t size);
+
+// Invoked when a transmit buffer is complete and more frames can be queued
+TU_ATTR_WEAK void tuh_ncm_tx_complete_cb(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+bool ncmh_init       (void);
+bool ncmh_deinit     (void);
+bool ncmh_open       (uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const *itf_desc, uint16_t max_len);
+bool ncmh_set_config (uint8_t daddr, uint8_t itf_num);
+bool ncmh_xfer_cb    (uint8_t daddr, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+void ncmh_close      (uint8_t daddr);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
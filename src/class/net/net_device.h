@@ -44,6 +44,30 @@
 #define CFG_TUD_NET_MTU           1514
 #endif
 
+// ECM/RNDIS: number of receive transfer buffers. With more than one, the OUT endpoint is re-armed
+// while frames of the previous transfer are consumed by the application
+#ifndef CFG_TUD_NET_RX_FRAMES
+#define CFG_TUD_NET_RX_FRAMES 2
+#endif
+
+// ECM/RNDIS: number of transmit transfer buffers, frames are queued while another one is sent
+#ifndef CFG_TUD_NET_TX_FRAMES
+#define CFG_TUD_NET_TX_FRAMES 2
+#endif
+
+// RNDIS: maximum number of packet messages combined in one transfer (both directions), reported to host
+// as MaxPacketsPerTransfer. Each transfer buffer holds this many full size frames.
+#ifndef CFG_TUD_NET_RNDIS_PACKETS_PER_XFER
+#define CFG_TUD_NET_RNDIS_PACKETS_PER_XFER 1
+#endif
+
+// ECM only: transmit a single-segment frame passed to tud_network_xmit_bufs() directly from application memory
+// instead of copying it. The buffer must be accessible by the USB controller (DMA) and stay valid until
+// tud_network_xmit_done_cb() is invoked.
+#ifndef CFG_TUD_NET_XMIT_ZERO_COPY
+#define CFG_TUD_NET_XMIT_ZERO_COPY 0
+#endif
+
 #ifndef CFG_TUD_NCM_IN_NTB_MAX_SIZE
 #define CFG_TUD_NCM_IN_NTB_MAX_SIZE 3200
 #endif
@@ -52,10 +76,28 @@
 #define CFG_TUD_NCM_OUT_NTB_MAX_SIZE 3200
 #endif
 
+// Number of receive NTB buffers. With more than one, the next NTB is received while datagrams
+// of the previous one are consumed by the application
+#ifndef CFG_TUD_NCM_OUT_NTB_N
+#define CFG_TUD_NCM_OUT_NTB_N 2
+#endif
+
 #ifndef CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB
 #define CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB 8
 #endif
 
+// Support 32-bit NTB format (NTH32/NDP32), required for NTBs larger than 64 KB
+#ifndef CFG_TUD_NCM_NTB32
+#define CFG_TUD_NCM_NTB32 1
+#endif
+
+// Transmit aggregation: hold a partially filled NTB for up to this many microseconds so that more datagrams
+// can be added before it is sent. NTB is sent earlier once it is full by count or size. Hold time is
+// measured with SOF (1 ms full speed, 125 us high speed). 0 sends the NTB as soon as endpoint is idle.
+#ifndef CFG_TUD_NCM_TX_AGGREGATION_US
+#define CFG_TUD_NCM_TX_AGGREGATION_US 0
+#endif
+
 #ifndef CFG_TUD_NCM_ALIGNMENT
 #define CFG_TUD_NCM_ALIGNMENT 4
 #endif
@@ -74,9 +116,33 @@ void tud_network_recv_renew(void);
 // poll network driver for its ability to accept another packet to transmit
 bool tud_network_can_xmit(uint16_t size);
 
-// if network_can_xmit() returns true, network_xmit() can be called once
+// if network_can_xmit() returns true, network_xmit() can be called once.
+// Otherwise the frame is dropped without invoking tud_network_xmit_cb(), ref stays owned by the caller.
 void tud_network_xmit(void *ref, uint16_t arg);
 
+// segment of a frame passed by reference e.g a pbuf of lwIP pbuf chain
+typedef struct {
+  void const *data;
+  uint16_t len;
+} tud_network_buf_t;
+
+// Alternative to tud_network_xmit(): transmit a frame made of count segments without tud_network_xmit_cb().
+// Segments are gathered directly into the transfer buffer, or (ECM with CFG_TUD_NET_XMIT_ZERO_COPY) a single
+// segment is sent in place. tud_network_xmit_done_cb(ref) is invoked when the segments are no longer needed,
+// possibly before this function returns. network_can_xmit() must be called first with the total length.
+// Return false if the frame does not fit and is dropped, tud_network_xmit_done_cb(ref) is invoked in that case too.
+bool tud_network_xmit_bufs(tud_network_buf_t const *bufs, uint8_t count, void *ref);
+
+// keep the datagram passed to tud_network_recv_cb() valid after tud_network_recv_renew(), so that it can be
+// processed in place (e.g wrapped by a reference pbuf). Each hold must be released by tud_network_recv_release().
+// NCM: its NTB buffer is not re-used until released, other NTBs keep being received.
+// ECM/RNDIS: its slot of the CFG_TUD_NET_RX_FRAMES receive ring stays occupied until released, other slots
+// keep being received. Reception stops only when the ring is full of held frames.
+bool tud_network_recv_hold(const uint8_t *datagram);
+
+// release a datagram held by tud_network_recv_hold()
+void tud_network_recv_release(const uint8_t *datagram);
+
 //--------------------------------------------------------------------+
 // Application Callbacks (WEAK is optional)
 //--------------------------------------------------------------------+
@@ -87,6 +153,9 @@ bool tud_network_recv_cb(const uint8_t *src, uint16_t size);
 // client must provide this: copy from network stack packet pointer to dst
 uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg);
 
+// segments passed to tud_network_xmit_bufs() are no longer used by driver, e.g to free pbuf
+TU_ATTR_WEAK void tud_network_xmit_done_cb(void *ref);
+
 //------------- ECM/RNDIS -------------//
 
 // client must provide this: initialize any network state back to the beginning
@@ -101,6 +170,19 @@ extern uint8_t tud_network_mac_address[6];
 // callback to client providing optional indication of internal state of network driver
 void tud_network_link_state_cb(bool state);
 
+// transmit statistics
+typedef struct {
+  uint32_t ntb_count;      // number of transmitted NTBs
+  uint32_t datagram_count; // number of transmitted datagrams
+  uint32_t sent_full;      // NTBs sent because full by count or size
+  uint32_t sent_timeout;   // NTBs sent because aggregation hold time expired
+  uint32_t sent_idle;      // NTBs sent before full without waiting for the hold time to expire
+  uint32_t datagrams_per_ntb[CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB]; // [n-1] is number of NTBs carrying n datagrams
+} tud_network_ncm_tx_stats_t;
+
+// get transmit statistics, optionally reset them afterwards
+void tud_network_ncm_tx_stats(tud_network_ncm_tx_stats_t *stats, bool reset);
+
 //--------------------------------------------------------------------+
 // INTERNAL USBD-CLASS DRIVER API
 //--------------------------------------------------------------------+
@@ -110,6 +192,7 @@ uint16_t netd_open            (uint8_t rhport, tusb_desc_interface_t const * itf
 bool     netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     netd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
 void     netd_report          (uint8_t *buf, uint16_t len);
+void     netd_sof_isr         (uint8_t rhport, uint32_t frame_count);
 
 #ifdef __cplusplus
  }
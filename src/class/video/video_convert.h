@@ -0,0 +1,294 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_VIDEO_CONVERT_H_
+#define _TUSB_VIDEO_CONVERT_H_
+
+#include "common/tusb_common.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Kernels converting a source frame into an uncompressed UVC format (YUY2 or NV12). Any byte range of the converted
+// frame is produced on request, so a payload is converted straight into the endpoint buffer and each source pixel is
+// read once per payload without an intermediate frame buffer.
+// - RGB565 pixels are little endian 16-bit words, RGB888 pixels are 3 bytes in R, G, B order.
+// - Bayer sources are 8-bit raw frames, demosaiced with a 2x2 window starting at each pixel: every window holds one
+//   red, two green and one blue sample, so luma keeps the full resolution.
+// - Color space is ITU-R BT.601 limited range in 8.8 fixed point. Chroma is computed from the average color of the
+//   pixels sharing it (2 pixels for YUY2, 2x2 pixels for NV12).
+// Width must be even, as well as height for NV12. Bayer sources must be at least 2x2 pixels.
+
+typedef enum {
+  VIDEO_CONVERT_NONE = 0,
+  VIDEO_CONVERT_RGB565_TO_YUY2,
+  VIDEO_CONVERT_RGB888_TO_YUY2,
+  VIDEO_CONVERT_RGB565_TO_NV12,
+  VIDEO_CONVERT_RGB888_TO_NV12,
+  VIDEO_CONVERT_BAYER_RGGB_TO_YUY2,
+  VIDEO_CONVERT_BAYER_GRBG_TO_YUY2,
+  VIDEO_CONVERT_BAYER_GBRG_TO_YUY2,
+  VIDEO_CONVERT_BAYER_BGGR_TO_YUY2,
+} video_convert_t;
+
+//--------------------------------------------------------------------+
+// Color space
+//--------------------------------------------------------------------+
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t tu_video_rgb_to_y(uint32_t r, uint32_t g, uint32_t b) {
+  return (uint8_t) ((66 * r + 129 * g + 25 * b + (16 << 8) + 128) >> 8);
+}
+
+// Offset by 128 << 8 before shifting, so that only unsigned arithmetic is involved
+TU_ATTR_ALWAYS_INLINE static inline uint8_t tu_video_rgb_to_u(uint32_t r, uint32_t g, uint32_t b) {
+  return (uint8_t) ((112 * b + (128 << 8) + 128 - 38 * r - 74 * g) >> 8);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t tu_video_rgb_to_v(uint32_t r, uint32_t g, uint32_t b) {
+  return (uint8_t) ((112 * r + (128 << 8) + 128 - 94 * g - 18 * b) >> 8);
+}
+
+// Load pixel i of a RGB565 or RGB888 frame, 5 and 6-bit components are expanded by replicating their upper bits
+TU_ATTR_ALWAYS_INLINE static inline void tu_video_rgb_load(bool rgb565, uint8_t const *src, uint32_t i,
+                                                           uint32_t *r, uint32_t *g, uint32_t *b) {
+  if (rgb565) {
+    uint32_t const v = tu_u16(src[2 * i + 1], src[2 * i]);
+    *r = ((v >> 8) & 0xF8) | (v >> 13);
+    *g = ((v >> 3) & 0xFC) | ((v >> 9) & 0x03);
+    *b = ((v << 3) & 0xF8) | ((v >> 2) & 0x07);
+  } else {
+    *r = src[3 * i];
+    *g = src[3 * i + 1];
+    *b = src[3 * i + 2];
+  }
+}
+
+//--------------------------------------------------------------------+
+// Kernels converting whole units: YUY2 macropixels (4 bytes), NV12 luma (1 byte) and chroma pairs (2 bytes)
+//--------------------------------------------------------------------+
+
+// Y0 U Y1 V from 2 pixels
+TU_ATTR_ALWAYS_INLINE static inline void tu_video_yuy2_pack(uint8_t *dst, uint32_t r0, uint32_t g0, uint32_t b0,
+                                                            uint32_t r1, uint32_t g1, uint32_t b1) {
+  uint32_t const r = (r0 + r1 + 1) >> 1;
+  uint32_t const g = (g0 + g1 + 1) >> 1;
+  uint32_t const b = (b0 + b1 + 1) >> 1;
+  dst[0] = tu_video_rgb_to_y(r0, g0, b0);
+  dst[1] = tu_video_rgb_to_u(r, g, b);
+  dst[2] = tu_video_rgb_to_y(r1, g1, b1);
+  dst[3] = tu_video_rgb_to_v(r, g, b);
+}
+
+// Convert n macropixels starting at macropixel mp. The frame is a linear sequence of pixel pairs, rows do not matter.
+TU_ATTR_ALWAYS_INLINE static inline void tu_video_rgb_to_yuy2(bool rgb565, uint8_t *dst, uint32_t mp, uint32_t n,
+                                                              uint8_t const *src) {
+  src += 2 * mp * (rgb565 ? 2 : 3);
+  for (; n; n--) {
+    uint32_t r0, g0, b0, r1, g1, b1;
+    tu_video_rgb_load(rgb565, src, 0, &r0, &g0, &b0);
+    tu_video_rgb_load(rgb565, src, 1, &r1, &g1, &b1);
+    tu_video_yuy2_pack(dst, r0, g0, b0, r1, g1, b1);
+    dst += 4;
+    src += rgb565 ? 4 : 6;
+  }
+}
+
+// Convert n luma bytes starting at pixel i
+TU_ATTR_ALWAYS_INLINE static inline void tu_video_rgb_to_nv12_y(bool rgb565, uint8_t *dst, uint32_t i, uint32_t n,
+                                                                uint8_t const *src) {
+  src += i * (rgb565 ? 2 : 3);
+  for (; n; n--) {
+    uint32_t r, g, b;
+    tu_video_rgb_load(rgb565, src, 0, &r, &g, &b);
+    *dst++ = tu_video_rgb_to_y(r, g, b);
+    src += rgb565 ? 2 : 3;
+  }
+}
+
+// Convert n chroma pairs (U V) starting at pair c, each one covering 2x2 pixels
+TU_ATTR_ALWAYS_INLINE static inline void tu_video_rgb_to_nv12_uv(bool rgb565, uint8_t *dst, uint32_t c, uint32_t n,
+                                                                 uint8_t const *src, uint16_t width) {
+  uint32_t const half = width / 2u;
+  uint32_t x = 2 * (c % half);
+  uint32_t y = 2 * (c / half);
+  uint8_t const *row = src + y * width * (rgb565 ? 2 : 3);
+  while (n) {
+    uint8_t const *row1 = row + width * (rgb565 ? 2 : 3);
+    for (; n && x < width; n--, x += 2) {
+      uint32_t r = 2, g = 2, b = 2; // rounding of the average
+      uint32_t pr, pg, pb;
+      tu_video_rgb_load(rgb565, row, x, &pr, &pg, &pb);
+      r += pr; g += pg; b += pb;
+      tu_video_rgb_load(rgb565, row, x + 1, &pr, &pg, &pb);
+      r += pr; g += pg; b += pb;
+      tu_video_rgb_load(rgb565, row1, x, &pr, &pg, &pb);
+      r += pr; g += pg; b += pb;
+      tu_video_rgb_load(rgb565, row1, x + 1, &pr, &pg, &pb);
+      r += pr; g += pg; b += pb;
+      r >>= 2; g >>= 2; b >>= 2;
+      *dst++ = tu_video_rgb_to_u(r, g, b);
+      *dst++ = tu_video_rgb_to_v(r, g, b);
+    }
+    x = 0;
+    row = row1 + width * (rgb565 ? 2 : 3);
+  }
+}
+
+// Colors of the 2x2 window a b / c d. Arrangement 0: RGGB, 1: GRBG, 2: GBRG, 3: BGGR.
+TU_ATTR_ALWAYS_INLINE static inline void tu_video_bayer_rgb(uint_fast8_t arrangement, uint32_t a, uint32_t b,
+                                                            uint32_t c, uint32_t d,
+                                                            uint32_t *r, uint32_t *g, uint32_t *bl) {
+  switch (arrangement) {
+    case 0:  *r = a; *g = (b + c + 1) >> 1; *bl = d; break;
+    case 1:  *r = b; *g = (a + d + 1) >> 1; *bl = c; break;
+    case 2:  *r = c; *g = (a + d + 1) >> 1; *bl = b; break;
+    default: *r = d; *g = (b + c + 1) >> 1; *bl = a; break;
+  }
+}
+
+// Convert n macropixels starting at macropixel mp. The window of a pixel is moved back into the frame at the last
+// row and column. Moving the window by one pixel horizontally or vertically flips bit 0 or 1 of its arrangement.
+TU_ATTR_ALWAYS_INLINE static inline void tu_video_bayer_to_yuy2(uint_fast8_t pattern, uint8_t *dst, uint32_t mp,
+                                                                uint32_t n, uint8_t const *src, uint16_t width,
+                                                                uint16_t height) {
+  uint32_t x = (2 * mp) % width;
+  uint32_t y = (2 * mp) / width;
+  while (n) {
+    uint32_t const y0 = (y + 1 < height) ? y : y - 1u;
+    uint_fast8_t const arr = (uint_fast8_t) (pattern ^ ((y0 & 1) << 1));
+    uint8_t const *row0 = src + y0 * width;
+    uint8_t const *row1 = row0 + width;
+    uint32_t r0, g0, b0, r1, g1, b1;
+
+    // all but the last macropixel of the row read 3 columns
+    for (; n && x + 2 < width; n--, x += 2) {
+      tu_video_bayer_rgb(arr, row0[x], row0[x + 1], row1[x], row1[x + 1], &r0, &g0, &b0);
+      tu_video_bayer_rgb(arr ^ 1, row0[x + 1], row0[x + 2], row1[x + 1], row1[x + 2], &r1, &g1, &b1);
+      tu_video_yuy2_pack(dst, r0, g0, b0, r1, g1, b1);
+      dst += 4;
+    }
+    if (!n) break;
+
+    // last macropixel: both pixels share the last window
+    tu_video_bayer_rgb(arr, row0[x], row0[x + 1], row1[x], row1[x + 1], &r0, &g0, &b0);
+    tu_video_yuy2_pack(dst, r0, g0, b0, r0, g0, b0);
+    dst += 4;
+    n--;
+    x = 0;
+    y++;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Conversion of byte ranges
+//--------------------------------------------------------------------+
+
+// Byte size of the converted frame
+static inline uint32_t tu_video_convert_frame_size(video_convert_t convert, uint16_t width, uint16_t height) {
+  uint32_t const pixels = (uint32_t) width * height;
+  switch (convert) {
+    case VIDEO_CONVERT_RGB565_TO_NV12:
+    case VIDEO_CONVERT_RGB888_TO_NV12:
+      return pixels + pixels / 2;
+
+    case VIDEO_CONVERT_NONE:
+      return 0;
+
+    default:
+      return 2 * pixels;
+  }
+}
+
+// Convert n units starting at unit u: YUY2 macropixels or NV12 chroma pairs
+TU_ATTR_ALWAYS_INLINE static inline void tu_video_convert_units(video_convert_t convert, uint8_t *dst, uint32_t u,
+                                                                uint32_t n, void const *frame, uint16_t width,
+                                                                uint16_t height) {
+  uint8_t const *src = (uint8_t const *) frame;
+  switch (convert) {
+    case VIDEO_CONVERT_RGB565_TO_YUY2: tu_video_rgb_to_yuy2(true, dst, u, n, src); break;
+    case VIDEO_CONVERT_RGB888_TO_YUY2: tu_video_rgb_to_yuy2(false, dst, u, n, src); break;
+    case VIDEO_CONVERT_RGB565_TO_NV12: tu_video_rgb_to_nv12_uv(true, dst, u, n, src, width); break;
+    case VIDEO_CONVERT_RGB888_TO_NV12: tu_video_rgb_to_nv12_uv(false, dst, u, n, src, width); break;
+    case VIDEO_CONVERT_BAYER_RGGB_TO_YUY2: tu_video_bayer_to_yuy2(0, dst, u, n, src, width, height); break;
+    case VIDEO_CONVERT_BAYER_GRBG_TO_YUY2: tu_video_bayer_to_yuy2(1, dst, u, n, src, width, height); break;
+    case VIDEO_CONVERT_BAYER_GBRG_TO_YUY2: tu_video_bayer_to_yuy2(2, dst, u, n, src, width, height); break;
+    case VIDEO_CONVERT_BAYER_BGGR_TO_YUY2: tu_video_bayer_to_yuy2(3, dst, u, n, src, width, height); break;
+    default: break;
+  }
+}
+
+// Convert len bytes at offset ofs of the converted frame into dst. Units cut by the range boundaries are converted
+// into a scratch and copied partially.
+static inline void tu_video_convert(video_convert_t convert, uint8_t *dst, uint32_t ofs, uint32_t len,
+                                    void const *src, uint16_t width, uint16_t height) {
+  uint32_t unit = 4;
+  if (convert == VIDEO_CONVERT_RGB565_TO_NV12 || convert == VIDEO_CONVERT_RGB888_TO_NV12) {
+    // luma plane is converted byte by byte
+    uint32_t const pixels = (uint32_t) width * height;
+    if (ofs < pixels) {
+      uint32_t const n = tu_min32(len, pixels - ofs);
+      tu_video_rgb_to_nv12_y(convert == VIDEO_CONVERT_RGB565_TO_NV12, dst, ofs, n, (uint8_t const *) src);
+      dst += n;
+      ofs += n;
+      len -= n;
+      if (!len) return;
+    }
+    ofs -= pixels;
+    unit = 2;
+  }
+
+  uint8_t scratch[4];
+  uint32_t u = ofs / unit;
+  uint32_t const head = ofs % unit;
+  if (len && head) {
+    uint32_t const n = tu_min32(len, unit - head);
+    tu_video_convert_units(convert, scratch, u, 1, src, width, height);
+    memcpy(dst, scratch + head, n);
+    dst += n;
+    len -= n;
+    u++;
+  }
+
+  uint32_t const n_units = len / unit;
+  if (n_units) {
+    tu_video_convert_units(convert, dst, u, n_units, src, width, height);
+    dst += n_units * unit;
+    len -= n_units * unit;
+    u += n_units;
+  }
+
+  if (len) {
+    tu_video_convert_units(convert, scratch, u, 1, src, width, height);
+    memcpy(dst, scratch, len);
+  }
+}
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
@@ -98,6 +98,18 @@ typedef union {
   tusb_desc_video_frame_framebased_t  frame_based;
 } tusb_desc_cs_video_frm_t;
 
+/* frame waiting for transfer */
+typedef struct TU_ATTR_PACKED {
+  uint8_t *buffer;   /* frame buffer, NULL if frame data is pulled by tud_video_frame_pull_cb() */
+  uint32_t bufsize;  /* frame size */
+  uint8_t  inplace;  /* 1: payloads are sent directly from frame buffer */
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+  uint8_t  convert;  /* video_convert_t applied to the frame buffer */
+  uint16_t width;
+  uint16_t height;
+#endif
+} videod_frame_t;
+
 /* video streaming interface */
 typedef struct TU_ATTR_PACKED {
   uint8_t index_vc;  /* index of bound video control interface */
@@ -108,10 +120,30 @@ typedef struct TU_ATTR_PACKED {
     uint16_t cur;    /* Offset of the current settings */
     uint16_t ep[2];  /* Offset of endpoint descriptors. 0: streaming, 1: still capture */
   } desc;
-  uint8_t *buffer;   /* frame buffer. assume linear buffer. no support for stride access */
-  uint32_t bufsize;  /* frame buffer size */
+  struct {
+    uint16_t fmt[CFG_TUD_VIDEO_STREAMING_FORMAT_MAX];     /* Offset of format descriptors by bFormatIndex - 1, 0 if none */
+    uint8_t  frm_beg[CFG_TUD_VIDEO_STREAMING_FORMAT_MAX]; /* Position of the first frame of each format in frm[] */
+    uint16_t frm[CFG_TUD_VIDEO_STREAMING_FRAME_MAX];      /* Offset of frame descriptors by position + bFrameIndex - 1 */
+  } index;
+  uint8_t *buffer;   /* frame buffer. assume linear buffer. no support for stride access. NULL if pulled */
+  uint32_t bufsize;  /* frame buffer size, 0 if no frame is in transfer */
   uint32_t offset;   /* offset for the next payload transfer */
   uint32_t max_payload_transfer_size;
+  uint16_t bulk_mps; /* max packet size of the bulk streaming endpoint, 0 for isochronous */
+  uint8_t *hdr_inplace; /* payload header position in frame buffer while an in-place payload is sent, otherwise NULL */
+  uint8_t  hdr_saved[sizeof(tusb_video_payload_header_t)]; /* frame data overwritten by the in-place payload header */
+  uint8_t  inplace;  /* 1: payloads are sent directly from frame buffer */
+  uint8_t  zlp;      /* 1: last bulk payload must be terminated by a zero-length packet */
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+  uint8_t  convert;  /* video_convert_t applied to the frame buffer, bufsize is the size of the converted frame */
+  uint16_t width;
+  uint16_t height;
+#endif
+#if CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_SIZE
+  videod_frame_t queue[CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_SIZE]; /* frames queued behind the one in transfer */
+  uint8_t  queue_rd;
+  uint8_t  queue_cnt;
+#endif
   uint8_t  error_code;/* error code */
   uint8_t  state;    /* 0:probing 1:committed 2:streaming */
 
@@ -126,6 +158,7 @@ typedef struct TU_ATTR_PACKED {
   uint16_t    len;  /* Byte length of the descriptors */
   uint16_t    cur;  /* offset for current video control interface */
   uint8_t     stm[CFG_TUD_VIDEO_STREAMING]; /* Indices of streaming interface */
+  uint32_t    entity_map[8]; /* Bit n is set if the current video control interface has an entity with ID n */
   uint8_t error_code;  /* error code */
   uint8_t power_mode;
 
@@ -136,6 +169,9 @@ typedef struct TU_ATTR_PACKED {
 
 #define ITF_STM_MEM_RESET_SIZE   offsetof(videod_streaming_interface_t, ep_buf)
 
+TU_VERIFY_STATIC(CFG_TUD_VIDEO_STREAMING_BULK_PAYLOAD_SIZE <= UINT16_MAX, "payload is sent by a single transfer");
+TU_VERIFY_STATIC(CFG_TUD_VIDEO_STREAMING_FRAME_MAX <= UINT8_MAX, "frame position must fit into frm_beg");
+
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
@@ -359,29 +395,6 @@ static inline void const* _end_of_control_descriptor(void const *desc)
   return ((uint8_t const*) desc) + vc->std.bLength + tu_le16toh(vc->ctl.wTotalLength);
 }
 
-/** Find the first entity descriptor with the entity ID
- *  specified by the argument belonging to the current video control descriptor.
- *
- * @param[in] desc      The video control interface descriptor.
- * @param[in] entityid  The target entity id.
- *
- * @return The pointer for interface descriptor.
- * @retval end   did not found interface descriptor */
-static void const* _find_desc_entity(void const *desc, uint_fast8_t entityid)
-{
-  void const *end = _end_of_control_descriptor(desc);
-  for (void const *cur = desc; cur < end; cur = _find_desc(cur, end, TUSB_DESC_CS_INTERFACE)) {
-    tusb_desc_cs_video_entity_itf_t const *itf = (tusb_desc_cs_video_entity_itf_t const *)cur;
-    if ((VIDEO_CS_ITF_VC_INPUT_TERMINAL  <= itf->bDescriptorSubtype
-         && itf->bDescriptorSubtype < VIDEO_CS_ITF_VC_MAX)
-        && itf->bEntityId == entityid) {
-      return itf;
-    }
-    cur = tu_desc_next(cur);
-  }
-  return end;
-}
-
 /** Return the end of the video streaming descriptor. */
 static inline void const* _end_of_streaming_descriptor(void const *desc)
 {
@@ -389,17 +402,29 @@ static inline void const* _end_of_streaming_descriptor(void const *desc)
   return ((uint8_t const*) desc) + vs->std.bLength + tu_le16toh(vs->stm.wTotalLength);
 }
 
+/** Return true if the descriptor subtype is a format descriptor. */
+static inline bool _is_desc_format(uint_fast8_t subtype)
+{
+  return subtype == VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED ||
+         subtype == VIDEO_CS_ITF_VS_FORMAT_MJPEG ||
+         subtype == VIDEO_CS_ITF_VS_FORMAT_DV ||
+         subtype == VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED;
+}
+
+/** Return true if the descriptor subtype is a frame descriptor. */
+static inline bool _is_desc_frame(uint_fast8_t subtype)
+{
+  return subtype == VIDEO_CS_ITF_VS_FRAME_UNCOMPRESSED ||
+         subtype == VIDEO_CS_ITF_VS_FRAME_MJPEG ||
+         subtype == VIDEO_CS_ITF_VS_FRAME_FRAME_BASED;
+}
+
 /** Find the first format descriptor with the specified format number. */
 static inline void const *_find_desc_format(void const *beg, void const *end, uint_fast8_t fmtnum)
 {
   for (void const *cur = beg; cur < end; cur = _find_desc(cur, end, TUSB_DESC_CS_INTERFACE)) {
     uint8_t const *p = (uint8_t const *)cur;
-    uint_fast8_t fmt = p[2];
-    if ((fmt == VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED ||
-         fmt == VIDEO_CS_ITF_VS_FORMAT_MJPEG ||
-         fmt == VIDEO_CS_ITF_VS_FORMAT_DV ||
-         fmt == VIDEO_CS_ITF_VS_FRAME_FRAME_BASED) &&
-        fmtnum == p[3]) {
+    if (_is_desc_format(p[2]) && fmtnum == p[3]) {
       return cur;
     }
     cur = tu_desc_next(cur);
@@ -412,11 +437,7 @@ static inline void const *_find_desc_frame(void const *beg, void const *end, uin
 {
   for (void const *cur = beg; cur < end; cur = _find_desc(cur, end, TUSB_DESC_CS_INTERFACE)) {
     uint8_t const *p = (uint8_t const *)cur;
-    uint_fast8_t frm = p[2];
-    if ((frm == VIDEO_CS_ITF_VS_FRAME_UNCOMPRESSED ||
-         frm == VIDEO_CS_ITF_VS_FRAME_MJPEG ||
-         frm == VIDEO_CS_ITF_VS_FRAME_FRAME_BASED) &&
-        frmnum == p[3]) {
+    if (_is_desc_frame(p[2]) && frmnum == p[3]) {
       return cur;
     }
     cur = tu_desc_next(cur);
@@ -424,6 +445,158 @@ static inline void const *_find_desc_frame(void const *beg, void const *end, uin
   return end;
 }
 
+/** Record entity IDs of the video control interface, so that class requests are verified without walking the
+ *  descriptors.
+ *
+ * @param[in] beg   The next descriptor after the class-specific VC interface header descriptor.
+ * @param[in] end   The end of the video control interface descriptor. */
+static void _index_vc_entities(videod_interface_t *self, void const *beg, void const *end)
+{
+  tu_memclr(self->entity_map, sizeof(self->entity_map));
+  for (void const *cur = beg; cur < end; cur = _find_desc(cur, end, TUSB_DESC_CS_INTERFACE)) {
+    tusb_desc_cs_video_entity_itf_t const *itf = (tusb_desc_cs_video_entity_itf_t const *)cur;
+    if (VIDEO_CS_ITF_VC_INPUT_TERMINAL  <= itf->bDescriptorSubtype
+        && itf->bDescriptorSubtype < VIDEO_CS_ITF_VC_MAX) {
+      self->entity_map[itf->bEntityId >> 5] |= TU_BIT(itf->bEntityId & 0x1Fu);
+    }
+    cur = tu_desc_next(cur);
+  }
+}
+
+/** Return true if the current video control interface has an entity with the entity ID. */
+static inline bool _has_entity(videod_interface_t const *self, uint_fast8_t entityid)
+{
+  return tu_bit_test(self->entity_map[entityid >> 5], (uint8_t) (entityid & 0x1Fu));
+}
+
+/** Record the offsets of format and frame descriptors of the streaming interface.
+ *  Frames of a format are placed after the frames of the former format, each at position bFrameIndex - 1. */
+static void _index_vs_formats(videod_streaming_interface_t *stm)
+{
+  uint8_t const *desc = _videod_itf[stm->index_vc].beg;
+  void const *vs  = desc + stm->desc.beg;
+  void const *end = _end_of_streaming_descriptor(vs);
+  uint_fast16_t frm_beg = 0;
+  uint_fast16_t frm_num = 0; /* number of frames of the current format, 0 if not indexed */
+  uint_fast16_t frm_pos = 0;
+
+  tu_memclr(&stm->index, sizeof(stm->index));
+  for (void const *cur = _find_desc(tu_desc_next(vs), end, TUSB_DESC_CS_INTERFACE); cur < end;
+       cur = _find_desc(tu_desc_next(cur), end, TUSB_DESC_CS_INTERFACE)) {
+    uint8_t const *p = (uint8_t const *)cur;
+    uint_fast8_t const num = p[3];
+    if (_is_desc_format(p[2])) {
+      frm_num = 0;
+      if (!num || CFG_TUD_VIDEO_STREAMING_FORMAT_MAX < num || stm->index.fmt[num - 1]) continue;
+      stm->index.fmt[num - 1] = (uint16_t) (p - desc);
+      if (VIDEO_CS_ITF_VS_FORMAT_DV == p[2]) continue; /* DV has no frame descriptors */
+      if (frm_beg < CFG_TUD_VIDEO_STREAMING_FRAME_MAX) {
+        frm_pos = frm_beg;
+        frm_num = ((tusb_desc_cs_video_fmt_t const *)cur)->bNumFrameDescriptors;
+        stm->index.frm_beg[num - 1] = (uint8_t) frm_pos;
+        frm_beg += frm_num;
+      } else {
+        /* Frames of this format are found by walking the descriptors */
+        stm->index.frm_beg[num - 1] = CFG_TUD_VIDEO_STREAMING_FRAME_MAX;
+      }
+    } else if (_is_desc_frame(p[2]) && num && num <= frm_num) {
+      uint_fast16_t const pos = frm_pos + num - 1;
+      if (pos < CFG_TUD_VIDEO_STREAMING_FRAME_MAX && !stm->index.frm[pos]) {
+        stm->index.frm[pos] = (uint16_t) (p - desc);
+      }
+    }
+  }
+}
+
+/** Get the format descriptor with the specified format number.
+ *
+ * @return The pointer for format descriptor.
+ * @retval NULL   did not found format descriptor */
+static tusb_desc_cs_video_fmt_t const *_get_desc_format(videod_streaming_interface_t const *stm, uint_fast8_t fmtnum)
+{
+  uint8_t const *desc = _videod_itf[stm->index_vc].beg;
+  if (!fmtnum) return NULL;
+  if (fmtnum <= CFG_TUD_VIDEO_STREAMING_FORMAT_MAX) {
+    uint_fast16_t ofs = stm->index.fmt[fmtnum - 1];
+    return ofs ? (tusb_desc_cs_video_fmt_t const *)(desc + ofs) : NULL;
+  }
+  void const *vs  = desc + stm->desc.beg;
+  void const *end = _end_of_streaming_descriptor(vs);
+  void const *fmt = _find_desc_format(tu_desc_next(vs), end, fmtnum);
+  return (fmt < end) ? (tusb_desc_cs_video_fmt_t const *)fmt : NULL;
+}
+
+/** Get the frame descriptor with the specified frame number of the format descriptor.
+ *
+ * @return The pointer for frame descriptor.
+ * @retval NULL   did not found frame descriptor */
+static tusb_desc_cs_video_frm_t const *_get_desc_frame(videod_streaming_interface_t const *stm,
+                                                       tusb_desc_cs_video_fmt_t const *fmt, uint_fast8_t frmnum)
+{
+  uint8_t const *desc = _videod_itf[stm->index_vc].beg;
+  if (!frmnum || fmt->bNumFrameDescriptors < frmnum) return NULL;
+  uint_fast8_t const fmtnum = fmt->bFormatIndex;
+  if (fmtnum <= CFG_TUD_VIDEO_STREAMING_FORMAT_MAX) {
+    uint_fast16_t const pos = stm->index.frm_beg[fmtnum - 1] + frmnum - 1u;
+    if (pos < CFG_TUD_VIDEO_STREAMING_FRAME_MAX) {
+      uint_fast16_t ofs = stm->index.frm[pos];
+      return ofs ? (tusb_desc_cs_video_frm_t const *)(desc + ofs) : NULL;
+    }
+  }
+  void const *end = _end_of_streaming_descriptor(desc + stm->desc.beg);
+  void const *frm = _find_desc_frame(tu_desc_next(fmt), end, frmnum);
+  return (frm < end) ? (tusb_desc_cs_video_frm_t const *)frm : NULL;
+}
+
+/** Return the largest bytes per (micro)frame of isochronous endpoints of the streaming interface which can be opened.
+ *  High-bandwidth endpoints count with all their transactions, if the controller supports them. */
+static uint_fast32_t _max_iso_interval_size(videod_streaming_interface_t const *stm)
+{
+  uint8_t const *desc = _videod_itf[stm->index_vc].beg;
+  void const *end = desc + stm->desc.end;
+  uint_fast32_t max_size = 0;
+  for (void const *cur = desc + stm->desc.beg; cur < end; cur = tu_desc_next(cur)) {
+    if (TUSB_DESC_ENDPOINT != tu_desc_type(cur)) continue;
+    tusb_desc_endpoint_t const *ep = (tusb_desc_endpoint_t const*)cur;
+    if (TUSB_XFER_ISOCHRONOUS != ep->bmAttributes.xfer) continue;
+    if (usbd_edpt_iso_mult_max(0, ep->bEndpointAddress) < tu_edpt_mult(ep)) continue;
+    uint_fast32_t const size = tu_edpt_interval_size(ep);
+    if (max_size < size) max_size = size;
+  }
+  return max_size;
+}
+
+/** Return the upper limit of dwMaxPayloadTransferSize.
+ *
+ * Bulk streaming, which uses alternate setting 0 with an endpoint, may carry a whole frame in one payload. */
+static uint_fast32_t _max_payload_size(videod_streaming_interface_t const *stm, uint_fast32_t frame_size,
+                                       uint_fast32_t interval_ms)
+{
+  tusb_desc_vs_itf_t const *vs = _get_desc_vs(stm);
+  uint_fast32_t payload_size;
+  if (vs && !vs->std.bAlternateSetting && vs->std.bNumEndpoints) {
+    payload_size = frame_size + 2;
+    if (CFG_TUD_VIDEO_STREAMING_BULK_PAYLOAD_SIZE < payload_size) {
+      payload_size = CFG_TUD_VIDEO_STREAMING_BULK_PAYLOAD_SIZE;
+    }
+  } else {
+    if (!interval_ms) {
+      payload_size = frame_size + 2;
+    } else {
+      payload_size = (frame_size + interval_ms - 1) / interval_ms + 2;
+    }
+    if (CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE < payload_size) {
+      payload_size = CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE;
+    }
+    /* A payload must fit into one (micro)frame of the alternate setting chosen by the host */
+    uint_fast32_t const iso_size = _max_iso_interval_size(stm);
+    if (iso_size && iso_size < payload_size) {
+      payload_size = iso_size;
+    }
+  }
+  return payload_size;
+}
+
 /** Set uniquely determined values to variables that have not been set
  *
  * @param[in,out] param       Target */
@@ -452,9 +625,8 @@ static bool _update_streaming_parameters(videod_streaming_interface_t const *stm
   param->bUsage           = 0;
   param->bBitDepthLuma    = 8;
 
-  void const *end = _end_of_streaming_descriptor(vs);
-  tusb_desc_cs_video_fmt_t const *fmt = _find_desc_format(tu_desc_next(vs), end, fmtnum);
-  TU_ASSERT(fmt != end);
+  tusb_desc_cs_video_fmt_t const *fmt = _get_desc_format(stm, fmtnum);
+  TU_ASSERT(fmt);
 
   switch (fmt->bDescriptorSubType) {
     case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
@@ -474,8 +646,8 @@ static bool _update_streaming_parameters(videod_streaming_interface_t const *stm
     frmnum = 1;
     param->bFrameIndex = 1;
   }
-  tusb_desc_cs_video_frm_t const *frm = _find_desc_frame(tu_desc_next(fmt), end, frmnum);
-  TU_ASSERT(frm != end);
+  tusb_desc_cs_video_frm_t const *frm = _get_desc_frame(stm, fmt, frmnum);
+  TU_ASSERT(frm);
 
   /* Set the parameters determined by the frame  */
   uint_fast32_t frame_size = param->dwMaxVideoFrameSize;
@@ -506,11 +678,7 @@ static bool _update_streaming_parameters(videod_streaming_interface_t const *stm
   }
   uint_fast32_t interval_ms = interval / 10000;
   TU_ASSERT(interval_ms);
-  uint_fast32_t payload_size = (frame_size + interval_ms - 1) / interval_ms + 2;
-  if (CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE < payload_size) {
-    payload_size = CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE;
-  }
-  param->dwMaxPayloadTransferSize = payload_size;
+  param->dwMaxPayloadTransferSize = _max_payload_size(stm, frame_size, interval_ms);
   return true;
 }
 
@@ -555,10 +723,8 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
 
   uint_fast8_t frmnum = param->bFrameIndex;
   if (!frmnum) {
-    tusb_desc_vs_itf_t const *vs = _get_desc_vs(stm);
-    TU_ASSERT(vs);
-    void const *end = _end_of_streaming_descriptor(vs);
-    tusb_desc_cs_video_fmt_t const *fmt = _find_desc_format(tu_desc_next(vs), end, fmtnum);
+    tusb_desc_cs_video_fmt_t const *fmt = _get_desc_format(stm, fmtnum);
+    TU_ASSERT(fmt);
     switch (request) {
       case VIDEO_REQUEST_GET_MAX:
         frmnum = fmt->bNumFrameDescriptors;
@@ -585,7 +751,8 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
     }
     param->bFrameIndex = (uint8_t)frmnum;
     /* Set the parameters determined by the frame */
-    tusb_desc_cs_video_frm_t const *frm = _find_desc_frame(tu_desc_next(fmt), end, frmnum);
+    tusb_desc_cs_video_frm_t const *frm = _get_desc_frame(stm, fmt, frmnum);
+    TU_ASSERT(frm);
     uint_fast32_t frame_size;
     switch (fmt->bDescriptorSubType) {
       case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
@@ -603,11 +770,10 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
   }
 
   if (!param->dwFrameInterval) {
-    tusb_desc_vs_itf_t const *vs = _get_desc_vs(stm);
-    TU_ASSERT(vs);
-    void const *end = _end_of_streaming_descriptor(vs);
-    tusb_desc_cs_video_fmt_t const *fmt = _find_desc_format(tu_desc_next(vs), end, fmtnum);
-    tusb_desc_cs_video_frm_t const *frm = _find_desc_frame(tu_desc_next(fmt), end, frmnum);
+    tusb_desc_cs_video_fmt_t const *fmt = _get_desc_format(stm, fmtnum);
+    TU_ASSERT(fmt);
+    tusb_desc_cs_video_frm_t const *frm = _get_desc_frame(stm, fmt, frmnum);
+    TU_ASSERT(frm);
 
     uint_fast32_t interval, interval_ms;
     switch (request) {
@@ -654,17 +820,7 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
     if (!interval) {
       param->dwMaxPayloadTransferSize = 0;
     } else {
-      uint_fast32_t frame_size = param->dwMaxVideoFrameSize;
-      uint_fast32_t payload_size;
-      if (!interval_ms) {
-        payload_size = frame_size + 2;
-      } else {
-        payload_size = (frame_size + interval_ms - 1) / interval_ms + 2;
-      }
-      if (CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE < payload_size) {
-        payload_size = CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE;
-      }
-      param->dwMaxPayloadTransferSize = payload_size;
+      param->dwMaxPayloadTransferSize = _max_payload_size(stm, param->dwMaxVideoFrameSize, interval_ms);
     }
     return true;
   }
@@ -720,6 +876,7 @@ static bool _open_vc_itf(uint8_t rhport, videod_interface_t *self, uint_fast8_t
 
   /* Advance to the next descriptor after the class-specific VC interface header descriptor. */
   cur += vc->std.bLength + vc->ctl.bLength;
+  _index_vc_entities(self, cur, end);
   TU_LOG_DRV("    bNumEndpoints %d\r\n", vc->std.bNumEndpoints);
   /* Open the notification endpoint if it exist. */
   if (vc->std.bNumEndpoints) {
@@ -736,6 +893,15 @@ static bool _open_vc_itf(uint8_t rhport, videod_interface_t *self, uint_fast8_t
   return true;
 }
 
+/** Restore frame data overwritten by the payload header of the last in-place payload. */
+static void _restore_inplace_payload(videod_streaming_interface_t *stm)
+{
+  if (stm->hdr_inplace) {
+    memcpy(stm->hdr_inplace, stm->hdr_saved, stm->ep_buf[0]);
+    stm->hdr_inplace = NULL;
+  }
+}
+
 static bool _init_vs_configuration(videod_streaming_interface_t *stm) {
   /* initialize streaming settings */
   stm->state = VS_STATE_PROBING;
@@ -766,9 +932,15 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
   }
 
   /* clear transfer management information */
+  _restore_inplace_payload(stm);
   stm->buffer  = NULL;
   stm->bufsize = 0;
   stm->offset  = 0;
+  stm->bulk_mps = 0;
+  stm->zlp     = 0;
+#if CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_SIZE
+  stm->queue_cnt = 0;
+#endif
 
   /* Find a alternate interface */
   uint8_t const *beg = desc + stm->desc.beg;
@@ -790,12 +962,13 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
     uint_fast32_t max_size = stm->max_payload_transfer_size;
     if (altnum) {
       if ((TUSB_XFER_ISOCHRONOUS == ep->bmAttributes.xfer) &&
-          (tu_edpt_packet_size(ep) < max_size)) {
-        /* FS must be less than or equal to max packet size */
+          (tu_edpt_interval_size(ep) < max_size)) {
+        /* Payload must be less than or equal to max packet size x transactions per microframe */
         return false;
       }
     } else {
       TU_VERIFY(TUSB_XFER_BULK == ep->bmAttributes.xfer);
+      if (!i) stm->bulk_mps = tu_edpt_packet_size(ep);
     }
     TU_ASSERT(usbd_edpt_open(rhport, ep));
     stm->desc.ep[i] = (uint16_t) (cur - desc);
@@ -808,25 +981,78 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
   return true;
 }
 
-/** Prepare the next packet payload. */
-static uint_fast16_t _prepare_in_payload(videod_streaming_interface_t *stm)
+/** Prepare the next packet payload.
+ *
+ * @param[out] payload  Start of the payload to be transferred, ep_buf or a position in the frame buffer */
+static uint_fast16_t _prepare_in_payload(videod_streaming_interface_t *stm, uint8_t **payload)
 {
-  uint_fast16_t remaining = stm->bufsize - stm->offset;
+  uint_fast32_t remaining = stm->bufsize - stm->offset;
   uint_fast16_t hdr_len   = stm->ep_buf[0];
-  uint_fast16_t pkt_len   = stm->max_payload_transfer_size;
+  uint_fast32_t pkt_len   = stm->max_payload_transfer_size;
+  bool const    inplace   = stm->inplace && (stm->offset >= hdr_len);
+  if (!inplace && CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE < pkt_len) {
+    /* The payload is assembled in ep_buf */
+    pkt_len = CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE;
+  }
   if (hdr_len + remaining < pkt_len) {
     pkt_len = hdr_len + remaining;
   }
   TU_ASSERT(pkt_len >= hdr_len);
-  uint_fast16_t data_len = pkt_len - hdr_len;
-  memcpy(&stm->ep_buf[hdr_len], stm->buffer + stm->offset, data_len);
-  stm->offset += data_len;
-  remaining -= data_len;
-  if (!remaining) {
-    tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm->ep_buf;
+  uint_fast32_t data_len = pkt_len - hdr_len;
+  if (data_len < remaining) {
+    if (stm->inplace) {
+      /* Keep header of the next payload, which overlaps the tail of this one, word aligned in frame buffer */
+      uint_fast32_t const next_ofs = ((stm->offset + data_len - hdr_len) & ~3u) + hdr_len;
+      if (next_ofs > stm->offset) data_len = next_ofs - stm->offset;
+    }
+    if (stm->bulk_mps && (hdr_len + data_len < stm->max_payload_transfer_size) &&
+        !((hdr_len + data_len) % stm->bulk_mps)) {
+      /* A bulk payload shorter than dwMaxPayloadTransferSize must end with a short packet */
+      data_len -= stm->inplace ? 4 : 1;
+    }
+  }
+
+  if (!inplace) {
+    if (stm->buffer) {
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+      if (stm->convert) {
+        tu_video_convert((video_convert_t) stm->convert, &stm->ep_buf[hdr_len], stm->offset, (uint32_t) data_len,
+                         stm->buffer, stm->width, stm->height);
+      } else
+#endif
+      {
+        memcpy(&stm->ep_buf[hdr_len], stm->buffer + stm->offset, data_len);
+      }
+    } else {
+      /* Ask the application for the data, it may provide less if not ready yet */
+      uint16_t n = 0;
+      if (tud_video_frame_pull_cb) {
+        n = tud_video_frame_pull_cb(stm->index_vc, stm->index_vs, stm->offset, &stm->ep_buf[hdr_len], (uint16_t) data_len);
+      }
+      if (n < data_len) data_len = n;
+    }
+  }
+
+  tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm->ep_buf;
+  if (remaining == data_len) {
     hdr->EndOfFrame = 1;
   }
-  return hdr_len + data_len;
+
+  if (inplace) {
+    /* The preceding bytes were sent with the former payload, borrow them for the header */
+    uint8_t *p = stm->buffer + stm->offset - hdr_len;
+    memcpy(stm->hdr_saved, p, hdr_len);
+    memcpy(p, stm->ep_buf, hdr_len);
+    stm->hdr_inplace = p;
+    *payload = p;
+  } else {
+    *payload = stm->ep_buf;
+  }
+  stm->offset += data_len;
+
+  pkt_len = hdr_len + data_len;
+  stm->zlp = stm->bulk_mps && (pkt_len < stm->max_payload_transfer_size) && !(pkt_len % stm->bulk_mps);
+  return (uint_fast16_t) pkt_len;
 }
 
 /** Handle a standard request to the video control interface. */
@@ -948,7 +1174,7 @@ static int handle_video_ctl_req(uint8_t rhport, uint8_t stage,
       if (!entity_id) {
         return handle_video_ctl_cs_req(rhport, stage, request, ctl_idx);
       } else {
-        TU_VERIFY(_find_desc_entity(_get_desc_vc(&_videod_itf[ctl_idx]), entity_id), VIDEO_ERROR_INVALID_REQUEST);
+        TU_VERIFY(_has_entity(&_videod_itf[ctl_idx], entity_id), VIDEO_ERROR_INVALID_REQUEST);
         return VIDEO_ERROR_NONE;
       }
     }
@@ -1182,15 +1408,44 @@ bool tud_video_n_streaming(uint_fast8_t ctl_idx, uint_fast8_t stm_idx)
   return true;
 }
 
-bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize)
+/** Make the frame current and prepare the payload header for it. */
+static void _start_frame(videod_streaming_interface_t *stm, videod_frame_t const *frame)
+{
+  tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm->ep_buf;
+  hdr->FrameID   ^= 1;
+  hdr->EndOfFrame = 0;
+  stm->buffer     = frame->buffer;
+  stm->bufsize    = frame->bufsize;
+  stm->offset     = 0;
+  stm->inplace    = frame->inplace;
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+  stm->convert    = frame->convert;
+  stm->width      = frame->width;
+  stm->height     = frame->height;
+#endif
+}
+
+static bool _frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, videod_frame_t const *frame)
 {
   TU_ASSERT(ctl_idx < CFG_TUD_VIDEO);
   TU_ASSERT(stm_idx < CFG_TUD_VIDEO_STREAMING);
-  if (!buffer || !bufsize) return false;
+  if (!frame->bufsize) return false;
   videod_streaming_interface_t *stm = _get_instance_streaming(ctl_idx, stm_idx);
-  if (!stm || !stm->desc.ep[0] || stm->buffer) return false;
+  if (!stm || !stm->desc.ep[0]) return false;
   if (stm->state == VS_STATE_PROBING) return false;
 
+  if (stm->bufsize) {
+#if CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_SIZE
+    /* Queue behind the frame in transfer */
+    if (stm->queue_cnt >= CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_SIZE) return false;
+    stm->queue[(stm->queue_rd + stm->queue_cnt) % CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_SIZE] = *frame;
+    stm->queue_cnt++;
+    return true;
+#else
+    return false;
+#endif
+  }
+
   /* Find EP address */
   uint8_t const *desc = _videod_itf[stm->index_vc].beg;
   uint8_t ep_addr = 0;
@@ -1203,18 +1458,54 @@ bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *bu
   if (!ep_addr) return false;
 
   TU_VERIFY( usbd_edpt_claim(0, ep_addr) );
-  /* update the packet header */
-  tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm->ep_buf;
-  hdr->FrameID   ^= 1;
-  hdr->EndOfFrame = 0;
-  /* update the packet data */
-  stm->buffer     = (uint8_t*)buffer;
-  stm->bufsize    = bufsize;
-  uint_fast16_t pkt_len = _prepare_in_payload(stm);
-  TU_ASSERT( usbd_edpt_xfer(0, ep_addr, stm->ep_buf, (uint16_t) pkt_len), 0);
+  _start_frame(stm, frame);
+  uint8_t *payload;
+  uint_fast16_t pkt_len = _prepare_in_payload(stm, &payload);
+  TU_ASSERT( usbd_edpt_xfer(0, ep_addr, payload, (uint16_t) pkt_len), 0);
   return true;
 }
 
+bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize)
+{
+  TU_VERIFY(buffer);
+  videod_frame_t const frame = { .buffer = (uint8_t*) buffer, .bufsize = (uint32_t) bufsize };
+  return _frame_xfer(ctl_idx, stm_idx, &frame);
+}
+
+bool tud_video_n_frame_xfer_inplace(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize)
+{
+  TU_VERIFY(buffer && 0 == ((uintptr_t) buffer & 3u));
+  videod_frame_t const frame = { .buffer = (uint8_t*) buffer, .bufsize = (uint32_t) bufsize, .inplace = 1 };
+  return _frame_xfer(ctl_idx, stm_idx, &frame);
+}
+
+bool tud_video_n_frame_xfer_pull(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, size_t frame_size)
+{
+  videod_frame_t const frame = { .buffer = NULL, .bufsize = (uint32_t) frame_size };
+  return _frame_xfer(ctl_idx, stm_idx, &frame);
+}
+
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+bool tud_video_n_frame_xfer_convert(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void const *src,
+                                    video_convert_t convert, uint16_t width, uint16_t height)
+{
+  TU_VERIFY(src && convert != VIDEO_CONVERT_NONE && width >= 2 && height && !(width & 1));
+  if (convert == VIDEO_CONVERT_RGB565_TO_NV12 || convert == VIDEO_CONVERT_RGB888_TO_NV12) {
+    TU_VERIFY(!(height & 1));
+  } else if (convert >= VIDEO_CONVERT_BAYER_RGGB_TO_YUY2) {
+    TU_VERIFY(height >= 2);
+  }
+  videod_frame_t const frame = {
+    .buffer  = (uint8_t*) (uintptr_t) src,
+    .bufsize = tu_video_convert_frame_size(convert, width, height),
+    .convert = (uint8_t) convert,
+    .width   = width,
+    .height  = height
+  };
+  return _frame_xfer(ctl_idx, stm_idx, &frame);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
@@ -1283,6 +1574,7 @@ uint16_t videod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uin
     cur = _next_desc_itf(cur, end);
     stm->desc.end = (uint16_t) ((uintptr_t)cur - (uintptr_t)itf_desc);
     stm->state = VS_STATE_PROBING;
+    _index_vs_formats(stm);
     if (0 == stm_idx && 1 == bInCollection) {
       /* If there is only one streaming interface and no alternate settings,
        * host may not issue set_interface so open the streaming interface here. */
@@ -1355,18 +1647,41 @@ bool videod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
   }
 
   TU_ASSERT(itf < CFG_TUD_VIDEO_STREAMING);
-  if (stm->offset < stm->bufsize) {
-    /* Claim the endpoint */
+  _restore_inplace_payload(stm);
+  if (stm->zlp) {
+    /* Terminate the bulk payload which ended on a packet boundary */
+    stm->zlp = 0;
     TU_VERIFY( usbd_edpt_claim(rhport, ep_addr), 0);
-    uint_fast16_t pkt_len = _prepare_in_payload(stm);
-    TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, stm->ep_buf, (uint16_t) pkt_len), 0);
-  } else {
+    TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, NULL, 0), 0);
+    return true;
+  }
+
+  bool complete = false;
+  if (stm->offset >= stm->bufsize) {
+    complete = true;
     stm->buffer  = NULL;
     stm->bufsize = 0;
     stm->offset  = 0;
-    if (tud_video_frame_xfer_complete_cb) {
-      tud_video_frame_xfer_complete_cb(stm->index_vc, stm->index_vs);
+#if CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_SIZE
+    /* Continue with the next frame right away */
+    if (stm->queue_cnt) {
+      _start_frame(stm, &stm->queue[stm->queue_rd]);
+      stm->queue_rd = (uint8_t) ((stm->queue_rd + 1) % CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_SIZE);
+      stm->queue_cnt--;
     }
+#endif
+  }
+
+  if (stm->bufsize) {
+    /* Claim the endpoint */
+    TU_VERIFY( usbd_edpt_claim(rhport, ep_addr), 0);
+    uint8_t *payload;
+    uint_fast16_t pkt_len = _prepare_in_payload(stm, &payload);
+    TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, payload, (uint16_t) pkt_len), 0);
+  }
+
+  if (complete && tud_video_frame_xfer_complete_cb) {
+    tud_video_frame_xfer_complete_cb(stm->index_vc, stm->index_vs);
   }
   return true;
 }
@@ -30,11 +30,45 @@
 
 #include "common/tusb_common.h"
 #include "video.h"
+#include "video_convert.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// Upper limit of dwMaxPayloadTransferSize for bulk streaming, up to 65535. Payloads larger than
+// CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE are sent directly from the frame buffer by tud_video_n_frame_xfer_inplace(), so a
+// frame takes a few transfers instead of one per CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE bytes.
+#ifndef CFG_TUD_VIDEO_STREAMING_BULK_PAYLOAD_SIZE
+#define CFG_TUD_VIDEO_STREAMING_BULK_PAYLOAD_SIZE  CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE
+#endif
+
+// Number of format and frame descriptors per streaming interface which are indexed at open, so that probe and commit
+// controls find them without walking the descriptors. Descriptors beyond these are still found by walking.
+#ifndef CFG_TUD_VIDEO_STREAMING_FORMAT_MAX
+#define CFG_TUD_VIDEO_STREAMING_FORMAT_MAX         4
+#endif
+
+#ifndef CFG_TUD_VIDEO_STREAMING_FRAME_MAX
+#define CFG_TUD_VIDEO_STREAMING_FRAME_MAX          16
+#endif
+
+// Number of frames which can be queued behind the frame in transfer. A queued frame is started as soon as the former
+// one is sent, without waiting for the application.
+#ifndef CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_SIZE
+#define CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_SIZE   0
+#endif
+
+// Enable tud_video_n_frame_xfer_convert(), which converts RGB or Bayer frames to YUY2 or NV12 while each payload is
+// prepared
+#ifndef CFG_TUD_VIDEO_STREAMING_CONVERT
+#define CFG_TUD_VIDEO_STREAMING_CONVERT            0
+#endif
+
 //--------------------------------------------------------------------+
 // Application API (Multiple Ports)
 // CFG_TUD_VIDEO > 1
@@ -47,6 +81,8 @@ extern "C" {
 bool tud_video_n_streaming(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
 
 /** Transfer a frame
+ *
+ * If a frame is in transfer, the frame is queued when CFG_TUD_VIDEO_STREAMING_FRAME_QUEUE_SIZE allows it.
  *
  * @param[in] ctl_idx    Destination control interface index
  * @param[in] stm_idx    Destination streaming interface index
@@ -54,6 +90,45 @@ bool tud_video_n_streaming(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
  * @param[in] bufsize    Byte size of the frame buffer */
 bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize);
 
+/** Transfer a frame without copying it into the endpoint buffer
+ *
+ * Payloads are sent directly from the frame buffer. The payload header is temporarily written over the bytes
+ * just sent with the former payload and restored afterwards, so only the first payload of a frame is copied.
+ * Payloads may be a few bytes shorter than dwMaxPayloadTransferSize to keep transfers word aligned.
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index
+ * @param[in] buffer     Frame buffer. Must be word aligned, writable and accessible by the USB controller.
+ *                       The caller must not use this buffer until the operation is completed.
+ * @param[in] bufsize    Byte size of the frame buffer */
+bool tud_video_n_frame_xfer_inplace(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize);
+
+/** Transfer a frame whose data is pulled from the application
+ *
+ * No frame buffer is needed: tud_video_frame_pull_cb() is invoked for the data of each payload, e.g. while the sensor
+ * delivers it line by line. Queued like tud_video_n_frame_xfer().
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index
+ * @param[in] frame_size Byte size of the frame */
+bool tud_video_n_frame_xfer_pull(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, size_t frame_size);
+
+#if CFG_TUD_VIDEO_STREAMING_CONVERT
+/** Transfer a frame converted to the format of the stream
+ *
+ * Each payload is converted from the source frame directly into the endpoint buffer, see video_convert.h. The
+ * converted frame must match the committed format and frame size. Queued like tud_video_n_frame_xfer().
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index
+ * @param[in] src        Source frame. The caller must not use this buffer until the operation is completed.
+ * @param[in] convert    Source and converted format
+ * @param[in] width      Frame width in pixels, must be even
+ * @param[in] height     Frame height in pixels, must be even for NV12 */
+bool tud_video_n_frame_xfer_convert(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void const *src,
+                                    video_convert_t convert, uint16_t width, uint16_t height);
+#endif
+
 /*------------- Optional callbacks -------------*/
 /** Invoked when compeletion of a frame transfer
  *
@@ -61,6 +136,17 @@ bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *bu
  * @param[in] stm_idx    Destination streaming interface index */
 TU_ATTR_WEAK void tud_video_frame_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
 
+/** Invoked to get data of a frame started by tud_video_n_frame_xfer_pull()
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index
+ * @param[in] offset     Offset of the requested data in the frame
+ * @param[out] buffer    Buffer to copy the data to
+ * @param[in] bufsize    Number of bytes requested
+ * @return Number of bytes copied. Less than bufsize if not available yet, the payload is then sent shorter */
+TU_ATTR_WEAK uint16_t tud_video_frame_pull_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, uint32_t offset,
+                                              void *buffer, uint16_t bufsize);
+
 //--------------------------------------------------------------------+
 // Application Callback API (weak is optional)
 //--------------------------------------------------------------------+
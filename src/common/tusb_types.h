@@ -496,6 +496,16 @@ TU_ATTR_ALWAYS_INLINE static inline uint16_t tu_edpt_packet_size(tusb_desc_endpo
   return tu_le16toh(desc_ep->wMaxPacketSize) & TU_GENMASK(10, 0);
 }
 
+// Get number of transactions per microframe (1-3) of high-bandwidth endpoint, encoded in bits 12..11 of wMaxPacketSize
+TU_ATTR_ALWAYS_INLINE static inline uint8_t tu_edpt_mult(tusb_desc_endpoint_t const* desc_ep) {
+  return (uint8_t) (((tu_le16toh(desc_ep->wMaxPacketSize) >> 11) & 0x03u) + 1u);
+}
+
+// Get max bytes per (micro)frame i.e packet size x number of transactions, up to 3072 for high-bandwidth endpoint
+TU_ATTR_ALWAYS_INLINE static inline uint16_t tu_edpt_interval_size(tusb_desc_endpoint_t const* desc_ep) {
+  return (uint16_t) (tu_edpt_packet_size(desc_ep) * tu_edpt_mult(desc_ep));
+}
+
 #if CFG_TUSB_DEBUG
 TU_ATTR_ALWAYS_INLINE static inline const char *tu_edpt_dir_str(tusb_dir_t dir) {
   tu_static const char *str[] = {"out", "in"};
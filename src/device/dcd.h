@@ -187,6 +187,10 @@ TU_ATTR_WEAK bool dcd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t l
 // Configure and enable an ISO endpoint according to descriptor
 TU_ATTR_WEAK bool dcd_edpt_iso_activate(uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc);
 
+// Get max number of transactions per microframe (1-3) supported by a highspeed ISO endpoint.
+// Not implemented means high-bandwidth endpoints are not supported i.e 1 transaction per microframe.
+TU_ATTR_WEAK uint8_t dcd_edpt_iso_mult_max(uint8_t rhport, uint8_t ep_addr);
+
 //--------------------------------------------------------------------+
 // Event API (implemented by stack)
 //--------------------------------------------------------------------+
@@ -71,12 +71,17 @@ typedef struct {
   volatile uint8_t cfg_num; // current active configuration (0x00 is not configured)
   uint8_t speed;
   volatile uint8_t setup_count;
+  volatile uint8_t sof_consumer; // bitmap of sof_consumer_t that need SOF interrupt
 
   uint8_t itf2drv[CFG_TUD_INTERFACE_MAX];   // map interface number to driver (0xff is invalid)
   uint8_t ep2drv[CFG_TUD_ENDPPOINT_MAX][2]; // map endpoint to driver ( 0xff is invalid ), can use only 4-bit each
 
   tu_edpt_state_t ep_status[CFG_TUD_ENDPPOINT_MAX][2];
 
+#if CFG_TUD_ISO_PACKETS_PER_XFER > 1
+  usbd_iso_xfer_t* volatile iso_xfer[CFG_TUD_ENDPPOINT_MAX][2]; // multi-packet ISO transfers in progress
+#endif
+
 }usbd_device_t;
 
 tu_static usbd_device_t _usbd_dev;
@@ -220,7 +225,11 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
       .open             = netd_open,
       .control_xfer_cb  = netd_control_xfer_cb,
       .xfer_cb          = netd_xfer_cb,
-      .sof                  = NULL,
+      #if CFG_TUD_NCM && CFG_TUD_NCM_TX_AGGREGATION_US
+      .sof              = netd_sof_isr,
+      #else
+      .sof              = NULL,
+      #endif
     },
     #endif
 
@@ -423,6 +432,9 @@ static void configuration_reset(uint8_t rhport) {
     driver->reset(rhport);
   }
 
+  // drivers are reset, none of them needs SOF anymore
+  if (_usbd_dev.sof_consumer) dcd_sof_enable(rhport, false);
+
   tu_varclr(&_usbd_dev);
   memset(_usbd_dev.itf2drv, DRVID_INVALID, sizeof(_usbd_dev.itf2drv)); // invalid mapping
   memset(_usbd_dev.ep2drv, DRVID_INVALID, sizeof(_usbd_dev.ep2drv)); // invalid mapping
@@ -1018,6 +1030,17 @@ static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const
 //--------------------------------------------------------------------+
 // DCD Event Handler
 //--------------------------------------------------------------------+
+#if CFG_TUD_ISO_PACKETS_PER_XFER > 1
+// Queue current packet of a multi-packet ISO transfer
+static bool iso_xfer_queue(uint8_t rhport, uint8_t ep_addr, usbd_iso_xfer_t* xfer) {
+  uint16_t len = xfer->packet_len[xfer->index];
+  if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN) {
+    len = tu_min16(len, tu_fifo_count(xfer->ff));
+  }
+  return dcd_edpt_xfer_fifo(rhport, ep_addr, xfer->ff, len);
+}
+#endif
+
 TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr) {
   bool send = false;
   switch (event->event_id) {
@@ -1074,6 +1097,34 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
       send = true;
       break;
 
+  #if CFG_TUD_ISO_PACKETS_PER_XFER > 1
+    case DCD_EVENT_XFER_COMPLETE: {
+      uint8_t const ep_addr = event->xfer_complete.ep_addr;
+      usbd_iso_xfer_t* iso_xfer = _usbd_dev.iso_xfer[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+
+      if (!iso_xfer) {
+        send = true;
+        break;
+      }
+
+      iso_xfer->xferred += event->xfer_complete.len;
+      iso_xfer->index++;
+
+      // queue next packet right away, usbd task is only notified after the last one
+      if (event->xfer_complete.result == XFER_RESULT_SUCCESS && iso_xfer->index < iso_xfer->n_packets &&
+          iso_xfer_queue(event->rhport, ep_addr, iso_xfer)) {
+        break;
+      }
+
+      _usbd_dev.iso_xfer[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)] = NULL;
+
+      dcd_event_t event_total = *event;
+      event_total.xfer_complete.len = iso_xfer->xferred;
+      queue_event(&event_total, in_isr);
+      break;
+    }
+  #endif
+
     default:
       send = true;
       break;
@@ -1145,6 +1196,12 @@ bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
   TU_ASSERT(tu_edpt_number(desc_ep->bEndpointAddress) < CFG_TUD_ENDPPOINT_MAX);
   TU_ASSERT(tu_edpt_validate(desc_ep, (tusb_speed_t) _usbd_dev.speed));
 
+  // high-bandwidth is only supported for ISO endpoints, and if DCD is capable of it
+  if (tu_edpt_mult(desc_ep) > 1) {
+    TU_ASSERT(desc_ep->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS);
+    TU_ASSERT(tu_edpt_mult(desc_ep) <= usbd_edpt_iso_mult_max(rhport, desc_ep->bEndpointAddress));
+  }
+
   return dcd_edpt_open(rhport, desc_ep);
 }
 
@@ -1233,6 +1290,41 @@ bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_
   }
 }
 
+#if CFG_TUD_ISO_PACKETS_PER_XFER > 1
+bool usbd_edpt_iso_xfer_fifo_n(uint8_t rhport, uint8_t ep_addr, usbd_iso_xfer_t* xfer) {
+  rhport = _usbd_rhport;
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+
+  TU_ASSERT(dcd_edpt_xfer_fifo);
+  TU_ASSERT(xfer->n_packets > 0 && xfer->n_packets <= CFG_TUD_ISO_PACKETS_PER_XFER);
+  TU_LOG_USBD("  Queue ISO EP %02X with %u packets ... ", ep_addr, xfer->n_packets);
+
+  // Attempt to transfer on a busy endpoint, sound like an race condition !
+  TU_ASSERT(_usbd_dev.ep_status[epnum][dir].busy == 0);
+
+  // Set busy and transfer first since the first packet can be complete before iso_xfer_queue() could return
+  _usbd_dev.ep_status[epnum][dir].busy = 1;
+  xfer->index = 0;
+  xfer->xferred = 0;
+  _usbd_dev.iso_xfer[epnum][dir] = xfer;
+
+  if (iso_xfer_queue(rhport, ep_addr, xfer)) {
+    TU_LOG_USBD("OK\r\n");
+    return true;
+  } else {
+    // DCD error, mark endpoint as ready to allow next transfer
+    _usbd_dev.iso_xfer[epnum][dir] = NULL;
+    _usbd_dev.ep_status[epnum][dir].busy = 0;
+    _usbd_dev.ep_status[epnum][dir].claimed = 0;
+    TU_LOG_USBD("failed\r\n");
+    TU_BREAKPOINT();
+    return false;
+  }
+}
+#endif
+
 bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr) {
   (void) rhport;
 
@@ -1295,6 +1387,9 @@ void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr) {
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
   dcd_edpt_close(rhport, ep_addr);
+#if CFG_TUD_ISO_PACKETS_PER_XFER > 1
+  _usbd_dev.iso_xfer[epnum][dir] = NULL;
+#endif
   _usbd_dev.ep_status[epnum][dir].stalled = 0;
   _usbd_dev.ep_status[epnum][dir].busy = 0;
   _usbd_dev.ep_status[epnum][dir].claimed = 0;
@@ -1302,12 +1397,20 @@ void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr) {
   return;
 }
 
-void usbd_sof_enable(uint8_t rhport, bool en) {
+void usbd_sof_enable(uint8_t rhport, sof_consumer_t consumer, bool en) {
   rhport = _usbd_rhport;
 
-  // TODO: Check needed if all drivers including the user sof_cb does not need an active SOF ISR any more.
-  // Only if all drivers switched off SOF calls the SOF interrupt may be disabled
-  dcd_sof_enable(rhport, en);
+  // Keep track of drivers that need SOF: interrupt is only disabled when none of them does anymore
+  uint8_t const consumer_old = _usbd_dev.sof_consumer;
+  if (en) {
+    _usbd_dev.sof_consumer = (uint8_t) (consumer_old | TU_BIT(consumer));
+  } else {
+    _usbd_dev.sof_consumer = (uint8_t) (consumer_old & ~TU_BIT(consumer));
+  }
+
+  if (!_usbd_dev.sof_consumer != !consumer_old) {
+    dcd_sof_enable(rhport, _usbd_dev.sof_consumer != 0);
+  }
 }
 
 bool usbd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet_size) {
@@ -1319,6 +1422,16 @@ bool usbd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packe
   return dcd_edpt_iso_alloc(rhport, ep_addr, largest_packet_size);
 }
 
+uint8_t usbd_edpt_iso_mult_max(uint8_t rhport, uint8_t ep_addr) {
+  rhport = _usbd_rhport;
+
+  if (_usbd_dev.speed != TUSB_SPEED_HIGH || !dcd_edpt_iso_mult_max) {
+    return 1;
+  }
+
+  return tu_min8(dcd_edpt_iso_mult_max(rhport, ep_addr), 3);
+}
+
 bool usbd_edpt_iso_activate(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
   rhport = _usbd_rhport;
 
@@ -1328,7 +1441,11 @@ bool usbd_edpt_iso_activate(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep)
   TU_ASSERT(dcd_edpt_iso_activate);
   TU_ASSERT(epnum < CFG_TUD_ENDPPOINT_MAX);
   TU_ASSERT(tu_edpt_validate(desc_ep, (tusb_speed_t) _usbd_dev.speed));
+  TU_ASSERT(tu_edpt_mult(desc_ep) <= usbd_edpt_iso_mult_max(rhport, desc_ep->bEndpointAddress));
 
+#if CFG_TUD_ISO_PACKETS_PER_XFER > 1
+  _usbd_dev.iso_xfer[epnum][dir] = NULL;
+#endif
   _usbd_dev.ep_status[epnum][dir].stalled = 0;
   _usbd_dev.ep_status[epnum][dir].busy = 0;
   _usbd_dev.ep_status[epnum][dir].claimed = 0;
@@ -78,6 +78,22 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
 // Submit a usb ISO transfer by use of a FIFO (ring buffer) - all bytes in FIFO get transmitted
 bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes);
 
+#if CFG_TUD_ISO_PACKETS_PER_XFER > 1
+// Isochronous transfer over consecutive service intervals, owned by class driver until it completes
+typedef struct {
+  tu_fifo_t* ff;
+  uint16_t packet_len[CFG_TUD_ISO_PACKETS_PER_XFER]; // max bytes per packet, IN packet is cut to FIFO count when queued
+  uint8_t  n_packets;
+
+  // managed by usbd
+  uint8_t  index;
+  uint32_t xferred;
+} usbd_iso_xfer_t;
+
+// Submit n_packets ISO packets by use of a FIFO. Transfer complete is reported once with total bytes of all packets
+bool usbd_edpt_iso_xfer_fifo_n(uint8_t rhport, uint8_t ep_addr, usbd_iso_xfer_t* xfer);
+#endif
+
 // Claim an endpoint before submitting a transfer.
 // If caller does not make any transfer, it must release endpoint for others.
 bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr);
@@ -98,8 +114,12 @@ void usbd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr);
 bool usbd_edpt_stalled(uint8_t rhport, uint8_t ep_addr);
 
 // Allocate packet buffer used by ISO endpoints
+// For high-bandwidth endpoint largest_packet_size is the size of all transactions in a microframe (up to 3072)
 bool usbd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet_size);
 
+// Get max number of transactions per microframe (1-3) an ISO endpoint supports at current speed
+uint8_t usbd_edpt_iso_mult_max(uint8_t rhport, uint8_t ep_addr);
+
 // Configure and enable an ISO endpoint according to descriptor
 bool usbd_edpt_iso_activate(uint8_t rhport,  tusb_desc_endpoint_t const * p_endpoint_desc);
 
@@ -109,8 +129,14 @@ bool usbd_edpt_ready(uint8_t rhport, uint8_t ep_addr) {
   return !usbd_edpt_busy(rhport, ep_addr) && !usbd_edpt_stalled(rhport, ep_addr);
 }
 
-// Enable SOF interrupt
-void usbd_sof_enable(uint8_t rhport, bool en);
+// Drivers using SOF interrupt
+typedef enum {
+  SOF_CONSUMER_AUDIO = 0,
+  SOF_CONSUMER_NCM,
+} sof_consumer_t;
+
+// Enable/disable SOF interrupt for a consumer, interrupt stays enabled while any consumer needs it
+void usbd_sof_enable(uint8_t rhport, sof_consumer_t consumer, bool en);
 
 /*------------------------------------------------------------------*/
 /* Helper
@@ -172,7 +172,13 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr);
 // Open an endpoint
 bool hcd_edpt_open(uint8_t rhport, uint8_t daddr, tusb_desc_endpoint_t const * ep_desc);
 
+// Close an endpoint that has no pending transfer, e.g isochronous endpoint of an alternate setting (optional).
+bool hcd_edpt_close(uint8_t rhport, uint8_t daddr, uint8_t ep_addr);
+
 // Submit a transfer, when complete hcd_event_xfer_complete() must be invoked
+// Isochronous transfer (if supported by HCD) is a single packet of up to wMaxPacketSize, sent/received in the next
+// service interval of the endpoint. It is never retried and completes with XFER_RESULT_SUCCESS and actual length
+// (possibly 0), or XFER_RESULT_FAILED e.g on CRC error or missed interval.
 bool hcd_edpt_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t * buffer, uint16_t buflen);
 
 // Abort a queued transfer. Note: it can only abort transfer that has not been started
@@ -52,6 +52,13 @@ TU_ATTR_WEAK bool hcd_deinit(uint8_t rhport) {
   return false;
 }
 
+TU_ATTR_WEAK bool hcd_edpt_close(uint8_t rhport, uint8_t daddr, uint8_t ep_addr) {
+  (void) rhport;
+  (void) daddr;
+  (void) ep_addr;
+  return false;
+}
+
 TU_ATTR_WEAK void tuh_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_isr) {
   (void) rhport;
   (void) eventid;
@@ -154,6 +161,43 @@ static usbh_class_driver_t const usbh_class_drivers[] = {
     },
     #endif
 
+    #if CFG_TUH_NCM
+    {
+        .name       = DRIVER_NAME("NCM"),
+        .init       = ncmh_init,
+        .deinit     = ncmh_deinit,
+        .open       = ncmh_open,
+        .set_config = ncmh_set_config,
+        .xfer_cb    = ncmh_xfer_cb,
+        .close      = ncmh_close
+    },
+    #endif
+
+    #if CFG_TUH_AUDIO
+    {
+        .name       = DRIVER_NAME("AUDIO"),
+        .init       = audioh_init,
+        .deinit     = audioh_deinit,
+        .open       = audioh_open,
+        .set_config = audioh_set_config,
+        .xfer_cb    = audioh_xfer_cb,
+        .close      = audioh_close
+    },
+    #endif
+
+    // after audio driver, which leaves functions without audio streaming to this driver
+    #if CFG_TUH_MIDI
+    {
+        .name       = DRIVER_NAME("MIDI"),
+        .init       = midih_init,
+        .deinit     = midih_deinit,
+        .open       = midih_open,
+        .set_config = midih_set_config,
+        .xfer_cb    = midih_xfer_cb,
+        .close      = midih_close
+    },
+    #endif
+
     #if CFG_TUH_HID
     {
         .name       = DRIVER_NAME("HID"),
@@ -924,6 +968,18 @@ bool tuh_edpt_open(uint8_t dev_addr, tusb_desc_endpoint_t const* desc_ep) {
   return hcd_edpt_open(usbh_get_rhport(dev_addr), dev_addr, desc_ep);
 }
 
+bool tuh_edpt_close(uint8_t dev_addr, uint8_t ep_addr) {
+  usbh_device_t* dev = get_device(dev_addr);
+  TU_VERIFY(dev);
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+  TU_VERIFY(epnum && !dev->ep_status[epnum][dir].busy);
+
+  dev->ep_status[epnum][dir].claimed = 0;
+  return hcd_edpt_close(dev->rhport, dev_addr, ep_addr);
+}
+
 bool usbh_edpt_busy(uint8_t dev_addr, uint8_t ep_addr) {
   usbh_device_t* dev = get_device(dev_addr);
   TU_VERIFY(dev);
@@ -1640,6 +1696,33 @@ static bool _parse_configuration_descriptor(uint8_t dev_addr, tusb_desc_configur
     TU_ASSERT( TUSB_DESC_INTERFACE == tu_desc_type(p_desc) );
     tusb_desc_interface_t const* desc_itf = (tusb_desc_interface_t const*) p_desc;
 
+#if CFG_TUH_AUDIO
+    // UAC1 function does not have IAD, its AudioControl header lists the streaming interfaces of the collection.
+    // Only AudioStreaming interfaces are associated, MIDIStreaming interface of the collection is left for MIDI driver
+    if (1                              == assoc_itf_count              &&
+        TUSB_CLASS_AUDIO               == desc_itf->bInterfaceClass    &&
+        AUDIO_SUBCLASS_CONTROL         == desc_itf->bInterfaceSubClass &&
+        AUDIO_FUNC_PROTOCOL_CODE_UNDEF == desc_itf->bInterfaceProtocol) {
+      uint8_t const* p_header = tu_desc_next(desc_itf);
+      if (p_header < desc_end && TUSB_DESC_CS_INTERFACE == tu_desc_type(p_header) &&
+          AUDIO_CS_AC_INTERFACE_HEADER == p_header[2] && tu_desc_len(p_header) >= 8) {
+        uint8_t const in_collection = p_header[7];
+        uint8_t itf_num = desc_itf->bInterfaceNumber;
+
+        for (uint8_t const* p = tu_desc_next(p_header); p < desc_end && assoc_itf_count <= in_collection; p = tu_desc_next(p)) {
+          if (TUSB_DESC_INTERFACE != tu_desc_type(p)) continue;
+
+          tusb_desc_interface_t const* desc_as = (tusb_desc_interface_t const*) p;
+          if (itf_num == desc_as->bInterfaceNumber) continue; // alternate setting
+
+          if (TUSB_CLASS_AUDIO != desc_as->bInterfaceClass || AUDIO_SUBCLASS_STREAMING != desc_as->bInterfaceSubClass) break;
+          itf_num = desc_as->bInterfaceNumber;
+          assoc_itf_count++;
+        }
+      }
+    }
+#endif
+
 #if CFG_TUH_MIDI
     // MIDI has 2 interfaces (Audio Control v1 + MIDIStreaming) but does not have IAD
     // manually force associated count = 2
@@ -1661,6 +1744,16 @@ static bool _parse_configuration_descriptor(uint8_t dev_addr, tusb_desc_configur
     }
 #endif
 
+#if CFG_TUH_NCM
+    // Same for ECM/NCM adapters without IAD: communication and data interface are one function
+    if (1              == assoc_itf_count           &&
+        TUSB_CLASS_CDC == desc_itf->bInterfaceClass &&
+        (CDC_COMM_SUBCLASS_ETHERNET_CONTROL_MODEL == desc_itf->bInterfaceSubClass ||
+         CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL  == desc_itf->bInterfaceSubClass)) {
+      assoc_itf_count = 2;
+    }
+#endif
+
     uint16_t const drv_len = tu_desc_get_interface_total_len(desc_itf, assoc_itf_count, (uint16_t) (desc_end-p_desc));
     TU_ASSERT(drv_len >= sizeof(tusb_desc_interface_t));
 
@@ -30,6 +30,7 @@
 #include "osal/osal.h"
 #include "common/tusb_fifo.h"
 #include "common/tusb_private.h"
+#include "host/usbh.h"
 
 #ifdef __cplusplus
  extern "C" {
@@ -180,6 +180,7 @@ typedef struct {
     uint8_t data_toggle   : 1;
     uint8_t xfer_pending  : 1;
     uint8_t xfer_complete : 1;
+    uint8_t iso_due       : 1; // isochronous transfer can go out in current frame
   };
 
   struct TU_ATTR_PACKED {
@@ -393,13 +394,18 @@ static void free_ep(uint8_t daddr) {
   }
 }
 
+// isochronous transfer is only started once per frame, from the FRAME IRQ
+TU_ATTR_ALWAYS_INLINE static inline bool ep_xfer_ready(max3421_ep_t const* ep) {
+  return ep->xfer_pending && ep->packet_size && (!ep->is_iso || ep->iso_due);
+}
+
 static max3421_ep_t * find_next_pending_ep(max3421_ep_t * cur_ep) {
   size_t const idx = (size_t) (cur_ep - _hcd_data.ep);
 
   // starting from next endpoint
   for (size_t i = idx + 1; i < CFG_TUH_MAX3421_ENDPOINT_TOTAL; i++) {
     max3421_ep_t* ep = &_hcd_data.ep[i];
-    if (ep->xfer_pending && ep->packet_size) {
+    if (ep_xfer_ready(ep)) {
 //      TU_LOG3("next pending i = %u\r\n", i);
       return ep;
     }
@@ -408,7 +414,7 @@ static max3421_ep_t * find_next_pending_ep(max3421_ep_t * cur_ep) {
   // wrap around including current endpoint
   for (size_t i = 0; i <= idx; i++) {
     max3421_ep_t* ep = &_hcd_data.ep[i];
-    if (ep->xfer_pending && ep->packet_size) {
+    if (ep_xfer_ready(ep)) {
 //      TU_LOG3("next pending i = %u\r\n", i);
       return ep;
     }
@@ -582,6 +588,17 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t daddr, tusb_desc_endpoint_t const * e
   return true;
 }
 
+// Close an endpoint that has no pending transfer
+bool hcd_edpt_close(uint8_t rhport, uint8_t daddr, uint8_t ep_addr) {
+  (void) rhport;
+
+  max3421_ep_t* ep = find_ep_not_addr0(daddr, tu_edpt_number(ep_addr), tu_edpt_dir(ep_addr));
+  TU_VERIFY(ep && tu_edpt_number(ep_addr) && !ep->xfer_pending);
+
+  tu_memclr(ep, sizeof(max3421_ep_t));
+  return true;
+}
+
 void xact_out(uint8_t rhport, max3421_ep_t *ep, bool switch_ep, bool in_isr) {
   // Page 12: Programming BULK-OUT Transfers
   // TODO double buffered
@@ -658,6 +675,7 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t * buf
   ep->total_len = buflen;
   ep->xferred_len = 0;
   ep->xfer_complete = 0;
+  ep->iso_due = 0;
   ep->xfer_pending = 1;
 
   if ( ep_num == 0 ) {
@@ -665,6 +683,11 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t * buf
     ep->data_toggle = 1;
   }
 
+  // isochronous is started in next frame by FRAME IRQ
+  if (ep->is_iso) {
+    return true;
+  }
+
   // carry out transfer if not busy
   if ( !atomic_flag_test_and_set(&_hcd_data.busy) ) {
     xact_inout(rhport, ep, true, false);
@@ -777,6 +800,7 @@ static void xfer_complete_isr(uint8_t rhport, max3421_ep_t *ep, xfer_result_t re
   }
 
   ep->xfer_pending = 0;
+  ep->iso_due = 0;
   hcd_event_xfer_complete(ep->daddr, ep_addr, ep->xferred_len, result, in_isr);
 
   // Find next pending endpoint
@@ -800,6 +824,15 @@ static void handle_xfer_done(uint8_t rhport, bool in_isr) {
   max3421_ep_t *ep = find_opened_ep(_hcd_data.peraddr, ep_num, ep_dir);
   TU_VERIFY(ep, );
 
+  if (ep->is_iso && hresult != HRSL_BAD_REQ) {
+    // isochronous: single packet per frame without handshake, never retried
+    if (hresult == HRSL_SUCCESS && !ep_dir) {
+      ep->xferred_len += _hcd_data.sndbc;
+    }
+    xfer_complete_isr(rhport, ep, (hresult == HRSL_SUCCESS) ? XFER_RESULT_SUCCESS : XFER_RESULT_FAILED, hrsl, in_isr);
+    return;
+  }
+
   xfer_result_t xfer_result;
   switch(hresult) {
     case HRSL_SUCCESS:
@@ -882,6 +915,27 @@ static void handle_xfer_done(uint8_t rhport, bool in_isr) {
   }
 }
 
+// Pending isochronous transfers are due in this frame, start one if bus is idle
+static void handle_frame_irq(uint8_t rhport, bool in_isr) {
+  bool iso_due = false;
+  for (size_t i = 1; i < CFG_TUH_MAX3421_ENDPOINT_TOTAL; i++) {
+    max3421_ep_t* ep = &_hcd_data.ep[i];
+    if (ep->is_iso && ep->xfer_pending) {
+      ep->iso_due = 1;
+      iso_due = true;
+    }
+  }
+
+  if (iso_due && !atomic_flag_test_and_set(&_hcd_data.busy)) {
+    max3421_ep_t* next_ep = find_next_pending_ep(&_hcd_data.ep[CFG_TUH_MAX3421_ENDPOINT_TOTAL - 1]);
+    if (next_ep) {
+      xact_inout(rhport, next_ep, true, in_isr);
+    } else {
+      atomic_flag_clear(&_hcd_data.busy);
+    }
+  }
+}
+
 #if CFG_TUSB_DEBUG >= 3
 void print_hirq(uint8_t hirq) {
   TU_LOG3_HEX(hirq);
@@ -909,6 +963,7 @@ void hcd_int_handler(uint8_t rhport, bool in_isr) {
 
   if (hirq & HIRQ_FRAME_IRQ) {
     _hcd_data.frame_count++;
+    handle_frame_irq(rhport, in_isr);
   }
 
   if (hirq & HIRQ_CONDET_IRQ) {
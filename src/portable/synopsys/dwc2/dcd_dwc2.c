@@ -87,6 +87,7 @@ typedef struct {
   uint16_t total_len;
   uint16_t max_size;
   uint8_t interval;
+  uint8_t mult; // transactions per (micro)frame of high-bandwidth endpoint
 } xfer_ctl_t;
 
 static xfer_ctl_t xfer_status[DWC2_EP_MAX][2];
@@ -192,6 +193,7 @@ static void edpt_activate(uint8_t rhport, tusb_desc_endpoint_t const * p_endpoin
   xfer_ctl_t* xfer = XFER_CTL_BASE(epnum, dir);
   xfer->max_size = tu_edpt_packet_size(p_endpoint_desc);
   xfer->interval = p_endpoint_desc->bInterval;
+  xfer->mult = tu_edpt_mult(p_endpoint_desc);
 
   // USBAEP, EPTYP, SD0PID_SEVNFRM, MPSIZ are the same for IN and OUT endpoints.
   uint32_t const dxepctl = (1 << DOEPCTL_USBAEP_Pos) |
@@ -380,14 +382,23 @@ static void edpt_schedule_packets(uint8_t rhport, uint8_t const epnum, uint8_t c
   if (dir == TUSB_DIR_IN) {
     dwc2_epin_t* epin = dwc2->epin;
 
+    bool const is_iso = (epin[epnum].diepctl & DIEPCTL_EPTYP) == DIEPCTL_EPTYP_0;
+
     // A full IN transfer (multiple packets, possibly) triggers XFRC.
-    epin[epnum].dieptsiz = (num_packets << DIEPTSIZ_PKTCNT_Pos) |
-                           ((total_bytes << DIEPTSIZ_XFRSIZ_Pos) & DIEPTSIZ_XFRSIZ_Msk);
+    uint32_t dieptsiz = (num_packets << DIEPTSIZ_PKTCNT_Pos) |
+                        ((total_bytes << DIEPTSIZ_XFRSIZ_Pos) & DIEPTSIZ_XFRSIZ_Msk);
+
+    // ISO: number of transactions per (micro)frame of high-bandwidth endpoint, fewer for a short transfer
+    if (is_iso) {
+      uint16_t const mult = tu_min16(num_packets, XFER_CTL_BASE(epnum, dir)->mult);
+      dieptsiz |= ((uint32_t) mult << DIEPTSIZ_MULCNT_Pos) & DIEPTSIZ_MULCNT_Msk;
+    }
+    epin[epnum].dieptsiz = dieptsiz;
 
     epin[epnum].diepctl |= DIEPCTL_EPENA | DIEPCTL_CNAK;
 
     // For ISO endpoint set correct odd/even bit for next frame.
-    if ((epin[epnum].diepctl & DIEPCTL_EPTYP) == DIEPCTL_EPTYP_0 && (XFER_CTL_BASE(epnum, dir))->interval == 1) {
+    if (is_iso && (XFER_CTL_BASE(epnum, dir))->interval == 1) {
       // Take odd/even bit from frame counter.
       uint32_t const odd_frame_now = (dwc2->dsts & (1u << DSTS_FNSOF_Pos));
       epin[epnum].diepctl |= (odd_frame_now ? DIEPCTL_SD0PID_SEVNFRM_Msk : DIEPCTL_SODDFRM_Msk);
@@ -692,7 +703,7 @@ void dcd_sof_enable(uint8_t rhport, bool en) {
  *------------------------------------------------------------------*/
 
 bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_edpt) {
-  TU_ASSERT(fifo_alloc(rhport, desc_edpt->bEndpointAddress, tu_edpt_packet_size(desc_edpt)));
+  TU_ASSERT(fifo_alloc(rhport, desc_edpt->bEndpointAddress, tu_edpt_interval_size(desc_edpt)));
   edpt_activate(rhport, desc_edpt);
   return true;
 }
@@ -724,6 +735,13 @@ bool dcd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet
   return true;
 }
 
+// IN endpoint supports high-bandwidth transfer with up to 3 transactions per microframe (DIEPTSIZ.MC).
+// FIFO must be allocated with the size of all transactions.
+uint8_t dcd_edpt_iso_mult_max(uint8_t rhport, uint8_t ep_addr) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  return (tu_edpt_dir(ep_addr) == TUSB_DIR_IN && phy_hs_supported(dwc2)) ? 3 : 1;
+}
+
 bool dcd_edpt_iso_activate(uint8_t rhport,  tusb_desc_endpoint_t const * p_endpoint_desc) {
   // Disable EP to clear potential incomplete transfers
   edpt_disable(rhport, p_endpoint_desc->bEndpointAddress, false);
@@ -19,8 +19,11 @@ TINYUSB_SRC_C += \
 	src/class/vendor/vendor_device.c \
   src/host/usbh.c \
   src/host/hub.c \
+  src/class/audio/audio_host.c \
   src/class/cdc/cdc_host.c \
   src/class/hid/hid_host.c \
+  src/class/midi/midi_host.c \
   src/class/msc/msc_host.c \
+  src/class/net/ncm_host.c \
   src/class/vendor/vendor_host.c \
   src/typec/usbc.c \
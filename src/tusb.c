@@ -136,7 +136,14 @@ bool tu_edpt_release(tu_edpt_state_t* ep_state, osal_mutex_t mutex) {
 
 bool tu_edpt_validate(tusb_desc_endpoint_t const* desc_ep, tusb_speed_t speed) {
   uint16_t const max_packet_size = tu_edpt_packet_size(desc_ep);
-  TU_LOG2("  Open EP %02X with Size = %u\r\n", desc_ep->bEndpointAddress, max_packet_size);
+  uint8_t const mult = tu_edpt_mult(desc_ep);
+  TU_LOG2("  Open EP %02X with Size = %u x %u\r\n", desc_ep->bEndpointAddress, max_packet_size, mult);
+
+  // Additional transactions per microframe are only allowed for highspeed periodic endpoints, 0b11 is reserved
+  if (mult > 1) {
+    TU_ASSERT(speed == TUSB_SPEED_HIGH && mult <= 3);
+    TU_ASSERT(desc_ep->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS || desc_ep->bmAttributes.xfer == TUSB_XFER_INTERRUPT);
+  }
 
   switch (desc_ep->bmAttributes.xfer) {
     case TUSB_XFER_ISOCHRONOUS: {
@@ -49,10 +49,18 @@
 #if CFG_TUH_ENABLED
   #include "host/usbh.h"
 
+  #if CFG_TUH_AUDIO
+    #include "class/audio/audio_host.h"
+  #endif
+
   #if CFG_TUH_HID
     #include "class/hid/hid_host.h"
   #endif
 
+  #if CFG_TUH_MIDI
+    #include "class/midi/midi_host.h"
+  #endif
+
   #if CFG_TUH_MSC
     #include "class/msc/msc_host.h"
   #endif
@@ -61,6 +69,10 @@
     #include "class/cdc/cdc_host.h"
   #endif
 
+  #if CFG_TUH_NCM
+    #include "class/net/ncm_host.h"
+  #endif
+
   #if CFG_TUH_VENDOR
     #include "class/vendor/vendor_host.h"
   #endif
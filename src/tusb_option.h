@@ -359,6 +359,13 @@
   #define CFG_TUD_INTERFACE_MAX   16
 #endif
 
+// Max number of isochronous packets (service intervals) queued per transfer by usbd_edpt_iso_xfer_fifo_n().
+// Packets after the first one are queued from transfer complete interrupt, class driver gets one completion per
+// transfer. DCD must support dcd_edpt_xfer_fifo() called from its interrupt handler. 1 to disable.
+#ifndef CFG_TUD_ISO_PACKETS_PER_XFER
+  #define CFG_TUD_ISO_PACKETS_PER_XFER  1
+#endif
+
 //------------- Device Class Driver -------------//
 #ifndef CFG_TUD_BTH
   #define CFG_TUD_BTH             0
@@ -495,6 +502,10 @@
     { 0x9986, 0x7523 }  /* overtaken from Linux Kernel driver /drivers/usb/serial/ch341.c */
 #endif
 
+#ifndef CFG_TUH_AUDIO
+  #define CFG_TUH_AUDIO  0
+#endif
+
 #ifndef CFG_TUH_HID
   #define CFG_TUH_HID    0
 #endif
@@ -507,6 +518,10 @@
   #define CFG_TUH_MSC    0
 #endif
 
+#ifndef CFG_TUH_NCM
+  #define CFG_TUH_NCM    0
+#endif
+
 #ifndef CFG_TUH_VENDOR
   #define CFG_TUH_VENDOR 0
 #endif
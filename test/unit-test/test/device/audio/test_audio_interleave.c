@@ -0,0 +1,562 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+
+// Files to test
+#include "audio_interleave.h"
+
+// All kernels are checked against the former audiod_interleaved_copy_bytes_fast_decode/encode() for every sample size,
+// number of FIFOs (up to 32 channels) and FIFO offset. Benchmark compares their speed on host, it only prints timing
+// and is built with -DAUDIO_INTERLEAVE_BENCHMARK.
+// Sample format conversion is checked against known values.
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+enum {
+  FRAMES_MAX = 48,  // 1 ms at 48 kHz
+  FF_MAX     = 16,
+  SLICE_MAX  = 8,
+  STREAM_SZ  = FRAMES_MAX * FF_MAX * SLICE_MAX,
+  FIFO_SZ    = FRAMES_MAX * SLICE_MAX,
+};
+
+typedef void const* (*deinterleave_fn_t)(void* dst, uint16_t len, void const* src, uint8_t n_ff_used);
+typedef void* (*interleave_fn_t)(void* dst, void const* src, uint16_t len, uint8_t n_ff_used);
+
+static uint64_t stream_buf[STREAM_SZ / 8];
+static uint64_t ref_buf[STREAM_SZ / 8];
+static uint64_t out_buf[STREAM_SZ / 8];
+
+static uint8_t* const stream = (uint8_t*) stream_buf;
+static uint8_t* const ref = (uint8_t*) ref_buf;
+static uint8_t* const out = (uint8_t*) out_buf;
+
+//--------------------------------------------------------------------+
+// Reference: former audio_device.c helpers
+//--------------------------------------------------------------------+
+static void * ref_decode(uint16_t const nBytesPerSample, void * dst, const void * dst_end, void * src, uint8_t const n_ff_used)
+{
+  uint16_t * dst16 = dst;
+  uint16_t * src16 = src;
+  const uint16_t * dst_end16 = dst_end;
+  uint32_t * dst32 = dst;
+  uint32_t * src32 = src;
+  const uint32_t * dst_end32 = dst_end;
+
+  if (nBytesPerSample == 1)
+  {
+    while(dst16 < dst_end16)
+    {
+      *dst16++ = *src16++;
+      src16 += n_ff_used - 1;
+    }
+    return src16;
+  }
+  else if (nBytesPerSample == 2)
+  {
+    while(dst32 < dst_end32)
+    {
+      *dst32++ = *src32++;
+      src32 += n_ff_used - 1;
+    }
+    return src32;
+  }
+  else if (nBytesPerSample == 3)
+  {
+    while(dst16 < dst_end16)
+    {
+      *dst16++ = *src16++;
+      *dst16++ = *src16++;
+      *dst16++ = *src16++;
+      src16 += 3 * (n_ff_used - 1);
+    }
+    return src16;
+  }
+  else
+  {
+    while(dst32 < dst_end32)
+    {
+      *dst32++ = *src32++;
+      *dst32++ = *src32++;
+      src32 += 2 * (n_ff_used - 1);
+    }
+    return src32;
+  }
+}
+
+static void * ref_encode(uint16_t const nBytesPerSample, void * src, const void * src_end, void * dst, uint8_t const n_ff_used)
+{
+  uint16_t * dst16 = dst;
+  uint16_t * src16 = src;
+  const uint16_t * src_end16 = src_end;
+  uint32_t * dst32 = dst;
+  uint32_t * src32 = src;
+  const uint32_t * src_end32 = src_end;
+
+  if (nBytesPerSample == 1)
+  {
+    while(src16 < src_end16)
+    {
+      *dst16++ = *src16++;
+      dst16 += n_ff_used - 1;
+    }
+    return dst16;
+  }
+  else if (nBytesPerSample == 2)
+  {
+    while(src32 < src_end32)
+    {
+      *dst32++ = *src32++;
+      dst32 += n_ff_used - 1;
+    }
+    return dst32;
+  }
+  else if (nBytesPerSample == 3)
+  {
+    while(src16 < src_end16)
+    {
+      *dst16++ = *src16++;
+      *dst16++ = *src16++;
+      *dst16++ = *src16++;
+      dst16 += 3 * (n_ff_used - 1);
+    }
+    return dst16;
+  }
+  else
+  {
+    while(src32 < src_end32)
+    {
+      *dst32++ = *src32++;
+      *dst32++ = *src32++;
+      dst32 += 2 * (n_ff_used - 1);
+    }
+    return dst32;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Kernel wrappers with common signature
+//--------------------------------------------------------------------+
+static uint8_t _n_bytes;
+
+static void const* deinterleave_generic(void* dst, uint16_t len, void const* src, uint8_t n_ff_used) {
+  return tu_audio_deinterleave_generic(_n_bytes, dst, len, src, n_ff_used);
+}
+
+static void const* deinterleave_selected(void* dst, uint16_t len, void const* src, uint8_t n_ff_used) {
+  return tu_audio_deinterleave(_n_bytes, dst, len, src, n_ff_used);
+}
+
+static void* interleave_generic(void* dst, void const* src, uint16_t len, uint8_t n_ff_used) {
+  return tu_audio_interleave_generic(_n_bytes, dst, src, len, n_ff_used);
+}
+
+static void* interleave_selected(void* dst, void const* src, uint16_t len, uint8_t n_ff_used) {
+  return tu_audio_interleave(_n_bytes, dst, src, len, n_ff_used);
+}
+
+// Optimized kernel for sample size, regardless of compile time selection
+static deinterleave_fn_t deinterleave_optimized(uint8_t n_bytes) {
+  switch (n_bytes) {
+    case 1: return tu_audio_deinterleave_pk16;
+    case 3: return tu_audio_deinterleave_pk24;
+    case 4: return tu_audio_deinterleave_w64;
+    default: return deinterleave_selected;
+  }
+}
+
+static interleave_fn_t interleave_optimized(uint8_t n_bytes) {
+  switch (n_bytes) {
+    case 1: return tu_audio_interleave_pk16;
+    case 3: return tu_audio_interleave_pk24;
+    case 4: return tu_audio_interleave_w64;
+    default: return interleave_selected;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+static void fill_random(uint8_t* buf, uint32_t size) {
+  static uint32_t seed = 0x12345678;
+  for (uint32_t i = 0; i < size; i++) {
+    seed = seed * 1103515245u + 12345u;
+    buf[i] = (uint8_t) (seed >> 16);
+  }
+}
+
+// Decode all FIFOs of a stream at different FIFO offsets with given kernel and compare with reference
+static void check_deinterleave(deinterleave_fn_t fn, uint8_t n_bytes) {
+  uint8_t const slice = 2 * n_bytes;
+
+  for (uint8_t n_ff = 1; n_ff <= FF_MAX; n_ff++) {
+    for (uint8_t frames = 1; frames <= FRAMES_MAX; frames += 7) {
+      fill_random(stream, STREAM_SZ);
+      uint16_t const len = frames * slice;
+
+      for (uint8_t ff = 0; ff < n_ff; ff++) {
+        // FIFO write pointer can be at any slice
+        for (uint8_t offset = 0; offset < 4; offset++) {
+          uint8_t* src = stream + ff * slice;
+          memset(ref, 0, FIFO_SZ + 4 * SLICE_MAX);
+          memset(out, 0, FIFO_SZ + 4 * SLICE_MAX);
+
+          void* ref_end = ref_decode(n_bytes, ref + offset * slice, ref + offset * slice + len, src, n_ff);
+          void const* out_end = fn(out + offset * slice, len, src, n_ff);
+
+          TEST_ASSERT_EQUAL_MEMORY(ref, out, FIFO_SZ + 4 * SLICE_MAX);
+          TEST_ASSERT_EQUAL_PTR(ref_end, out_end);
+        }
+      }
+    }
+  }
+}
+
+// Encode all FIFOs into a stream at different FIFO offsets with given kernel and compare with reference
+static void check_interleave(interleave_fn_t fn, uint8_t n_bytes) {
+  uint8_t const slice = 2 * n_bytes;
+  static uint64_t fifo_buf[(FIFO_SZ + 4 * SLICE_MAX) / 8];
+  uint8_t* fifo = (uint8_t*) fifo_buf;
+
+  for (uint8_t n_ff = 1; n_ff <= FF_MAX; n_ff++) {
+    for (uint8_t frames = 1; frames <= FRAMES_MAX; frames += 7) {
+      uint16_t const len = frames * slice;
+      memset(ref, 0, STREAM_SZ);
+      memset(out, 0, STREAM_SZ);
+
+      for (uint8_t ff = 0; ff < n_ff; ff++) {
+        fill_random(fifo, sizeof(fifo_buf));
+        uint8_t const offset = ff % 4;
+
+        void* ref_end = ref_encode(n_bytes, fifo + offset * slice, fifo + offset * slice + len, ref + ff * slice, n_ff);
+        void* out_end = fn(out + ff * slice, fifo + offset * slice, len, n_ff);
+
+        TEST_ASSERT_EQUAL_INT((uint8_t*) ref_end - ref, (uint8_t*) out_end - out);
+      }
+
+      TEST_ASSERT_EQUAL_MEMORY(ref, out, STREAM_SZ);
+    }
+  }
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_deinterleave_generic(void) {
+  for (_n_bytes = 1; _n_bytes <= 4; _n_bytes++) {
+    check_deinterleave(deinterleave_generic, _n_bytes);
+  }
+}
+
+void test_deinterleave_optimized(void) {
+  for (_n_bytes = 1; _n_bytes <= 4; _n_bytes++) {
+    check_deinterleave(deinterleave_optimized(_n_bytes), _n_bytes);
+  }
+}
+
+void test_deinterleave_selected(void) {
+  for (_n_bytes = 1; _n_bytes <= 4; _n_bytes++) {
+    check_deinterleave(deinterleave_selected, _n_bytes);
+  }
+}
+
+void test_interleave_generic(void) {
+  for (_n_bytes = 1; _n_bytes <= 4; _n_bytes++) {
+    check_interleave(interleave_generic, _n_bytes);
+  }
+}
+
+void test_interleave_optimized(void) {
+  for (_n_bytes = 1; _n_bytes <= 4; _n_bytes++) {
+    check_interleave(interleave_optimized(_n_bytes), _n_bytes);
+  }
+}
+
+void test_interleave_selected(void) {
+  for (_n_bytes = 1; _n_bytes <= 4; _n_bytes++) {
+    check_interleave(interleave_selected, _n_bytes);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Sample format conversion
+//--------------------------------------------------------------------+
+void test_conv_init_identity(void) {
+  tu_audio_conv_t conv = { 0 };
+
+  // 16 bit both sides
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM16, false, 2, 16, false);
+  TEST_ASSERT_EQUAL(AUDIO_SAMPLE_FORMAT_SUBSLOT, conv.format);
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM16, false, 2, 16, true);
+  TEST_ASSERT_EQUAL(AUDIO_SAMPLE_FORMAT_SUBSLOT, conv.format);
+
+  // 24 bit in 4-byte subslot: identical to left-justified, 32 bit only when decoding
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM24_LJ, false, 4, 24, true);
+  TEST_ASSERT_EQUAL(AUDIO_SAMPLE_FORMAT_SUBSLOT, conv.format);
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM32, false, 4, 24, false);
+  TEST_ASSERT_EQUAL(AUDIO_SAMPLE_FORMAT_SUBSLOT, conv.format);
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM32, false, 4, 24, true);
+  TEST_ASSERT_EQUAL(AUDIO_SAMPLE_FORMAT_PCM32, conv.format);
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM24_RJ, false, 4, 24, false);
+  TEST_ASSERT_EQUAL(AUDIO_SAMPLE_FORMAT_PCM24_RJ, conv.format);
+
+  // different container
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM24_LJ, false, 3, 24, false);
+  TEST_ASSERT_EQUAL(AUDIO_SAMPLE_FORMAT_PCM24_LJ, conv.format);
+  TEST_ASSERT_EQUAL(4, tu_audio_sample_format_size(conv.format, 3));
+
+  // invalid resolution falls back to subslot size
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_FLOAT32, false, 3, 0, false);
+  TEST_ASSERT_EQUAL(24, conv.usb_bits);
+}
+
+void test_conv_decode_16bit(void) {
+  // 2 FIFOs, 2 frames of 16 bit subslots
+  int16_t const usb[] = { 0x1234, -2, 0x5555, 0x5555, 0x7FFF, INT16_MIN, 0x5555, 0x5555 };
+  tu_audio_conv_t conv = { 0 };
+  int32_t pcm32[4];
+  float flt[4];
+
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM24_RJ, false, 2, 16, false);
+  void const* end = tu_audio_deinterleave_conv(&conv, pcm32, sizeof(pcm32), usb, 2);
+  TEST_ASSERT_EQUAL_PTR(usb + 8, end);
+  TEST_ASSERT_EQUAL_HEX32(0x00123400, pcm32[0]);
+  TEST_ASSERT_EQUAL_INT32(-2 * 256, pcm32[1]);
+  TEST_ASSERT_EQUAL_HEX32(0x007FFF00, pcm32[2]);
+  TEST_ASSERT_EQUAL_INT32(INT16_MIN * 256, pcm32[3]);
+
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM32, false, 2, 16, false);
+  tu_audio_deinterleave_conv(&conv, pcm32, sizeof(pcm32), usb, 2);
+  TEST_ASSERT_EQUAL_HEX32(0x12340000, pcm32[0]);
+  TEST_ASSERT_EQUAL_INT32(INT32_MIN, pcm32[3]);
+
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_FLOAT32, false, 2, 16, false);
+  tu_audio_deinterleave_conv(&conv, flt, sizeof(flt), usb + 2, 2);
+  TEST_ASSERT_EQUAL_FLOAT(0x5555 / 32768.0f, flt[0]);
+  TEST_ASSERT_EQUAL_FLOAT(0x5555 / 32768.0f, flt[3]);
+  tu_audio_deinterleave_conv(&conv, flt, sizeof(flt), usb, 2);
+  TEST_ASSERT_EQUAL_FLOAT(-2 / 32768.0f, flt[1]);
+  TEST_ASSERT_EQUAL_FLOAT(-1.0f, flt[3]);
+}
+
+void test_conv_decode_truncate(void) {
+  // single FIFO, 24 bit subslots to 16 bit: truncation rounds towards minus infinity
+  uint8_t const usb[] = { 0x56, 0x34, 0x12, 0xFF, 0xFF, 0xFF };
+  tu_audio_conv_t conv = { 0 };
+  int16_t pcm16[2];
+
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM16, false, 3, 24, false);
+  TEST_ASSERT_EQUAL_PTR(usb + 6, tu_audio_deinterleave_conv(&conv, pcm16, sizeof(pcm16), usb, 1));
+  TEST_ASSERT_EQUAL_HEX16(0x1234, pcm16[0]);
+  TEST_ASSERT_EQUAL_INT16(-1, pcm16[1]);
+}
+
+void test_conv_encode_float(void) {
+  float const flt[] = { 0.5f, -1.0f, 1.0f, 1.5f, -3.0f, -0.25f };
+  tu_audio_conv_t conv = { 0 };
+  int16_t usb16[6];
+  uint8_t usb24[24];
+
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_FLOAT32, false, 2, 16, true);
+  TEST_ASSERT_EQUAL_PTR(usb16 + 6, tu_audio_interleave_conv(&conv, usb16, flt, sizeof(flt), 1));
+  TEST_ASSERT_EQUAL_HEX16(0x4000, usb16[0]);
+  TEST_ASSERT_EQUAL_INT16(INT16_MIN, usb16[1]);
+  TEST_ASSERT_EQUAL_INT16(INT16_MAX, usb16[2]);
+  TEST_ASSERT_EQUAL_INT16(INT16_MAX, usb16[3]);
+  TEST_ASSERT_EQUAL_INT16(INT16_MIN, usb16[4]);
+  TEST_ASSERT_EQUAL_INT16(-0x2000, usb16[5]);
+
+  // 3 FIFOs, only 2nd one written, 1 frame
+  memset(usb24, 0xAA, sizeof(usb24));
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_FLOAT32, false, 3, 24, true);
+  TEST_ASSERT_EQUAL_PTR(usb24 + 6 + 18, tu_audio_interleave_conv(&conv, usb24 + 6, flt, 2 * sizeof(float), 3));
+  uint8_t const expected[] = { 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0x00, 0x00, 0x40, 0x00, 0x00, 0x80 };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, usb24, sizeof(expected));
+  TEST_ASSERT_EACH_EQUAL_HEX8(0xAA, usb24 + 12, 12);
+}
+
+void test_conv_encode_bit_resolution(void) {
+  // 20 bit resolution in 3-byte subslots: low 4 bits are cleared
+  int32_t const pcm32[] = { 0x12345678, -1 };
+  tu_audio_conv_t conv = { 0 };
+  uint8_t usb[6];
+
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM32, false, 3, 20, true);
+  tu_audio_interleave_conv(&conv, usb, pcm32, sizeof(pcm32), 1);
+  uint8_t const expected[] = { 0x50, 0x34, 0x12, 0xF0, 0xFF, 0xFF };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, usb, sizeof(expected));
+}
+
+void test_conv_encode_dither(void) {
+  // Value half way between two 16-bit steps
+  enum { N = 512 };
+  static int32_t pcm32[N];
+  static int16_t usb[N];
+  tu_audio_conv_t conv = { 0 };
+  int32_t sum = 0;
+  uint32_t hist[3] = { 0 };
+
+  for (int i = 0; i < N; i++) pcm32[i] = 0x12348000;
+
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM32, false, 2, 16, true);
+  tu_audio_interleave_conv(&conv, usb, pcm32, sizeof(pcm32), 1);
+  TEST_ASSERT_EACH_EQUAL_INT16(0x1234, usb, N);
+
+  tu_audio_conv_init(&conv, AUDIO_SAMPLE_FORMAT_PCM32, true, 2, 16, true);
+  tu_audio_interleave_conv(&conv, usb, pcm32, sizeof(pcm32), 1);
+  for (int i = 0; i < N; i++) {
+    TEST_ASSERT_INT16_WITHIN(1, 0x1234, usb[i]);
+    hist[usb[i] - 0x1233]++;
+    sum += usb[i] - 0x1234;
+  }
+
+  // Triangular noise of +-1 LSB around 0x1234.5: mostly 0x1234, both neighbours hit, no bias beyond truncation
+  TEST_ASSERT_GREATER_THAN(N / 2, hist[1]);
+  TEST_ASSERT_NOT_EQUAL(0, hist[0]);
+  TEST_ASSERT_NOT_EQUAL(0, hist[2]);
+  TEST_ASSERT_INT_WITHIN(N / 8, 0, sum);
+
+  // Full scale is saturated rather than wrapped
+  for (int i = 0; i < N; i++) pcm32[i] = INT32_MAX;
+  tu_audio_interleave_conv(&conv, usb, pcm32, sizeof(pcm32), 1);
+  for (int i = 0; i < N; i++) TEST_ASSERT_INT16_WITHIN(1, INT16_MAX - 1, usb[i]);
+}
+
+void test_conv_round_trip_24bit_float(void) {
+  // 4 FIFOs of 24 bit subslots through float and back is lossless
+  static float flt[FRAMES_MAX * 2];
+  tu_audio_conv_t dec = { 0 }, enc = { 0 };
+  uint16_t const len = FRAMES_MAX * 2 * sizeof(float);
+
+  fill_random(stream, STREAM_SZ);
+  memset(out, 0, STREAM_SZ);
+  tu_audio_conv_init(&dec, AUDIO_SAMPLE_FORMAT_FLOAT32, false, 3, 24, false);
+  tu_audio_conv_init(&enc, AUDIO_SAMPLE_FORMAT_FLOAT32, false, 3, 24, true);
+
+  for (uint8_t ff = 0; ff < 4; ff++) {
+    tu_audio_deinterleave_conv(&dec, flt, len, stream + ff * 6, 4);
+    tu_audio_interleave_conv(&enc, out + ff * 6, flt, len, 4);
+  }
+
+  TEST_ASSERT_EQUAL_MEMORY(stream, out, FRAMES_MAX * 4 * 6);
+}
+
+//--------------------------------------------------------------------+
+// Benchmark: 16 FIFOs (32 channels), 1 ms of 192 kHz per call
+//--------------------------------------------------------------------+
+#ifdef AUDIO_INTERLEAVE_BENCHMARK
+enum {
+  BENCH_ROUNDS = 2000,
+  BENCH_FF     = 16,
+  BENCH_FRAMES = 192,
+};
+
+static uint64_t bench_stream[BENCH_FF * BENCH_FRAMES * SLICE_MAX / 8];
+static uint64_t bench_fifo[BENCH_FRAMES * SLICE_MAX / 8];
+
+static double bench_us(clock_t start) {
+  return (double) (clock() - start) * 1e6 / CLOCKS_PER_SEC / BENCH_ROUNDS;
+}
+
+void test_benchmark(void) {
+  fill_random((uint8_t*) bench_stream, sizeof(bench_stream));
+
+  for (_n_bytes = 1; _n_bytes <= 4; _n_bytes++) {
+    uint16_t const len = BENCH_FRAMES * 2 * _n_bytes;
+    uint8_t* fifo = (uint8_t*) bench_fifo;
+    uint8_t* stream_end = (uint8_t*) bench_stream;
+    deinterleave_fn_t const dec_opt = deinterleave_optimized(_n_bytes);
+    interleave_fn_t const enc_opt = interleave_optimized(_n_bytes);
+    double t_ref[2], t_opt[2], t_sel[2];
+    clock_t start;
+
+    start = clock();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint8_t ff = 0; ff < BENCH_FF; ff++) {
+        stream_end = ref_decode(_n_bytes, fifo, fifo + len, (uint8_t*) bench_stream + ff * 2 * _n_bytes, BENCH_FF);
+      }
+    }
+    t_ref[0] = bench_us(start);
+
+    start = clock();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint8_t ff = 0; ff < BENCH_FF; ff++) {
+        dec_opt(fifo, len, (uint8_t*) bench_stream + ff * 2 * _n_bytes, BENCH_FF);
+      }
+    }
+    t_opt[0] = bench_us(start);
+
+    start = clock();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint8_t ff = 0; ff < BENCH_FF; ff++) {
+        deinterleave_selected(fifo, len, (uint8_t*) bench_stream + ff * 2 * _n_bytes, BENCH_FF);
+      }
+    }
+    t_sel[0] = bench_us(start);
+
+    start = clock();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint8_t ff = 0; ff < BENCH_FF; ff++) {
+        ref_encode(_n_bytes, fifo, fifo + len, (uint8_t*) bench_stream + ff * 2 * _n_bytes, BENCH_FF);
+      }
+    }
+    t_ref[1] = bench_us(start);
+
+    start = clock();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint8_t ff = 0; ff < BENCH_FF; ff++) {
+        enc_opt((uint8_t*) bench_stream + ff * 2 * _n_bytes, fifo, len, BENCH_FF);
+      }
+    }
+    t_opt[1] = bench_us(start);
+
+    start = clock();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint8_t ff = 0; ff < BENCH_FF; ff++) {
+        interleave_selected((uint8_t*) bench_stream + ff * 2 * _n_bytes, fifo, len, BENCH_FF);
+      }
+    }
+    t_sel[1] = bench_us(start);
+
+    TEST_ASSERT_NOT_NULL(stream_end);
+    printf("%u-byte samples, %u channels: decode ref %.2f us, optimized %.2f us, selected %.2f us | "
+           "encode ref %.2f us, optimized %.2f us, selected %.2f us\n",
+           _n_bytes, 2 * BENCH_FF, t_ref[0], t_opt[0], t_sel[0], t_ref[1], t_opt[1], t_sel[1]);
+  }
+}
+
+#endif
@@ -0,0 +1,345 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <string.h>
+#include "unity.h"
+
+// Files to test
+#include "osal/osal.h"
+#include "tusb_fifo.h"
+#include "tusb.h"
+#include "hid_device.h"
+
+// Mock File
+#include "mock_usbd.h"
+#include "mock_usbd_pvt.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum {
+  ITF_NUM   = 0,
+  EP_IN     = 0x81,
+  REPORT_ID = 7,
+};
+
+uint8_t const desc_report[] = {
+  TUD_HID_REPORT_DESC_GAMEPAD(HID_REPORT_ID(REPORT_ID))
+};
+
+uint8_t const desc_hid[] = {
+  TUD_HID_DESCRIPTOR(ITF_NUM, 0, HID_ITF_PROTOCOL_NONE, sizeof(desc_report), EP_IN, CFG_TUD_HID_EP_BUFSIZE, 1)
+};
+
+static struct {
+  bool busy;
+  bool claimed;
+  uint8_t const* buffer;
+  uint16_t len;
+  uint32_t xfer_count;
+} ep;
+
+static osal_task_func_t deferred_func;
+static void* deferred_param;
+
+// payload (2nd byte, after report ID) of completed reports
+static uint8_t completed[512];
+static uint32_t completed_count;
+static uint32_t chain_count; // number of reports queued from complete callback
+
+//--------------------------------------------------------------------+
+// Device stack
+//--------------------------------------------------------------------+
+
+static bool stub_usbd_open_edpt_pair(uint8_t rhport, uint8_t const* p_desc, uint8_t ep_count, uint8_t xfer_type,
+                                     uint8_t* ep_out, uint8_t* ep_in, int num_calls) {
+  (void) rhport; (void) p_desc; (void) ep_count; (void) xfer_type; (void) num_calls;
+  *ep_out = 0;
+  *ep_in = EP_IN;
+  return true;
+}
+
+static bool stub_usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr, int num_calls) {
+  (void) rhport; (void) ep_addr; (void) num_calls;
+  if (ep.busy || ep.claimed) return false;
+  ep.claimed = true;
+  return true;
+}
+
+static bool stub_usbd_edpt_release(uint8_t rhport, uint8_t ep_addr, int num_calls) {
+  (void) rhport; (void) ep_addr; (void) num_calls;
+  ep.claimed = false;
+  return true;
+}
+
+static bool stub_usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr, int num_calls) {
+  (void) rhport; (void) ep_addr; (void) num_calls;
+  return ep.busy;
+}
+
+static bool stub_usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes, int num_calls) {
+  (void) rhport; (void) num_calls;
+  TEST_ASSERT_EQUAL_HEX8(EP_IN, ep_addr);
+  TEST_ASSERT_FALSE(ep.busy);
+  ep.busy = true;
+  ep.claimed = false;
+  ep.buffer = buffer;
+  ep.len = total_bytes;
+  ep.xfer_count++;
+  return true;
+}
+
+static void stub_usbd_defer_func(osal_task_func_t func, void* param, bool in_isr, int num_calls) {
+  (void) num_calls;
+  TEST_ASSERT_TRUE(in_isr);
+  TEST_ASSERT_NULL_MESSAGE(deferred_func, "deferred twice");
+  deferred_func = func;
+  deferred_param = param;
+}
+
+static void run_deferred(void) {
+  TEST_ASSERT_NOT_NULL(deferred_func);
+  osal_task_func_t func = deferred_func;
+  deferred_func = NULL;
+  func(deferred_param);
+}
+
+// Host reads the armed report
+static void host_read_report(void) {
+  TEST_ASSERT_TRUE(ep.busy);
+  ep.busy = false;
+  TEST_ASSERT_TRUE(hidd_xfer_cb(0, EP_IN, XFER_RESULT_SUCCESS, ep.len));
+}
+
+//--------------------------------------------------------------------+
+// Application callbacks
+//--------------------------------------------------------------------+
+
+uint8_t const* tud_hid_descriptor_report_cb(uint8_t instance) {
+  (void) instance;
+  return desc_report;
+}
+
+uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t* buffer,
+                               uint16_t reqlen) {
+  (void) instance; (void) report_id; (void) report_type; (void) buffer; (void) reqlen;
+  return 0;
+}
+
+void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer,
+                           uint16_t bufsize) {
+  (void) instance; (void) report_id; (void) report_type; (void) buffer; (void) bufsize;
+}
+
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* report, uint16_t len) {
+  (void) instance;
+  TEST_ASSERT_EQUAL(3, len);
+  TEST_ASSERT_EQUAL(REPORT_ID, report[0]);
+  TEST_ASSERT_LESS_THAN(sizeof(completed), completed_count);
+  completed[completed_count++] = report[1];
+
+  if (chain_count) {
+    chain_count--;
+    uint8_t const next[2] = { (uint8_t) (report[1] + 1), (uint8_t) ~(report[1] + 1) };
+    TEST_ASSERT_TRUE(tud_hid_n_report_queue(0, REPORT_ID, next, sizeof(next), false));
+  }
+}
+
+static bool queue(uint8_t value, bool in_isr) {
+  uint8_t const report[2] = { value, (uint8_t) ~value };
+  return tud_hid_n_report_queue(0, REPORT_ID, report, sizeof(report), in_isr);
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+
+void setUp(void) {
+  usbd_open_edpt_pair_StubWithCallback(stub_usbd_open_edpt_pair);
+  usbd_edpt_claim_StubWithCallback(stub_usbd_edpt_claim);
+  usbd_edpt_release_StubWithCallback(stub_usbd_edpt_release);
+  usbd_edpt_busy_StubWithCallback(stub_usbd_edpt_busy);
+  usbd_edpt_xfer_StubWithCallback(stub_usbd_edpt_xfer);
+  usbd_defer_func_StubWithCallback(stub_usbd_defer_func);
+
+  memset(&ep, 0, sizeof(ep));
+  deferred_func = NULL;
+  completed_count = 0;
+  chain_count = 0;
+
+  hidd_init();
+  TEST_ASSERT_EQUAL(sizeof(desc_hid), hidd_open(0, (tusb_desc_interface_t const*) desc_hid, sizeof(desc_hid)));
+}
+
+void tearDown(void) {
+  hidd_reset(0);
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+void test_queue_in_order(void) {
+  for (uint8_t i = 0; i < CFG_TUD_HID_REPORT_QUEUE_SIZE; i++) {
+    TEST_ASSERT_TRUE(queue(i, false));
+  }
+
+  // first report is armed right away, others wait
+  TEST_ASSERT_EQUAL(1, ep.xfer_count);
+  TEST_ASSERT_EQUAL(0, tud_hid_n_report_queue_available(0));
+
+  // next report is armed before complete callback
+  for (uint8_t i = 0; i < CFG_TUD_HID_REPORT_QUEUE_SIZE; i++) {
+    TEST_ASSERT_EQUAL(i, ep.buffer[1]);
+    TEST_ASSERT_EQUAL_HEX8((uint8_t) ~i, ep.buffer[2]);
+    host_read_report();
+    TEST_ASSERT_EQUAL(i < CFG_TUD_HID_REPORT_QUEUE_SIZE - 1, ep.busy);
+  }
+
+  TEST_ASSERT_EQUAL(CFG_TUD_HID_REPORT_QUEUE_SIZE, completed_count);
+  TEST_ASSERT_EQUAL(CFG_TUD_HID_REPORT_QUEUE_SIZE, tud_hid_n_report_queue_available(0));
+
+  tud_hid_report_queue_stats_t stats;
+  TEST_ASSERT_TRUE(tud_hid_n_report_queue_stats(0, &stats, true));
+  TEST_ASSERT_EQUAL(CFG_TUD_HID_REPORT_QUEUE_SIZE, stats.max_count);
+  TEST_ASSERT_EQUAL(0, stats.dropped);
+  TEST_ASSERT_EQUAL(0, stats.coalesced);
+}
+
+void test_queue_full_coalesce_and_drop(void) {
+  for (uint8_t i = 0; i < CFG_TUD_HID_REPORT_QUEUE_SIZE; i++) {
+    TEST_ASSERT_TRUE(queue(i, false));
+  }
+
+  // same report ID and length: replaces the newest waiting report
+  TEST_ASSERT_TRUE(queue(100, false));
+  TEST_ASSERT_TRUE(queue(101, false));
+
+  // different length: dropped
+  uint8_t const other[1] = { 0xff };
+  TEST_ASSERT_FALSE(tud_hid_n_report_queue(0, REPORT_ID, other, sizeof(other), false));
+
+  while (ep.busy) host_read_report();
+
+  TEST_ASSERT_EQUAL(CFG_TUD_HID_REPORT_QUEUE_SIZE, completed_count);
+  for (uint8_t i = 0; i < CFG_TUD_HID_REPORT_QUEUE_SIZE - 1; i++) {
+    TEST_ASSERT_EQUAL(i, completed[i]);
+  }
+  TEST_ASSERT_EQUAL(101, completed[CFG_TUD_HID_REPORT_QUEUE_SIZE - 1]);
+
+  tud_hid_report_queue_stats_t stats;
+  TEST_ASSERT_TRUE(tud_hid_n_report_queue_stats(0, &stats, false));
+  TEST_ASSERT_EQUAL(1, stats.dropped);
+  TEST_ASSERT_EQUAL(2, stats.coalesced);
+}
+
+void test_queue_from_complete_cb(void) {
+  // application queues the next report from complete callback, while the completed slot is not yet released
+  chain_count = 10;
+  TEST_ASSERT_TRUE(queue(0, false));
+
+  while (ep.busy) host_read_report();
+
+  TEST_ASSERT_EQUAL(11, completed_count);
+  for (uint8_t i = 0; i < completed_count; i++) {
+    TEST_ASSERT_EQUAL(i, completed[i]);
+  }
+  TEST_ASSERT_EQUAL(CFG_TUD_HID_REPORT_QUEUE_SIZE, tud_hid_n_report_queue_available(0));
+}
+
+void test_index_wrap_around(void) {
+  // push more than 256 reports through the queue with varying fill level
+  uint32_t sent = 0;
+  uint32_t expected = 0;
+  for (uint32_t round = 0; round < 200; round++) {
+    uint32_t const n = 1 + (round % CFG_TUD_HID_REPORT_QUEUE_SIZE);
+    for (uint32_t i = 0; i < n && tud_hid_n_report_queue_available(0); i++) {
+      TEST_ASSERT_TRUE(queue((uint8_t) sent, false));
+      sent++;
+    }
+    // host reads fewer than queued every other round, so the queue level keeps moving
+    uint32_t const reads = (round & 1) ? n : (n + 1) / 2;
+    for (uint32_t i = 0; i < reads && ep.busy; i++) {
+      TEST_ASSERT_EQUAL_HEX8((uint8_t) expected, ep.buffer[1]);
+      TEST_ASSERT_EQUAL_HEX8((uint8_t) ~expected, ep.buffer[2]);
+      host_read_report();
+      expected++;
+    }
+    if (completed_count >= sizeof(completed) - CFG_TUD_HID_REPORT_QUEUE_SIZE) break;
+  }
+  while (ep.busy) {
+    TEST_ASSERT_EQUAL_HEX8((uint8_t) expected, ep.buffer[1]);
+    host_read_report();
+    expected++;
+  }
+
+  TEST_ASSERT_GREATER_THAN(300, sent);
+  TEST_ASSERT_EQUAL(sent, completed_count);
+  for (uint32_t i = 0; i < completed_count; i++) {
+    TEST_ASSERT_EQUAL_HEX8((uint8_t) i, completed[i]);
+  }
+}
+
+void test_queue_from_isr(void) {
+  // arming is deferred to usbd task
+  TEST_ASSERT_TRUE(queue(1, true));
+  TEST_ASSERT_TRUE(queue(2, true));
+  TEST_ASSERT_FALSE(ep.busy);
+
+  run_deferred();
+  TEST_ASSERT_TRUE(ep.busy);
+  TEST_ASSERT_EQUAL(1, ep.buffer[1]);
+
+  // endpoint is busy: report is armed on completion without deferring
+  TEST_ASSERT_TRUE(queue(3, true));
+  TEST_ASSERT_NULL(deferred_func);
+
+  while (ep.busy) host_read_report();
+  TEST_ASSERT_EQUAL(3, completed_count);
+  TEST_ASSERT_EQUAL(1, completed[0]);
+  TEST_ASSERT_EQUAL(2, completed[1]);
+  TEST_ASSERT_EQUAL(3, completed[2]);
+}
+
+void test_queue_after_direct_report(void) {
+  uint8_t const report[2] = { 50, (uint8_t) ~50 };
+  TEST_ASSERT_TRUE(tud_hid_n_report(0, REPORT_ID, report, sizeof(report)));
+
+  // queued while direct report is in flight, armed when it completes
+  TEST_ASSERT_TRUE(queue(51, false));
+  TEST_ASSERT_EQUAL(50, ep.buffer[1]);
+
+  host_read_report();
+  TEST_ASSERT_TRUE(ep.busy);
+  TEST_ASSERT_EQUAL(51, ep.buffer[1]);
+
+  host_read_report();
+  TEST_ASSERT_FALSE(ep.busy);
+  TEST_ASSERT_EQUAL(2, completed_count);
+  TEST_ASSERT_EQUAL(50, completed[0]);
+  TEST_ASSERT_EQUAL(51, completed[1]);
+}
@@ -0,0 +1,356 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <string.h>
+#include "unity.h"
+
+// Files to test
+#include "osal/osal.h"
+#include "tusb_fifo.h"
+#include "tusb.h"
+#include "midi_device.h"
+
+// Mock File
+#include "mock_usbd.h"
+#include "mock_usbd_pvt.h"
+
+// tud_midi_n_stream_write() is checked against the former byte by byte state machine with random message sequences
+// written in random chunks, so that SysEx packets (CIN 4 and ending CIN 5/6/7) cross chunk and FIFO boundaries.
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum {
+  ITF_NUM = 0,
+  EP_OUT  = 0x01,
+  EP_IN   = 0x81,
+  EP_SIZE = CFG_TUD_MIDI_EP_BUFSIZE,
+};
+
+uint8_t const desc_midi[] = {
+  TUD_MIDI_DESCRIPTOR(ITF_NUM, 0, EP_OUT, EP_IN, EP_SIZE)
+};
+
+#define DESC_ITF    ((tusb_desc_interface_t const*) desc_midi)
+#define DESC_LEN    ((uint16_t) sizeof(desc_midi))
+
+static struct {
+  bool busy;
+  bool claimed;
+  uint16_t len;
+} ep_in;
+
+// event packets received by host
+static uint8_t host_rx[4096];
+static uint32_t host_rx_len;
+
+static uint32_t random_next(void) {
+  static uint32_t seed = 0x12345678;
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 16;
+}
+
+//--------------------------------------------------------------------+
+// Reference: former stream write state machine, one byte at a time
+//--------------------------------------------------------------------+
+
+typedef struct {
+  uint8_t buffer[4];
+  uint8_t index;
+  uint8_t total;
+} ref_stream_t;
+
+static uint32_t ref_stream_write(ref_stream_t* stream, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize,
+                                 uint8_t* packets) {
+  uint32_t count = 0;
+
+  for (uint32_t i = 0; i < bufsize; i++) {
+    uint8_t const data = buffer[i];
+
+    if (stream->index == 0) {
+      uint8_t const msg = data >> 4;
+
+      stream->index = 2;
+      stream->buffer[1] = data;
+
+      if ((stream->buffer[0] & 0xF) == MIDI_CIN_SYSEX_START) {
+        if (data == MIDI_STATUS_SYSEX_END) {
+          stream->buffer[0] = (uint8_t) ((cable_num << 4) | MIDI_CIN_SYSEX_END_1BYTE);
+          stream->total = 2;
+        } else {
+          stream->total = 4;
+        }
+      } else if ((msg >= 0x8 && msg <= 0xB) || msg == 0xE) {
+        stream->buffer[0] = (uint8_t) ((cable_num << 4) | msg);
+        stream->total = 4;
+      } else if (msg == 0xC || msg == 0xD) {
+        stream->buffer[0] = (uint8_t) ((cable_num << 4) | msg);
+        stream->total = 3;
+      } else if (msg == 0xf) {
+        if (data == MIDI_STATUS_SYSEX_START) {
+          stream->buffer[0] = MIDI_CIN_SYSEX_START;
+          stream->total = 4;
+        } else if (data == MIDI_STATUS_SYSCOM_TIME_CODE_QUARTER_FRAME || data == MIDI_STATUS_SYSCOM_SONG_SELECT) {
+          stream->buffer[0] = MIDI_CIN_SYSCOM_2BYTE;
+          stream->total = 3;
+        } else if (data == MIDI_STATUS_SYSCOM_SONG_POSITION_POINTER) {
+          stream->buffer[0] = MIDI_CIN_SYSCOM_3BYTE;
+          stream->total = 4;
+        } else {
+          stream->buffer[0] = MIDI_CIN_SYSEX_END_1BYTE;
+          stream->total = 2;
+        }
+        stream->buffer[0] |= (uint8_t) (cable_num << 4);
+      } else {
+        stream->buffer[0] = (uint8_t) (cable_num << 4 | 0xf);
+        stream->buffer[2] = 0;
+        stream->buffer[3] = 0;
+        stream->index = 2;
+        stream->total = 2;
+      }
+    } else {
+      stream->buffer[stream->index] = data;
+      stream->index++;
+
+      if ((stream->buffer[0] & 0xF) == MIDI_CIN_SYSEX_START && data == MIDI_STATUS_SYSEX_END) {
+        stream->buffer[0] = (uint8_t) ((cable_num << 4) | (MIDI_CIN_SYSEX_START + (stream->index - 1)));
+        stream->total = stream->index;
+      }
+    }
+
+    if (stream->index == stream->total) {
+      for (uint8_t idx = stream->total; idx < 4; idx++) stream->buffer[idx] = 0;
+      memcpy(packets + count, stream->buffer, 4);
+      count += 4;
+      stream->index = stream->total = 0;
+    }
+  }
+
+  return count;
+}
+
+//--------------------------------------------------------------------+
+// Device stack
+//--------------------------------------------------------------------+
+
+static bool stub_usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep, int num_calls) {
+  (void) rhport; (void) desc_ep; (void) num_calls;
+  return true;
+}
+
+static bool stub_usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr, int num_calls) {
+  (void) rhport; (void) num_calls;
+  if (ep_addr != EP_IN) return false; // no data from host
+  if (ep_in.busy || ep_in.claimed) return false;
+  ep_in.claimed = true;
+  return true;
+}
+
+static bool stub_usbd_edpt_release(uint8_t rhport, uint8_t ep_addr, int num_calls) {
+  (void) rhport; (void) num_calls;
+  TEST_ASSERT_EQUAL_HEX8(EP_IN, ep_addr);
+  ep_in.claimed = false;
+  return true;
+}
+
+static bool stub_usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes, int num_calls) {
+  (void) rhport; (void) num_calls;
+  TEST_ASSERT_EQUAL_HEX8(EP_IN, ep_addr);
+  TEST_ASSERT_TRUE(ep_in.claimed);
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(host_rx) - host_rx_len, total_bytes);
+  TEST_ASSERT_EQUAL(0, total_bytes % 4);
+
+  if (total_bytes) memcpy(host_rx + host_rx_len, buffer, total_bytes);
+  host_rx_len += total_bytes;
+
+  ep_in.busy = true;
+  ep_in.claimed = false;
+  ep_in.len = total_bytes;
+  return true;
+}
+
+// Host reads IN endpoint until device has nothing left to send
+static void host_read_all(void) {
+  while (ep_in.busy) {
+    ep_in.busy = false;
+    TEST_ASSERT_TRUE(midid_xfer_cb(0, EP_IN, XFER_RESULT_SUCCESS, ep_in.len));
+  }
+}
+
+// Write whole buffer in chunks, host reads in between when FIFO is full
+static void stream_write(uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize, uint32_t chunk_max) {
+  uint32_t i = 0;
+  while (i < bufsize) {
+    uint32_t const chunk = tu_min32(1 + random_next() % chunk_max, bufsize - i);
+    i += tud_midi_n_stream_write(0, cable_num, buffer + i, chunk);
+    host_read_all();
+  }
+}
+
+// Random sequence of complete messages, mostly SysEx of any length
+static uint32_t random_messages(uint8_t* buffer, uint32_t size) {
+  uint32_t n = 0;
+
+  while (n + 64 < size) {
+    switch (random_next() % 6) {
+      case 0:
+      case 1:
+      case 2: {
+        uint32_t const len = random_next() % 40;
+        buffer[n++] = MIDI_STATUS_SYSEX_START;
+        for (uint32_t i = 0; i < len; i++) buffer[n++] = (uint8_t) (random_next() & 0x7f);
+        buffer[n++] = MIDI_STATUS_SYSEX_END;
+        break;
+      }
+
+      case 3:
+        buffer[n++] = (uint8_t) (0x90 | (random_next() & 0x0f));
+        buffer[n++] = (uint8_t) (random_next() & 0x7f);
+        buffer[n++] = (uint8_t) (random_next() & 0x7f);
+        break;
+
+      case 4:
+        buffer[n++] = (uint8_t) (0xC0 | (random_next() & 0x0f));
+        buffer[n++] = (uint8_t) (random_next() & 0x7f);
+        break;
+
+      default: {
+        uint8_t const sys[] = { MIDI_STATUS_SYSCOM_SONG_POSITION_POINTER, MIDI_STATUS_SYSCOM_SONG_SELECT,
+                                MIDI_STATUS_SYSCOM_TUNE_REQUEST, MIDI_STATUS_SYSREAL_TIMING_CLOCK };
+        uint8_t const status = sys[random_next() % TU_ARRAY_SIZE(sys)];
+        buffer[n++] = status;
+        if (status == MIDI_STATUS_SYSCOM_SONG_POSITION_POINTER) buffer[n++] = (uint8_t) (random_next() & 0x7f);
+        if (status <= MIDI_STATUS_SYSCOM_SONG_SELECT) buffer[n++] = (uint8_t) (random_next() & 0x7f);
+        break;
+      }
+    }
+  }
+
+  return n;
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+
+void setUp(void) {
+  usbd_edpt_open_StubWithCallback(stub_usbd_edpt_open);
+  usbd_edpt_claim_StubWithCallback(stub_usbd_edpt_claim);
+  usbd_edpt_release_StubWithCallback(stub_usbd_edpt_release);
+  usbd_edpt_xfer_StubWithCallback(stub_usbd_edpt_xfer);
+
+  memset(&ep_in, 0, sizeof(ep_in));
+  host_rx_len = 0;
+
+  midid_init();
+  TEST_ASSERT_EQUAL(DESC_LEN, midid_open(0, DESC_ITF, DESC_LEN));
+}
+
+void tearDown(void) {
+  midid_reset(0);
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+void test_sysex_end_cin(void) {
+  // SysEx ends with 1, 2 or 3 bytes in last packet
+  uint8_t const msg[] = {
+    0xF0, 0x01, 0x02, 0xF7,
+    0xF0, 0xF7,
+    0xF0, 0x01, 0xF7,
+    0xF0, 0x01, 0x02, 0x03, 0x04, 0xF7,
+  };
+  uint8_t const expected[] = {
+    0x14, 0xF0, 0x01, 0x02,   0x15, 0xF7, 0x00, 0x00,
+    0x16, 0xF0, 0xF7, 0x00,
+    0x17, 0xF0, 0x01, 0xF7,
+    0x14, 0xF0, 0x01, 0x02,   0x17, 0x03, 0x04, 0xF7,
+  };
+
+  TEST_ASSERT_EQUAL(sizeof(msg), tud_midi_n_stream_write(0, 1, msg, sizeof(msg)));
+  host_read_all();
+
+  TEST_ASSERT_EQUAL(sizeof(expected), host_rx_len);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, host_rx, sizeof(expected));
+}
+
+void test_sysex_byte_by_byte(void) {
+  uint8_t const msg[] = { 0xF0, 0x7E, 0x7F, 0x06, 0x01, 0xF7, 0x90, 0x3C, 0x40 };
+  uint8_t const expected[] = {
+    0x04, 0xF0, 0x7E, 0x7F,   0x07, 0x06, 0x01, 0xF7,   0x09, 0x90, 0x3C, 0x40,
+  };
+
+  // every chunk boundary inside a packet
+  for (uint32_t i = 0; i < sizeof(msg); i++) {
+    TEST_ASSERT_EQUAL(1, tud_midi_n_stream_write(0, 0, msg + i, 1));
+  }
+  host_read_all();
+
+  TEST_ASSERT_EQUAL(sizeof(expected), host_rx_len);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, host_rx, sizeof(expected));
+}
+
+void test_stream_write_random(void) {
+  static uint8_t msg[1024];
+  static uint8_t ref_packets[4096];
+
+  for (uint32_t round = 0; round < 2000; round++) {
+    uint32_t const len = random_messages(msg, sizeof(msg));
+    uint8_t const cable_num = (uint8_t) (random_next() % 2);
+
+    // small chunks split most packets, large chunks fill the FIFO
+    host_rx_len = 0;
+    stream_write(cable_num, msg, len, (round & 1) ? 5 : 300);
+
+    ref_stream_t ref = { 0 };
+    uint32_t const ref_len = ref_stream_write(&ref, cable_num, msg, len, ref_packets);
+
+    TEST_ASSERT_EQUAL(ref_len, host_rx_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ref_packets, host_rx, ref_len);
+  }
+}
+
+void test_packet_write_n(void) {
+  enum { N_PACKETS = CFG_TUD_MIDI_TX_BUFSIZE/4 + 8 };
+  uint8_t packets[N_PACKETS * 4];
+  for (uint32_t i = 0; i < sizeof(packets); i++) packets[i] = (uint8_t) i;
+
+  // only as many packets as fit in FIFO are written
+  uint32_t const count = tud_midi_n_packet_write_n(0, packets, N_PACKETS);
+  TEST_ASSERT_EQUAL(CFG_TUD_MIDI_TX_BUFSIZE/4, count);
+
+  host_read_all();
+  TEST_ASSERT_EQUAL(4 * count, host_rx_len);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(packets, host_rx, 4 * count);
+
+  TEST_ASSERT_EQUAL(N_PACKETS - count, tud_midi_n_packet_write_n(0, packets + 4 * count, N_PACKETS - count));
+  host_read_all();
+  TEST_ASSERT_EQUAL(sizeof(packets), host_rx_len);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(packets, host_rx, sizeof(packets));
+}
@@ -29,6 +29,7 @@
 #include "tusb_fifo.h"
 #include "tusb.h"
 #include "usbd.h"
+#include "usbd_pvt.h"
 TEST_FILE("usbd_control.c")
 
 // Mock File
@@ -242,3 +243,22 @@ void test_usbd_control_in_zlp(void)
 
   tud_task();
 }
+
+//--------------------------------------------------------------------+
+// SOF
+//--------------------------------------------------------------------+
+
+void test_usbd_sof_enable_multiple_consumers(void)
+{
+  // SOF interrupt is enabled by the first consumer
+  dcd_sof_enable_Expect(rhport, true);
+  usbd_sof_enable(rhport, SOF_CONSUMER_AUDIO, true);
+  usbd_sof_enable(rhport, SOF_CONSUMER_NCM, true);
+
+  // and only disabled when no consumer needs it anymore
+  usbd_sof_enable(rhport, SOF_CONSUMER_AUDIO, false);
+  usbd_sof_enable(rhport, SOF_CONSUMER_AUDIO, false);
+
+  dcd_sof_enable_Expect(rhport, false);
+  usbd_sof_enable(rhport, SOF_CONSUMER_NCM, false);
+}
@@ -0,0 +1,308 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+
+// Files to test
+#include "video_convert.h"
+
+// Every conversion is checked against a whole frame reference, which first decodes the source into an RGB image and
+// then lays out the converted frame, for payloads of various sizes and odd offsets. Benchmark compares converting
+// while preparing payloads with converting the frame first and copying payloads out of it, it only prints timing and
+// is built with -DVIDEO_CONVERT_BENCHMARK.
+// Color space conversion is checked against known values.
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+enum {
+  W_MAX     = 64,
+  H_MAX     = 16,
+  PIXEL_MAX = W_MAX * H_MAX,
+  FRAME_MAX = 2 * PIXEL_MAX,
+};
+
+static uint8_t src[3 * PIXEL_MAX];
+static uint8_t rgb[3 * PIXEL_MAX];
+static uint8_t ref[FRAME_MAX];
+static uint8_t out[FRAME_MAX + 1];
+
+static uint32_t _seed = 1;
+
+static void fill_random(uint8_t* buf, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    _seed = _seed * 1103515245u + 12345u;
+    buf[i] = (uint8_t) (_seed >> 16);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Reference
+//--------------------------------------------------------------------+
+static uint8_t ref_y(uint8_t const* p) {
+  return (uint8_t) ((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) / 256 + 16);
+}
+
+static uint8_t ref_u(int r, int g, int b) {
+  return (uint8_t) ((-38 * r - 74 * g + 112 * b + 128 + 256 * 128) / 256);
+}
+
+static uint8_t ref_v(int r, int g, int b) {
+  return (uint8_t) ((112 * r - 94 * g - 18 * b + 128 + 256 * 128) / 256);
+}
+
+static void ref_decode_rgb(bool rgb565, int w, int h) {
+  for (int i = 0; i < w * h; i++) {
+    if (rgb565) {
+      int const v = src[2 * i] | (src[2 * i + 1] << 8);
+      int const r5 = v >> 11, g6 = (v >> 5) & 63, b5 = v & 31;
+      rgb[3 * i]     = (uint8_t) ((r5 << 3) | (r5 >> 2));
+      rgb[3 * i + 1] = (uint8_t) ((g6 << 2) | (g6 >> 4));
+      rgb[3 * i + 2] = (uint8_t) ((b5 << 3) | (b5 >> 2));
+    } else {
+      memcpy(&rgb[3 * i], &src[3 * i], 3);
+    }
+  }
+}
+
+// Sample of color c (0: R, 1: G, 2: B) at x, y for pattern 0: RGGB, 1: GRBG, 2: GBRG, 3: BGGR
+static int ref_bayer_color(int pattern, int x, int y) {
+  int const pos = (((y & 1) << 1) | (x & 1)) ^ pattern;
+  return pos == 0 ? 0 : (pos == 3 ? 2 : 1);
+}
+
+static void ref_demosaic(int pattern, int w, int h) {
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      int const x0 = x < w - 1 ? x : w - 2;
+      int const y0 = y < h - 1 ? y : h - 2;
+      int sum[3] = { 0 }, cnt[3] = { 0 };
+      for (int dy = 0; dy < 2; dy++) {
+        for (int dx = 0; dx < 2; dx++) {
+          int const c = ref_bayer_color(pattern, x0 + dx, y0 + dy);
+          sum[c] += src[(y0 + dy) * w + x0 + dx];
+          cnt[c]++;
+        }
+      }
+      for (int c = 0; c < 3; c++) {
+        rgb[3 * (y * w + x) + c] = (uint8_t) ((sum[c] + cnt[c] / 2) / cnt[c]);
+      }
+    }
+  }
+}
+
+static void ref_yuy2(int w, int h) {
+  for (int i = 0; i < w * h; i += 2) {
+    uint8_t const* p0 = &rgb[3 * i];
+    uint8_t const* p1 = &rgb[3 * i + 3];
+    int const r = (p0[0] + p1[0] + 1) / 2, g = (p0[1] + p1[1] + 1) / 2, b = (p0[2] + p1[2] + 1) / 2;
+    ref[2 * i]     = ref_y(p0);
+    ref[2 * i + 1] = ref_u(r, g, b);
+    ref[2 * i + 2] = ref_y(p1);
+    ref[2 * i + 3] = ref_v(r, g, b);
+  }
+}
+
+static void ref_nv12(int w, int h) {
+  uint8_t* uv = ref + w * h;
+  for (int i = 0; i < w * h; i++) ref[i] = ref_y(&rgb[3 * i]);
+  for (int y = 0; y < h; y += 2) {
+    for (int x = 0; x < w; x += 2) {
+      int sum[3] = { 0 };
+      for (int c = 0; c < 3; c++) {
+        sum[c] = (rgb[3 * (y * w + x) + c] + rgb[3 * (y * w + x + 1) + c] + rgb[3 * ((y + 1) * w + x) + c] +
+                  rgb[3 * ((y + 1) * w + x + 1) + c] + 2) / 4;
+      }
+      *uv++ = ref_u(sum[0], sum[1], sum[2]);
+      *uv++ = ref_v(sum[0], sum[1], sum[2]);
+    }
+  }
+}
+
+static uint32_t ref_convert(video_convert_t convert, int w, int h) {
+  switch (convert) {
+    case VIDEO_CONVERT_RGB565_TO_YUY2: ref_decode_rgb(true, w, h); ref_yuy2(w, h); return (uint32_t) (2 * w * h);
+    case VIDEO_CONVERT_RGB888_TO_YUY2: ref_decode_rgb(false, w, h); ref_yuy2(w, h); return (uint32_t) (2 * w * h);
+    case VIDEO_CONVERT_RGB565_TO_NV12: ref_decode_rgb(true, w, h); ref_nv12(w, h); return (uint32_t) (3 * w * h / 2);
+    case VIDEO_CONVERT_RGB888_TO_NV12: ref_decode_rgb(false, w, h); ref_nv12(w, h); return (uint32_t) (3 * w * h / 2);
+    default:
+      ref_demosaic(convert - VIDEO_CONVERT_BAYER_RGGB_TO_YUY2, w, h);
+      ref_yuy2(w, h);
+      return (uint32_t) (2 * w * h);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_color_space(void) {
+  // black, white, red, green, blue of BT.601 limited range, green is 144.5 rounded down by the fixed point formula
+  uint8_t const rgb_in[5][3] = { { 0, 0, 0 }, { 255, 255, 255 }, { 255, 0, 0 }, { 0, 255, 0 }, { 0, 0, 255 } };
+  uint8_t const yuv[5][3] = { { 16, 128, 128 }, { 235, 128, 128 }, { 82, 90, 240 }, { 144, 54, 34 }, { 41, 240, 110 } };
+
+  for (int i = 0; i < 5; i++) {
+    TEST_ASSERT_EQUAL_UINT8(yuv[i][0], tu_video_rgb_to_y(rgb_in[i][0], rgb_in[i][1], rgb_in[i][2]));
+    TEST_ASSERT_EQUAL_UINT8(yuv[i][1], tu_video_rgb_to_u(rgb_in[i][0], rgb_in[i][1], rgb_in[i][2]));
+    TEST_ASSERT_EQUAL_UINT8(yuv[i][2], tu_video_rgb_to_v(rgb_in[i][0], rgb_in[i][1], rgb_in[i][2]));
+  }
+}
+
+void test_frame_size(void) {
+  TEST_ASSERT_EQUAL_UINT32(640 * 480 * 2, tu_video_convert_frame_size(VIDEO_CONVERT_RGB565_TO_YUY2, 640, 480));
+  TEST_ASSERT_EQUAL_UINT32(640 * 480 * 3 / 2, tu_video_convert_frame_size(VIDEO_CONVERT_RGB888_TO_NV12, 640, 480));
+  TEST_ASSERT_EQUAL_UINT32(640 * 480 * 2, tu_video_convert_frame_size(VIDEO_CONVERT_BAYER_BGGR_TO_YUY2, 640, 480));
+}
+
+void test_convert_payloads(void) {
+  // frame sizes including the smallest ones and a single row
+  uint16_t const sizes[][2] = { { 2, 2 }, { 4, 2 }, { 2, 4 }, { 6, 1 }, { 10, 6 }, { W_MAX, H_MAX } };
+  // payload data lengths, odd ones cut macropixels and chroma pairs at every position
+  uint32_t const payloads[] = { 1, 2, 3, 5, 7, 64, 1023, FRAME_MAX };
+
+  for (video_convert_t convert = VIDEO_CONVERT_RGB565_TO_YUY2; convert <= VIDEO_CONVERT_BAYER_BGGR_TO_YUY2; convert++) {
+    bool const nv12 = (convert == VIDEO_CONVERT_RGB565_TO_NV12 || convert == VIDEO_CONVERT_RGB888_TO_NV12);
+    bool const bayer = (convert >= VIDEO_CONVERT_BAYER_RGGB_TO_YUY2);
+
+    for (size_t s = 0; s < TU_ARRAY_SIZE(sizes); s++) {
+      uint16_t const w = sizes[s][0], h = sizes[s][1];
+      if ((nv12 && (h & 1)) || (bayer && h < 2)) continue;
+
+      fill_random(src, sizeof(src));
+      uint32_t const size = ref_convert(convert, w, h);
+      TEST_ASSERT_EQUAL_UINT32(size, tu_video_convert_frame_size(convert, w, h));
+
+      for (size_t p = 0; p < TU_ARRAY_SIZE(payloads); p++) {
+        memset(out, 0xAA, sizeof(out));
+        for (uint32_t ofs = 0; ofs < size; ofs += payloads[p]) {
+          tu_video_convert(convert, out + ofs, ofs, tu_min32(payloads[p], size - ofs), src, w, h);
+        }
+        char msg[64];
+        snprintf(msg, sizeof(msg), "convert %d, %ux%u, payload %u", convert, w, h, (unsigned) payloads[p]);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(ref, out, size, msg);
+        TEST_ASSERT_EQUAL_HEX8_MESSAGE(0xAA, out[size], msg);
+      }
+    }
+  }
+}
+
+void test_convert_bayer_flat(void) {
+  // flat colored field: every pixel gets the same color at the frame edges too
+  enum { W = 8, H = 4 };
+  uint8_t const rggb[4] = { 200, 100, 100, 50 };
+
+  for (int y = 0; y < H; y++) {
+    for (int x = 0; x < W; x++) src[y * W + x] = rggb[((y & 1) << 1) | (x & 1)];
+  }
+  tu_video_convert(VIDEO_CONVERT_BAYER_RGGB_TO_YUY2, out, 0, 2 * W * H, src, W, H);
+
+  uint8_t const y = tu_video_rgb_to_y(200, 100, 50);
+  uint8_t const u = tu_video_rgb_to_u(200, 100, 50);
+  uint8_t const v = tu_video_rgb_to_v(200, 100, 50);
+  for (int i = 0; i < W * H / 2; i++) {
+    uint8_t const expected[4] = { y, u, y, v };
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out + 4 * i, 4);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Benchmark: 320x240 frame sent in 1023-byte payloads
+//--------------------------------------------------------------------+
+#ifdef VIDEO_CONVERT_BENCHMARK
+enum {
+  BENCH_ROUNDS  = 50,
+  BENCH_W       = 320,
+  BENCH_H       = 240,
+  BENCH_PAYLOAD = 1023,
+};
+
+static uint8_t bench_src[3 * BENCH_W * BENCH_H];
+static uint8_t bench_frame[2 * BENCH_W * BENCH_H];
+static uint8_t bench_ep[BENCH_PAYLOAD];
+
+static double bench_us(clock_t start) {
+  return (double) (clock() - start) * 1e6 / CLOCKS_PER_SEC / BENCH_ROUNDS;
+}
+
+void test_benchmark(void) {
+  video_convert_t const converts[] = { VIDEO_CONVERT_RGB565_TO_YUY2, VIDEO_CONVERT_RGB888_TO_YUY2,
+                                       VIDEO_CONVERT_RGB565_TO_NV12, VIDEO_CONVERT_BAYER_RGGB_TO_YUY2 };
+  char const* const names[] = { "RGB565 to YUY2", "RGB888 to YUY2", "RGB565 to NV12", "Bayer to YUY2" };
+  uint32_t check = 0;
+
+  fill_random(bench_src, sizeof(bench_src));
+
+  for (size_t c = 0; c < TU_ARRAY_SIZE(converts); c++) {
+    uint32_t const size = tu_video_convert_frame_size(converts[c], BENCH_W, BENCH_H);
+    double t_copy, t_two_pass, t_fused;
+    clock_t start;
+
+    // frame already in the streamed format: payloads are only copied
+    start = clock();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint32_t ofs = 0; ofs < size; ofs += BENCH_PAYLOAD) {
+        memcpy(bench_ep, bench_frame + ofs, tu_min32(BENCH_PAYLOAD, size - ofs));
+        check += bench_ep[0];
+      }
+    }
+    t_copy = bench_us(start);
+
+    // frame converted into a frame buffer, payloads copied out of it
+    start = clock();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      tu_video_convert(converts[c], bench_frame, 0, size, bench_src, BENCH_W, BENCH_H);
+      for (uint32_t ofs = 0; ofs < size; ofs += BENCH_PAYLOAD) {
+        memcpy(bench_ep, bench_frame + ofs, tu_min32(BENCH_PAYLOAD, size - ofs));
+        check += bench_ep[0];
+      }
+    }
+    t_two_pass = bench_us(start);
+
+    // each payload converted straight into the endpoint buffer
+    start = clock();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint32_t ofs = 0; ofs < size; ofs += BENCH_PAYLOAD) {
+        tu_video_convert(converts[c], bench_ep, ofs, tu_min32(BENCH_PAYLOAD, size - ofs), bench_src, BENCH_W, BENCH_H);
+        check += bench_ep[0];
+      }
+    }
+    t_fused = bench_us(start);
+
+    TEST_ASSERT_NOT_EQUAL(0, check);
+    printf("%s %ux%u: copy only %.1f us, convert then copy %.1f us, fused %.1f us per frame\n",
+           names[c], BENCH_W, BENCH_H, t_copy, t_two_pass, t_fused);
+  }
+}
+
+#endif
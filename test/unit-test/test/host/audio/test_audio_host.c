@@ -0,0 +1,648 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Loopback of audio host driver against audio device driver: isochronous transfers of the host are exchanged with
+// the device driver once per frame, control requests are run on the device driver in-process.
+
+#include <string.h>
+#include "unity.h"
+
+// Files to test
+#include "osal/osal.h"
+#include "tusb_fifo.h"
+#include "audio_host.h"
+#include "audio_device.h"
+TEST_FILE("audio_device.c")
+
+// Mock File
+#include "mock_usbd.h"
+#include "mock_usbd_pvt.h"
+#include "mock_usbh.h"
+#include "mock_usbh_pvt.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum {
+  DADDR      = 1,
+  ITF_AC     = 0,
+  ITF_SPK    = 1,
+  ITF_MIC    = 2,
+  CLOCK_ID   = 4,
+  EP_SPK     = 0x01,
+  EP_FB      = 0x81,
+  EP_MIC     = 0x82,
+  EP_SPK_SZ  = 196, // 49 stereo 16-bit samples
+  EP_MIC_SZ  = 98,  // 49 mono 16-bit samples
+};
+
+enum {
+  STREAM_SPK = 0,
+  STREAM_MIC = 1,
+};
+
+#define AC_TOTAL_LEN  (TUD_AUDIO_DESC_CLK_SRC_LEN + 2*TUD_AUDIO_DESC_INPUT_TERM_LEN + 2*TUD_AUDIO_DESC_OUTPUT_TERM_LEN)
+
+// UAC2 headset: USB streaming -> speaker, microphone -> USB streaming, both clocked by a programmable clock source
+uint8_t const desc_audio[] = {
+  TUD_AUDIO_DESC_IAD(ITF_AC, 3, 0),
+  TUD_AUDIO_DESC_STD_AC(ITF_AC, 0, 0),
+  TUD_AUDIO_DESC_CS_AC(0x0200, AUDIO_FUNC_HEADSET, AC_TOTAL_LEN, 0),
+  TUD_AUDIO_DESC_CLK_SRC(CLOCK_ID, AUDIO_CLOCK_SOURCE_ATT_INT_PRO_CLK, (AUDIO_CTRL_RW << AUDIO_CLOCK_SOURCE_CTRL_CLK_FRQ_POS), 0, 0),
+  TUD_AUDIO_DESC_INPUT_TERM(1, AUDIO_TERM_TYPE_USB_STREAMING, 0, CLOCK_ID, 2, AUDIO_CHANNEL_CONFIG_NON_PREDEFINED, 0, 0, 0),
+  TUD_AUDIO_DESC_OUTPUT_TERM(3, AUDIO_TERM_TYPE_OUT_GENERIC_SPEAKER, 0, 1, CLOCK_ID, 0, 0),
+  TUD_AUDIO_DESC_INPUT_TERM(5, AUDIO_TERM_TYPE_IN_GENERIC_MIC, 0, CLOCK_ID, 1, AUDIO_CHANNEL_CONFIG_NON_PREDEFINED, 0, 0, 0),
+  TUD_AUDIO_DESC_OUTPUT_TERM(7, AUDIO_TERM_TYPE_USB_STREAMING, 0, 5, CLOCK_ID, 0, 0),
+
+  // speaker: asynchronous with explicit feedback
+  TUD_AUDIO_DESC_STD_AS_INT(ITF_SPK, 0, 0, 0),
+  TUD_AUDIO_DESC_STD_AS_INT(ITF_SPK, 1, 2, 0),
+  TUD_AUDIO_DESC_CS_AS_INT(1, AUDIO_CTRL_NONE, AUDIO_FORMAT_TYPE_I, AUDIO_DATA_FORMAT_TYPE_I_PCM, 2, AUDIO_CHANNEL_CONFIG_NON_PREDEFINED, 0),
+  TUD_AUDIO_DESC_TYPE_I_FORMAT(2, 16),
+  TUD_AUDIO_DESC_STD_AS_ISO_EP(EP_SPK, (uint8_t) (TUSB_XFER_ISOCHRONOUS | TUSB_ISO_EP_ATT_ASYNCHRONOUS | TUSB_ISO_EP_ATT_DATA), EP_SPK_SZ, 1),
+  TUD_AUDIO_DESC_CS_AS_ISO_EP(AUDIO_CS_AS_ISO_DATA_EP_ATT_NON_MAX_PACKETS_OK, AUDIO_CTRL_NONE, AUDIO_CS_AS_ISO_DATA_EP_LOCK_DELAY_UNIT_UNDEFINED, 0),
+  TUD_AUDIO_DESC_STD_AS_ISO_FB_EP(EP_FB, 1),
+
+  // microphone
+  TUD_AUDIO_DESC_STD_AS_INT(ITF_MIC, 0, 0, 0),
+  TUD_AUDIO_DESC_STD_AS_INT(ITF_MIC, 1, 1, 0),
+  TUD_AUDIO_DESC_CS_AS_INT(7, AUDIO_CTRL_NONE, AUDIO_FORMAT_TYPE_I, AUDIO_DATA_FORMAT_TYPE_I_PCM, 1, AUDIO_CHANNEL_CONFIG_NON_PREDEFINED, 0),
+  TUD_AUDIO_DESC_TYPE_I_FORMAT(2, 16),
+  TUD_AUDIO_DESC_STD_AS_ISO_EP(EP_MIC, (uint8_t) (TUSB_XFER_ISOCHRONOUS | TUSB_ISO_EP_ATT_ASYNCHRONOUS | TUSB_ISO_EP_ATT_DATA), EP_MIC_SZ, 1),
+  TUD_AUDIO_DESC_CS_AS_ISO_EP(AUDIO_CS_AS_ISO_DATA_EP_ATT_NON_MAX_PACKETS_OK, AUDIO_CTRL_NONE, AUDIO_CS_AS_ISO_DATA_EP_LOCK_DELAY_UNIT_UNDEFINED, 0),
+};
+
+TU_VERIFY_STATIC(sizeof(desc_audio) == CFG_TUD_AUDIO_FUNC_1_DESC_LEN, "descriptor length mismatch");
+
+// UAC1 speaker and MIDIStreaming interface in the same audio interface collection
+uint8_t const desc_uac1_midi[] = {
+  // AudioControl: header with 2 interfaces in collection
+  9, TUSB_DESC_INTERFACE, ITF_AC, 0, 0, TUSB_CLASS_AUDIO, AUDIO_SUBCLASS_CONTROL, AUDIO_FUNC_PROTOCOL_CODE_UNDEF, 0,
+  10, TUSB_DESC_CS_INTERFACE, AUDIO_CS_AC_INTERFACE_HEADER, U16_TO_U8S_LE(0x0100), U16_TO_U8S_LE(10), 2, ITF_SPK, ITF_MIC,
+
+  // AudioStreaming: 48 kHz stereo 16-bit
+  9, TUSB_DESC_INTERFACE, ITF_SPK, 0, 0, TUSB_CLASS_AUDIO, AUDIO_SUBCLASS_STREAMING, AUDIO_FUNC_PROTOCOL_CODE_UNDEF, 0,
+  9, TUSB_DESC_INTERFACE, ITF_SPK, 1, 1, TUSB_CLASS_AUDIO, AUDIO_SUBCLASS_STREAMING, AUDIO_FUNC_PROTOCOL_CODE_UNDEF, 0,
+  7, TUSB_DESC_CS_INTERFACE, AUDIO_CS_AS_INTERFACE_AS_GENERAL, 1, 1, U16_TO_U8S_LE(AUDIO10_DATA_FORMAT_TYPE_I_PCM),
+  11, TUSB_DESC_CS_INTERFACE, AUDIO_CS_AS_INTERFACE_FORMAT_TYPE, AUDIO_FORMAT_TYPE_I, 2, 2, 16, 1, TU_U32_BYTE0(48000), TU_U32_BYTE1(48000), TU_U32_BYTE2(48000),
+  9, TUSB_DESC_ENDPOINT, EP_SPK, (uint8_t) (TUSB_XFER_ISOCHRONOUS | TUSB_ISO_EP_ATT_ADAPTIVE), U16_TO_U8S_LE(192), 1, 0, 0,
+  7, TUSB_DESC_CS_ENDPOINT, AUDIO_CS_EP_SUBTYPE_GENERAL, 0, 0, U16_TO_U8S_LE(0),
+
+  // MIDIStreaming: belongs to MIDI driver
+  9, TUSB_DESC_INTERFACE, ITF_MIC, 0, 0, TUSB_CLASS_AUDIO, AUDIO_SUBCLASS_MIDI_STREAMING, AUDIO_FUNC_PROTOCOL_CODE_UNDEF, 0,
+  7, TUSB_DESC_CS_INTERFACE, 0x01, U16_TO_U8S_LE(0x0100), U16_TO_U8S_LE(7),
+};
+
+// skip interface association
+#define DESC_ITF    ((tusb_desc_interface_t const*) (desc_audio + TUD_AUDIO_DESC_IAD_LEN))
+#define DESC_LEN    ((uint16_t) (sizeof(desc_audio) - TUD_AUDIO_DESC_IAD_LEN))
+
+typedef struct {
+  uint8_t* buffer;
+  uint16_t len;
+  bool pending;
+} fake_xfer_t;
+
+// index by endpoint number
+static fake_xfer_t dev_xfer[3][2];
+static fake_xfer_t host_xfer[3][2];
+
+// one control transfer at a time
+static struct {
+  bool pending;
+  tuh_xfer_t xfer;
+  tusb_control_request_t setup;
+} host_ctrl;
+
+static struct {
+  uint8_t* buffer;
+  uint16_t len;
+} dev_ctrl;
+
+static bool config_complete;
+static uint8_t config_itf_last;
+static uint32_t dev_sample_rate;
+static uint8_t set_itf_count;
+
+static struct {
+  uint8_t count;
+  bool success;
+} open_cb;
+static uint8_t close_cb_count;
+
+static uint16_t tx_len[64];
+static uint8_t tx_count;
+static uint32_t rx_total;
+
+static fake_xfer_t* get_xfer(fake_xfer_t xfer[3][2], uint8_t ep_addr) {
+  return &xfer[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+}
+
+//--------------------------------------------------------------------+
+// Device stack
+//--------------------------------------------------------------------+
+
+static bool stub_usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep, int num_calls) {
+  (void) rhport; (void) desc_ep; (void) num_calls;
+  return true;
+}
+
+static void stub_usbd_edpt_close(uint8_t rhport, uint8_t ep_addr, int num_calls) {
+  (void) rhport; (void) num_calls;
+  get_xfer(dev_xfer, ep_addr)->pending = false;
+}
+
+static bool stub_usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr, int num_calls) {
+  (void) rhport; (void) num_calls;
+  return get_xfer(dev_xfer, ep_addr)->pending;
+}
+
+static bool stub_usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes, int num_calls) {
+  (void) rhport; (void) num_calls;
+
+  fake_xfer_t* xfer = get_xfer(dev_xfer, ep_addr);
+  TEST_ASSERT_FALSE(xfer->pending);
+  *xfer = (fake_xfer_t) { .buffer = buffer, .len = total_bytes, .pending = true };
+  return true;
+}
+
+static bool stub_tud_control_xfer(uint8_t rhport, tusb_control_request_t const* request, void* buffer, uint16_t len,
+                                  int num_calls) {
+  (void) rhport; (void) request; (void) num_calls;
+  dev_ctrl.buffer = (uint8_t*) buffer;
+  dev_ctrl.len = len;
+  return true;
+}
+
+static bool stub_tud_control_status(uint8_t rhport, tusb_control_request_t const* request, int num_calls) {
+  (void) rhport; (void) request; (void) num_calls;
+  dev_ctrl.buffer = NULL;
+  dev_ctrl.len = 0;
+  return true;
+}
+
+// Clock source only supports 44.1 and 48 kHz, 48 kHz is off by a few Hz
+bool tud_audio_set_req_entity_cb(uint8_t rhport, tusb_control_request_t const* p_request, uint8_t* pBuff) {
+  (void) rhport;
+  TU_VERIFY(CLOCK_ID == TU_U16_HIGH(p_request->wIndex) && AUDIO_CS_CTRL_SAM_FREQ == TU_U16_HIGH(p_request->wValue));
+  TU_VERIFY(AUDIO_CS_REQ_CUR == p_request->bRequest && 4 == p_request->wLength);
+
+  uint32_t const rate = tu_unaligned_read32(pBuff);
+  TU_VERIFY(rate == 44100 || rate == 48000);
+
+  dev_sample_rate = (rate == 48000) ? 48003 : rate;
+  return true;
+}
+
+bool tud_audio_get_req_entity_cb(uint8_t rhport, tusb_control_request_t const* p_request) {
+  TU_VERIFY(CLOCK_ID == TU_U16_HIGH(p_request->wIndex) && AUDIO_CS_CTRL_SAM_FREQ == TU_U16_HIGH(p_request->wValue));
+  TU_VERIFY(AUDIO_CS_REQ_CUR == p_request->bRequest);
+
+  return tud_audio_buffer_and_schedule_control_xfer(rhport, p_request, &dev_sample_rate, sizeof(dev_sample_rate));
+}
+
+//--------------------------------------------------------------------+
+// Host stack
+//--------------------------------------------------------------------+
+
+static bool stub_tuh_edpt_open(uint8_t daddr, tusb_desc_endpoint_t const* desc_ep, int num_calls) {
+  (void) daddr; (void) num_calls;
+  TEST_ASSERT_EQUAL(TUSB_XFER_ISOCHRONOUS, desc_ep->bmAttributes.xfer);
+  return true;
+}
+
+static bool stub_tuh_edpt_close(uint8_t daddr, uint8_t ep_addr, int num_calls) {
+  (void) daddr; (void) num_calls;
+  TEST_ASSERT_FALSE(get_xfer(host_xfer, ep_addr)->pending);
+  return true;
+}
+
+static bool stub_usbh_edpt_claim(uint8_t daddr, uint8_t ep_addr, int num_calls) {
+  (void) daddr; (void) num_calls;
+  return !get_xfer(host_xfer, ep_addr)->pending;
+}
+
+static bool stub_usbh_edpt_release(uint8_t daddr, uint8_t ep_addr, int num_calls) {
+  (void) daddr; (void) ep_addr; (void) num_calls;
+  return true;
+}
+
+static bool stub_usbh_edpt_xfer_with_callback(uint8_t daddr, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes,
+                                              tuh_xfer_cb_t complete_cb, uintptr_t user_data, int num_calls) {
+  (void) daddr; (void) complete_cb; (void) user_data; (void) num_calls;
+
+  fake_xfer_t* xfer = get_xfer(host_xfer, ep_addr);
+  TEST_ASSERT_FALSE(xfer->pending);
+  *xfer = (fake_xfer_t) { .buffer = buffer, .len = total_bytes, .pending = true };
+  return true;
+}
+
+static tusb_speed_t stub_speed_get(int num_calls) {
+  (void) num_calls;
+  return TUSB_SPEED_FULL;
+}
+
+static tusb_speed_t stub_tuh_speed_get(uint8_t daddr, int num_calls) {
+  (void) daddr; (void) num_calls;
+  return TUSB_SPEED_FULL;
+}
+
+static bool stub_tuh_control_xfer(tuh_xfer_t* xfer, int num_calls) {
+  (void) num_calls;
+  TEST_ASSERT_FALSE(host_ctrl.pending);
+
+  host_ctrl.pending = true;
+  host_ctrl.xfer    = *xfer;
+  host_ctrl.setup   = *xfer->setup;
+  host_ctrl.xfer.setup = &host_ctrl.setup;
+  return true;
+}
+
+static bool stub_tuh_interface_set(uint8_t daddr, uint8_t itf_num, uint8_t itf_alt, tuh_xfer_cb_t complete_cb,
+                                   uintptr_t user_data, int num_calls) {
+  (void) num_calls;
+
+  tusb_control_request_t const request = {
+    .bmRequestType = 0x01,
+    .bRequest      = TUSB_REQ_SET_INTERFACE,
+    .wValue        = itf_alt,
+    .wIndex        = itf_num,
+    .wLength       = 0
+  };
+
+  tuh_xfer_t xfer = {
+    .daddr       = daddr,
+    .setup       = &request,
+    .complete_cb = complete_cb,
+    .user_data   = user_data
+  };
+
+  set_itf_count++;
+  return stub_tuh_control_xfer(&xfer, 0);
+}
+
+static void stub_usbh_driver_set_config_complete(uint8_t daddr, uint8_t itf_num, int num_calls) {
+  (void) num_calls;
+  TEST_ASSERT_EQUAL(DADDR, daddr);
+  TEST_ASSERT_EQUAL(config_itf_last, itf_num);
+  config_complete = true;
+}
+
+void tuh_audio_stream_open_cb(uint8_t idx, uint8_t stream, bool success) {
+  (void) idx; (void) stream;
+  open_cb.count++;
+  open_cb.success = success;
+}
+
+void tuh_audio_stream_close_cb(uint8_t idx, uint8_t stream) {
+  (void) idx; (void) stream;
+  close_cb_count++;
+}
+
+void tuh_audio_tx_cb(uint8_t idx, uint8_t stream, uint16_t n_bytes) {
+  (void) idx; (void) stream;
+  if (tx_count < TU_ARRAY_SIZE(tx_len)) tx_len[tx_count++] = n_bytes;
+}
+
+void tuh_audio_rx_cb(uint8_t idx, uint8_t stream, uint16_t n_bytes) {
+  (void) idx; (void) stream;
+  rx_total += n_bytes;
+}
+
+//--------------------------------------------------------------------+
+// Bus
+//--------------------------------------------------------------------+
+
+// Complete a control transfer of host by running it on the device driver
+static void bus_control(void) {
+  tuh_xfer_t xfer = host_ctrl.xfer;
+  tusb_control_request_t const* setup = &host_ctrl.setup;
+  host_ctrl.pending = false;
+
+  xfer.result = XFER_RESULT_SUCCESS;
+  xfer.actual_len = 0;
+
+  dev_ctrl.buffer = NULL;
+  dev_ctrl.len = 0;
+
+  if (!audiod_control_xfer_cb(0, CONTROL_STAGE_SETUP, setup)) {
+    xfer.result = XFER_RESULT_STALLED;
+  } else {
+    uint16_t const len = tu_min16(dev_ctrl.len, setup->wLength);
+    if (len) {
+      if (setup->bmRequestType_bit.direction == TUSB_DIR_IN) {
+        memcpy(xfer.buffer, dev_ctrl.buffer, len);
+      } else {
+        memcpy(dev_ctrl.buffer, xfer.buffer, len);
+      }
+      xfer.actual_len = len;
+
+      if (!audiod_control_xfer_cb(0, CONTROL_STAGE_DATA, setup)) xfer.result = XFER_RESULT_STALLED;
+    }
+    if (xfer.result == XFER_RESULT_SUCCESS) audiod_control_xfer_cb(0, CONTROL_STAGE_ACK, setup);
+  }
+
+  if (xfer.complete_cb) xfer.complete_cb(&xfer);
+}
+
+static void bus_control_run(void) {
+  while (host_ctrl.pending) bus_control();
+}
+
+// Isochronous: host transfer completes every frame, with no data if device has nothing scheduled
+static void bus_iso(uint8_t ep_addr) {
+  bool const dev_is_src = (tu_edpt_dir(ep_addr) == TUSB_DIR_IN);
+  fake_xfer_t* dev = get_xfer(dev_xfer, ep_addr);
+  fake_xfer_t* host = get_xfer(host_xfer, ep_addr);
+  if (!host->pending) return;
+
+  uint16_t n = 0;
+  bool const dev_done = dev->pending;
+  if (dev_done) {
+    fake_xfer_t* src = dev_is_src ? dev : host;
+    fake_xfer_t* dst = dev_is_src ? host : dev;
+    n = tu_min16(src->len, dst->len);
+    if (n) memcpy(dst->buffer, src->buffer, n);
+  } else if (!dev_is_src) {
+    n = host->len; // sent but not received
+  }
+
+  dev->pending = false;
+  host->pending = false;
+
+  if (dev_done) audiod_xfer_cb(0, ep_addr, XFER_RESULT_SUCCESS, n);
+  audioh_xfer_cb(DADDR, ep_addr, XFER_RESULT_SUCCESS, n);
+}
+
+static void bus_frame(void) {
+  bus_control_run();
+  bus_iso(EP_SPK);
+  bus_iso(EP_FB);
+  bus_iso(EP_MIC);
+  bus_control_run();
+}
+
+static void fill_samples(int16_t* buf, uint16_t count, int16_t start) {
+  for (uint16_t i = 0; i < count; i++) {
+    buf[i] = (int16_t) (start + i);
+  }
+}
+
+static void stream_open(uint8_t stream, uint32_t rate) {
+  uint8_t const idx = tuh_audio_itf_get_index(DADDR);
+  TEST_ASSERT_TRUE(tuh_audio_stream_open(idx, stream, 0, rate));
+  bus_control_run();
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+
+void setUp(void) {
+  usbd_edpt_open_StubWithCallback(stub_usbd_edpt_open);
+  usbd_edpt_close_StubWithCallback(stub_usbd_edpt_close);
+  usbd_edpt_busy_StubWithCallback(stub_usbd_edpt_busy);
+  usbd_edpt_xfer_StubWithCallback(stub_usbd_edpt_xfer);
+  usbd_edpt_clear_stall_Ignore();
+  usbd_sof_enable_Ignore();
+  tud_speed_get_StubWithCallback(stub_speed_get);
+  tud_control_xfer_StubWithCallback(stub_tud_control_xfer);
+  tud_control_status_StubWithCallback(stub_tud_control_status);
+
+  tuh_speed_get_StubWithCallback(stub_tuh_speed_get);
+  tuh_edpt_open_StubWithCallback(stub_tuh_edpt_open);
+  tuh_edpt_close_StubWithCallback(stub_tuh_edpt_close);
+  usbh_edpt_claim_StubWithCallback(stub_usbh_edpt_claim);
+  usbh_edpt_release_StubWithCallback(stub_usbh_edpt_release);
+  usbh_edpt_xfer_with_callback_StubWithCallback(stub_usbh_edpt_xfer_with_callback);
+  tuh_control_xfer_StubWithCallback(stub_tuh_control_xfer);
+  tuh_interface_set_StubWithCallback(stub_tuh_interface_set);
+  usbh_driver_set_config_complete_StubWithCallback(stub_usbh_driver_set_config_complete);
+
+  memset(dev_xfer, 0, sizeof(dev_xfer));
+  memset(host_xfer, 0, sizeof(host_xfer));
+  memset(&host_ctrl, 0, sizeof(host_ctrl));
+  memset(&open_cb, 0, sizeof(open_cb));
+  config_complete = false;
+  config_itf_last = ITF_MIC;
+  dev_sample_rate = 0;
+  set_itf_count = 0;
+  close_cb_count = 0;
+  tx_count = 0;
+  rx_total = 0;
+
+  audiod_init();
+  audioh_init();
+
+  TEST_ASSERT_EQUAL(DESC_LEN, audiod_open(0, DESC_ITF, DESC_LEN));
+  TEST_ASSERT_TRUE(audioh_open(0, DADDR, DESC_ITF, DESC_LEN));
+  TEST_ASSERT_TRUE(audioh_set_config(DADDR, ITF_AC));
+}
+
+void tearDown(void) {
+  audioh_close(DADDR);
+  audiod_reset(0);
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+void test_enumerate(void) {
+  uint8_t const idx = tuh_audio_itf_get_index(DADDR);
+
+  TEST_ASSERT_TRUE(config_complete);
+  TEST_ASSERT_TRUE(tuh_audio_mounted(idx));
+  TEST_ASSERT_EQUAL_HEX16(0x0200, tuh_audio_version(idx));
+  TEST_ASSERT_EQUAL(2, tuh_audio_stream_count(idx));
+
+  TEST_ASSERT_EQUAL(TUSB_DIR_OUT, tuh_audio_stream_dir(idx, STREAM_SPK));
+  TEST_ASSERT_EQUAL(1, tuh_audio_stream_alt_count(idx, STREAM_SPK));
+  tuh_audio_alt_t const* alt = tuh_audio_stream_alt(idx, STREAM_SPK, 0);
+  TEST_ASSERT_NOT_NULL(alt);
+  TEST_ASSERT_EQUAL(1, alt->alt);
+  TEST_ASSERT_EQUAL_HEX8(EP_SPK, alt->ep_addr);
+  TEST_ASSERT_EQUAL_HEX8(EP_FB, alt->ep_fb);
+  TEST_ASSERT_EQUAL(EP_SPK_SZ, alt->ep_size);
+  TEST_ASSERT_EQUAL(TUSB_ISO_EP_ATT_ASYNCHRONOUS, alt->sync_type);
+  TEST_ASSERT_EQUAL(2, alt->n_channels);
+  TEST_ASSERT_EQUAL(2, alt->subslot_size);
+  TEST_ASSERT_EQUAL(16, alt->bit_resolution);
+  TEST_ASSERT_EQUAL(CLOCK_ID, alt->clock_id);
+  TEST_ASSERT_EQUAL(AUDIO_CTRL_RW, alt->freq_ctrl);
+
+  TEST_ASSERT_EQUAL(TUSB_DIR_IN, tuh_audio_stream_dir(idx, STREAM_MIC));
+  alt = tuh_audio_stream_alt(idx, STREAM_MIC, 0);
+  TEST_ASSERT_NOT_NULL(alt);
+  TEST_ASSERT_EQUAL_HEX8(EP_MIC, alt->ep_addr);
+  TEST_ASSERT_EQUAL_HEX8(0, alt->ep_fb);
+  TEST_ASSERT_EQUAL(1, alt->n_channels);
+  TEST_ASSERT_EQUAL(CLOCK_ID, alt->clock_id);
+}
+
+void test_speaker_stream(void) {
+  uint8_t const idx = tuh_audio_itf_get_index(DADDR);
+  stream_open(STREAM_SPK, 48000);
+
+  TEST_ASSERT_EQUAL(1, open_cb.count);
+  TEST_ASSERT_TRUE(open_cb.success);
+  TEST_ASSERT_TRUE(tuh_audio_stream_active(idx, STREAM_SPK));
+  TEST_ASSERT_EQUAL(48003, tuh_audio_stream_sample_rate(idx, STREAM_SPK));
+  TEST_ASSERT_TRUE(get_xfer(host_xfer, EP_SPK)->pending);
+  TEST_ASSERT_TRUE(get_xfer(host_xfer, EP_FB)->pending);
+
+  // samples arrive in order at the device
+  static int16_t samples[48*2*5];
+  fill_samples(samples, TU_ARRAY_SIZE(samples), 0);
+  TEST_ASSERT_EQUAL(sizeof(samples), tuh_audio_stream_write(idx, STREAM_SPK, samples, sizeof(samples)));
+
+  for (uint8_t i = 0; i < 12; i++) bus_frame();
+
+  static int16_t received[48*2*5];
+  TEST_ASSERT_EQUAL(sizeof(received), tud_audio_available());
+  TEST_ASSERT_EQUAL(sizeof(received), tud_audio_read(received, sizeof(received)));
+  TEST_ASSERT_EQUAL_INT16_ARRAY(samples, received, TU_ARRAY_SIZE(samples));
+
+  // 48 samples per frame at nominal rate
+  for (uint8_t i = 0; i < tx_count; i++) {
+    TEST_ASSERT_TRUE(tx_len[i] == 0 || tx_len[i] == 48*4);
+  }
+}
+
+void test_speaker_feedback(void) {
+  uint8_t const idx = tuh_audio_itf_get_index(DADDR);
+  stream_open(STREAM_SPK, 48000);
+  TEST_ASSERT_TRUE(open_cb.success);
+
+  // device consumes 48.5 samples per frame
+  TEST_ASSERT_TRUE(tud_audio_fb_set(0x00308000));
+  bus_frame();
+  TEST_ASSERT_EQUAL_HEX32(0x00308000, tuh_audio_stream_feedback(idx, STREAM_SPK));
+
+  static int16_t samples[49*2];
+  tx_count = 0;
+  for (uint8_t i = 0; i < 20; i++) {
+    while (tuh_audio_stream_available(idx, STREAM_SPK) >= sizeof(samples)) {
+      tuh_audio_stream_write(idx, STREAM_SPK, samples, sizeof(samples));
+    }
+    bus_frame();
+    tud_audio_clear_ep_out_ff();
+  }
+
+  // once FIFO is filled, packets alternate between 48 and 49 samples
+  TEST_ASSERT_EQUAL(20, tx_count);
+  uint32_t total = 0;
+  for (uint8_t i = 4; i < 20; i++) {
+    TEST_ASSERT_TRUE(tx_len[i] == 48*4 || tx_len[i] == 49*4);
+    total += tx_len[i];
+  }
+  TEST_ASSERT_EQUAL(16*4*97/2, total);
+}
+
+void test_microphone_stream(void) {
+  uint8_t const idx = tuh_audio_itf_get_index(DADDR);
+  stream_open(STREAM_MIC, 44100);
+
+  TEST_ASSERT_TRUE(open_cb.success);
+  TEST_ASSERT_EQUAL(44100, tuh_audio_stream_sample_rate(idx, STREAM_MIC));
+  TEST_ASSERT_TRUE(get_xfer(host_xfer, EP_MIC)->pending);
+
+  static int16_t samples[44*6];
+  fill_samples(samples, TU_ARRAY_SIZE(samples), 1000);
+  TEST_ASSERT_EQUAL(sizeof(samples), tud_audio_write(samples, sizeof(samples)));
+
+  for (uint8_t i = 0; i < 8; i++) bus_frame();
+
+  static int16_t received[44*6];
+  TEST_ASSERT_EQUAL(sizeof(samples), rx_total);
+  TEST_ASSERT_EQUAL(sizeof(received), tuh_audio_stream_available(idx, STREAM_MIC));
+  TEST_ASSERT_EQUAL(sizeof(received), tuh_audio_stream_read(idx, STREAM_MIC, received, sizeof(received)));
+  TEST_ASSERT_EQUAL_INT16_ARRAY(samples, received, TU_ARRAY_SIZE(samples));
+
+  // receive stays armed
+  TEST_ASSERT_TRUE(get_xfer(host_xfer, EP_MIC)->pending);
+}
+
+void test_stream_close(void) {
+  uint8_t const idx = tuh_audio_itf_get_index(DADDR);
+  stream_open(STREAM_SPK, 48000);
+  TEST_ASSERT_TRUE(open_cb.success);
+  bus_frame();
+
+  set_itf_count = 0;
+  TEST_ASSERT_TRUE(tuh_audio_stream_close(idx, STREAM_SPK));
+  TEST_ASSERT_FALSE(tuh_audio_stream_active(idx, STREAM_SPK));
+
+  // endpoints are closed once pending transfers are done, then alternate setting 0 is selected
+  for (uint8_t i = 0; i < 4; i++) bus_frame();
+
+  TEST_ASSERT_EQUAL(1, set_itf_count);
+  TEST_ASSERT_EQUAL(1, close_cb_count);
+  TEST_ASSERT_FALSE(get_xfer(host_xfer, EP_SPK)->pending);
+  TEST_ASSERT_FALSE(get_xfer(host_xfer, EP_FB)->pending);
+  TEST_ASSERT_FALSE(get_xfer(dev_xfer, EP_SPK)->pending);
+
+  // can be opened again
+  stream_open(STREAM_SPK, 44100);
+  TEST_ASSERT_EQUAL(2, open_cb.count);
+  TEST_ASSERT_TRUE(open_cb.success);
+}
+
+void test_open_unsupported_rate(void) {
+  uint8_t const idx = tuh_audio_itf_get_index(DADDR);
+  stream_open(STREAM_SPK, 96000);
+
+  // rate request is stalled, alternate setting 0 is restored
+  TEST_ASSERT_EQUAL(1, open_cb.count);
+  TEST_ASSERT_FALSE(open_cb.success);
+  TEST_ASSERT_EQUAL(2, set_itf_count);
+  TEST_ASSERT_FALSE(tuh_audio_stream_active(idx, STREAM_SPK));
+  TEST_ASSERT_FALSE(get_xfer(host_xfer, EP_SPK)->pending);
+  TEST_ASSERT_FALSE(get_xfer(dev_xfer, EP_SPK)->pending);
+}
+
+void test_uac1_midi_streaming_not_claimed(void) {
+  audioh_close(DADDR);
+
+  // MIDIStreaming interface of the collection is not part of the audio function
+  config_itf_last = ITF_SPK;
+  config_complete = false;
+  TEST_ASSERT_TRUE(audioh_open(0, DADDR, (tusb_desc_interface_t const*) desc_uac1_midi, sizeof(desc_uac1_midi)));
+  TEST_ASSERT_TRUE(audioh_set_config(DADDR, ITF_AC));
+  TEST_ASSERT_TRUE(config_complete);
+
+  uint8_t const idx = tuh_audio_itf_get_index(DADDR);
+  TEST_ASSERT_EQUAL_HEX16(0x0100, tuh_audio_version(idx));
+  TEST_ASSERT_EQUAL(1, tuh_audio_stream_count(idx));
+
+  tuh_audio_alt_t const* alt = tuh_audio_stream_alt(idx, 0, 0);
+  TEST_ASSERT_NOT_NULL(alt);
+  TEST_ASSERT_EQUAL_HEX8(EP_SPK, alt->ep_addr);
+  TEST_ASSERT_EQUAL(2, alt->n_channels);
+  TEST_ASSERT_EQUAL(1, alt->n_freq);
+  TEST_ASSERT_EQUAL(48000, alt->freq[0]);
+}
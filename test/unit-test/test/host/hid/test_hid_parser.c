@@ -0,0 +1,328 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Report descriptor field parser and decoder of the HID host driver, against descriptors of real devices and random
+// or mutated descriptors.
+
+#include <string.h>
+#include "unity.h"
+
+// Files to test
+#include "hid_host.h"
+
+// Mock File
+#include "mock_usbh.h"
+#include "mock_usbh_pvt.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum {
+  FIELD_MAX = 32,
+};
+
+static tuh_hid_field_t fields[FIELD_MAX];
+
+// Boot keyboard, HID 1.11 Appendix E.6
+static uint8_t const desc_keyboard[] = {
+  0x05, 0x01, 0x09, 0x06, 0xA1, 0x01,
+  0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02, // modifiers
+  0x95, 0x01, 0x75, 0x08, 0x81, 0x01,                                                             // reserved
+  0x95, 0x05, 0x75, 0x01, 0x05, 0x08, 0x19, 0x01, 0x29, 0x05, 0x91, 0x02,                         // LEDs
+  0x95, 0x01, 0x75, 0x03, 0x91, 0x01,                                                             // LED padding
+  0x95, 0x06, 0x75, 0x08, 0x15, 0x00, 0x25, 0x65, 0x05, 0x07, 0x19, 0x00, 0x29, 0x65, 0x81, 0x00, // key array
+  0xC0
+};
+
+// Mouse with report ID, 16 buttons, 12-bit axes, wheel and AC Pan as found on wireless receivers
+static uint8_t const desc_mouse[] = {
+  0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x85, 0x02, 0x09, 0x01, 0xA1, 0x00,
+  0x05, 0x09, 0x19, 0x01, 0x29, 0x10, 0x15, 0x00, 0x25, 0x01, 0x95, 0x10, 0x75, 0x01, 0x81, 0x02, // buttons
+  0x05, 0x01, 0x16, 0x01, 0xF8, 0x26, 0xFF, 0x07, 0x75, 0x0C, 0x95, 0x02, 0x09, 0x30, 0x09, 0x31, // X, Y
+  0x81, 0x06,
+  0x15, 0x81, 0x25, 0x7F, 0x75, 0x08, 0x95, 0x01, 0x09, 0x38, 0x81, 0x06,                         // wheel
+  0x05, 0x0C, 0x0A, 0x38, 0x02, 0x95, 0x01, 0x81, 0x06,                                           // AC Pan
+  0xC0, 0xC0
+};
+
+// Gamepad with non-consecutive axes, hat switch inside PUSH/POP, padding and an extended vendor usage
+static uint8_t const desc_gamepad[] = {
+  0x05, 0x01, 0x09, 0x05, 0xA1, 0x01,
+  0x15, 0x00, 0x26, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x04, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, // X, Y, Z, Rz
+  0x35, 0x81, 0x02,
+  0xA4,                                                                                           // push
+  0x75, 0x04, 0x95, 0x01, 0x15, 0x00, 0x25, 0x07, 0x35, 0x00, 0x46, 0x3B, 0x01, 0x65, 0x14, 0x09, // hat switch
+  0x39, 0x81, 0x42,
+  0xB4,                                                                                           // pop
+  0x75, 0x01, 0x95, 0x04, 0x81, 0x03,                                                             // padding
+  0x05, 0x09, 0x19, 0x01, 0x29, 0x0E, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x0E, 0x81, 0x02, // buttons
+  0x75, 0x02, 0x95, 0x01, 0x81, 0x03,                                                             // padding
+  0x0B, 0x01, 0x00, 0x01, 0xFF, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x01, 0x81, 0x02, // vendor
+  0xC0
+};
+
+// Composite keyboard and consumer control with report IDs, as generated by hid.h/hid_device.h macros
+static uint8_t const desc_composite[] = {
+  0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x85, 0x01,
+  0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01, 0x95, 0x08, 0x75, 0x01, 0x81, 0x02,
+  0x95, 0x01, 0x75, 0x08, 0x81, 0x01,
+  0x05, 0x08, 0x19, 0x01, 0x29, 0x05, 0x95, 0x05, 0x75, 0x01, 0x91, 0x02,
+  0x95, 0x01, 0x75, 0x03, 0x91, 0x01,
+  0x05, 0x07, 0x19, 0x00, 0x2A, 0xFF, 0x00, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x95, 0x06, 0x75, 0x08, 0x81, 0x00,
+  0xC0,
+  0x05, 0x0C, 0x09, 0x01, 0xA1, 0x01, 0x85, 0x03,
+  0x15, 0x01, 0x26, 0x9C, 0x02, 0x19, 0x01, 0x2A, 0x9C, 0x02, 0x75, 0x10, 0x95, 0x01, 0x81, 0x00,
+  0xC0
+};
+
+static uint32_t _seed = 1;
+
+static uint32_t random_u32(void) {
+  _seed = _seed * 1103515245u + 12345u;
+  return _seed >> 8;
+}
+
+static void check_field(tuh_hid_field_t const* field, uint8_t type, uint8_t report_id, uint16_t usage_page,
+                        uint16_t usage, uint16_t usage_max, uint16_t bit_offset, uint8_t bit_size, uint16_t count) {
+  TEST_ASSERT_EQUAL_UINT8(type, field->type);
+  TEST_ASSERT_EQUAL_UINT8(report_id, field->report_id);
+  TEST_ASSERT_EQUAL_HEX16(usage_page, field->usage_page);
+  TEST_ASSERT_EQUAL_HEX16(usage, field->usage);
+  TEST_ASSERT_EQUAL_HEX16(usage_max, field->usage_max);
+  TEST_ASSERT_EQUAL_UINT16(bit_offset, field->bit_offset);
+  TEST_ASSERT_EQUAL_UINT8(bit_size, field->bit_size);
+  TEST_ASSERT_EQUAL_UINT16(count, field->count);
+}
+
+static int32_t field_value(tuh_hid_field_t const* field, uint8_t const* report, uint16_t len, uint16_t idx) {
+  int32_t value = 0x5A5A5A5A;
+  TEST_ASSERT_TRUE(tuh_hid_field_value(field, report, len, idx, &value));
+  return value;
+}
+
+void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t idx, uint8_t const* report, uint16_t len) {
+  (void) dev_addr; (void) idx; (void) report; (void) len;
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void setUp(void) {
+  memset(fields, 0xAA, sizeof(fields));
+}
+
+void tearDown(void) {
+}
+
+void test_keyboard(void) {
+  TEST_ASSERT_EQUAL_UINT16(3, tuh_hid_parse_report_fields(fields, FIELD_MAX, desc_keyboard, sizeof(desc_keyboard)));
+  check_field(&fields[0], HID_REPORT_TYPE_INPUT, 0, HID_USAGE_PAGE_KEYBOARD, 0xE0, 0xE7, 0, 1, 8);
+  check_field(&fields[1], HID_REPORT_TYPE_OUTPUT, 0, HID_USAGE_PAGE_LED, 0x01, 0x05, 0, 1, 5);
+  check_field(&fields[2], HID_REPORT_TYPE_INPUT, 0, HID_USAGE_PAGE_KEYBOARD, 0x00, 0x65, 16, 8, 6);
+  TEST_ASSERT_EQUAL_HEX8(HID_DATA | HID_VARIABLE | HID_ABSOLUTE, fields[0].flags);
+  TEST_ASSERT_EQUAL_HEX8(HID_DATA | HID_ARRAY | HID_ABSOLUTE, fields[2].flags);
+  TEST_ASSERT_EQUAL_INT32(0, fields[2].logical_min);
+  TEST_ASSERT_EQUAL_INT32(101, fields[2].logical_max);
+
+  // left shift + 'a' 'b'
+  uint8_t const report[] = { 0x02, 0x00, HID_KEY_A, HID_KEY_B, 0, 0, 0, 0 };
+  TEST_ASSERT_EQUAL_INT32(0, field_value(&fields[0], report, sizeof(report), 0));
+  TEST_ASSERT_EQUAL_INT32(1, field_value(&fields[0], report, sizeof(report), 1));
+  TEST_ASSERT_EQUAL_INT32(HID_KEY_A, field_value(&fields[2], report, sizeof(report), 0));
+  TEST_ASSERT_EQUAL_INT32(HID_KEY_B, field_value(&fields[2], report, sizeof(report), 1));
+  TEST_ASSERT_EQUAL_INT32(0, field_value(&fields[2], report, sizeof(report), 5));
+
+  // out of range element and short report
+  int32_t value;
+  TEST_ASSERT_FALSE(tuh_hid_field_value(&fields[2], report, sizeof(report), 6, &value));
+  TEST_ASSERT_FALSE(tuh_hid_field_value(&fields[2], report, 7, 5, &value));
+}
+
+void test_mouse_report_id(void) {
+  TEST_ASSERT_EQUAL_UINT16(4, tuh_hid_parse_report_fields(fields, FIELD_MAX, desc_mouse, sizeof(desc_mouse)));
+  check_field(&fields[0], HID_REPORT_TYPE_INPUT, 2, HID_USAGE_PAGE_BUTTON, 1, 16, 0, 1, 16);
+  check_field(&fields[1], HID_REPORT_TYPE_INPUT, 2, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_X, HID_USAGE_DESKTOP_Y,
+              16, 12, 2);
+  check_field(&fields[2], HID_REPORT_TYPE_INPUT, 2, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_WHEEL,
+              HID_USAGE_DESKTOP_WHEEL, 40, 8, 1);
+  check_field(&fields[3], HID_REPORT_TYPE_INPUT, 2, HID_USAGE_PAGE_CONSUMER, 0x238, 0x238, 48, 8, 1);
+  TEST_ASSERT_EQUAL_INT32(-2047, fields[1].logical_min);
+  TEST_ASSERT_EQUAL_INT32(2047, fields[1].logical_max);
+  TEST_ASSERT_EQUAL_HEX8(HID_DATA | HID_VARIABLE | HID_RELATIVE, fields[1].flags);
+
+  // buttons 1 and 3, X = -5, Y = 300, wheel -1, pan 1
+  uint8_t const report[] = { 0x02, 0x05, 0x00, 0xFB, 0xCF, 0x12, 0xFF, 0x01 };
+  TEST_ASSERT_EQUAL_INT32(1, field_value(&fields[0], report, sizeof(report), 0));
+  TEST_ASSERT_EQUAL_INT32(0, field_value(&fields[0], report, sizeof(report), 1));
+  TEST_ASSERT_EQUAL_INT32(1, field_value(&fields[0], report, sizeof(report), 2));
+  TEST_ASSERT_EQUAL_INT32(-5, field_value(&fields[1], report, sizeof(report), 0));
+  TEST_ASSERT_EQUAL_INT32(300, field_value(&fields[1], report, sizeof(report), 1));
+  TEST_ASSERT_EQUAL_INT32(-1, field_value(&fields[2], report, sizeof(report), 0));
+  TEST_ASSERT_EQUAL_INT32(1, field_value(&fields[3], report, sizeof(report), 0));
+
+  // usage lookup
+  tuh_hid_field_t const* y = tuh_hid_field_find(fields, 4, HID_REPORT_TYPE_INPUT, HID_USAGE_PAGE_DESKTOP,
+                                                 HID_USAGE_DESKTOP_Y);
+  TEST_ASSERT_EQUAL_PTR(&fields[1], y);
+  TEST_ASSERT_EQUAL_INT32(300, field_value(y, report, sizeof(report), HID_USAGE_DESKTOP_Y - y->usage));
+  TEST_ASSERT_NULL(tuh_hid_field_find(fields, 4, HID_REPORT_TYPE_OUTPUT, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_Y));
+  TEST_ASSERT_NULL(tuh_hid_field_find(fields, 4, HID_REPORT_TYPE_INPUT, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_Z));
+
+  // report of another ID
+  uint8_t const other[] = { 0x01, 0x05, 0x00, 0xFB, 0xCF, 0x12, 0xFF, 0x01 };
+  int32_t value;
+  TEST_ASSERT_FALSE(tuh_hid_field_value(&fields[1], other, sizeof(other), 0, &value));
+  TEST_ASSERT_FALSE(tuh_hid_field_value(&fields[1], other, 0, 0, &value));
+}
+
+void test_gamepad_push_pop_extended_usage(void) {
+  TEST_ASSERT_EQUAL_UINT16(5, tuh_hid_parse_report_fields(fields, FIELD_MAX, desc_gamepad, sizeof(desc_gamepad)));
+  check_field(&fields[0], HID_REPORT_TYPE_INPUT, 0, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_X, HID_USAGE_DESKTOP_Z,
+              0, 8, 3);
+  check_field(&fields[1], HID_REPORT_TYPE_INPUT, 0, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_RZ, HID_USAGE_DESKTOP_RZ,
+              24, 8, 1);
+  check_field(&fields[2], HID_REPORT_TYPE_INPUT, 0, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_HAT_SWITCH,
+              HID_USAGE_DESKTOP_HAT_SWITCH, 32, 4, 1);
+  check_field(&fields[3], HID_REPORT_TYPE_INPUT, 0, HID_USAGE_PAGE_BUTTON, 1, 14, 40, 1, 14);
+  check_field(&fields[4], HID_REPORT_TYPE_INPUT, 0, 0xFF01, 0x0001, 0x0001, 56, 8, 1);
+  TEST_ASSERT_EQUAL_HEX8(HID_DATA | HID_VARIABLE | HID_NULL_STATE, fields[2].flags);
+  TEST_ASSERT_EQUAL_INT32(7, fields[2].logical_max);
+  TEST_ASSERT_EQUAL_INT32(255, fields[4].logical_max); // restored by pop, then set again
+
+  // X 0x80, Y 0x10, Z 0xFF, Rz 0x7F, hat 3, buttons 1 and 14, vendor 0xAB
+  uint8_t const report[] = { 0x80, 0x10, 0xFF, 0x7F, 0x03, 0x01, 0x20, 0xAB };
+  TEST_ASSERT_EQUAL_INT32(0x80, field_value(&fields[0], report, sizeof(report), 0));
+  TEST_ASSERT_EQUAL_INT32(0x10, field_value(&fields[0], report, sizeof(report), 1));
+  TEST_ASSERT_EQUAL_INT32(0xFF, field_value(&fields[0], report, sizeof(report), 2));
+  TEST_ASSERT_EQUAL_INT32(0x7F, field_value(&fields[1], report, sizeof(report), 0));
+  TEST_ASSERT_EQUAL_INT32(3, field_value(&fields[2], report, sizeof(report), 0));
+  TEST_ASSERT_EQUAL_INT32(1, field_value(&fields[3], report, sizeof(report), 0));
+  TEST_ASSERT_EQUAL_INT32(0, field_value(&fields[3], report, sizeof(report), 12));
+  TEST_ASSERT_EQUAL_INT32(1, field_value(&fields[3], report, sizeof(report), 13));
+  TEST_ASSERT_EQUAL_INT32(0xAB, field_value(&fields[4], report, sizeof(report), 0));
+}
+
+void test_composite_report_ids(void) {
+  TEST_ASSERT_EQUAL_UINT16(4, tuh_hid_parse_report_fields(fields, FIELD_MAX, desc_composite, sizeof(desc_composite)));
+  check_field(&fields[0], HID_REPORT_TYPE_INPUT, 1, HID_USAGE_PAGE_KEYBOARD, 0xE0, 0xE7, 0, 1, 8);
+  check_field(&fields[1], HID_REPORT_TYPE_OUTPUT, 1, HID_USAGE_PAGE_LED, 1, 5, 0, 1, 5);
+  check_field(&fields[2], HID_REPORT_TYPE_INPUT, 1, HID_USAGE_PAGE_KEYBOARD, 0x00, 0xFF, 16, 8, 6);
+  // bit position starts over for each report ID
+  check_field(&fields[3], HID_REPORT_TYPE_INPUT, 3, HID_USAGE_PAGE_CONSUMER, 1, 0x29C, 0, 16, 1);
+  TEST_ASSERT_EQUAL_INT32(1, fields[3].logical_min);
+  TEST_ASSERT_EQUAL_INT32(0x29C, fields[3].logical_max);
+
+  uint8_t const report[] = { 0x03, 0xE9, 0x00 }; // volume increment
+  TEST_ASSERT_EQUAL_INT32(HID_USAGE_CONSUMER_VOLUME_INCREMENT, field_value(&fields[3], report, sizeof(report), 0));
+
+  // table full: parsing stops at the last field fitting in
+  TEST_ASSERT_EQUAL_UINT16(2, tuh_hid_parse_report_fields(fields, 2, desc_composite, sizeof(desc_composite)));
+}
+
+void test_value_32bit_unaligned(void) {
+  // 4 bits padding then a signed 32-bit value spanning 5 bytes, and an unsigned one
+  uint8_t const desc[] = {
+    0x75, 0x04, 0x95, 0x01, 0x81, 0x03,
+    0x17, 0x00, 0x00, 0x00, 0x80, 0x27, 0xFF, 0xFF, 0xFF, 0x7F, 0x75, 0x20, 0x95, 0x01, 0x09, 0x30, 0x81, 0x02,
+    0x15, 0x00, 0x27, 0xFF, 0xFF, 0xFF, 0xFF, 0x09, 0x31, 0x81, 0x02,
+  };
+  TEST_ASSERT_EQUAL_UINT16(2, tuh_hid_parse_report_fields(fields, FIELD_MAX, desc, sizeof(desc)));
+  TEST_ASSERT_EQUAL_INT32(INT32_MIN, fields[0].logical_min);
+  TEST_ASSERT_EQUAL_INT32(INT32_MAX, fields[0].logical_max);
+  check_field(&fields[1], HID_REPORT_TYPE_INPUT, 0, 0, 0x31, 0x31, 36, 32, 1);
+
+  // -123456789 = 0xF8A432EB at bit 4, 0x89ABCDEF at bit 36
+  uint8_t const report[] = { 0xB0, 0x2E, 0x43, 0x8A, 0xFF, 0xDE, 0xBC, 0x9A, 0x08 };
+  TEST_ASSERT_EQUAL_INT32(-123456789, field_value(&fields[0], report, sizeof(report), 0));
+  TEST_ASSERT_EQUAL_HEX32(0x89ABCDEF, (uint32_t) field_value(&fields[1], report, sizeof(report), 0));
+}
+
+void test_malformed(void) {
+  // truncated item data, long item, unbalanced pop: nothing is read past the descriptor
+  uint8_t const truncated[] = { 0x75, 0x08, 0x95, 0x01, 0x81, 0x02, 0x27, 0xFF, 0xFF };
+  TEST_ASSERT_EQUAL_UINT16(1, tuh_hid_parse_report_fields(fields, FIELD_MAX, truncated, sizeof(truncated)));
+
+  uint8_t const long_item[] = { 0xFE, 0x02, 0x10, 0x75, 0x08, 0x75, 0x08, 0x95, 0x01, 0x81, 0x02, 0xFE, 0x05 };
+  TEST_ASSERT_EQUAL_UINT16(1, tuh_hid_parse_report_fields(fields, FIELD_MAX, long_item, sizeof(long_item)));
+  TEST_ASSERT_EQUAL_UINT8(8, fields[0].bit_size);
+
+  uint8_t const pop[] = { 0xB4, 0xB4, 0x75, 0x10, 0x95, 0x02, 0x09, 0x30, 0x81, 0x02 };
+  TEST_ASSERT_EQUAL_UINT16(1, tuh_hid_parse_report_fields(fields, FIELD_MAX, pop, sizeof(pop)));
+  TEST_ASSERT_EQUAL_UINT16(2, fields[0].count);
+
+  // elements larger than 32 bits are skipped
+  uint8_t const wide[] = { 0x75, 0x40, 0x95, 0x01, 0x81, 0x02, 0x75, 0x08, 0x81, 0x02 };
+  TEST_ASSERT_EQUAL_UINT16(1, tuh_hid_parse_report_fields(fields, FIELD_MAX, wide, sizeof(wide)));
+  TEST_ASSERT_EQUAL_UINT16(64, fields[0].bit_offset);
+}
+
+void test_fuzz(void) {
+  // random descriptors made of valid item prefixes, and real descriptors with random bytes changed
+  static uint8_t desc[256];
+  static uint8_t report[64];
+  uint8_t const* const seeds[] = { desc_keyboard, desc_mouse, desc_gamepad, desc_composite };
+  uint16_t const seed_len[] = { sizeof(desc_keyboard), sizeof(desc_mouse), sizeof(desc_gamepad),
+                                sizeof(desc_composite) };
+
+  for (uint32_t iter = 0; iter < 20000; iter++) {
+    uint16_t len;
+    if (iter & 1) {
+      uint8_t const s = (uint8_t) (random_u32() % 4);
+      len = seed_len[s];
+      memcpy(desc, seeds[s], len);
+      for (uint8_t n = (uint8_t) (1 + random_u32() % 4); n; n--) desc[random_u32() % len] = (uint8_t) random_u32();
+      len = (uint16_t) (len - random_u32() % 3);
+    } else {
+      len = (uint16_t) (random_u32() % sizeof(desc));
+      for (uint16_t i = 0; i < len; i++) desc[i] = (uint8_t) random_u32();
+    }
+
+    uint16_t const field_count = (uint16_t) (random_u32() % (FIELD_MAX + 1));
+    uint16_t const n = tuh_hid_parse_report_fields(fields, field_count, desc, len);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT16(field_count, n);
+
+    uint16_t const report_len = (uint16_t) (random_u32() % sizeof(report));
+    for (uint16_t i = 0; i < report_len; i++) report[i] = (uint8_t) random_u32();
+
+    for (uint16_t f = 0; f < n; f++) {
+      tuh_hid_field_t const* field = &fields[f];
+      TEST_ASSERT_TRUE(field->bit_size >= 1 && field->bit_size <= 32);
+      TEST_ASSERT_NOT_EQUAL(0, field->count);
+      TEST_ASSERT_TRUE(field->type >= HID_REPORT_TYPE_INPUT && field->type <= HID_REPORT_TYPE_FEATURE);
+      TEST_ASSERT_FALSE(field->flags & HID_CONSTANT);
+
+      if (field->report_id) report[0] = field->report_id;
+      uint16_t const data_len = (uint16_t) (field->report_id ? (report_len ? report_len - 1 : 0) : report_len);
+      for (uint16_t i = 0; i < field->count && i < 64; i++) {
+        int32_t value;
+        bool const fits = report_len && (field->bit_offset + (uint32_t) i * field->bit_size + field->bit_size <=
+                                         8u * data_len);
+        TEST_ASSERT_EQUAL(fits, tuh_hid_field_value(field, report, report_len, i, &value));
+      }
+    }
+  }
+}
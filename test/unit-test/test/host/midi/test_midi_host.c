@@ -0,0 +1,434 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Loopback of MIDI host driver against MIDI device driver: bulk transfers of the host are exchanged with the device
+// driver whenever both sides have a transfer pending.
+
+#include <string.h>
+#include "unity.h"
+
+// Files to test
+#include "osal/osal.h"
+#include "tusb_fifo.h"
+#include "midi_host.h"
+#include "midi_device.h"
+TEST_FILE("midi_device.c")
+
+// Mock File
+#include "mock_usbd.h"
+#include "mock_usbd_pvt.h"
+#include "mock_usbh.h"
+#include "mock_usbh_pvt.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum {
+  DADDR   = 1,
+  ITF_AC  = 0,
+  ITF_MS  = 1,
+  EP_OUT  = 0x01,
+  EP_IN   = 0x81,
+  EP_SIZE = 64,
+};
+
+// 2 cables in each direction
+uint8_t const desc_midi[] = {
+  TUD_MIDI_DESC_HEAD(ITF_AC, 0, 2),
+  TUD_MIDI_DESC_JACK(1),
+  TUD_MIDI_DESC_JACK(2),
+  TUD_MIDI_DESC_EP(EP_OUT, EP_SIZE, 2), TUD_MIDI_JACKID_IN_EMB(1), TUD_MIDI_JACKID_IN_EMB(2),
+  TUD_MIDI_DESC_EP(EP_IN, EP_SIZE, 2), TUD_MIDI_JACKID_OUT_EMB(1), TUD_MIDI_JACKID_OUT_EMB(2),
+};
+
+#define DESC_ITF    ((tusb_desc_interface_t const*) desc_midi)
+#define DESC_LEN    ((uint16_t) sizeof(desc_midi))
+
+typedef struct {
+  uint8_t* buffer;
+  uint16_t len;
+  bool pending;
+  bool claimed;
+} fake_xfer_t;
+
+// index by endpoint number
+static fake_xfer_t dev_xfer[2][2];
+static fake_xfer_t host_xfer[2][2];
+
+static bool config_complete;
+static uint8_t mount_count;
+static uint8_t umount_count;
+static uint32_t rx_cb_packets;
+
+static fake_xfer_t* get_xfer(fake_xfer_t xfer[2][2], uint8_t ep_addr) {
+  return &xfer[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+}
+
+static bool xfer_claim(fake_xfer_t* xfer) {
+  if (xfer->pending || xfer->claimed) return false;
+  xfer->claimed = true;
+  return true;
+}
+
+static void xfer_submit(fake_xfer_t* xfer, uint8_t* buffer, uint16_t total_bytes) {
+  TEST_ASSERT_FALSE(xfer->pending);
+  *xfer = (fake_xfer_t) { .buffer = buffer, .len = total_bytes, .pending = true };
+}
+
+//--------------------------------------------------------------------+
+// Device stack
+//--------------------------------------------------------------------+
+
+static bool stub_usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep, int num_calls) {
+  (void) rhport; (void) num_calls;
+  TEST_ASSERT_EQUAL(TUSB_XFER_BULK, desc_ep->bmAttributes.xfer);
+  return true;
+}
+
+static bool stub_usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr, int num_calls) {
+  (void) rhport; (void) num_calls;
+  return xfer_claim(get_xfer(dev_xfer, ep_addr));
+}
+
+static bool stub_usbd_edpt_release(uint8_t rhport, uint8_t ep_addr, int num_calls) {
+  (void) rhport; (void) num_calls;
+  get_xfer(dev_xfer, ep_addr)->claimed = false;
+  return true;
+}
+
+static bool stub_usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes, int num_calls) {
+  (void) rhport; (void) num_calls;
+  xfer_submit(get_xfer(dev_xfer, ep_addr), buffer, total_bytes);
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Host stack
+//--------------------------------------------------------------------+
+
+static bool stub_tuh_edpt_open(uint8_t daddr, tusb_desc_endpoint_t const* desc_ep, int num_calls) {
+  (void) daddr; (void) num_calls;
+  TEST_ASSERT_EQUAL(TUSB_XFER_BULK, desc_ep->bmAttributes.xfer);
+  return true;
+}
+
+static bool stub_usbh_edpt_claim(uint8_t daddr, uint8_t ep_addr, int num_calls) {
+  (void) daddr; (void) num_calls;
+  return xfer_claim(get_xfer(host_xfer, ep_addr));
+}
+
+static bool stub_usbh_edpt_release(uint8_t daddr, uint8_t ep_addr, int num_calls) {
+  (void) daddr; (void) num_calls;
+  get_xfer(host_xfer, ep_addr)->claimed = false;
+  return true;
+}
+
+static bool stub_usbh_edpt_xfer_with_callback(uint8_t daddr, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes,
+                                              tuh_xfer_cb_t complete_cb, uintptr_t user_data, int num_calls) {
+  (void) daddr; (void) complete_cb; (void) user_data; (void) num_calls;
+  xfer_submit(get_xfer(host_xfer, ep_addr), buffer, total_bytes);
+  return true;
+}
+
+// usbh task is not running: deferred function is called right away
+static void stub_usbh_defer_func(osal_task_func_t func, void* param, bool in_isr, int num_calls) {
+  (void) in_isr; (void) num_calls;
+  func(param);
+}
+
+static void stub_usbh_driver_set_config_complete(uint8_t daddr, uint8_t itf_num, int num_calls) {
+  (void) num_calls;
+  TEST_ASSERT_EQUAL(DADDR, daddr);
+  TEST_ASSERT_EQUAL(ITF_MS, itf_num);
+  config_complete = true;
+}
+
+void tuh_midi_mount_cb(uint8_t idx) {
+  (void) idx;
+  mount_count++;
+}
+
+void tuh_midi_umount_cb(uint8_t idx) {
+  (void) idx;
+  umount_count++;
+}
+
+void tuh_midi_rx_cb(uint8_t idx, uint32_t num_packets) {
+  (void) idx;
+  rx_cb_packets += num_packets;
+}
+
+//--------------------------------------------------------------------+
+// Bus
+//--------------------------------------------------------------------+
+
+// Complete a bulk transfer when both host and device have one pending, return true if any
+static bool bus_bulk(uint8_t ep_addr) {
+  bool const dev_is_src = (tu_edpt_dir(ep_addr) == TUSB_DIR_IN);
+  fake_xfer_t* dev = get_xfer(dev_xfer, ep_addr);
+  fake_xfer_t* host = get_xfer(host_xfer, ep_addr);
+  if (!dev->pending || !host->pending) return false;
+
+  fake_xfer_t* src = dev_is_src ? dev : host;
+  fake_xfer_t* dst = dev_is_src ? host : dev;
+  uint16_t const n = tu_min16(src->len, dst->len);
+  if (n) memcpy(dst->buffer, src->buffer, n);
+
+  dev->pending = false;
+  host->pending = false;
+
+  midid_xfer_cb(0, ep_addr, XFER_RESULT_SUCCESS, n);
+  midih_xfer_cb(DADDR, ep_addr, XFER_RESULT_SUCCESS, n);
+  return true;
+}
+
+static void bus_run(void) {
+  while (bus_bulk(EP_OUT) || bus_bulk(EP_IN)) {}
+}
+
+static uint8_t host_idx(void) {
+  return tuh_midi_itf_get_index(DADDR);
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+
+void setUp(void) {
+  usbd_edpt_open_StubWithCallback(stub_usbd_edpt_open);
+  usbd_edpt_claim_StubWithCallback(stub_usbd_edpt_claim);
+  usbd_edpt_release_StubWithCallback(stub_usbd_edpt_release);
+  usbd_edpt_xfer_StubWithCallback(stub_usbd_edpt_xfer);
+
+  tuh_edpt_open_StubWithCallback(stub_tuh_edpt_open);
+  usbh_edpt_claim_StubWithCallback(stub_usbh_edpt_claim);
+  usbh_edpt_release_StubWithCallback(stub_usbh_edpt_release);
+  usbh_edpt_xfer_with_callback_StubWithCallback(stub_usbh_edpt_xfer_with_callback);
+  usbh_defer_func_StubWithCallback(stub_usbh_defer_func);
+  usbh_driver_set_config_complete_StubWithCallback(stub_usbh_driver_set_config_complete);
+
+  memset(dev_xfer, 0, sizeof(dev_xfer));
+  memset(host_xfer, 0, sizeof(host_xfer));
+  config_complete = false;
+  mount_count = 0;
+  umount_count = 0;
+  rx_cb_packets = 0;
+
+  midid_init();
+  midih_init();
+
+  TEST_ASSERT_EQUAL(DESC_LEN, midid_open(0, DESC_ITF, DESC_LEN));
+  TEST_ASSERT_TRUE(midih_open(0, DADDR, DESC_ITF, DESC_LEN));
+  TEST_ASSERT_TRUE(midih_set_config(DADDR, ITF_AC));
+}
+
+void tearDown(void) {
+  midih_close(DADDR);
+  midid_reset(0);
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+void test_enumerate(void) {
+  uint8_t const idx = host_idx();
+
+  TEST_ASSERT_TRUE(config_complete);
+  TEST_ASSERT_EQUAL(1, mount_count);
+  TEST_ASSERT_TRUE(tuh_midi_mounted(idx));
+  TEST_ASSERT_EQUAL(2, tuh_midi_rx_cable_count(idx));
+  TEST_ASSERT_EQUAL(2, tuh_midi_tx_cable_count(idx));
+  TEST_ASSERT_EQUAL(0, tuh_midi_available(idx));
+
+  // IN endpoint is armed with one max packet
+  TEST_ASSERT_TRUE(get_xfer(host_xfer, EP_IN)->pending);
+  TEST_ASSERT_EQUAL(EP_SIZE, get_xfer(host_xfer, EP_IN)->len);
+
+  midih_close(DADDR);
+  TEST_ASSERT_EQUAL(1, umount_count);
+  TEST_ASSERT_FALSE(tuh_midi_mounted(idx));
+  TEST_ASSERT_EQUAL(TUSB_INDEX_INVALID_8, host_idx());
+}
+
+void test_host_packet_write(void) {
+  uint8_t const idx = host_idx();
+
+  // more than one transfer worth of packets
+  uint8_t packets[40*4];
+  for (uint8_t i = 0; i < 40; i++) {
+    packets[4*i + 0] = (uint8_t) (((i & 1) << 4) | MIDI_CIN_NOTE_ON);
+    packets[4*i + 1] = 0x90;
+    packets[4*i + 2] = i;
+    packets[4*i + 3] = 0x7f;
+  }
+  TEST_ASSERT_EQUAL(40, tuh_midi_packet_write_n(idx, packets, 40));
+  bus_run();
+
+  uint8_t received[40*4];
+  for (uint8_t i = 0; i < 40; i++) {
+    TEST_ASSERT_TRUE(tud_midi_n_packet_read(0, received + 4*i));
+  }
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(packets, received, sizeof(packets));
+  TEST_ASSERT_FALSE(tud_midi_n_packet_read(0, received));
+}
+
+void test_host_stream_write_per_cable(void) {
+  uint8_t const idx = host_idx();
+
+  // note on of cable 0 is interrupted by a control change on cable 1
+  uint8_t const note_on[] = { 0x90, 0x3c, 0x40 };
+  uint8_t const cc[] = { 0xb1, 0x07, 0x64 };
+  TEST_ASSERT_EQUAL(2, tuh_midi_stream_write(idx, 0, note_on, 2));
+  TEST_ASSERT_EQUAL(3, tuh_midi_stream_write(idx, 1, cc, 3));
+  TEST_ASSERT_EQUAL(1, tuh_midi_stream_write(idx, 0, note_on + 2, 1));
+
+  // SysEx spanning several packets
+  uint8_t const sysex[] = { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7 };
+  TEST_ASSERT_EQUAL(sizeof(sysex), tuh_midi_stream_write(idx, 1, sysex, sizeof(sysex)));
+  bus_run();
+
+  uint8_t const expected[][4] = {
+    { 0x10 | MIDI_CIN_CONTROL_CHANGE, 0xb1, 0x07, 0x64 },
+    { 0x00 | MIDI_CIN_NOTE_ON, 0x90, 0x3c, 0x40 },
+    { 0x10 | MIDI_CIN_SYSEX_START, 0xf0, 0x7e, 0x7f },
+    { 0x10 | MIDI_CIN_SYSEX_END_3BYTE, 0x06, 0x01, 0xf7 },
+  };
+
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(expected); i++) {
+    uint8_t packet[4];
+    TEST_ASSERT_TRUE(tud_midi_n_packet_read(0, packet));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected[i], packet, 4);
+  }
+}
+
+void test_host_stream_read_multi_cable(void) {
+  uint8_t const idx = host_idx();
+
+  uint8_t const packets[] = {
+    0x00 | MIDI_CIN_NOTE_ON, 0x90, 0x3c, 0x40,
+    0x00 | MIDI_CIN_PROGRAM_CHANGE, 0xc0, 0x05, 0x00,
+    0x10 | MIDI_CIN_NOTE_OFF, 0x81, 0x3c, 0x00,
+    0x00 | MIDI_CIN_1BYTE_DATA, 0xf8, 0x00, 0x00,
+  };
+  TEST_ASSERT_EQUAL(4, tud_midi_n_packet_write_n(0, packets, 4));
+  bus_run();
+
+  TEST_ASSERT_EQUAL(4, rx_cb_packets);
+  TEST_ASSERT_EQUAL(sizeof(packets), tuh_midi_available(idx));
+
+  // each read stops before bytes of another cable
+  uint8_t buf[16];
+  uint8_t cable = 0xff;
+  TEST_ASSERT_EQUAL(5, tuh_midi_stream_read(idx, &cable, buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL(0, cable);
+  uint8_t const msg0[] = { 0x90, 0x3c, 0x40, 0xc0, 0x05 };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(msg0, buf, sizeof(msg0));
+
+  TEST_ASSERT_EQUAL(3, tuh_midi_stream_read(idx, &cable, buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL(1, cable);
+  uint8_t const msg1[] = { 0x81, 0x3c, 0x00 };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(msg1, buf, sizeof(msg1));
+
+  // partial read of a packet
+  TEST_ASSERT_EQUAL(1, tuh_midi_stream_read(idx, &cable, buf, 1));
+  TEST_ASSERT_EQUAL(0, cable);
+  TEST_ASSERT_EQUAL_HEX8(0xf8, buf[0]);
+  TEST_ASSERT_EQUAL(0, tuh_midi_stream_read(idx, &cable, buf, sizeof(buf)));
+}
+
+void test_rx_padding_skipped(void) {
+  uint8_t const idx = host_idx();
+
+  uint8_t const packets[] = {
+    0x00 | MIDI_CIN_NOTE_ON, 0x90, 0x3c, 0x40,
+    0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00,
+    0x10 | MIDI_CIN_NOTE_OFF, 0x81, 0x3c, 0x00,
+  };
+  TEST_ASSERT_EQUAL(4, tud_midi_n_packet_write_n(0, packets, 4));
+  bus_run();
+
+  TEST_ASSERT_EQUAL(2, rx_cb_packets);
+  uint8_t received[8];
+  TEST_ASSERT_EQUAL(2, tuh_midi_packet_read_n(idx, received, 4));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(packets, received, 4);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(packets + 12, received + 4, 4);
+}
+
+void test_rx_double_buffered(void) {
+  uint8_t const idx = host_idx();
+  fake_xfer_t* host_in = get_xfer(host_xfer, EP_IN);
+
+  uint8_t packets[EP_SIZE];
+  for (uint8_t i = 0; i < EP_SIZE/4; i++) {
+    packets[4*i + 0] = MIDI_CIN_CONTROL_CHANGE;
+    packets[4*i + 1] = 0xb0;
+    packets[4*i + 2] = i;
+    packets[4*i + 3] = 0;
+  }
+
+  // IN endpoint is re-armed with the other buffer as soon as a transfer completes
+  uint8_t* first = host_in->buffer;
+  TEST_ASSERT_EQUAL(EP_SIZE/4, tud_midi_n_packet_write_n(0, packets, EP_SIZE/4));
+  TEST_ASSERT_TRUE(bus_bulk(EP_IN));
+  TEST_ASSERT_TRUE(host_in->pending);
+  TEST_ASSERT_TRUE(host_in->buffer != first);
+  TEST_ASSERT_EQUAL(EP_SIZE, tuh_midi_available(idx));
+}
+
+void test_rx_flow_control(void) {
+  uint8_t const idx = host_idx();
+  fake_xfer_t* host_in = get_xfer(host_xfer, EP_IN);
+
+  // device sends a sequence of packets while host application does not read
+  uint32_t sent = 0;
+  for (uint32_t i = 0; i < 200 && sent < 256; i++) {
+    uint8_t packet[4] = { MIDI_CIN_CONTROL_CHANGE, 0xb0, (uint8_t) (sent & 0x7f), (uint8_t) (sent >> 7) };
+    if (tud_midi_n_packet_write(0, packet)) sent++;
+    bus_run();
+  }
+
+  // RX FIFO is full: endpoint is paused instead of losing events
+  TEST_ASSERT_FALSE(host_in->pending);
+  TEST_ASSERT_TRUE(tuh_midi_available(idx) <= CFG_TUH_MIDI_RX_BUFSIZE);
+
+  // reading resumes the endpoint, all events arrive in order
+  uint32_t received = 0;
+  while (received < sent) {
+    uint8_t packet[4];
+    if (tuh_midi_packet_read(idx, packet)) {
+      TEST_ASSERT_EQUAL_HEX8(received & 0x7f, packet[2]);
+      TEST_ASSERT_EQUAL_HEX8(received >> 7, packet[3]);
+      received++;
+    } else {
+      TEST_ASSERT_TRUE(host_in->pending);
+      TEST_ASSERT_TRUE(bus_bulk(EP_IN));
+    }
+  }
+  TEST_ASSERT_EQUAL(sent, rx_cb_packets);
+}
@@ -0,0 +1,369 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Block cache layer against a RAM disk behind a mocked MSC host driver. Commands are queued and completed by the
+// task hook (tuh_task), like the real driver.
+
+#include <string.h>
+#include "unity.h"
+
+// Files to test
+#include "msc_blk.h"
+
+// Mock File
+#include "mock_usbh.h"
+#include "mock_msc_host.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum {
+  DADDR        = 1,
+  LUN          = 0,
+  SECTOR_SIZE  = CFG_MSC_BLK_SECTOR_SIZE,
+  LINE_SECTORS = CFG_MSC_BLK_LINE_SECTORS,
+  DISK_SECTORS = 6*LINE_SECTORS + LINE_SECTORS/2, // last line is partial
+  QUEUE_SIZE   = 4,
+};
+
+typedef struct {
+  bool is_read;
+  uint8_t* buffer;
+  uint64_t lba;
+  uint32_t count;
+  tuh_msc_complete_cb_t complete_cb;
+  uintptr_t arg;
+} fake_cmd_t;
+
+static uint8_t disk[DISK_SECTORS][SECTOR_SIZE];
+
+static fake_cmd_t cmd_queue[QUEUE_SIZE];
+static uint8_t cmd_count;
+
+static uint32_t read_cmds;
+static uint32_t write_cmds;
+static uint32_t task_calls;
+static bool write_fail;       // device fails write commands
+static bool full_after_read;  // command queue becomes full once a read completes
+static bool queue_full;
+
+//--------------------------------------------------------------------+
+// Fake MSC driver
+//--------------------------------------------------------------------+
+
+static bool stub_tuh_msc_mounted(uint8_t daddr, int num_calls) {
+  (void) num_calls;
+  return daddr == DADDR;
+}
+
+static bool stub_tuh_msc_ready(uint8_t daddr, int num_calls) {
+  (void) num_calls;
+  return daddr == DADDR && !queue_full && cmd_count < QUEUE_SIZE;
+}
+
+static uint64_t stub_tuh_msc_get_block_count64(uint8_t daddr, uint8_t lun, int num_calls) {
+  (void) daddr; (void) lun; (void) num_calls;
+  return DISK_SECTORS;
+}
+
+static uint32_t stub_tuh_msc_get_block_size(uint8_t daddr, uint8_t lun, int num_calls) {
+  (void) daddr; (void) lun; (void) num_calls;
+  return SECTOR_SIZE;
+}
+
+static bool queue_cmd(bool is_read, void* buffer, uint64_t lba, uint32_t count, tuh_msc_complete_cb_t complete_cb,
+                      uintptr_t arg) {
+  if (cmd_count >= QUEUE_SIZE) return false;
+  TEST_ASSERT_TRUE(count > 0 && lba + count <= DISK_SECTORS);
+
+  cmd_queue[cmd_count++] = (fake_cmd_t) {
+    .is_read = is_read, .buffer = (uint8_t*) buffer, .lba = lba, .count = count, .complete_cb = complete_cb, .arg = arg
+  };
+  if (is_read) {
+    read_cmds++;
+  } else {
+    write_cmds++;
+  }
+  return true;
+}
+
+static bool stub_tuh_msc_read10(uint8_t daddr, uint8_t lun, void* buffer, uint32_t lba, uint16_t block_count,
+                                tuh_msc_complete_cb_t complete_cb, uintptr_t arg, int num_calls) {
+  (void) daddr; (void) lun; (void) num_calls;
+  return queue_cmd(true, buffer, lba, block_count, complete_cb, arg);
+}
+
+static bool stub_tuh_msc_write10(uint8_t daddr, uint8_t lun, void const* buffer, uint32_t lba, uint16_t block_count,
+                                 tuh_msc_complete_cb_t complete_cb, uintptr_t arg, int num_calls) {
+  (void) daddr; (void) lun; (void) num_calls;
+  return queue_cmd(false, (void*) (uintptr_t) buffer, lba, block_count, complete_cb, arg);
+}
+
+// complete the oldest command
+static void stub_tuh_task_ext(uint32_t timeout_ms, bool in_isr, int num_calls) {
+  (void) timeout_ms; (void) in_isr; (void) num_calls;
+  task_calls++;
+  if (!cmd_count) {
+    queue_full = false; // slot used by other application becomes free
+    return;
+  }
+
+  fake_cmd_t const cmd = cmd_queue[0];
+  cmd_count--;
+  memmove(cmd_queue, cmd_queue + 1, cmd_count * sizeof(fake_cmd_t));
+
+  uint8_t status = MSC_CSW_STATUS_PASSED;
+  if (cmd.is_read) {
+    memcpy(cmd.buffer, disk[cmd.lba], cmd.count * SECTOR_SIZE);
+    if (full_after_read) queue_full = true;
+  } else if (write_fail) {
+    status = MSC_CSW_STATUS_FAILED;
+  } else {
+    memcpy(disk[cmd.lba], cmd.buffer, cmd.count * SECTOR_SIZE);
+  }
+
+  msc_cbw_t const cbw = { .signature = MSC_CBW_SIGNATURE };
+  msc_csw_t const csw = { .signature = MSC_CSW_SIGNATURE, .status = status };
+  tuh_msc_complete_data_t const cb_data = { .cbw = &cbw, .csw = &csw, .scsi_data = cmd.buffer, .user_arg = cmd.arg };
+  cmd.complete_cb(DADDR, &cb_data);
+}
+
+static void fill_sector(uint8_t* buf, uint64_t lba, uint8_t seed) {
+  for (uint32_t i = 0; i < SECTOR_SIZE; i++) buf[i] = (uint8_t) (lba * 7 + i + seed);
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+
+void setUp(void) {
+  tuh_msc_mounted_StubWithCallback(stub_tuh_msc_mounted);
+  tuh_msc_ready_StubWithCallback(stub_tuh_msc_ready);
+  tuh_msc_get_block_count64_StubWithCallback(stub_tuh_msc_get_block_count64);
+  tuh_msc_get_block_size_StubWithCallback(stub_tuh_msc_get_block_size);
+  tuh_msc_read10_StubWithCallback(stub_tuh_msc_read10);
+  tuh_msc_write10_StubWithCallback(stub_tuh_msc_write10);
+  tuh_task_ext_StubWithCallback(stub_tuh_task_ext);
+
+  for (uint32_t lba = 0; lba < DISK_SECTORS; lba++) fill_sector(disk[lba], lba, 0);
+  cmd_count = 0;
+  read_cmds = 0;
+  write_cmds = 0;
+  task_calls = 0;
+  write_fail = false;
+  full_after_read = false;
+  queue_full = false;
+
+  msc_blk_init();
+}
+
+void tearDown(void) {
+  msc_blk_detach(DADDR);
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+void test_read_cached(void) {
+  uint8_t buf[SECTOR_SIZE];
+
+  // whole line is read once, other sectors of the line come from cache (backward: no read-ahead)
+  for (uint32_t lba = LINE_SECTORS - 1; lba >= 3; lba--) {
+    TEST_ASSERT_TRUE(msc_blk_read(DADDR, LUN, buf, lba, 1));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(disk[lba], buf, SECTOR_SIZE);
+  }
+  TEST_ASSERT_EQUAL(1, read_cmds);
+}
+
+void test_read_large_bypass(void) {
+  static uint8_t buf[2*LINE_SECTORS][SECTOR_SIZE];
+
+  TEST_ASSERT_TRUE(msc_blk_read(DADDR, LUN, buf, 1, 2*LINE_SECTORS));
+  TEST_ASSERT_EQUAL(1, read_cmds);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(disk[1], buf, sizeof(buf));
+}
+
+void test_read_ahead(void) {
+  uint8_t buf[SECTOR_SIZE];
+
+  TEST_ASSERT_TRUE(msc_blk_read(DADDR, LUN, buf, 3, 1));
+  TEST_ASSERT_EQUAL(1, read_cmds);
+
+  // sequential read prefetches the next line without waiting for it
+  TEST_ASSERT_TRUE(msc_blk_read(DADDR, LUN, buf, 4, 1));
+  TEST_ASSERT_EQUAL(2, read_cmds);
+  TEST_ASSERT_EQUAL(1, cmd_count);
+  TEST_ASSERT_EQUAL(LINE_SECTORS, cmd_queue[0].lba);
+
+  // prefetched line is served without another command
+  TEST_ASSERT_TRUE(msc_blk_read(DADDR, LUN, buf, LINE_SECTORS, 1));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(disk[LINE_SECTORS], buf, SECTOR_SIZE);
+  TEST_ASSERT_EQUAL(2, read_cmds);
+}
+
+void test_read_ahead_skipped_when_queue_full(void) {
+  uint8_t buf[SECTOR_SIZE];
+
+  // command queue is full once the requested line is read: read-ahead must not wait for a free slot
+  full_after_read = true;
+  TEST_ASSERT_TRUE(msc_blk_read(DADDR, LUN, buf, 3, 1));
+  uint32_t const calls = task_calls;
+
+  TEST_ASSERT_TRUE(msc_blk_read(DADDR, LUN, buf, 4, 1));
+  TEST_ASSERT_EQUAL(1, read_cmds);
+  TEST_ASSERT_EQUAL(calls, task_calls);
+  TEST_ASSERT_EQUAL(0, cmd_count);
+}
+
+void test_write_behind(void) {
+  uint8_t buf[SECTOR_SIZE];
+
+  // partially written line is held in cache
+  for (uint32_t lba = 0; lba < LINE_SECTORS - 1; lba++) {
+    fill_sector(buf, lba, 1);
+    TEST_ASSERT_TRUE(msc_blk_write(DADDR, LUN, buf, lba, 1));
+  }
+  TEST_ASSERT_EQUAL(0, write_cmds);
+
+  // completely written line is written right away
+  fill_sector(buf, LINE_SECTORS - 1, 1);
+  TEST_ASSERT_TRUE(msc_blk_write(DADDR, LUN, buf, LINE_SECTORS - 1, 1));
+  TEST_ASSERT_EQUAL(1, write_cmds);
+  TEST_ASSERT_EQUAL(0, read_cmds);
+
+  TEST_ASSERT_TRUE(msc_blk_sync(DADDR, LUN));
+  TEST_ASSERT_EQUAL(1, write_cmds);
+  for (uint32_t lba = 0; lba < LINE_SECTORS; lba++) {
+    fill_sector(buf, lba, 1);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(buf, disk[lba], SECTOR_SIZE);
+  }
+}
+
+void test_write_partial_last_line(void) {
+  uint8_t buf[SECTOR_SIZE];
+  uint32_t const last_line = DISK_SECTORS - (DISK_SECTORS % LINE_SECTORS);
+
+  // last line is complete when sectors up to capacity are written
+  for (uint32_t lba = last_line; lba < DISK_SECTORS; lba++) {
+    fill_sector(buf, lba, 2);
+    TEST_ASSERT_TRUE(msc_blk_write(DADDR, LUN, buf, lba, 1));
+  }
+  TEST_ASSERT_EQUAL(1, write_cmds);
+  TEST_ASSERT_TRUE(msc_blk_sync(DADDR, LUN));
+
+  fill_sector(buf, DISK_SECTORS - 1, 2);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(buf, disk[DISK_SECTORS - 1], SECTOR_SIZE);
+}
+
+void test_write_beyond_capacity(void) {
+  uint8_t buf[SECTOR_SIZE] = { 0 };
+
+  // line beyond capacity has no sector: nothing is written to device
+  uint32_t const lba = DISK_SECTORS - (DISK_SECTORS % LINE_SECTORS) + LINE_SECTORS;
+  msc_blk_write(DADDR, LUN, buf, lba, 1);
+  TEST_ASSERT_EQUAL(0, write_cmds);
+}
+
+void test_failed_write_stays_dirty(void) {
+  uint8_t buf[SECTOR_SIZE];
+
+  fill_sector(buf, 2, 3);
+  TEST_ASSERT_TRUE(msc_blk_write(DADDR, LUN, buf, 2, 1));
+
+  // failed write is reported and kept
+  write_fail = true;
+  TEST_ASSERT_FALSE(msc_blk_sync(DADDR, LUN));
+  TEST_ASSERT_EQUAL(1, write_cmds);
+
+  // cached data is still readable and is not overwritten by a fill
+  uint8_t read_buf[SECTOR_SIZE];
+  TEST_ASSERT_TRUE(msc_blk_read(DADDR, LUN, read_buf, 2, 1));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(buf, read_buf, SECTOR_SIZE);
+
+  // retried by next sync
+  write_fail = false;
+  TEST_ASSERT_TRUE(msc_blk_sync(DADDR, LUN));
+  TEST_ASSERT_EQUAL(2, write_cmds);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(buf, disk[2], SECTOR_SIZE);
+
+  // nothing left to write
+  TEST_ASSERT_TRUE(msc_blk_sync(DADDR, LUN));
+  TEST_ASSERT_EQUAL(2, write_cmds);
+}
+
+void test_failed_large_write_keeps_cache(void) {
+  static uint8_t large[2 * LINE_SECTORS][SECTOR_SIZE];
+  uint8_t buf[SECTOR_SIZE];
+
+  fill_sector(buf, 2, 3);
+  TEST_ASSERT_TRUE(msc_blk_write(DADDR, LUN, buf, 2, 1));
+  for (uint32_t i = 0; i < 2 * LINE_SECTORS; i++) fill_sector(large[i], i, 5);
+
+  // failed large write does not update cached sectors
+  write_fail = true;
+  TEST_ASSERT_FALSE(msc_blk_write(DADDR, LUN, large, 0, 2 * LINE_SECTORS));
+  TEST_ASSERT_EQUAL(1, write_cmds);
+  write_fail = false;
+
+  uint8_t read_buf[SECTOR_SIZE];
+  TEST_ASSERT_TRUE(msc_blk_read(DADDR, LUN, read_buf, 2, 1));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(buf, read_buf, SECTOR_SIZE);
+
+  // sector written before is still dirty
+  TEST_ASSERT_TRUE(msc_blk_sync(DADDR, LUN));
+  TEST_ASSERT_EQUAL(2, write_cmds);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(buf, disk[2], SECTOR_SIZE);
+
+  // successful large write updates cache, sectors are clean
+  TEST_ASSERT_TRUE(msc_blk_write(DADDR, LUN, large, 0, 2 * LINE_SECTORS));
+  TEST_ASSERT_EQUAL(3, write_cmds);
+  TEST_ASSERT_TRUE(msc_blk_read(DADDR, LUN, read_buf, 2, 1));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(large[2], read_buf, SECTOR_SIZE);
+  TEST_ASSERT_TRUE(msc_blk_sync(DADDR, LUN));
+  TEST_ASSERT_EQUAL(3, write_cmds);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(large[2], disk[2], SECTOR_SIZE);
+}
+
+void test_failed_write_not_evicted(void) {
+  uint8_t buf[SECTOR_SIZE];
+
+  fill_sector(buf, 0, 4);
+  TEST_ASSERT_TRUE(msc_blk_write(DADDR, LUN, buf, 0, 1));
+
+  // evicting the dirty line fails while it cannot be written
+  write_fail = true;
+  for (uint32_t i = 1; i <= CFG_MSC_BLK_CACHE_LINES; i++) {
+    uint8_t other[SECTOR_SIZE];
+    msc_blk_read(DADDR, LUN, other, i * LINE_SECTORS, 1);
+  }
+
+  write_fail = false;
+  TEST_ASSERT_FALSE(msc_blk_sync(DADDR, LUN)); // reports the earlier failure
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(buf, disk[0], SECTOR_SIZE);
+  TEST_ASSERT_TRUE(msc_blk_sync(DADDR, LUN));
+}
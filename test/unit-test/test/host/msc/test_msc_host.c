@@ -0,0 +1,361 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <string.h>
+#include "unity.h"
+
+// Files to test
+#include "osal/osal.h"
+#include "tusb_fifo.h"
+#include "tusb.h"
+#include "msc_host.h"
+
+// Mock File
+#include "mock_usbd.h"
+#include "mock_usbd_pvt.h"
+#include "mock_usbh.h"
+#include "mock_usbh_pvt.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum {
+  DADDR   = 1,
+  ITF_NUM = 0,
+  EP_OUT  = 0x01,
+  EP_IN   = 0x81,
+};
+
+uint8_t const desc_msc[] = {
+  // Interface
+  9, TUSB_DESC_INTERFACE, ITF_NUM, 0, 2, TUSB_CLASS_MSC, MSC_SUBCLASS_SCSI, MSC_PROTOCOL_BOT, 0,
+  // Endpoint Out & In
+  7, TUSB_DESC_ENDPOINT, EP_OUT, TUSB_XFER_BULK, U16_TO_U8S_LE(64), 0,
+  7, TUSB_DESC_ENDPOINT, EP_IN, TUSB_XFER_BULK, U16_TO_U8S_LE(64), 0,
+};
+
+typedef struct {
+  uint8_t* buffer;
+  uint16_t len;
+  bool pending;
+  bool claimed;
+} fake_xfer_t;
+
+static fake_xfer_t xfer_out;
+static fake_xfer_t xfer_in;
+static bool xfer_fail;  // next transfers are rejected by usbh
+static uint8_t xfer_fail_ep; // next transfers on this endpoint are rejected by usbh
+static bool claim_fail; // next endpoint claims fail
+
+// completed commands
+static struct {
+  uintptr_t arg;
+  uint8_t status;
+  bool next_cbw_sent; // CBW of next command is already out when callback is invoked
+} done[16];
+static uint8_t done_count;
+
+static fake_xfer_t* get_xfer(uint8_t ep_addr) {
+  return (ep_addr == EP_OUT) ? &xfer_out : &xfer_in;
+}
+
+//--------------------------------------------------------------------+
+// Host stack
+//--------------------------------------------------------------------+
+
+static bool stub_tuh_edpt_open(uint8_t daddr, tusb_desc_endpoint_t const* desc_ep, int num_calls) {
+  (void) daddr; (void) desc_ep; (void) num_calls;
+  return true;
+}
+
+static bool stub_tuh_control_xfer(tuh_xfer_t* xfer, int num_calls) {
+  (void) xfer; (void) num_calls;
+  return true; // Get Max LUN is never completed: command queue only needs configured interface
+}
+
+static bool stub_usbh_edpt_claim(uint8_t daddr, uint8_t ep_addr, int num_calls) {
+  (void) daddr; (void) num_calls;
+  fake_xfer_t* xfer = get_xfer(ep_addr);
+  if (claim_fail || xfer->claimed || xfer->pending) return false;
+  xfer->claimed = true;
+  return true;
+}
+
+static bool stub_usbh_edpt_release(uint8_t daddr, uint8_t ep_addr, int num_calls) {
+  (void) daddr; (void) num_calls;
+  fake_xfer_t* xfer = get_xfer(ep_addr);
+  TEST_ASSERT_TRUE_MESSAGE(xfer->claimed, "release endpoint which is not claimed");
+  xfer->claimed = false;
+  return true;
+}
+
+static bool stub_usbh_edpt_xfer_with_callback(uint8_t daddr, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes,
+                                              tuh_xfer_cb_t complete_cb, uintptr_t user_data, int num_calls) {
+  (void) daddr; (void) complete_cb; (void) user_data; (void) num_calls;
+  if (xfer_fail || ep_addr == xfer_fail_ep) return false;
+
+  fake_xfer_t* xfer = get_xfer(ep_addr);
+  TEST_ASSERT_FALSE(xfer->pending);
+  *xfer = (fake_xfer_t) { .buffer = buffer, .len = total_bytes, .pending = true };
+  return true;
+}
+
+static bool complete_cb(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  TEST_ASSERT_EQUAL(DADDR, daddr);
+  TEST_ASSERT_LESS_THAN(TU_ARRAY_SIZE(done), done_count);
+  done[done_count].arg = cb_data->user_arg;
+  done[done_count].status = cb_data->csw->status;
+  done[done_count].next_cbw_sent = xfer_out.pending;
+  done_count++;
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Device
+//--------------------------------------------------------------------+
+
+static msc_cbw_t const* pending_cbw(void) {
+  TEST_ASSERT_TRUE(xfer_out.pending);
+  TEST_ASSERT_EQUAL(sizeof(msc_cbw_t), xfer_out.len);
+  return (msc_cbw_t const*) xfer_out.buffer;
+}
+
+// Device receives CBW, host queues CSW
+static void device_receive_cbw(void) {
+  (void) pending_cbw();
+  xfer_out.pending = false;
+  TEST_ASSERT_TRUE(msch_xfer_cb(DADDR, EP_OUT, XFER_RESULT_SUCCESS, sizeof(msc_cbw_t)));
+}
+
+static void device_send_csw(uint8_t status) {
+  TEST_ASSERT_TRUE(xfer_in.pending);
+  TEST_ASSERT_EQUAL(sizeof(msc_csw_t), xfer_in.len);
+  msc_csw_t const csw = {
+    .signature    = MSC_CSW_SIGNATURE,
+    .tag          = 0,
+    .data_residue = 0,
+    .status       = status
+  };
+  memcpy(xfer_in.buffer, &csw, sizeof(csw));
+  xfer_in.pending = false;
+  TEST_ASSERT_TRUE(msch_xfer_cb(DADDR, EP_IN, XFER_RESULT_SUCCESS, sizeof(msc_csw_t)));
+}
+
+static void device_complete_command(uint8_t status) {
+  device_receive_cbw();
+  device_send_csw(status);
+}
+
+static bool submit(uint8_t arg) {
+  msc_cbw_t cbw;
+  tu_memclr(&cbw, sizeof(cbw));
+  cbw.signature  = MSC_CBW_SIGNATURE;
+  cbw.tag        = arg;
+  cbw.dir        = TUSB_DIR_OUT;
+  cbw.cmd_len    = sizeof(scsi_test_unit_ready_t);
+  cbw.command[0] = SCSI_CMD_TEST_UNIT_READY;
+  return tuh_msc_scsi_command(DADDR, &cbw, NULL, complete_cb, arg);
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+
+void setUp(void) {
+  tuh_edpt_open_StubWithCallback(stub_tuh_edpt_open);
+  tuh_control_xfer_StubWithCallback(stub_tuh_control_xfer);
+  usbh_edpt_claim_StubWithCallback(stub_usbh_edpt_claim);
+  usbh_edpt_release_StubWithCallback(stub_usbh_edpt_release);
+  usbh_edpt_xfer_with_callback_StubWithCallback(stub_usbh_edpt_xfer_with_callback);
+
+  tu_memclr(&xfer_out, sizeof(xfer_out));
+  tu_memclr(&xfer_in, sizeof(xfer_in));
+  tu_memclr(done, sizeof(done));
+  done_count = 0;
+  xfer_fail = false;
+  xfer_fail_ep = 0;
+  claim_fail = false;
+
+  msch_init();
+  TEST_ASSERT_TRUE(msch_open(0, DADDR, (tusb_desc_interface_t const*) desc_msc, sizeof(desc_msc)));
+  TEST_ASSERT_TRUE(msch_set_config(DADDR, ITF_NUM));
+}
+
+void tearDown(void) {
+  msch_close(DADDR);
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+void test_submit_while_busy(void) {
+  TEST_ASSERT_TRUE(submit(1));
+  TEST_ASSERT_TRUE(submit(2));
+  TEST_ASSERT_TRUE(submit(3));
+
+  // only one command in flight, others are queued
+  TEST_ASSERT_EQUAL(1, pending_cbw()->tag);
+  TEST_ASSERT_EQUAL(2, tuh_msc_queue_count(DADDR));
+
+  device_complete_command(MSC_CSW_STATUS_PASSED);
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(1, done[0].arg);
+  TEST_ASSERT_EQUAL(MSC_CSW_STATUS_PASSED, done[0].status);
+  TEST_ASSERT_TRUE(done[0].next_cbw_sent);
+  TEST_ASSERT_EQUAL(2, pending_cbw()->tag);
+
+  device_complete_command(MSC_CSW_STATUS_FAILED);
+  device_complete_command(MSC_CSW_STATUS_PASSED);
+
+  TEST_ASSERT_EQUAL(3, done_count);
+  TEST_ASSERT_EQUAL(2, done[1].arg);
+  TEST_ASSERT_EQUAL(MSC_CSW_STATUS_FAILED, done[1].status);
+  TEST_ASSERT_EQUAL(3, done[2].arg);
+  TEST_ASSERT_FALSE(done[2].next_cbw_sent);
+  TEST_ASSERT_FALSE(xfer_out.pending);
+  TEST_ASSERT_EQUAL(0, tuh_msc_queue_count(DADDR));
+}
+
+void test_queue_full(void) {
+  // one in flight and CFG_TUH_MSC_CMD_QUEUE_SIZE queued
+  for (uint8_t i = 0; i < CFG_TUH_MSC_CMD_QUEUE_SIZE + 1; i++) {
+    TEST_ASSERT_TRUE(submit(i));
+  }
+  TEST_ASSERT_EQUAL(CFG_TUH_MSC_CMD_QUEUE_SIZE, tuh_msc_queue_count(DADDR));
+  TEST_ASSERT_FALSE(submit(0xff));
+
+  // completing one makes room for another
+  device_complete_command(MSC_CSW_STATUS_PASSED);
+  TEST_ASSERT_TRUE(submit(CFG_TUH_MSC_CMD_QUEUE_SIZE + 1));
+
+  for (uint8_t i = 1; i < CFG_TUH_MSC_CMD_QUEUE_SIZE + 2; i++) {
+    device_complete_command(MSC_CSW_STATUS_PASSED);
+  }
+
+  TEST_ASSERT_EQUAL(CFG_TUH_MSC_CMD_QUEUE_SIZE + 2, done_count);
+  for (uint8_t i = 0; i < done_count; i++) {
+    TEST_ASSERT_EQUAL(i, done[i].arg);
+  }
+}
+
+void test_failed_transfer_completes_and_drains(void) {
+  TEST_ASSERT_TRUE(submit(1));
+  TEST_ASSERT_TRUE(submit(2));
+  TEST_ASSERT_TRUE(submit(3));
+
+  // CBW of queued commands cannot be sent
+  device_receive_cbw();
+  xfer_fail = true;
+  device_send_csw(MSC_CSW_STATUS_PASSED);
+
+  TEST_ASSERT_EQUAL(3, done_count);
+  TEST_ASSERT_FALSE(xfer_out.claimed);
+  TEST_ASSERT_EQUAL(0, tuh_msc_queue_count(DADDR));
+
+  uint8_t failed = 0;
+  for (uint8_t i = 0; i < done_count; i++) {
+    if (done[i].arg == 1) {
+      TEST_ASSERT_EQUAL(MSC_CSW_STATUS_PASSED, done[i].status);
+    } else {
+      TEST_ASSERT_EQUAL(MSC_CSW_STATUS_FAILED, done[i].status);
+      failed++;
+    }
+  }
+  TEST_ASSERT_EQUAL(2, failed);
+
+  // queue is not stalled
+  xfer_fail = false;
+  TEST_ASSERT_TRUE(submit(4));
+  TEST_ASSERT_EQUAL(4, pending_cbw()->tag);
+  device_complete_command(MSC_CSW_STATUS_PASSED);
+  TEST_ASSERT_EQUAL(4, done_count);
+  TEST_ASSERT_EQUAL(4, done[3].arg);
+}
+
+void test_failed_claim_does_not_release(void) {
+  claim_fail = true;
+  TEST_ASSERT_TRUE(submit(1));
+
+  // completed with failed status, endpoint not released since it was never claimed
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(MSC_CSW_STATUS_FAILED, done[0].status);
+  TEST_ASSERT_FALSE(xfer_out.pending);
+
+  claim_fail = false;
+  TEST_ASSERT_TRUE(submit(2));
+  TEST_ASSERT_EQUAL(2, pending_cbw()->tag);
+  device_complete_command(MSC_CSW_STATUS_PASSED);
+  TEST_ASSERT_EQUAL(2, done_count);
+}
+
+void test_failed_csw_xfer_completes_and_continues(void) {
+  TEST_ASSERT_TRUE(submit(1));
+  TEST_ASSERT_TRUE(submit(2));
+  TEST_ASSERT_TRUE(submit(3));
+
+  // CSW transfer cannot be queued
+  xfer_fail_ep = EP_IN;
+  device_receive_cbw();
+  TEST_ASSERT_EQUAL(1, done_count);
+  TEST_ASSERT_EQUAL(1, done[0].arg);
+  TEST_ASSERT_EQUAL(MSC_CSW_STATUS_FAILED, done[0].status);
+  TEST_ASSERT_TRUE(done[0].next_cbw_sent);
+
+  // CSW is stalled
+  xfer_fail_ep = 0;
+  device_receive_cbw();
+  xfer_in.pending = false;
+  TEST_ASSERT_TRUE(msch_xfer_cb(DADDR, EP_IN, XFER_RESULT_STALLED, 0));
+  TEST_ASSERT_EQUAL(2, done_count);
+  TEST_ASSERT_EQUAL(2, done[1].arg);
+  TEST_ASSERT_EQUAL(MSC_CSW_STATUS_FAILED, done[1].status);
+
+  // queue is not stalled
+  TEST_ASSERT_EQUAL(3, pending_cbw()->tag);
+  device_complete_command(MSC_CSW_STATUS_PASSED);
+  TEST_ASSERT_EQUAL(3, done_count);
+  TEST_ASSERT_EQUAL(MSC_CSW_STATUS_PASSED, done[2].status);
+}
+
+void test_close_completes_pending(void) {
+  TEST_ASSERT_TRUE(submit(1));
+  TEST_ASSERT_TRUE(submit(2));
+  TEST_ASSERT_TRUE(submit(3));
+  device_receive_cbw();
+
+  // command in flight and queued commands are completed in order
+  msch_close(DADDR);
+  TEST_ASSERT_EQUAL(3, done_count);
+  for (uint8_t i = 0; i < done_count; i++) {
+    TEST_ASSERT_EQUAL(i + 1, done[i].arg);
+    TEST_ASSERT_EQUAL(MSC_CSW_STATUS_FAILED, done[i].status);
+  }
+
+  TEST_ASSERT_EQUAL(0, tuh_msc_queue_count(DADDR));
+  TEST_ASSERT_FALSE(submit(4));
+}
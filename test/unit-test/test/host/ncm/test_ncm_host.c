@@ -0,0 +1,662 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Loopback of NCM host driver against NCM device driver: endpoint transfers and control requests of the host
+// are routed to the device driver in-process.
+
+#include <string.h>
+#include "unity.h"
+
+// Files to test
+#include "ncm_host.h"
+#include "net_device.h"
+TEST_FILE("ncm_device.c")
+
+// Mock File
+#include "mock_usbd.h"
+#include "mock_usbd_pvt.h"
+#include "mock_usbh.h"
+#include "mock_usbh_pvt.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum {
+  DADDR      = 1,
+  ITF_NUM    = 0,
+  STRID_MAC  = 4,
+  EP_NOTIF   = 0x81,
+  EP_OUT     = 0x02,
+  EP_IN      = 0x82,
+  EP_SIZE    = 512,
+};
+
+uint8_t const desc_ncm[] = {
+  TUD_CDC_NCM_DESCRIPTOR(ITF_NUM, 0, STRID_MAC, EP_NOTIF, 64, EP_OUT, EP_IN, EP_SIZE, CFG_TUD_NET_MTU)
+};
+
+// skip interface association
+#define DESC_ITF    ((tusb_desc_interface_t const*) (desc_ncm + 8))
+#define DESC_LEN    ((uint16_t) (sizeof(desc_ncm) - 8))
+
+uint8_t tud_network_mac_address[6] = {0x02, 0xCA, 0xFE, 0x00, 0x00, 0x01};
+
+typedef struct {
+  uint8_t* buffer;
+  uint16_t len;
+  uint16_t xferred;
+  bool pending;
+} fake_xfer_t;
+
+// index by endpoint number
+static fake_xfer_t dev_xfer[3][2];
+static fake_xfer_t host_xfer[3][2];
+
+// one control transfer at a time
+static struct {
+  bool pending;
+  tuh_xfer_t xfer;
+  tusb_control_request_t setup;
+  uint16_t const* str; // string descriptor response
+} host_ctrl;
+
+static struct {
+  uint8_t* buffer;
+  uint16_t len;
+} dev_ctrl;
+
+static bool config_complete;
+static bool link_up;
+static uint32_t host_out_xfer_count;
+
+// frames received on each side
+static uint8_t dev_rx[8][CFG_TUD_NET_MTU];
+static uint16_t dev_rx_len[8];
+static uint8_t dev_rx_count;
+static bool dev_rx_renew;
+static uint8_t dev_rx_reject; // number of next frames rejected by device application
+
+static uint8_t host_rx[8][CFG_TUH_NCM_MTU];
+static uint16_t host_rx_len[8];
+static uint8_t host_rx_count;
+static uint8_t const* host_rx_hold; // hold next received frame
+static bool host_rx_release_now;    // hold and release received frames within callback
+
+static fake_xfer_t* get_xfer(fake_xfer_t xfer[3][2], uint8_t ep_addr) {
+  return &xfer[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+}
+
+static void fill_frame(uint8_t* frame, uint16_t size, uint8_t seed) {
+  for (uint16_t i = 0; i < size; i++) {
+    frame[i] = (uint8_t) (seed + i);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Device stack
+//--------------------------------------------------------------------+
+
+static bool stub_usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep, int num_calls) {
+  (void) rhport; (void) desc_ep; (void) num_calls;
+  return true;
+}
+
+static bool stub_usbd_open_edpt_pair(uint8_t rhport, uint8_t const* p_desc, uint8_t ep_count, uint8_t xfer_type,
+                                     uint8_t* ep_out, uint8_t* ep_in, int num_calls) {
+  (void) rhport; (void) xfer_type; (void) num_calls;
+
+  for (uint8_t i = 0; i < ep_count; i++) {
+    tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+    if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
+      *ep_in = desc_ep->bEndpointAddress;
+    } else {
+      *ep_out = desc_ep->bEndpointAddress;
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return true;
+}
+
+static bool stub_usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes, int num_calls) {
+  (void) rhport; (void) num_calls;
+
+  fake_xfer_t* xfer = get_xfer(dev_xfer, ep_addr);
+  TEST_ASSERT_FALSE(xfer->pending);
+  *xfer = (fake_xfer_t) { .buffer = buffer, .len = total_bytes, .xferred = 0, .pending = true };
+  return true;
+}
+
+static bool stub_tud_control_xfer(uint8_t rhport, tusb_control_request_t const* request, void* buffer, uint16_t len,
+                                  int num_calls) {
+  (void) rhport; (void) request; (void) num_calls;
+  dev_ctrl.buffer = (uint8_t*) buffer;
+  dev_ctrl.len = len;
+  return true;
+}
+
+static bool stub_tud_control_status(uint8_t rhport, tusb_control_request_t const* request, int num_calls) {
+  (void) rhport; (void) request; (void) num_calls;
+  dev_ctrl.buffer = NULL;
+  dev_ctrl.len = 0;
+  return true;
+}
+
+bool tud_network_recv_cb(const uint8_t* src, uint16_t size) {
+  if (dev_rx_reject) {
+    dev_rx_reject--;
+    return false;
+  }
+  TEST_ASSERT_LESS_THAN(TU_ARRAY_SIZE(dev_rx), dev_rx_count);
+  memcpy(dev_rx[dev_rx_count], src, size);
+  dev_rx_len[dev_rx_count++] = size;
+  dev_rx_renew = true;
+  return true;
+}
+
+uint16_t tud_network_xmit_cb(uint8_t* dst, void* ref, uint16_t arg) {
+  memcpy(dst, ref, arg);
+  return arg;
+}
+
+//--------------------------------------------------------------------+
+// Host stack
+//--------------------------------------------------------------------+
+
+static bool stub_tuh_edpt_open(uint8_t daddr, tusb_desc_endpoint_t const* desc_ep, int num_calls) {
+  (void) daddr; (void) desc_ep; (void) num_calls;
+  return true;
+}
+
+static bool stub_usbh_edpt_claim(uint8_t daddr, uint8_t ep_addr, int num_calls) {
+  (void) daddr; (void) num_calls;
+  return !get_xfer(host_xfer, ep_addr)->pending;
+}
+
+static bool stub_usbh_edpt_release(uint8_t daddr, uint8_t ep_addr, int num_calls) {
+  (void) daddr; (void) ep_addr; (void) num_calls;
+  return true;
+}
+
+static bool stub_usbh_edpt_xfer_with_callback(uint8_t daddr, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes,
+                                              tuh_xfer_cb_t complete_cb, uintptr_t user_data, int num_calls) {
+  (void) daddr; (void) complete_cb; (void) user_data; (void) num_calls;
+
+  fake_xfer_t* xfer = get_xfer(host_xfer, ep_addr);
+  TEST_ASSERT_FALSE(xfer->pending);
+  *xfer = (fake_xfer_t) { .buffer = buffer, .len = total_bytes, .xferred = 0, .pending = true };
+
+  if (ep_addr == EP_OUT) host_out_xfer_count++;
+  return true;
+}
+
+static bool stub_tuh_control_xfer(tuh_xfer_t* xfer, int num_calls) {
+  (void) num_calls;
+  TEST_ASSERT_FALSE(host_ctrl.pending);
+
+  host_ctrl.pending = true;
+  host_ctrl.xfer    = *xfer;
+  host_ctrl.setup   = *xfer->setup;
+  host_ctrl.str     = NULL;
+  host_ctrl.xfer.setup = &host_ctrl.setup;
+  return true;
+}
+
+static bool stub_tuh_interface_set(uint8_t daddr, uint8_t itf_num, uint8_t itf_alt, tuh_xfer_cb_t complete_cb,
+                                   uintptr_t user_data, int num_calls) {
+  (void) num_calls;
+
+  tusb_control_request_t const request = {
+    .bmRequestType = 0x01,
+    .bRequest      = TUSB_REQ_SET_INTERFACE,
+    .wValue        = itf_alt,
+    .wIndex        = itf_num,
+    .wLength       = 0
+  };
+
+  tuh_xfer_t xfer = {
+    .daddr       = daddr,
+    .setup       = &request,
+    .complete_cb = complete_cb,
+    .user_data   = user_data
+  };
+
+  return stub_tuh_control_xfer(&xfer, 0);
+}
+
+static bool stub_tuh_descriptor_get_string(uint8_t daddr, uint8_t index, uint16_t language_id, void* buffer,
+                                           uint16_t len, tuh_xfer_cb_t complete_cb, uintptr_t user_data,
+                                           int num_calls) {
+  (void) num_calls;
+  static uint16_t const mac_str[] = {
+    (TUSB_DESC_STRING << 8) | 26, '0', '2', 'C', 'A', 'F', 'E', '0', '0', '0', '0', '0', '1'
+  };
+
+  TEST_ASSERT_EQUAL(STRID_MAC, index);
+
+  tusb_control_request_t const request = {
+    .bmRequestType = 0x80,
+    .bRequest      = TUSB_REQ_GET_DESCRIPTOR,
+    .wValue        = (uint16_t) ((TUSB_DESC_STRING << 8) | index),
+    .wIndex        = language_id,
+    .wLength       = len
+  };
+
+  tuh_xfer_t xfer = {
+    .daddr       = daddr,
+    .setup       = &request,
+    .buffer      = buffer,
+    .complete_cb = complete_cb,
+    .user_data   = user_data
+  };
+
+  TEST_ASSERT_TRUE(stub_tuh_control_xfer(&xfer, 0));
+  host_ctrl.str = mac_str;
+  return true;
+}
+
+static void stub_usbh_driver_set_config_complete(uint8_t daddr, uint8_t itf_num, int num_calls) {
+  (void) num_calls;
+  TEST_ASSERT_EQUAL(DADDR, daddr);
+  TEST_ASSERT_EQUAL(ITF_NUM + 1, itf_num);
+  config_complete = true;
+}
+
+void tuh_ncm_link_cb(uint8_t idx, bool connected) {
+  (void) idx;
+  link_up = connected;
+}
+
+void tuh_ncm_rx_cb(uint8_t idx, uint8_t const* frame, uint16_t size) {
+  TEST_ASSERT_LESS_THAN(TU_ARRAY_SIZE(host_rx), host_rx_count);
+  memcpy(host_rx[host_rx_count], frame, size);
+  host_rx_len[host_rx_count++] = size;
+
+  if (host_rx_hold == NULL) {
+    TEST_ASSERT_TRUE(tuh_ncm_rx_hold(idx, frame));
+    host_rx_hold = frame;
+  } else if (host_rx_release_now) {
+    TEST_ASSERT_TRUE(tuh_ncm_rx_hold(idx, frame));
+    tuh_ncm_rx_release(idx, frame);
+
+    // buffer being delivered must not be armed for the next transfer
+    fake_xfer_t const* xfer = get_xfer(host_xfer, EP_IN);
+    TEST_ASSERT_FALSE(xfer->pending && xfer->buffer <= frame && frame < xfer->buffer + xfer->len);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Bus
+//--------------------------------------------------------------------+
+
+// Complete a control transfer of host by running it on the device driver
+static void bus_control(void) {
+  tuh_xfer_t xfer = host_ctrl.xfer;
+  tusb_control_request_t const* setup = &host_ctrl.setup;
+  host_ctrl.pending = false;
+
+  xfer.result = XFER_RESULT_SUCCESS;
+  xfer.actual_len = 0;
+
+  if (host_ctrl.str) {
+    xfer.actual_len = tu_min16(setup->wLength, (uint16_t) (host_ctrl.str[0] & 0xFF));
+    memcpy(xfer.buffer, host_ctrl.str, xfer.actual_len);
+  } else {
+    dev_ctrl.buffer = NULL;
+    dev_ctrl.len = 0;
+
+    if (!netd_control_xfer_cb(0, CONTROL_STAGE_SETUP, setup)) {
+      xfer.result = XFER_RESULT_STALLED;
+    } else {
+      uint16_t const len = tu_min16(dev_ctrl.len, setup->wLength);
+      if (len) {
+        if (setup->bmRequestType_bit.direction == TUSB_DIR_IN) {
+          memcpy(xfer.buffer, dev_ctrl.buffer, len);
+        } else {
+          memcpy(dev_ctrl.buffer, xfer.buffer, len);
+        }
+        xfer.actual_len = len;
+
+        if (!netd_control_xfer_cb(0, CONTROL_STAGE_DATA, setup)) xfer.result = XFER_RESULT_STALLED;
+      }
+      if (xfer.result == XFER_RESULT_SUCCESS) netd_control_xfer_cb(0, CONTROL_STAGE_ACK, setup);
+    }
+  }
+
+  if (xfer.complete_cb) xfer.complete_cb(&xfer);
+}
+
+// Move data from source to destination transfer, a transfer completes when it is done or a short packet is seen
+static bool bus_move(uint8_t ep_addr, fake_xfer_t* src, fake_xfer_t* dst, bool dev_is_src) {
+  if (!(src->pending && dst->pending)) return false;
+
+  uint16_t const n = tu_min16(src->len - src->xferred, dst->len - dst->xferred);
+  if (n) memcpy(dst->buffer + dst->xferred, src->buffer + src->xferred, n);
+  src->xferred += n;
+  dst->xferred += n;
+
+  bool const src_done = (src->xferred == src->len);
+  bool const dst_done = (dst->xferred == dst->len) || (src_done && (src->len % EP_SIZE || src->len == 0));
+
+  fake_xfer_t const s = *src;
+  fake_xfer_t const d = *dst;
+  if (src_done) src->pending = false;
+  if (dst_done) dst->pending = false;
+
+  if (dev_is_src) {
+    if (src_done) netd_xfer_cb(0, ep_addr, XFER_RESULT_SUCCESS, s.xferred);
+    if (dst_done) ncmh_xfer_cb(DADDR, ep_addr, XFER_RESULT_SUCCESS, d.xferred);
+  } else {
+    if (src_done) ncmh_xfer_cb(DADDR, ep_addr, XFER_RESULT_SUCCESS, s.xferred);
+    if (dst_done) netd_xfer_cb(0, ep_addr, XFER_RESULT_SUCCESS, d.xferred);
+  }
+
+  return true;
+}
+
+static void bus_run(void) {
+  bool progress = true;
+  while (progress) {
+    progress = false;
+
+    if (host_ctrl.pending) {
+      bus_control();
+      progress = true;
+    }
+
+    progress |= bus_move(EP_OUT, get_xfer(host_xfer, EP_OUT), get_xfer(dev_xfer, EP_OUT), false);
+    progress |= bus_move(EP_IN, get_xfer(dev_xfer, EP_IN), get_xfer(host_xfer, EP_IN), true);
+    progress |= bus_move(EP_NOTIF, get_xfer(dev_xfer, EP_NOTIF), get_xfer(host_xfer, EP_NOTIF), true);
+
+    if (dev_rx_renew) {
+      dev_rx_renew = false;
+      tud_network_recv_renew();
+      progress = true;
+    }
+  }
+}
+
+// Run a control request of host directly on the device driver
+static bool dev_control(uint8_t type, uint8_t request, uint16_t value, uint16_t index, void* data, uint16_t len) {
+  tusb_control_request_t const setup = {
+    .bmRequestType_bit = {
+      .recipient = TUSB_REQ_RCPT_INTERFACE,
+      .type      = type,
+      .direction = (len && request != NCM_SET_NTB_INPUT_SIZE) ? TUSB_DIR_IN : TUSB_DIR_OUT
+    },
+    .bRequest = request,
+    .wValue   = value,
+    .wIndex   = index,
+    .wLength  = len
+  };
+
+  dev_ctrl.buffer = NULL;
+  dev_ctrl.len = 0;
+  if (!netd_control_xfer_cb(0, CONTROL_STAGE_SETUP, &setup)) return false;
+
+  uint16_t const xfer_len = tu_min16(dev_ctrl.len, len);
+  if (xfer_len) {
+    if (setup.bmRequestType_bit.direction == TUSB_DIR_IN) {
+      memcpy(data, dev_ctrl.buffer, xfer_len);
+    } else {
+      memcpy(dev_ctrl.buffer, data, xfer_len);
+    }
+    if (!netd_control_xfer_cb(0, CONTROL_STAGE_DATA, &setup)) return false;
+  }
+  return netd_control_xfer_cb(0, CONTROL_STAGE_ACK, &setup);
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+
+void setUp(void) {
+  usbd_edpt_open_StubWithCallback(stub_usbd_edpt_open);
+  usbd_open_edpt_pair_StubWithCallback(stub_usbd_open_edpt_pair);
+  usbd_edpt_xfer_StubWithCallback(stub_usbd_edpt_xfer);
+  tud_control_xfer_StubWithCallback(stub_tud_control_xfer);
+  tud_control_status_StubWithCallback(stub_tud_control_status);
+
+  tuh_edpt_open_StubWithCallback(stub_tuh_edpt_open);
+  usbh_edpt_claim_StubWithCallback(stub_usbh_edpt_claim);
+  usbh_edpt_release_StubWithCallback(stub_usbh_edpt_release);
+  usbh_edpt_xfer_with_callback_StubWithCallback(stub_usbh_edpt_xfer_with_callback);
+  tuh_control_xfer_StubWithCallback(stub_tuh_control_xfer);
+  tuh_interface_set_StubWithCallback(stub_tuh_interface_set);
+  tuh_descriptor_get_string_StubWithCallback(stub_tuh_descriptor_get_string);
+  usbh_driver_set_config_complete_StubWithCallback(stub_usbh_driver_set_config_complete);
+
+  memset(dev_xfer, 0, sizeof(dev_xfer));
+  memset(host_xfer, 0, sizeof(host_xfer));
+  memset(&host_ctrl, 0, sizeof(host_ctrl));
+  config_complete = false;
+  link_up = false;
+  host_out_xfer_count = 0;
+  dev_rx_count = 0;
+  dev_rx_renew = false;
+  dev_rx_reject = 0;
+  host_rx_count = 0;
+  host_rx_hold = NULL;
+  host_rx_release_now = false;
+
+  netd_init();
+  ncmh_init();
+
+  TEST_ASSERT_EQUAL(DESC_LEN, netd_open(0, DESC_ITF, DESC_LEN));
+  TEST_ASSERT_TRUE(ncmh_open(0, DADDR, DESC_ITF, DESC_LEN));
+  TEST_ASSERT_TRUE(ncmh_set_config(DADDR, ITF_NUM));
+  bus_run();
+}
+
+void tearDown(void) {
+  ncmh_close(DADDR);
+  netd_reset(0);
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+void test_enumerate(void) {
+  uint8_t const idx = tuh_ncm_itf_get_index(DADDR);
+  uint8_t mac[6];
+
+  TEST_ASSERT_TRUE(config_complete);
+  TEST_ASSERT_TRUE(tuh_ncm_mounted(idx));
+  TEST_ASSERT_TRUE(tuh_ncm_is_ncm(idx));
+  TEST_ASSERT_TRUE(link_up);
+
+  TEST_ASSERT_TRUE(tuh_ncm_get_mac(idx, mac));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(tud_network_mac_address, mac, 6);
+
+  // host receive buffer is armed
+  TEST_ASSERT_TRUE(get_xfer(host_xfer, EP_IN)->pending);
+}
+
+void test_host_to_device(void) {
+  uint8_t const idx = tuh_ncm_itf_get_index(DADDR);
+  uint16_t const size[] = {60, 1514, 300, 511};
+  uint8_t frame[CFG_TUH_NCM_MTU];
+
+  // first frame is sent right away, others are aggregated while it is on the bus
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(size); i++) {
+    fill_frame(frame, size[i], i);
+    TEST_ASSERT_TRUE(tuh_ncm_xmit_available(idx, size[i]));
+    TEST_ASSERT_TRUE(tuh_ncm_xmit(idx, frame, size[i]));
+  }
+  TEST_ASSERT_EQUAL(1, host_out_xfer_count);
+
+  bus_run();
+  TEST_ASSERT_EQUAL(2, host_out_xfer_count);
+
+  TEST_ASSERT_EQUAL(TU_ARRAY_SIZE(size), dev_rx_count);
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(size); i++) {
+    fill_frame(frame, size[i], i);
+    TEST_ASSERT_EQUAL(size[i], dev_rx_len[i]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(frame, dev_rx[i], size[i]);
+  }
+}
+
+void test_host_to_device_rejected(void) {
+  uint8_t const idx = tuh_ncm_itf_get_index(DADDR);
+  uint16_t const size[] = {60, 1514, 300};
+  uint8_t frame[CFG_TUH_NCM_MTU];
+
+  // frames not taken by device application are dropped, following frames are still delivered
+  dev_rx_reject = 2;
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(size); i++) {
+    fill_frame(frame, size[i], i);
+    TEST_ASSERT_TRUE(tuh_ncm_xmit(idx, frame, size[i]));
+  }
+  bus_run();
+
+  TEST_ASSERT_EQUAL(0, dev_rx_reject);
+  TEST_ASSERT_EQUAL(1, dev_rx_count);
+  fill_frame(frame, size[2], 2);
+  TEST_ASSERT_EQUAL(size[2], dev_rx_len[0]);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(frame, dev_rx[0], size[2]);
+}
+
+void test_host_reserve_commit(void) {
+  uint8_t const idx = tuh_ncm_itf_get_index(DADDR);
+  uint8_t frame[100];
+
+  uint8_t* buf = tuh_ncm_xmit_reserve(idx, CFG_TUH_NCM_MTU);
+  TEST_ASSERT_NOT_NULL(buf);
+  fill_frame(buf, sizeof(frame), 7);
+  TEST_ASSERT_TRUE(tuh_ncm_xmit_commit(idx, sizeof(frame)));
+
+  bus_run();
+
+  fill_frame(frame, sizeof(frame), 7);
+  TEST_ASSERT_EQUAL(1, dev_rx_count);
+  TEST_ASSERT_EQUAL(sizeof(frame), dev_rx_len[0]);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(frame, dev_rx[0], sizeof(frame));
+}
+
+void test_device_to_host(void) {
+  uint8_t const idx = tuh_ncm_itf_get_index(DADDR);
+  uint16_t const size[] = {1514, 42, 600, 1000, 64};
+  static uint8_t frame[TU_ARRAY_SIZE(size)][CFG_TUD_NET_MTU];
+
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(size); i++) {
+    fill_frame(frame[i], size[i], (uint8_t) (0x80 + i));
+    TEST_ASSERT_TRUE(tud_network_can_xmit(size[i]));
+    tud_network_xmit(frame[i], size[i]);
+  }
+
+  bus_run();
+
+  TEST_ASSERT_EQUAL(TU_ARRAY_SIZE(size), host_rx_count);
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(size); i++) {
+    TEST_ASSERT_EQUAL(size[i], host_rx_len[i]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(frame[i], host_rx[i], size[i]);
+  }
+
+  // first frame is still held and intact while receiving continues in other buffers
+  TEST_ASSERT_NOT_NULL(host_rx_hold);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(frame[0], host_rx_hold, size[0]);
+  TEST_ASSERT_TRUE(get_xfer(host_xfer, EP_IN)->pending);
+
+  tuh_ncm_rx_release(idx, host_rx_hold);
+  TEST_ASSERT_TRUE(get_xfer(host_xfer, EP_IN)->pending);
+}
+
+void test_alt0_resets_ntb_params(void) {
+  uint16_t format = 0;
+  ntb_input_size_t input_size = {.dwNtbInMaxSize = 2048, .wNtbInMaxDatagrams = 1};
+
+  // host switches to NTB32 with another input size while data interface is inactive
+  TEST_ASSERT_TRUE(dev_control(TUSB_REQ_TYPE_STANDARD, TUSB_REQ_SET_INTERFACE, 0, ITF_NUM + 1, NULL, 0));
+  TEST_ASSERT_TRUE(dev_control(TUSB_REQ_TYPE_CLASS, NCM_SET_NTB_FORMAT, NTB_FORMAT_32, ITF_NUM, NULL, 0));
+  TEST_ASSERT_TRUE(dev_control(TUSB_REQ_TYPE_CLASS, NCM_SET_NTB_INPUT_SIZE, 0, ITF_NUM, &input_size, sizeof(input_size)));
+  TEST_ASSERT_TRUE(dev_control(TUSB_REQ_TYPE_STANDARD, TUSB_REQ_SET_INTERFACE, 1, ITF_NUM + 1, NULL, 0));
+
+  TEST_ASSERT_TRUE(dev_control(TUSB_REQ_TYPE_CLASS, NCM_GET_NTB_FORMAT, 0, ITF_NUM, &format, sizeof(format)));
+  TEST_ASSERT_EQUAL(NTB_FORMAT_32, format);
+
+  // host is reset: selecting alternate setting 0 restores the defaults
+  TEST_ASSERT_TRUE(dev_control(TUSB_REQ_TYPE_STANDARD, TUSB_REQ_SET_INTERFACE, 0, ITF_NUM + 1, NULL, 0));
+
+  TEST_ASSERT_TRUE(dev_control(TUSB_REQ_TYPE_CLASS, NCM_GET_NTB_FORMAT, 0, ITF_NUM, &format, sizeof(format)));
+  TEST_ASSERT_EQUAL(NTB_FORMAT_16, format);
+  TEST_ASSERT_TRUE(dev_control(TUSB_REQ_TYPE_CLASS, NCM_GET_NTB_INPUT_SIZE, 0, ITF_NUM, &input_size, sizeof(input_size)));
+  TEST_ASSERT_EQUAL(CFG_TUD_NCM_IN_NTB_MAX_SIZE, input_size.dwNtbInMaxSize);
+  TEST_ASSERT_EQUAL(CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB, input_size.wNtbInMaxDatagrams);
+}
+
+void test_host_rx_release_in_callback(void) {
+  uint8_t const idx = tuh_ncm_itf_get_index(DADDR);
+  uint16_t const size[] = {60, 100, 200};
+  static uint8_t frame[TU_ARRAY_SIZE(size)][CFG_TUD_NET_MTU];
+
+  // first frame is held, leaving a single receive buffer
+  fill_frame(frame[0], size[0], 0x40);
+  tud_network_xmit(frame[0], size[0]);
+  bus_run();
+  TEST_ASSERT_NOT_NULL(host_rx_hold);
+
+  host_rx_release_now = true;
+  for (uint8_t i = 1; i < TU_ARRAY_SIZE(size); i++) {
+    fill_frame(frame[i], size[i], (uint8_t) (0x40 + i));
+    tud_network_xmit(frame[i], size[i]);
+    bus_run();
+  }
+
+  TEST_ASSERT_EQUAL(TU_ARRAY_SIZE(size), host_rx_count);
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(size); i++) {
+    TEST_ASSERT_EQUAL(size[i], host_rx_len[i]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(frame[i], host_rx[i], size[i]);
+  }
+
+  // buffer is armed again once delivered
+  TEST_ASSERT_TRUE(get_xfer(host_xfer, EP_IN)->pending);
+  tuh_ncm_rx_release(idx, host_rx_hold);
+}
+
+void test_host_stalled_endpoints_not_rearmed(void) {
+  fake_xfer_t* rx = get_xfer(host_xfer, EP_IN);
+  fake_xfer_t* notif = get_xfer(host_xfer, EP_NOTIF);
+  TEST_ASSERT_TRUE(rx->pending);
+  TEST_ASSERT_TRUE(notif->pending);
+
+  rx->pending = false;
+  TEST_ASSERT_TRUE(ncmh_xfer_cb(DADDR, EP_IN, XFER_RESULT_STALLED, 0));
+  TEST_ASSERT_FALSE(rx->pending);
+
+  notif->pending = false;
+  TEST_ASSERT_TRUE(ncmh_xfer_cb(DADDR, EP_NOTIF, XFER_RESULT_FAILED, 0));
+  TEST_ASSERT_FALSE(notif->pending);
+
+  // frames sent by device are not received anymore
+  uint8_t frame[60];
+  fill_frame(frame, sizeof(frame), 0);
+  tud_network_xmit(frame, sizeof(frame));
+  bus_run();
+  TEST_ASSERT_EQUAL(0, host_rx_count);
+  TEST_ASSERT_FALSE(rx->pending);
+}